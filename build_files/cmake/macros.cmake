@@ -182,6 +182,30 @@ function(blender_include_dirs_sys
   include_directories(SYSTEM ${_ALL_INCS})
 endfunction()
 
+# Use LZO in a library, appends to its system include and library lists.
+# The bundled minilzo is used unless WITH_SYSTEM_LZO is enabled.
+macro(blender_add_lzo
+  inc_sys_id lib_id
+  )
+  if(WITH_SYSTEM_LZO)
+    list(APPEND ${inc_sys_id}
+      ${LZO_INCLUDE_DIR}
+    )
+    list(APPEND ${lib_id}
+      ${LZO_LIBRARIES}
+    )
+    add_definitions(-DWITH_SYSTEM_LZO)
+  else()
+    list(APPEND ${inc_sys_id}
+      ${CMAKE_SOURCE_DIR}/extern/lzo/minilzo
+    )
+    list(APPEND ${lib_id}
+      extern_minilzo
+    )
+  endif()
+  add_definitions(-DWITH_LZO)
+endmacro()
+
 # Set include paths for header files included with "*.h" syntax.
 # This enables auto-complete suggestions for user header files on Xcode.
 # Build process is not affected since the include paths are the same
@@ -27,6 +27,18 @@
 
 #include "MEM_guardedalloc.h"
 
+/* Small allocations are served from per-thread caches, see "Thread Cache" below.
+ * Comment this to use the system allocator for all allocations. */
+#define USE_THREAD_CACHE
+
+#ifdef USE_THREAD_CACHE
+#  ifdef WIN32
+#    include <windows.h>
+#  else
+#    include <pthread.h>
+#  endif
+#endif
+
 /* to ensure strict conversions */
 #include "../../source/blender/blenlib/BLI_strict_flags.h"
 
@@ -51,12 +63,15 @@ static void (*error_callback)(const char *) = NULL;
 
 enum {
   MEMHEAD_ALIGN_FLAG = 1,
+  /* Block comes from the thread cache. */
+  MEMHEAD_SMALL_FLAG = 2,
 };
 
 #define MEMHEAD_FROM_PTR(ptr) (((MemHead *)ptr) - 1)
 #define PTR_FROM_MEMHEAD(memhead) (memhead + 1)
 #define MEMHEAD_ALIGNED_FROM_PTR(ptr) (((MemHeadAligned *)ptr) - 1)
 #define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & (size_t)MEMHEAD_ALIGN_FLAG)
+#define MEMHEAD_IS_SMALL(memhead) ((memhead)->len & (size_t)MEMHEAD_SMALL_FLAG)
 
 /* Uncomment this to have proper peak counter. */
 #define USE_ATOMIC_MAX
@@ -70,6 +85,352 @@ MEM_INLINE void update_maximum(size_t *maximum_value, size_t value)
 #endif
 }
 
+#ifdef USE_THREAD_CACHE
+
+/* -------------------------------------------------------------------- */
+/** \name Thread Cache
+ *
+ * Every thread allocates small blocks from its own heap, without any locking. A heap has a list
+ * of chunks per size class, a chunk is a #MEM_CHUNK_SIZE region split into blocks of one size.
+ *
+ * Chunks are aligned to their size, so the chunk of a block (and with it the owning heap) is found
+ * from the block address. A block freed by another thread is pushed on a lock-free stack of the
+ * owning heap, the owner collects those blocks when it runs out of free blocks of a size class.
+ *
+ * When a thread exits its heap is abandoned, and adopted by the next new thread, so the chunks
+ * are reused and blocks freed after the thread exited are collected eventually. Allocations made
+ * by the thread after that (from other thread exit handlers) use the system allocator.
+ *
+ * Memory counters only account the requested sizes, as for blocks from the system allocator.
+ * Chunks that become empty are released, a heap only keeps a single spare chunk so that a
+ * size class going back and forth between zero and one block doesn't reallocate its chunk.
+ * \{ */
+
+/* Blocks up to this size (including #MemHead) come from the thread cache. */
+#  define MEM_SMALL_BLOCK_MAX 1024
+#  define MEM_SMALL_BLOCK_ALIGN 16
+#  define MEM_SMALL_LEN_MAX (MEM_SMALL_BLOCK_MAX - sizeof(MemHead))
+#  define MEM_SIZE_CLASS_NUM (MEM_SMALL_BLOCK_MAX / MEM_SMALL_BLOCK_ALIGN)
+
+#  define MEM_CHUNK_SIZE ((size_t)1 << 16)
+/* Keeps blocks aligned to #MEM_SMALL_BLOCK_ALIGN, and the header on its own cache lines. */
+#  define MEM_CHUNK_HEADER_SIZE 128
+
+#  ifdef _MSC_VER
+#    define MEM_THREAD_LOCAL __declspec(thread)
+#  else
+#    define MEM_THREAD_LOCAL __thread
+#  endif
+
+typedef struct MemFreeBlock {
+  struct MemFreeBlock *next;
+} MemFreeBlock;
+
+typedef struct MemChunk {
+  /* Heap that owns this chunk, only its thread allocates from the chunk. */
+  struct MemThreadHeap *heap;
+  /* Neighbors in the list of chunks that have free blocks. */
+  struct MemChunk *prev, *next;
+  /* Blocks freed by the owning thread. */
+  MemFreeBlock *free_blocks;
+  /* Blocks past this point were never used. */
+  char *unused_begin;
+  unsigned int size_class;
+  unsigned int block_size;
+  /* Blocks not in #free_blocks, includes blocks freed by other threads that were not collected. */
+  unsigned int used;
+  bool in_list;
+} MemChunk;
+
+typedef struct MemThreadHeap {
+  /* Chunks with free blocks, per size class. */
+  MemChunk *chunks[MEM_SIZE_CLASS_NUM];
+  /* Empty chunk, reused for any size class. */
+  MemChunk *spare_chunk;
+  /* Blocks freed by other threads. */
+  MemFreeBlock *remote_free;
+  struct MemThreadHeap *next_abandoned;
+} MemThreadHeap;
+
+#  define MEMCHUNK_FROM_BLOCK(block) \
+    ((MemChunk *)((uintptr_t)(block) & ~(uintptr_t)(MEM_CHUNK_SIZE - 1)))
+
+static MEM_THREAD_LOCAL MemThreadHeap *thread_heap = NULL;
+/* Set once the heap of the thread was abandoned, the thread is exiting. */
+static MEM_THREAD_LOCAL bool thread_heap_exited = false;
+
+/* The key is only used to be notified when a thread exits. */
+#  ifdef WIN32
+static DWORD thread_heap_key = FLS_OUT_OF_INDEXES;
+#  else
+static pthread_key_t thread_heap_key;
+#  endif
+static bool thread_heap_key_created = false;
+
+/* Protects #abandoned_heaps and the creation of #thread_heap_key. Only taken when threads
+ * allocate for the first time or exit, a spin lock avoids depending on a threading library. */
+static unsigned int abandoned_heaps_lock = 0;
+static MemThreadHeap *abandoned_heaps = NULL;
+
+static unsigned int totchunk = 0;
+
+MEM_INLINE unsigned int mem_size_class(size_t len)
+{
+  return (unsigned int)((len + sizeof(MemHead) + MEM_SMALL_BLOCK_ALIGN - 1) /
+                        MEM_SMALL_BLOCK_ALIGN) -
+         1;
+}
+
+MEM_INLINE bool memchunk_is_full(const MemChunk *chunk)
+{
+  return chunk->free_blocks == NULL &&
+         chunk->unused_begin + chunk->block_size > (char *)chunk + MEM_CHUNK_SIZE;
+}
+
+static void memchunk_link(MemThreadHeap *heap, MemChunk *chunk)
+{
+  MemChunk **head = &heap->chunks[chunk->size_class];
+  chunk->prev = NULL;
+  chunk->next = *head;
+  if (*head) {
+    (*head)->prev = chunk;
+  }
+  *head = chunk;
+  chunk->in_list = true;
+}
+
+static void memchunk_unlink(MemThreadHeap *heap, MemChunk *chunk)
+{
+  if (chunk->prev) {
+    chunk->prev->next = chunk->next;
+  }
+  else {
+    heap->chunks[chunk->size_class] = chunk->next;
+  }
+  if (chunk->next) {
+    chunk->next->prev = chunk->prev;
+  }
+  chunk->prev = chunk->next = NULL;
+  chunk->in_list = false;
+}
+
+static MemChunk *memchunk_new(MemThreadHeap *heap, unsigned int size_class)
+{
+  MemChunk *chunk = heap->spare_chunk;
+  if (chunk) {
+    heap->spare_chunk = NULL;
+  }
+  else {
+    chunk = (MemChunk *)aligned_malloc(MEM_CHUNK_SIZE, MEM_CHUNK_SIZE);
+    if (UNLIKELY(chunk == NULL)) {
+      return NULL;
+    }
+    atomic_add_and_fetch_u(&totchunk, 1);
+  }
+  chunk->heap = heap;
+  chunk->free_blocks = NULL;
+  chunk->unused_begin = (char *)chunk + MEM_CHUNK_HEADER_SIZE;
+  chunk->size_class = size_class;
+  chunk->block_size = (size_class + 1) * MEM_SMALL_BLOCK_ALIGN;
+  chunk->used = 0;
+  memchunk_link(heap, chunk);
+  return chunk;
+}
+
+static void memchunk_release(MemChunk *chunk)
+{
+  aligned_free(chunk);
+  atomic_sub_and_fetch_u(&totchunk, 1);
+}
+
+/* Free a block of a chunk owned by the calling thread. */
+static void memchunk_free_block(MemThreadHeap *heap, MemChunk *chunk, MemFreeBlock *block)
+{
+  block->next = chunk->free_blocks;
+  chunk->free_blocks = block;
+  chunk->used--;
+
+  if (chunk->used == 0) {
+    if (chunk->in_list) {
+      memchunk_unlink(heap, chunk);
+    }
+    if (heap->spare_chunk == NULL) {
+      heap->spare_chunk = chunk;
+    }
+    else {
+      memchunk_release(chunk);
+    }
+  }
+  else if (!chunk->in_list) {
+    memchunk_link(heap, chunk);
+  }
+}
+
+static void memheap_collect_remote_free(MemThreadHeap *heap)
+{
+  MemFreeBlock *block;
+  do {
+    block = heap->remote_free;
+  } while (atomic_cas_ptr((void **)&heap->remote_free, block, NULL) != block);
+
+  while (block) {
+    MemFreeBlock *next = block->next;
+    memchunk_free_block(heap, MEMCHUNK_FROM_BLOCK(block), block);
+    block = next;
+  }
+}
+
+MEM_INLINE void abandoned_heaps_lock_acquire(void)
+{
+  while (atomic_cas_u(&abandoned_heaps_lock, 0, 1) != 0) {
+    /* Pass. */
+  }
+}
+
+MEM_INLINE void abandoned_heaps_lock_release(void)
+{
+  atomic_cas_u(&abandoned_heaps_lock, 1, 0);
+}
+
+#  ifdef WIN32
+static void WINAPI memheap_abandon(void *heap_v)
+#  else
+static void memheap_abandon(void *heap_v)
+#  endif
+{
+  MemThreadHeap *heap = (MemThreadHeap *)heap_v;
+  memheap_collect_remote_free(heap);
+  if (heap->spare_chunk) {
+    memchunk_release(heap->spare_chunk);
+    heap->spare_chunk = NULL;
+  }
+  thread_heap = NULL;
+  thread_heap_exited = true;
+
+  abandoned_heaps_lock_acquire();
+  heap->next_abandoned = abandoned_heaps;
+  abandoned_heaps = heap;
+  abandoned_heaps_lock_release();
+}
+
+/* Called with #abandoned_heaps_lock held. */
+static bool memheap_key_ensure(void)
+{
+  if (!thread_heap_key_created) {
+#  ifdef WIN32
+    /* Unlike TLS callbacks, fiber local storage callbacks are also called for threads which
+     * were not created by the C runtime. */
+    thread_heap_key = FlsAlloc(memheap_abandon);
+    thread_heap_key_created = (thread_heap_key != FLS_OUT_OF_INDEXES);
+#  else
+    thread_heap_key_created = (pthread_key_create(&thread_heap_key, memheap_abandon) == 0);
+#  endif
+  }
+  return thread_heap_key_created;
+}
+
+static MemThreadHeap *memheap_acquire(void)
+{
+  /* Exit handlers of other libraries may still allocate, a new heap would never be abandoned. */
+  if (thread_heap_exited) {
+    return NULL;
+  }
+
+  abandoned_heaps_lock_acquire();
+  if (!memheap_key_ensure()) {
+    abandoned_heaps_lock_release();
+    return NULL;
+  }
+  MemThreadHeap *heap = abandoned_heaps;
+  if (heap) {
+    abandoned_heaps = heap->next_abandoned;
+  }
+  abandoned_heaps_lock_release();
+
+  if (heap == NULL) {
+    heap = (MemThreadHeap *)calloc(1, sizeof(MemThreadHeap));
+    if (UNLIKELY(heap == NULL)) {
+      return NULL;
+    }
+  }
+  heap->next_abandoned = NULL;
+
+#  ifdef WIN32
+  FlsSetValue(thread_heap_key, heap);
+#  else
+  pthread_setspecific(thread_heap_key, heap);
+#  endif
+  thread_heap = heap;
+  return heap;
+}
+
+/* Returns NULL when the block has to come from the system allocator instead. */
+static MemHead *small_block_alloc(size_t len)
+{
+  MemThreadHeap *heap = thread_heap;
+  if (UNLIKELY(heap == NULL)) {
+    heap = memheap_acquire();
+    if (heap == NULL) {
+      return NULL;
+    }
+  }
+
+  const unsigned int size_class = mem_size_class(len);
+  MemChunk *chunk = heap->chunks[size_class];
+  if (UNLIKELY(chunk == NULL)) {
+    if (heap->remote_free) {
+      memheap_collect_remote_free(heap);
+      chunk = heap->chunks[size_class];
+    }
+    if (chunk == NULL) {
+      chunk = memchunk_new(heap, size_class);
+      if (chunk == NULL) {
+        return NULL;
+      }
+    }
+  }
+
+  /* Chunks in the list always have a free block. */
+  MemHead *memh;
+  if (chunk->free_blocks) {
+    memh = (MemHead *)chunk->free_blocks;
+    chunk->free_blocks = chunk->free_blocks->next;
+  }
+  else {
+    memh = (MemHead *)chunk->unused_begin;
+    chunk->unused_begin += chunk->block_size;
+  }
+  chunk->used++;
+
+  if (memchunk_is_full(chunk)) {
+    memchunk_unlink(heap, chunk);
+  }
+  return memh;
+}
+
+static void small_block_free(MemHead *memh)
+{
+  MemFreeBlock *block = (MemFreeBlock *)memh;
+  MemChunk *chunk = MEMCHUNK_FROM_BLOCK(block);
+  MemThreadHeap *heap = chunk->heap;
+
+  if (heap == thread_heap) {
+    memchunk_free_block(heap, chunk, block);
+    return;
+  }
+
+  /* Freed from another thread, the owner collects the block. */
+  MemFreeBlock *next;
+  do {
+    next = heap->remote_free;
+    block->next = next;
+  } while (atomic_cas_ptr((void **)&heap->remote_free, next, block) != next);
+}
+
+/** \} */
+
+#endif /* USE_THREAD_CACHE */
+
 #ifdef __GNUC__
 __attribute__((format(printf, 1, 2)))
 #endif
@@ -92,7 +453,7 @@ print_error(const char *str, ...)
 size_t MEM_lockfree_allocN_len(const void *vmemh)
 {
   if (vmemh) {
-    return MEMHEAD_FROM_PTR(vmemh)->len & ~((size_t)(MEMHEAD_ALIGN_FLAG));
+    return MEMHEAD_FROM_PTR(vmemh)->len & ~((size_t)(MEMHEAD_ALIGN_FLAG | MEMHEAD_SMALL_FLAG));
   }
 
   return 0;
@@ -125,6 +486,11 @@ void MEM_lockfree_freeN(void *vmemh)
     MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
     aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
   }
+#ifdef USE_THREAD_CACHE
+  else if (MEMHEAD_IS_SMALL(memh)) {
+    small_block_free(memh);
+  }
+#endif
   else {
     free(memh);
   }
@@ -228,14 +594,28 @@ void *MEM_lockfree_recallocN_id(void *vmemh, size_t len, const char *str)
 
 void *MEM_lockfree_callocN(size_t len, const char *str)
 {
-  MemHead *memh;
+  MemHead *memh = NULL;
 
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)calloc(1, len + sizeof(MemHead));
+#ifdef USE_THREAD_CACHE
+  if (len <= MEM_SMALL_LEN_MAX) {
+    memh = small_block_alloc(len);
+  }
+  if (LIKELY(memh)) {
+    memset(memh + 1, 0, len);
+    memh->len = len | (size_t)MEMHEAD_SMALL_FLAG;
+  }
+  else
+#endif
+  {
+    memh = (MemHead *)calloc(1, len + sizeof(MemHead));
+    if (LIKELY(memh)) {
+      memh->len = len;
+    }
+  }
 
   if (LIKELY(memh)) {
-    memh->len = len;
     atomic_add_and_fetch_u(&totblock, 1);
     atomic_add_and_fetch_z(&mem_in_use, len);
     update_maximum(&peak_mem, mem_in_use);
@@ -269,18 +649,31 @@ void *MEM_lockfree_calloc_arrayN(size_t len, size_t size, const char *str)
 
 void *MEM_lockfree_mallocN(size_t len, const char *str)
 {
-  MemHead *memh;
+  MemHead *memh = NULL;
 
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)malloc(len + sizeof(MemHead));
+#ifdef USE_THREAD_CACHE
+  if (len <= MEM_SMALL_LEN_MAX) {
+    memh = small_block_alloc(len);
+  }
+  if (LIKELY(memh)) {
+    memh->len = len | (size_t)MEMHEAD_SMALL_FLAG;
+  }
+  else
+#endif
+  {
+    memh = (MemHead *)malloc(len + sizeof(MemHead));
+    if (LIKELY(memh)) {
+      memh->len = len;
+    }
+  }
 
   if (LIKELY(memh)) {
     if (UNLIKELY(malloc_debug_memset && len)) {
       memset(memh + 1, 255, len);
     }
 
-    memh->len = len;
     atomic_add_and_fetch_u(&totblock, 1);
     atomic_add_and_fetch_z(&mem_in_use, len);
     update_maximum(&peak_mem, mem_in_use);
@@ -383,6 +776,11 @@ void MEM_lockfree_printmemlist_stats(void)
 {
   printf("\ntotal memory len: %.3f MB\n", (double)mem_in_use / (double)(1024 * 1024));
   printf("peak memory len: %.3f MB\n", (double)peak_mem / (double)(1024 * 1024));
+#ifdef USE_THREAD_CACHE
+  printf("thread cache chunks: %u (%.3f MB)\n",
+         totchunk,
+         (double)((size_t)totchunk * MEM_CHUNK_SIZE) / (double)(1024 * 1024));
+#endif
   printf(
       "\nFor more detailed per-block statistics run Blender with memory debugging command line "
       "argument.\n");
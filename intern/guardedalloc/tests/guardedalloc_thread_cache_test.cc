@@ -0,0 +1,150 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <thread>
+#include <vector>
+
+#ifndef WIN32
+#  include <pthread.h>
+#endif
+
+#include "MEM_guardedalloc.h"
+#include "guardedalloc_test_base.h"
+
+namespace {
+
+/* Covers all small size classes and some sizes allocated by the system allocator. */
+const size_t sizes_num = 1100;
+
+void AllocBlocks(std::vector<void *> &blocks, const int seed)
+{
+  for (size_t len = 0; len < sizes_num; len++) {
+    char *block = (char *)MEM_mallocN(len, __func__);
+    memset(block, seed, len);
+    blocks.push_back(block);
+  }
+}
+
+void CheckAndFreeBlocks(std::vector<void *> &blocks, const int seed)
+{
+  for (size_t len = 0; len < blocks.size(); len++) {
+    const char *block = (const char *)blocks[len];
+    EXPECT_GE(MEM_allocN_len(block), len);
+    for (size_t i = 0; i < len; i++) {
+      EXPECT_EQ(block[i], (char)seed);
+    }
+    MEM_freeN(blocks[len]);
+  }
+  blocks.clear();
+}
+
+}  // namespace
+
+TEST_F(LockFreeAllocatorTest, ThreadCacheAllocFree)
+{
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  const unsigned int blocks_in_use = MEM_get_memory_blocks_in_use();
+
+  std::vector<void *> blocks;
+  for (int seed = 0; seed < 3; seed++) {
+    AllocBlocks(blocks, seed);
+    EXPECT_GT(MEM_get_memory_in_use(), mem_in_use);
+    CheckAndFreeBlocks(blocks, seed);
+    EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+    EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+  }
+}
+
+TEST_F(LockFreeAllocatorTest, ThreadCacheCalloc)
+{
+  for (size_t len = 0; len < sizes_num; len++) {
+    /* Dirty a block, so it's reused by the next allocation of the same size. */
+    void *dirty = MEM_mallocN(len, __func__);
+    memset(dirty, 255, len);
+    MEM_freeN(dirty);
+
+    const char *block = (const char *)MEM_callocN(len, __func__);
+    for (size_t i = 0; i < len; i++) {
+      EXPECT_EQ(block[i], 0);
+    }
+    MEM_freeN((void *)block);
+  }
+}
+
+/* Blocks freed by other threads (also after the allocating thread exited). */
+TEST_F(LockFreeAllocatorTest, ThreadCacheRemoteFree)
+{
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  const unsigned int blocks_in_use = MEM_get_memory_blocks_in_use();
+
+  const int threads_num = 8;
+  std::vector<std::vector<void *>> blocks(threads_num);
+
+  for (int iter = 0; iter < 4; iter++) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threads_num; i++) {
+      threads.emplace_back([&blocks, i]() { AllocBlocks(blocks[i], i); });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    threads.clear();
+
+    /* Every thread frees the blocks allocated by another (exited) thread, and allocates again
+     * from the chunks of those threads. */
+    for (int i = 0; i < threads_num; i++) {
+      threads.emplace_back([&blocks, i]() {
+        const int other = (i + 1) % threads_num;
+        CheckAndFreeBlocks(blocks[other], other);
+        std::vector<void *> local;
+        AllocBlocks(local, i);
+        CheckAndFreeBlocks(local, i);
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+
+    EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+    EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+  }
+}
+
+#ifndef WIN32
+/* Allocations from exit handlers which run after the thread cache of the thread was released. */
+TEST_F(LockFreeAllocatorTest, ThreadCacheAllocOnThreadExit)
+{
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  const unsigned int blocks_in_use = MEM_get_memory_blocks_in_use();
+
+  /* Created after the key of the thread cache, so its destructor runs later. */
+  MEM_freeN(MEM_mallocN(1, __func__));
+  static std::vector<void *> exit_blocks[2];
+  pthread_key_t key;
+  ASSERT_EQ(pthread_key_create(&key,
+                               [](void *seed) {
+                                 AllocBlocks(exit_blocks[(intptr_t)seed - 1],
+                                             (int)(intptr_t)seed);
+                               }),
+            0);
+
+  for (intptr_t seed = 1; seed <= 2; seed++) {
+    std::thread thread([key, seed]() {
+      std::vector<void *> blocks;
+      AllocBlocks(blocks, (int)seed);
+      CheckAndFreeBlocks(blocks, (int)seed);
+      pthread_setspecific(key, (void *)seed);
+    });
+    thread.join();
+  }
+  pthread_key_delete(key);
+
+  for (int seed = 1; seed <= 2; seed++) {
+    EXPECT_EQ(exit_blocks[seed - 1].size(), sizes_num);
+    CheckAndFreeBlocks(exit_blocks[seed - 1], seed);
+  }
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+#endif
@@ -647,6 +647,14 @@ class NODE_PT_quality(bpy.types.Panel):
         snode = context.space_data
         tree = snode.node_tree
 
+        col = layout.column()
+        col.prop(tree, "execution_mode")
+        if tree.execution_mode != 'FULL_FRAME':
+            col.prop(tree, "buffer_limit")
+            sub = col.column()
+            sub.active = tree.buffer_limit != 0
+            sub.prop(tree, "buffer_directory")
+
         col = layout.column()
         col.prop(tree, "render_quality", text="Render")
         col.prop(tree, "edit_quality", text="Edit")
@@ -621,6 +621,11 @@ class USERPREF_PT_system_memory(SystemPanel, CenterAlignMixIn, Panel):
 
         layout.separator()
 
+        col = layout.column()
+        col.prop(system, "compositor_cache_limit", text="Compositor Cache Limit")
+
+        layout.separator()
+
         col = layout.column()
         col.prop(system, "texture_time_out", text="Texture Time Out")
         col.prop(system, "texture_collection_rate", text="Garbage Collection Rate")
@@ -641,6 +646,10 @@ class USERPREF_PT_system_video_sequencer(SystemPanel, CenterAlignMixIn, Panel):
         edit = prefs.edit
 
         layout.prop(system, "memory_cache_limit")
+        layout.prop(system, "sequencer_compressed_cache_limit")
+        col = layout.column()
+        col.active = system.sequencer_compressed_cache_limit != 0
+        col.prop(system, "use_sequencer_compressed_cache_reduced_precision")
 
         layout.separator()
 
@@ -715,6 +724,7 @@ class USERPREF_PT_viewport_textures(ViewportPanel, CenterAlignMixIn, Panel):
         col.prop(system, "anisotropic_filter")
         col.prop(system, "gl_clip_alpha", slider=True)
         col.prop(system, "image_draw_method", text="Image Display Method")
+        col.prop(system, "display_lut_accuracy", text="Display Transform")
 
 
 class USERPREF_PT_viewport_selection(ViewportPanel, CenterAlignMixIn, Panel):
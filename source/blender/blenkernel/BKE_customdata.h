@@ -74,6 +74,12 @@ typedef enum eCDAllocType {
   CD_REFERENCE = 3,
   /** Do a full copy of all layers, only allowed if source has same number of elements. */
   CD_DUPLICATE = 4,
+  /**
+   * Share the data of the source layers, it is freed by the last layer using it.
+   * Like referenced layers, shared layers must be duplicated with
+   * #CustomData_duplicate_referenced_layer before writing to them.
+   */
+  CD_SHARE = 5,
 } eCDAllocType;
 
 #define CD_TYPE_AS_MASK(_type) (CustomDataMask)((CustomDataMask)1 << (CustomDataMask)(_type))
@@ -218,7 +224,8 @@ bool CustomData_has_layer(const struct CustomData *data, int type);
 int CustomData_number_of_layers(const struct CustomData *data, int type);
 int CustomData_number_of_layers_typemask(const struct CustomData *data, CustomDataMask mask);
 
-/* duplicate data of a layer with flag NOFREE, and remove that flag.
+/* duplicate data of a layer with flag NOFREE, and remove that flag,
+ * or of a layer sharing its data with other layers.
  * returns the layer data */
 void *CustomData_duplicate_referenced_layer(struct CustomData *data,
                                             const int type,
@@ -374,6 +381,8 @@ void CustomData_bmesh_set_n(
 void CustomData_bmesh_set_layer_n(struct CustomData *data, void *block, int n, const void *source);
 
 /* set the pointer of to the first layer of type. the old data is not freed.
+ * layers sharing their data must be duplicated with #CustomData_duplicate_referenced_layer
+ * first, so that the old data is owned by the caller.
  * returns the value of ptr if the layer is found, NULL otherwise
  */
 void *CustomData_set_layer(const struct CustomData *data, int type, void *ptr);
@@ -111,6 +111,8 @@ enum {
   /** Support simulating events (for testing). */
   G_FLAG_EVENT_SIMULATE = (1 << 3),
   G_FLAG_USERPREF_NO_SAVE_ON_EXIT = (1 << 4),
+  /** Only read the data-blocks used by the active scene when loading files in background mode. */
+  G_FLAG_LOAD_SCENE_ONLY = (1 << 5),
 
   G_FLAG_SCRIPT_AUTOEXEC = (1 << 13),
   /** When this flag is set ignore the prefs #USER_SCRIPT_AUTOEXEC_DISABLE. */
@@ -122,7 +124,7 @@ enum {
 /** Don't overwrite these flags when reading a file. */
 #define G_FLAG_ALL_RUNTIME \
   (G_FLAG_SCRIPT_AUTOEXEC | G_FLAG_SCRIPT_OVERRIDE_PREF | G_FLAG_EVENT_SIMULATE | \
-   G_FLAG_USERPREF_NO_SAVE_ON_EXIT)
+   G_FLAG_USERPREF_NO_SAVE_ON_EXIT | G_FLAG_LOAD_SCENE_ONLY)
 
 /** Flags to read from blend file. */
 #define G_FLAG_ALL_READFILE 0
@@ -155,7 +157,9 @@ enum {
   G_DEBUG_XR = (1 << 21),                    /* XR/OpenXR messages */
   G_DEBUG_XR_TIME = (1 << 22),               /* XR/OpenXR timing messages */
 
-  G_DEBUG_GHOST = (1 << 23), /* Debug GHOST module. */
+  G_DEBUG_GHOST = (1 << 23),           /* Debug GHOST module. */
+  G_DEBUG_COMPOSITOR = (1 << 24),      /* compositor execution profiling */
+  G_DEBUG_DEPSGRAPH_TRACE = (1 << 25), /* depsgraph evaluation timeline */
 };
 
 #define G_DEBUG_ALL \
@@ -49,6 +49,11 @@ enum {
   IDTYPE_FLAGS_NO_MAKELOCAL = 1 << 2,
   /** Indicates that the given IDType does not have animation data. */
   IDTYPE_FLAGS_NO_ANIMDATA = 1 << 3,
+  /**
+   * Indicates that the `blend_read_lib` callback of the given IDType only modifies the ID itself
+   * (and its embedded IDs), so IDs of this type can be lib-linked from multiple threads.
+   */
+  IDTYPE_FLAGS_THREADSAFE_READ_LIB = 1 << 4,
 };
 
 typedef struct IDCacheKey {
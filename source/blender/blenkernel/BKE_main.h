@@ -110,6 +110,12 @@ typedef struct Main {
    */
   char is_locked_for_linking;
 
+  /**
+   * Only the data-blocks used by the active scene were read (see #BLO_READ_SKIP_UNUSED_IDS),
+   * writing this main would lose all the others.
+   */
+  char is_partially_read;
+
   BlendThumbnail *blen_thumb;
 
   struct Library *curlib;
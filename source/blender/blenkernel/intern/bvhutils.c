@@ -30,6 +30,7 @@
 
 #include "BLI_linklist.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
@@ -1133,6 +1134,30 @@ static BVHTree *bvhtree_from_editmesh_looptri_create_tree(float epsilon,
   return tree;
 }
 
+typedef struct LooptriInsertData {
+  BVHTree *tree;
+  const MVert *vert;
+  const MLoop *mloop;
+  const MLoopTri *looptri;
+} LooptriInsertData;
+
+static void bvhtree_from_mesh_looptri_insert_cb(void *__restrict userdata,
+                                                const int i,
+                                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const LooptriInsertData *data = userdata;
+  const MVert *vert = data->vert;
+  const MLoop *mloop = data->mloop;
+  const MLoopTri *lt = &data->looptri[i];
+  float co[3][3];
+
+  copy_v3_v3(co[0], vert[mloop[lt->tri[0]].v].co);
+  copy_v3_v3(co[1], vert[mloop[lt->tri[1]].v].co);
+  copy_v3_v3(co[2], vert[mloop[lt->tri[2]].v].co);
+
+  BLI_bvhtree_insert_leaf(data->tree, i, i, co[0], 3);
+}
+
 static BVHTree *bvhtree_from_mesh_looptri_create_tree(float epsilon,
                                                       int tree_type,
                                                       int axis,
@@ -1157,7 +1182,21 @@ static BVHTree *bvhtree_from_mesh_looptri_create_tree(float epsilon,
     /* printf("%s: building BVH, total=%d\n", __func__, numFaces); */
     tree = BLI_bvhtree_new(looptri_num_active, epsilon, tree_type, axis);
     if (tree) {
-      if (vert && looptri) {
+      if (vert && looptri && looptri_mask == NULL) {
+        /* Without a mask every triangle is a leaf at its own index. */
+        LooptriInsertData data = {
+            .tree = tree,
+            .vert = vert,
+            .mloop = mloop,
+            .looptri = looptri,
+        };
+        TaskParallelSettings settings;
+        BLI_parallel_range_settings_defaults(&settings);
+        settings.min_iter_per_thread = 1024;
+        BLI_task_parallel_range(
+            0, looptri_num, &data, bvhtree_from_mesh_looptri_insert_cb, &settings);
+      }
+      else if (vert && looptri) {
         for (int i = 0; i < looptri_num; i++) {
           float co[3][3];
           if (looptri_mask && !BLI_BITMAP_TEST_BOOL(looptri_mask, i)) {
@@ -61,6 +61,8 @@
 
 #include "CLG_log.h"
 
+#include "atomic_ops.h"
+
 /* only for customdata_data_transfer_interp_normal_normals */
 #include "data_transfer_intern.h"
 
@@ -2036,6 +2038,100 @@ void customData_mask_layers__print(const CustomData_MeshMasks *mask)
   }
 }
 
+/********************* Shared layer data *********************/
+
+/* Layers copied with CD_SHARE use the data of the source layer, until one of them is written to
+ * and duplicates it. This saves the memory and the time of copying data which is only read, like
+ * the geometry of copy-on-write meshes. */
+
+typedef struct CustomDataSharing {
+  /** Number of layers using the data. */
+  int users;
+} CustomDataSharing;
+
+static bool customData_layer_is_shared(const CustomDataLayer *layer)
+{
+  return layer->sharing != NULL && layer->sharing->users > 1;
+}
+
+static CustomDataSharing *customData_layer_sharing_add_user(CustomDataLayer *layer)
+{
+  CustomDataSharing *sharing = layer->sharing;
+
+  if (sharing == NULL) {
+    /* The layer owned its data alone so far. */
+    CustomDataSharing *new_sharing = MEM_mallocN(sizeof(*new_sharing), __func__);
+    new_sharing->users = 1;
+    sharing = atomic_cas_ptr((void **)&layer->sharing, NULL, new_sharing);
+    if (sharing == NULL) {
+      sharing = new_sharing;
+    }
+    else {
+      MEM_freeN(new_sharing);
+    }
+  }
+
+  atomic_add_and_fetch_int32(&sharing->users, 1);
+  return sharing;
+}
+
+/* Returns true when the layer was the last user of its data, which is its own then. */
+static bool customData_layer_sharing_remove_user(CustomDataLayer *layer)
+{
+  CustomDataSharing *sharing = layer->sharing;
+
+  if (sharing == NULL) {
+    return true;
+  }
+
+  layer->sharing = NULL;
+  if (atomic_sub_and_fetch_int32(&sharing->users, 1) > 0) {
+    return false;
+  }
+
+  MEM_freeN(sharing);
+  return true;
+}
+
+/* Duplicate the data of the layer when other layers use it, before writing to it. */
+static void customData_layer_ensure_owned(CustomDataLayer *layer, const int totelem)
+{
+  if (!customData_layer_is_shared(layer) || totelem <= 0) {
+    customData_layer_sharing_remove_user(layer);
+    return;
+  }
+
+  const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+  void *old_data = layer->data;
+  void *dst_data = MEM_malloc_arrayN((size_t)totelem, typeInfo->size, "CD duplicate shared layer");
+
+  if (typeInfo->copy) {
+    typeInfo->copy(old_data, dst_data, totelem);
+  }
+  else {
+    memcpy(dst_data, old_data, (size_t)totelem * typeInfo->size);
+  }
+  layer->data = dst_data;
+
+  /* The other users could have been freed in the meantime. */
+  if (customData_layer_sharing_remove_user(layer)) {
+    if (typeInfo->free) {
+      typeInfo->free(old_data, totelem, typeInfo->size);
+    }
+    MEM_freeN(old_data);
+  }
+}
+
+/* Replace the data of the layer, the previous data is owned by the caller then. */
+static void customData_layer_set_data(CustomDataLayer *layer, void *ptr)
+{
+  /* The data of a shared layer isn't the caller's to free, it has to be duplicated with
+   * #CustomData_duplicate_referenced_layer first. */
+  BLI_assert(!customData_layer_is_shared(layer));
+  customData_layer_sharing_remove_user(layer);
+  layer->data = ptr;
+}
+
 /********************* CustomData functions *********************/
 static void customData_update_offsets(CustomData *data);
 
@@ -2124,6 +2220,7 @@ bool CustomData_merge(const struct CustomData *source,
       case CD_ASSIGN:
       case CD_REFERENCE:
       case CD_DUPLICATE:
+      case CD_SHARE:
         data = layer->data;
         break;
       default:
@@ -2135,11 +2232,23 @@ bool CustomData_merge(const struct CustomData *source,
       newlayer = customData_add_layer__internal(
           dest, type, CD_REFERENCE, data, totelem, layer->name);
     }
+    else if ((alloctype == CD_SHARE) && ((flag & CD_FLAG_NOFREE) || data == NULL)) {
+      /* Only data owned by the source can be shared. */
+      newlayer = customData_add_layer__internal(
+          dest, type, CD_DUPLICATE, data, totelem, layer->name);
+    }
     else {
       newlayer = customData_add_layer__internal(dest, type, alloctype, data, totelem, layer->name);
     }
 
     if (newlayer) {
+      if (alloctype == CD_ASSIGN) {
+        newlayer->sharing = layer->sharing;
+      }
+      else if ((alloctype == CD_SHARE) && (newlayer->data == data)) {
+        /* The sharing is run-time data, it's fine to add it to the const source. */
+        newlayer->sharing = customData_layer_sharing_add_user((CustomDataLayer *)layer);
+      }
       newlayer->uid = layer->uid;
 
       newlayer->active = lastactive;
@@ -2165,6 +2274,9 @@ void CustomData_realloc(CustomData *data, int totelem)
       continue;
     }
     typeInfo = layerType_getInfo(layer->type);
+    if (layer->sharing != NULL && layer->data != NULL) {
+      customData_layer_ensure_owned(layer, MEM_allocN_len(layer->data) / typeInfo->size);
+    }
     layer->data = MEM_reallocN(layer->data, (size_t)totelem * typeInfo->size);
   }
 }
@@ -2189,6 +2301,11 @@ static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
   const LayerTypeInfo *typeInfo;
 
   if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
+    if (!customData_layer_sharing_remove_user(layer)) {
+      /* Still used by other layers. */
+      return;
+    }
+
     typeInfo = layerType_getInfo(layer->type);
 
     if (typeInfo->free) {
@@ -2503,13 +2620,13 @@ static CustomDataLayer *customData_add_layer__internal(CustomData *data,
   /* Passing a layer-data to copy from with an alloctype that won't copy is
    * most likely a bug */
   BLI_assert(!layerdata || (alloctype == CD_ASSIGN) || (alloctype == CD_DUPLICATE) ||
-             (alloctype == CD_REFERENCE));
+             (alloctype == CD_REFERENCE) || (alloctype == CD_SHARE));
 
   if (!typeInfo->defaultname && CustomData_has_layer(data, type)) {
     return &data->layers[CustomData_get_layer_index(data, type)];
   }
 
-  if (ELEM(alloctype, CD_ASSIGN, CD_REFERENCE)) {
+  if (ELEM(alloctype, CD_ASSIGN, CD_REFERENCE, CD_SHARE)) {
     newlayerdata = layerdata;
   }
   else if (totelem > 0 && typeInfo->size > 0) {
@@ -2563,6 +2680,7 @@ static CustomDataLayer *customData_add_layer__internal(CustomData *data,
   data->layers[index].type = type;
   data->layers[index].flag = flag;
   data->layers[index].data = newlayerdata;
+  data->layers[index].sharing = NULL;
 
   /* Set default name if none exists. Note we only call DATA_()  once
    * we know there is a default name, to avoid overhead of locale lookups
@@ -2763,6 +2881,9 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
 
     layer->flag &= ~CD_FLAG_NOFREE;
   }
+  else if (layer->sharing != NULL) {
+    customData_layer_ensure_owned(layer, totelem);
+  }
 
   return layer->data;
 }
@@ -2807,7 +2928,7 @@ bool CustomData_is_referenced_layer(struct CustomData *data, int type)
 
   CustomDataLayer *layer = &data->layers[layer_index];
 
-  return (layer->flag & CD_FLAG_NOFREE) != 0;
+  return (layer->flag & CD_FLAG_NOFREE) != 0 || customData_layer_is_shared(layer);
 }
 
 void CustomData_free_temporary(CustomData *data, int totelem)
@@ -3252,7 +3373,7 @@ void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
     return NULL;
   }
 
-  data->layers[layer_index].data = ptr;
+  customData_layer_set_data(&data->layers[layer_index], ptr);
 
   return ptr;
 }
@@ -3265,7 +3386,7 @@ void *CustomData_set_layer_n(const struct CustomData *data, int type, int n, voi
     return NULL;
   }
 
-  data->layers[layer_index].data = ptr;
+  customData_layer_set_data(&data->layers[layer_index], ptr);
 
   return ptr;
 }
@@ -4245,7 +4366,8 @@ void CustomData_blend_write_prepare(CustomData *data,
         }
         write_layers_size += chunk_size;
       }
-      write_layers[j++] = *layer;
+      write_layers[j] = *layer;
+      write_layers[j++].sharing = NULL;
     }
   }
   BLI_assert(j == data->totlayer);
@@ -5174,6 +5296,7 @@ void CustomData_blend_read(BlendDataReader *reader, CustomData *data, int count)
     }
 
     layer->flag &= ~CD_FLAG_NOFREE;
+    layer->sharing = NULL;
 
     if (CustomData_verify_versions(data, i)) {
       BLO_read_data_address(reader, &layer->data);
@@ -0,0 +1,147 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2021 by Blender Foundation.
+ */
+#include "testing/testing.h"
+
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_customdata_types.h"
+#include "DNA_mesh_types.h"
+
+namespace blender::bke::tests {
+
+static const int elements_len = 16;
+
+static void customdata_init_float_layer(CustomData *data)
+{
+  CustomData_reset(data);
+  float *values = (float *)CustomData_add_layer(
+      data, CD_PROP_FLOAT, CD_CALLOC, nullptr, elements_len);
+  for (int i = 0; i < elements_len; i++) {
+    values[i] = (float)i;
+  }
+}
+
+static void expect_float_layer_values(const CustomData *data)
+{
+  const float *values = (const float *)CustomData_get_layer(data, CD_PROP_FLOAT);
+  ASSERT_NE(values, nullptr);
+  for (int i = 0; i < elements_len; i++) {
+    EXPECT_EQ(values[i], (float)i);
+  }
+}
+
+TEST(customdata, ShareFreeSourceFirst)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+  CustomData src, dst;
+  customdata_init_float_layer(&src);
+  CustomData_copy(&src, &dst, CD_MASK_PROP_FLOAT, CD_SHARE, elements_len);
+
+  EXPECT_EQ(CustomData_get_layer(&src, CD_PROP_FLOAT), CustomData_get_layer(&dst, CD_PROP_FLOAT));
+  EXPECT_TRUE(CustomData_is_referenced_layer(&src, CD_PROP_FLOAT));
+  EXPECT_TRUE(CustomData_is_referenced_layer(&dst, CD_PROP_FLOAT));
+
+  CustomData_free(&src, elements_len);
+  /* The copy is the only user of the data now. */
+  expect_float_layer_values(&dst);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&dst, CD_PROP_FLOAT));
+
+  CustomData_free(&dst, elements_len);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(customdata, ShareFreeCopyFirst)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+  CustomData src, dst;
+  customdata_init_float_layer(&src);
+  CustomData_copy(&src, &dst, CD_MASK_PROP_FLOAT, CD_SHARE, elements_len);
+
+  CustomData_free(&dst, elements_len);
+  expect_float_layer_values(&src);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&src, CD_PROP_FLOAT));
+
+  CustomData_free(&src, elements_len);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(customdata, ShareMultipleCopies)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+  CustomData src, dst_a, dst_b;
+  customdata_init_float_layer(&src);
+  CustomData_copy(&src, &dst_a, CD_MASK_PROP_FLOAT, CD_SHARE, elements_len);
+  CustomData_copy(&dst_a, &dst_b, CD_MASK_PROP_FLOAT, CD_SHARE, elements_len);
+
+  CustomData_free(&src, elements_len);
+  EXPECT_TRUE(CustomData_is_referenced_layer(&dst_a, CD_PROP_FLOAT));
+  CustomData_free(&dst_a, elements_len);
+  expect_float_layer_values(&dst_b);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&dst_b, CD_PROP_FLOAT));
+
+  CustomData_free(&dst_b, elements_len);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(customdata, ShareWriteCopy)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+  CustomData src, dst;
+  customdata_init_float_layer(&src);
+  CustomData_copy(&src, &dst, CD_MASK_PROP_FLOAT, CD_SHARE, elements_len);
+
+  float *values = (float *)CustomData_duplicate_referenced_layer(
+      &dst, CD_PROP_FLOAT, elements_len);
+  EXPECT_NE(values, CustomData_get_layer(&src, CD_PROP_FLOAT));
+  for (int i = 0; i < elements_len; i++) {
+    values[i] = -1.0f;
+  }
+  expect_float_layer_values(&src);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&src, CD_PROP_FLOAT));
+  EXPECT_FALSE(CustomData_is_referenced_layer(&dst, CD_PROP_FLOAT));
+
+  CustomData_free(&src, elements_len);
+  EXPECT_EQ(((float *)CustomData_get_layer(&dst, CD_PROP_FLOAT))[0], -1.0f);
+  CustomData_free(&dst, elements_len);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(customdata, ShareMeshCopy)
+{
+  BKE_idtype_init();
+  Mesh *mesh = BKE_mesh_new_nomain(4, 4, 0, 4, 1);
+  Mesh *mesh_copy = nullptr;
+  BKE_id_copy_ex(nullptr, &mesh->id, (ID **)&mesh_copy, LIB_ID_COPY_LOCALIZE | LIB_ID_COPY_CD_SHARE);
+
+  /* Vertices are written to in place during evaluation, they are never shared. */
+  EXPECT_NE(mesh_copy->mvert, mesh->mvert);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&mesh->vdata, CD_MVERT));
+  EXPECT_EQ(mesh_copy->mloop, mesh->mloop);
+  EXPECT_TRUE(CustomData_is_referenced_layer(&mesh->ldata, CD_MLOOP));
+
+  BKE_id_free(nullptr, mesh);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&mesh_copy->ldata, CD_MLOOP));
+  BKE_id_free(nullptr, mesh_copy);
+}
+
+}  // namespace blender::bke::tests
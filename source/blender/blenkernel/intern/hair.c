@@ -182,7 +182,7 @@ IDTypeInfo IDType_ID_HA = {
     .name = "Hair",
     .name_plural = "hairs",
     .translation_context = BLT_I18NCONTEXT_ID_HAIR,
-    .flags = 0,
+    .flags = IDTYPE_FLAGS_THREADSAFE_READ_LIB,
 
     .init_data = hair_init_data,
     .copy_data = hair_copy_data,
@@ -125,7 +125,9 @@ static void mesh_copy_data(Main *bmain, ID *id_dst, const ID *id_src, const int
 
   mesh_dst->mat = MEM_dupallocN(mesh_src->mat);
 
-  const eCDAllocType alloc_type = (flag & LIB_ID_COPY_CD_REFERENCE) ? CD_REFERENCE : CD_DUPLICATE;
+  const eCDAllocType alloc_type = (flag & LIB_ID_COPY_CD_REFERENCE) ?
+                                      CD_REFERENCE :
+                                      (flag & LIB_ID_COPY_CD_SHARE) ? CD_SHARE : CD_DUPLICATE;
   CustomData_copy(&mesh_src->vdata, &mesh_dst->vdata, mask.vmask, alloc_type, mesh_dst->totvert);
   CustomData_copy(&mesh_src->edata, &mesh_dst->edata, mask.emask, alloc_type, mesh_dst->totedge);
   CustomData_copy(&mesh_src->ldata, &mesh_dst->ldata, mask.lmask, alloc_type, mesh_dst->totloop);
@@ -136,6 +138,12 @@ static void mesh_copy_data(Main *bmain, ID *id_dst, const ID *id_src, const int
   else {
     mesh_tessface_clear_intern(mesh_dst, false);
   }
+  if (alloc_type == CD_SHARE) {
+    /* Vertex normals are calculated in place during evaluation, also through referencing copies
+     * of the mesh which don't duplicate the array first. Never share the vertices, so that the
+     * original mesh isn't written to. */
+    CustomData_duplicate_referenced_layer(&mesh_dst->vdata, CD_MVERT, mesh_dst->totvert);
+  }
 
   BKE_mesh_update_customdata_pointers(mesh_dst, do_tessface);
 
@@ -320,7 +328,7 @@ IDTypeInfo IDType_ID_ME = {
     .name = "Mesh",
     .name_plural = "meshes",
     .translation_context = BLT_I18NCONTEXT_ID_MESH,
-    .flags = 0,
+    .flags = IDTYPE_FLAGS_THREADSAFE_READ_LIB,
 
     .init_data = mesh_init_data,
     .copy_data = mesh_copy_data,
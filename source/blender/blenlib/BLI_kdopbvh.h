@@ -147,6 +147,8 @@ void BLI_bvhtree_free(BVHTree *tree);
 
 /* construct: first insert points, then call balance */
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints);
+void BLI_bvhtree_insert_leaf(
+    BVHTree *tree, int leaf_index, int index, const float co[3], int numpoints);
 void BLI_bvhtree_balance(BVHTree *tree);
 
 /* update: first update points/nodes, then call update_tree to refit the bounding volumes */
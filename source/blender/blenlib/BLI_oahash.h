@@ -0,0 +1,161 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * OAHash is an open addressing hash-map for C code, with the same API as #GHash.
+ *
+ * Keys and values are stored directly in one array of slots (together with the hash of the key),
+ * using the same probing strategy and load factor as `blender::Map`. Compared to #GHash there is
+ * no allocation per entry and no pointer chasing on lookups.
+ *
+ * The main difference with #GHash: pointers returned by #BLI_oahash_lookup_p and
+ * #BLI_oahash_ensure_p are only valid until the next insertion, which may grow the table.
+ * Removing items (also while iterating) never moves other items.
+ *
+ * Existing #GHashHashFP & #GHashCmpFP functions (e.g. #BLI_ghashutil_ptrhash) can be used as is.
+ */
+
+#include "BLI_compiler_attrs.h"
+#include "BLI_compiler_compat.h"
+#include "BLI_ghash.h"
+#include "BLI_sys_types.h" /* for bool */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct OAHash OAHash;
+
+typedef struct OAHashIterator {
+  OAHash *oh;
+  struct OAHashSlot *curSlot;
+  struct OAHashSlot *endSlot;
+} OAHashIterator;
+
+/* -------------------------------------------------------------------- */
+/** \name OAHash API
+ *
+ * Defined in ``BLI_oahash.cc``
+ * \{ */
+
+OAHash *BLI_oahash_new_ex(GHashHashFP hashfp,
+                          GHashCmpFP cmpfp,
+                          const char *info,
+                          const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_new(GHashHashFP hashfp,
+                       GHashCmpFP cmpfp,
+                       const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void BLI_oahash_free(OAHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void BLI_oahash_reserve(OAHash *oh, const unsigned int nentries_reserve);
+void BLI_oahash_insert(OAHash *oh, void *key, void *val);
+bool BLI_oahash_reinsert(
+    OAHash *oh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void *BLI_oahash_lookup(const OAHash *oh, const void *key) ATTR_WARN_UNUSED_RESULT;
+void *BLI_oahash_lookup_default(const OAHash *oh,
+                                const void *key,
+                                void *val_default) ATTR_WARN_UNUSED_RESULT;
+void **BLI_oahash_lookup_p(OAHash *oh, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_oahash_ensure_p(OAHash *oh, void *key, void ***r_val) ATTR_WARN_UNUSED_RESULT;
+bool BLI_oahash_ensure_p_ex(OAHash *oh, const void *key, void ***r_key, void ***r_val)
+    ATTR_WARN_UNUSED_RESULT;
+bool BLI_oahash_remove(OAHash *oh,
+                       const void *key,
+                       GHashKeyFreeFP keyfreefp,
+                       GHashValFreeFP valfreefp);
+void BLI_oahash_clear(OAHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void BLI_oahash_clear_ex(OAHash *oh,
+                         GHashKeyFreeFP keyfreefp,
+                         GHashValFreeFP valfreefp,
+                         const unsigned int nentries_reserve);
+void *BLI_oahash_popkey(OAHash *oh,
+                        const void *key,
+                        GHashKeyFreeFP keyfreefp) ATTR_WARN_UNUSED_RESULT;
+bool BLI_oahash_haskey(const OAHash *oh, const void *key) ATTR_WARN_UNUSED_RESULT;
+unsigned int BLI_oahash_len(const OAHash *oh) ATTR_WARN_UNUSED_RESULT;
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name OAHash Iterator
+ * \{ */
+
+void BLI_oahashIterator_init(OAHashIterator *ohi, OAHash *oh);
+void BLI_oahashIterator_step(OAHashIterator *ohi);
+
+BLI_INLINE void *BLI_oahashIterator_getKey(OAHashIterator *ohi) ATTR_WARN_UNUSED_RESULT;
+BLI_INLINE void *BLI_oahashIterator_getValue(OAHashIterator *ohi) ATTR_WARN_UNUSED_RESULT;
+BLI_INLINE void **BLI_oahashIterator_getValue_p(OAHashIterator *ohi) ATTR_WARN_UNUSED_RESULT;
+BLI_INLINE bool BLI_oahashIterator_done(const OAHashIterator *ohi) ATTR_WARN_UNUSED_RESULT;
+
+/* Must match the layout of the slots in ``BLI_oahash.cc``. */
+struct _oah_Slot {
+  void *key, *val;
+  unsigned int hash, state;
+};
+BLI_INLINE void *BLI_oahashIterator_getKey(OAHashIterator *ohi)
+{
+  return ((struct _oah_Slot *)ohi->curSlot)->key;
+}
+BLI_INLINE void *BLI_oahashIterator_getValue(OAHashIterator *ohi)
+{
+  return ((struct _oah_Slot *)ohi->curSlot)->val;
+}
+BLI_INLINE void **BLI_oahashIterator_getValue_p(OAHashIterator *ohi)
+{
+  return &((struct _oah_Slot *)ohi->curSlot)->val;
+}
+BLI_INLINE bool BLI_oahashIterator_done(const OAHashIterator *ohi)
+{
+  return ohi->curSlot == ohi->endSlot;
+}
+/* disallow further access */
+#ifdef __GNUC__
+#  pragma GCC poison _oah_Slot
+#else
+#  define _oah_Slot void
+#endif
+
+#define OAHASH_ITER(oh_iter_, oahash_) \
+  for (BLI_oahashIterator_init(&oh_iter_, oahash_); BLI_oahashIterator_done(&oh_iter_) == false; \
+       BLI_oahashIterator_step(&oh_iter_))
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name OAHash Creation Helpers
+ *
+ * Same hashing and comparison as the matching #GHash helpers.
+ * \{ */
+
+OAHash *BLI_oahash_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_ptr_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_str_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_str_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_int_new_ex(const char *info, const unsigned int nentries_reserve)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+OAHash *BLI_oahash_int_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+
+/** \} */
+
+#ifdef __cplusplus
+}
+#endif
@@ -48,6 +48,8 @@
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_strict_flags.h"
 
 /* used for iterative_raycast */
@@ -60,6 +62,8 @@
 // #define USE_VERIFY_TREE
 
 #define MAX_TREETYPE 32
+/* Enough for binary trees with INT_MAX leafs. */
+#define MAX_TREEDEPTH 32
 
 /* Setting zero so we can catch bugs in BLI_task/KDOPBVH.
  * TODO(sergey): Deduplicate the limits with PBVH from BKE.
@@ -107,6 +111,14 @@ BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 48) ||
                       (sizeof(void *) == 4 && sizeof(BVHTree) <= 32),
                   "over sized")
 
+/* Leaf bounds on the x, y and z axis while building the tree, stored next to each other so that
+ * partitioning the leafs doesn't have to follow the pointers to their nodes. */
+typedef struct BVHBuildLeaf {
+  /* Same layout as the start of #BVHNode.bv. */
+  float bv[6];
+  BVHNode *node;
+} BVHBuildLeaf;
+
 /* avoid duplicating vars in BVHOverlapData_Thread */
 typedef struct BVHOverlapData_Shared {
   const BVHTree *tree1, *tree2;
@@ -258,14 +270,14 @@ static void node_minmax_init(const BVHTree *tree, BVHNode *node)
 /**
  * Insertion sort algorithm
  */
-static void bvh_insertionsort(BVHNode **a, int lo, int hi, int axis)
+static void bvh_insertionsort(BVHBuildLeaf *a, int lo, int hi, int axis)
 {
   int i, j;
-  BVHNode *t;
+  BVHBuildLeaf t;
   for (i = lo; i < hi; i++) {
     j = i;
     t = a[i];
-    while ((j != lo) && (t->bv[axis] < (a[j - 1])->bv[axis])) {
+    while ((j != lo) && (t.bv[axis] < a[j - 1].bv[axis])) {
       a[j] = a[j - 1];
       j--;
     }
@@ -273,52 +285,53 @@ static void bvh_insertionsort(BVHNode **a, int lo, int hi, int axis)
   }
 }
 
-static int bvh_partition(BVHNode **a, int lo, int hi, BVHNode *x, int axis)
+static int bvh_partition(BVHBuildLeaf *a, int lo, int hi, const float x, int axis)
 {
   int i = lo, j = hi;
   while (1) {
-    while (a[i]->bv[axis] < x->bv[axis]) {
+    while (a[i].bv[axis] < x) {
       i++;
     }
     j--;
-    while (x->bv[axis] < a[j]->bv[axis]) {
+    while (x < a[j].bv[axis]) {
       j--;
     }
     if (!(i < j)) {
       return i;
     }
-    SWAP(BVHNode *, a[i], a[j]);
+    SWAP(BVHBuildLeaf, a[i], a[j]);
     i++;
   }
 }
 
 /* returns Sortable */
-static BVHNode *bvh_medianof3(BVHNode **a, int lo, int mid, int hi, int axis)
+static float bvh_medianof3(const BVHBuildLeaf *a, int lo, int mid, int hi, int axis)
 {
-  if ((a[mid])->bv[axis] < (a[lo])->bv[axis]) {
-    if ((a[hi])->bv[axis] < (a[mid])->bv[axis]) {
-      return a[mid];
+  if (a[mid].bv[axis] < a[lo].bv[axis]) {
+    if (a[hi].bv[axis] < a[mid].bv[axis]) {
+      return a[mid].bv[axis];
     }
-    if ((a[hi])->bv[axis] < (a[lo])->bv[axis]) {
-      return a[hi];
+    if (a[hi].bv[axis] < a[lo].bv[axis]) {
+      return a[hi].bv[axis];
     }
-    return a[lo];
+    return a[lo].bv[axis];
   }
 
-  if ((a[hi])->bv[axis] < (a[mid])->bv[axis]) {
-    if ((a[hi])->bv[axis] < (a[lo])->bv[axis]) {
-      return a[lo];
+  if (a[hi].bv[axis] < a[mid].bv[axis]) {
+    if (a[hi].bv[axis] < a[lo].bv[axis]) {
+      return a[lo].bv[axis];
     }
-    return a[hi];
+    return a[hi].bv[axis];
   }
-  return a[mid];
+  return a[mid].bv[axis];
 }
 
 /**
  * \note after a call to this function you can expect one of:
  * - every node to left of a[n] are smaller or equal to it
  * - every node to the right of a[n] are greater or equal to it */
-static void partition_nth_element(BVHNode **a, int begin, int end, const int n, const int axis)
+static void partition_nth_element(
+    BVHBuildLeaf *a, int begin, int end, const int n, const int axis)
 {
   while (end - begin > 3) {
     const int cut = bvh_partition(
@@ -384,36 +397,6 @@ static void create_kdop_hull(
   }
 }
 
-/**
- * \note depends on the fact that the BVH's for each face is already built
- */
-static void refit_kdop_hull(const BVHTree *tree, BVHNode *node, int start, int end)
-{
-  float newmin, newmax;
-  float *__restrict bv = node->bv;
-  int j;
-  axis_t axis_iter;
-
-  node_minmax_init(tree, node);
-
-  for (j = start; j < end; j++) {
-    float *__restrict node_bv = tree->nodes[j]->bv;
-
-    /* for all Axes. */
-    for (axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
-      newmin = node_bv[(2 * axis_iter)];
-      if ((newmin < bv[(2 * axis_iter)])) {
-        bv[(2 * axis_iter)] = newmin;
-      }
-
-      newmax = node_bv[(2 * axis_iter) + 1];
-      if ((newmax > bv[(2 * axis_iter) + 1])) {
-        bv[(2 * axis_iter) + 1] = newmax;
-      }
-    }
-  }
-}
-
 /**
  * only supports x,y,z axis in the moment
  * but we should use a plain and simple function here for speed sake */
@@ -661,6 +644,30 @@ static int implicit_needed_branches(int tree_type, int leafs)
   return max_ii(1, (leafs + tree_type - 3) / (tree_type - 1));
 }
 
+/**
+ * Fill in the index of the first branch on every depth of an implicit tree with `num_branches`,
+ * followed by the index the next depth would start at.
+ * Returns the number of depths that have branches.
+ */
+static int implicit_depth_first_branches(const int tree_type,
+                                         const int num_branches,
+                                         int r_first_branch[MAX_TREEDEPTH + 1])
+{
+  const int64_t tree_offset = 2 - tree_type;
+  int64_t first_branch = 1;
+  int depth = 0;
+
+  while (true) {
+    r_first_branch[depth] = (first_branch < INT_MAX) ? (int)first_branch : INT_MAX;
+    if (first_branch > num_branches) {
+      break;
+    }
+    first_branch = first_branch * tree_type + tree_offset;
+    depth++;
+  }
+  return depth;
+}
+
 /**
  * This function handles the problem of "sorting" the leafs (along the split_axis).
  *
@@ -671,57 +678,92 @@ static int implicit_needed_branches(int tree_type, int leafs)
  *
  * partition P is described as the elements in the range ( nth[P], nth[P+1] ]
  *
- * TODO: This can be optimized a bit by doing a specialized nth_element instead of K nth_elements
+ * Splitting off the first half of the partitions and then handling both halves separately
+ * visits every element log(K) times, instead of up to K times for K nth_elements in a row.
  */
-static void split_leafs(BVHNode **leafs_array,
+static void split_leafs(BVHBuildLeaf *leafs_array,
                         const int nth[],
                         const int partitions,
                         const int split_axis)
 {
-  int i;
-  for (i = 0; i < partitions - 1; i++) {
-    if (nth[i] >= nth[partitions]) {
-      break;
-    }
+  if (partitions < 2) {
+    return;
+  }
 
-    partition_nth_element(leafs_array, nth[i], nth[partitions], nth[i + 1], split_axis);
+  const int mid = partitions / 2;
+  if (nth[0] < nth[mid] && nth[mid] < nth[partitions]) {
+    partition_nth_element(leafs_array, nth[0], nth[partitions], nth[mid], split_axis);
+  }
+  split_leafs(leafs_array, nth, mid, split_axis);
+  split_leafs(leafs_array, nth + mid, partitions - mid, split_axis);
+}
+
+/**
+ * Bounds of the leafs in the given range on the x, y and z axis.
+ */
+static void bvh_leafs_minmax(const BVHBuildLeaf *leafs_array,
+                             const int begin,
+                             const int end,
+                             float r_bv[6])
+{
+  r_bv[0] = r_bv[2] = r_bv[4] = FLT_MAX;
+  r_bv[1] = r_bv[3] = r_bv[5] = -FLT_MAX;
+
+  for (int i = begin; i < end; i++) {
+    const float *leaf_bv = leafs_array[i].bv;
+    for (int axis = 0; axis < 6; axis += 2) {
+      r_bv[axis] = min_ff(r_bv[axis], leaf_bv[axis]);
+      r_bv[axis + 1] = max_ff(r_bv[axis + 1], leaf_bv[axis + 1]);
+    }
   }
 }
 
 typedef struct BVHDivNodesData {
   const BVHTree *tree;
   BVHNode *branches_array;
-  BVHNode **leafs_array;
+  BVHBuildLeaf *leafs_array;
 
   int tree_type;
   int tree_offset;
 
   const BVHBuildHelper *data;
 
-  int depth;
-  int i;
-  int first_of_next_level;
+  /** Index of the first branch on every depth, starting with the root at depth 1. */
+  int depth_first_branch[MAX_TREEDEPTH + 1];
+  int num_depths;
 } BVHDivNodesData;
 
-static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
-                                                const int j,
-                                                const TaskParallelTLS *__restrict UNUSED(tls))
+static int bvh_div_nodes_branch_depth(const BVHDivNodesData *data, const int branch_index)
 {
-  BVHDivNodesData *data = userdata;
+  int depth = 1;
+  while (depth < data->num_depths && data->depth_first_branch[depth] <= branch_index) {
+    depth++;
+  }
+  return depth;
+}
+
+static void bvh_div_nodes_task_cb(TaskPool *__restrict pool, void *taskdata);
 
+static void bvh_div_node(BVHDivNodesData *data,
+                         TaskPool *pool,
+                         const int branch_index,
+                         const int depth)
+{
   int k;
-  const int parent_level_index = j - data->i;
-  BVHNode *parent = &data->branches_array[j];
+  const int parent_level_index = branch_index - data->depth_first_branch[depth - 1];
+  const int first_of_next_level = data->depth_first_branch[depth];
+  BVHNode *parent = &data->branches_array[branch_index];
   int nth_positions[MAX_TREETYPE + 1];
+  float bv[6];
   char split_axis;
 
-  int parent_leafs_begin = implicit_leafs_index(data->data, data->depth, parent_level_index);
-  int parent_leafs_end = implicit_leafs_index(data->data, data->depth, parent_level_index + 1);
+  const int parent_leafs_begin = implicit_leafs_index(data->data, depth, parent_level_index);
+  const int parent_leafs_end = implicit_leafs_index(data->data, depth, parent_level_index + 1);
 
   /* This calculates the bounding box of this branch
    * and chooses the largest axis as the axis to divide leafs */
-  refit_kdop_hull(data->tree, parent, parent_leafs_begin, parent_leafs_end);
-  split_axis = get_largest_axis(parent->bv);
+  bvh_leafs_minmax(data->leafs_array, parent_leafs_begin, parent_leafs_end, bv);
+  split_axis = get_largest_axis(bv);
 
   /* Save split axis (this can be used on ray-tracing to speedup the query time) */
   parent->main_axis = split_axis / 2;
@@ -733,10 +775,10 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
   nth_positions[0] = parent_leafs_begin;
   nth_positions[data->tree_type] = parent_leafs_end;
   for (k = 1; k < data->tree_type; k++) {
-    const int child_index = j * data->tree_type + data->tree_offset + k;
+    const int child_index = branch_index * data->tree_type + data->tree_offset + k;
     /* child level index */
-    const int child_level_index = child_index - data->first_of_next_level;
-    nth_positions[k] = implicit_leafs_index(data->data, data->depth + 1, child_level_index);
+    const int child_level_index = child_index - first_of_next_level;
+    nth_positions[k] = implicit_leafs_index(data->data, depth + 1, child_level_index);
   }
 
   split_leafs(data->leafs_array, nth_positions, data->tree_type, split_axis);
@@ -745,21 +787,28 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
    * Not really needed but currently most of BVH code
    * relies on having an explicit children structure */
   for (k = 0; k < data->tree_type; k++) {
-    const int child_index = j * data->tree_type + data->tree_offset + k;
+    const int child_index = branch_index * data->tree_type + data->tree_offset + k;
     /* child level index */
-    const int child_level_index = child_index - data->first_of_next_level;
+    const int child_level_index = child_index - first_of_next_level;
 
-    const int child_leafs_begin = implicit_leafs_index(
-        data->data, data->depth + 1, child_level_index);
+    const int child_leafs_begin = implicit_leafs_index(data->data, depth + 1, child_level_index);
     const int child_leafs_end = implicit_leafs_index(
-        data->data, data->depth + 1, child_level_index + 1);
+        data->data, depth + 1, child_level_index + 1);
 
     if (child_leafs_end - child_leafs_begin > 1) {
       parent->children[k] = &data->branches_array[child_index];
       parent->children[k]->parent = parent;
+
+      /* The leafs of the child are only touched by the child's subtree from here on. */
+      if (pool && (child_leafs_end - child_leafs_begin > KDOPBVH_THREAD_LEAF_THRESHOLD)) {
+        BLI_task_pool_push(pool, bvh_div_nodes_task_cb, POINTER_FROM_INT(child_index), false, NULL);
+      }
+      else {
+        bvh_div_node(data, pool, child_index, depth + 1);
+      }
     }
     else if (child_leafs_end - child_leafs_begin == 1) {
-      parent->children[k] = data->leafs_array[child_leafs_begin];
+      parent->children[k] = data->leafs_array[child_leafs_begin].node;
       parent->children[k]->parent = parent;
     }
     else {
@@ -769,6 +818,14 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
   parent->totnode = (char)k;
 }
 
+static void bvh_div_nodes_task_cb(TaskPool *__restrict pool, void *taskdata)
+{
+  BVHDivNodesData *data = BLI_task_pool_user_data(pool);
+  const int branch_index = POINTER_AS_INT(taskdata);
+
+  bvh_div_node(data, pool, branch_index, bvh_div_nodes_branch_depth(data, branch_index));
+}
+
 /**
  * This functions builds an optimal implicit tree from the given leafs.
  * Where optimal stands for:
@@ -779,21 +836,22 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
  * This function creates an implicit tree on branches_array,
  * the leafs are given on the leafs_array.
  *
- * The tree is built per depth levels. First branches at depth 1.. then branches at depth 2.. etc..
- * The reason is that we can build level N+1 from level N without any data dependencies..
- * thus it allows to use multi-thread building.
+ * The tree is built top-down. Which leafs end up below a branch only depends on its parent,
+ * so subtrees with many leafs are divided in separate tasks, while small subtrees are divided
+ * depth first by the thread that split them off, while their leafs are still in its cache.
+ *
+ * Only the bounds on the x, y and z axis are needed to divide the leafs,
+ * the bounding volumes of the branches are computed afterwards by #BLI_bvhtree_update_tree.
  *
  * To archive this is necessary to find how much leafs are accessible from a certain branch,
  * #BVHBuildHelper, #implicit_needed_branches and #implicit_leafs_index
  * are auxiliary functions to solve that "optimal-split".
  */
-static void non_recursive_bvh_div_nodes(const BVHTree *tree,
-                                        BVHNode *branches_array,
-                                        BVHNode **leafs_array,
-                                        int num_leafs)
+static void bvh_div_nodes(const BVHTree *tree,
+                          BVHNode *branches_array,
+                          BVHBuildLeaf *leafs_array,
+                          int num_leafs)
 {
-  int i;
-
   const int tree_type = tree->tree_type;
   /* this value is 0 (on binary trees) and negative on the others */
   const int tree_offset = 2 - tree->tree_type;
@@ -801,7 +859,6 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
   const int num_branches = implicit_needed_branches(tree_type, num_leafs);
 
   BVHBuildHelper data;
-  int depth;
 
   {
     /* set parent from root node to NULL */
@@ -811,10 +868,9 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
     /* Most of bvhtree code relies on 1-leaf trees having at least one branch
      * We handle that special case here */
     if (num_leafs == 1) {
-      refit_kdop_hull(tree, root, 0, num_leafs);
-      root->main_axis = get_largest_axis(root->bv) / 2;
+      root->main_axis = get_largest_axis(leafs_array[0].bv) / 2;
       root->totnode = 1;
-      root->children[0] = leafs_array[0];
+      root->children[0] = leafs_array[0].node;
       root->children[0]->parent = root;
       return;
     }
@@ -829,35 +885,19 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
       .tree_type = tree_type,
       .tree_offset = tree_offset,
       .data = &data,
-      .first_of_next_level = 0,
-      .depth = 0,
-      .i = 0,
   };
+  cb_data.num_depths = implicit_depth_first_branches(
+      tree_type, num_branches, cb_data.depth_first_branch);
 
-  /* Loop tree levels (log N) loops */
-  for (i = 1, depth = 1; i <= num_branches; i = i * tree_type + tree_offset, depth++) {
-    const int first_of_next_level = i * tree_type + tree_offset;
-    /* index of last branch on this level */
-    const int i_stop = min_ii(first_of_next_level, num_branches + 1);
-
-    /* Loop all branches on this level */
-    cb_data.first_of_next_level = first_of_next_level;
-    cb_data.i = i;
-    cb_data.depth = depth;
-
-    if (true) {
-      TaskParallelSettings settings;
-      BLI_parallel_range_settings_defaults(&settings);
-      settings.use_threading = (num_leafs > KDOPBVH_THREAD_LEAF_THRESHOLD);
-      BLI_task_parallel_range(i, i_stop, &cb_data, non_recursive_bvh_div_nodes_task_cb, &settings);
-    }
-    else {
-      /* Less hassle for debugging. */
-      TaskParallelTLS tls = {0};
-      for (int i_task = i; i_task < i_stop; i_task++) {
-        non_recursive_bvh_div_nodes_task_cb(&cb_data, i_task, &tls);
-      }
-    }
+  if (num_leafs > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+    TaskPool *pool = BLI_task_pool_create(&cb_data, TASK_PRIORITY_HIGH);
+    BLI_task_pool_push(pool, bvh_div_nodes_task_cb, POINTER_FROM_INT(1), false, NULL);
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+  }
+  else {
+    /* Not worth the overhead of a task pool. */
+    bvh_div_node(&cb_data, NULL, 1, 1);
   }
 }
 
@@ -953,17 +993,52 @@ void BLI_bvhtree_free(BVHTree *tree)
   }
 }
 
+typedef struct BVHBuildLeafsData {
+  const BVHTree *tree;
+  BVHBuildLeaf *build_leafs;
+} BVHBuildLeafsData;
+
+static void bvhtree_build_leafs_cb(void *__restrict userdata,
+                                   const int i,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHBuildLeafsData *data = userdata;
+  BVHNode *node = data->tree->nodes[i];
+
+  memcpy(data->build_leafs[i].bv, node->bv, sizeof(data->build_leafs[i].bv));
+  data->build_leafs[i].node = node;
+}
+
 void BLI_bvhtree_balance(BVHTree *tree)
 {
   BVHNode **leafs_array = tree->nodes;
+  BVHBuildLeaf *build_leafs;
 
   /* This function should only be called once
    * (some big bug goes here if its being called more than once per tree) */
   BLI_assert(tree->totbranch == 0);
 
+  build_leafs = MEM_malloc_arrayN(
+      (size_t)max_ii(tree->totleaf, 1), sizeof(*build_leafs), "BVHBuildLeaf");
+  {
+    BVHBuildLeafsData data = {
+        .tree = tree,
+        .build_leafs = build_leafs,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = (tree->totleaf > KDOPBVH_THREAD_LEAF_THRESHOLD);
+    BLI_task_parallel_range(0, tree->totleaf, &data, bvhtree_build_leafs_cb, &settings);
+  }
+
   /* Build the implicit tree */
-  non_recursive_bvh_div_nodes(
-      tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
+  bvh_div_nodes(tree, tree->nodearray + (tree->totleaf - 1), build_leafs, tree->totleaf);
+
+  /* Keep the leafs in the order they were divided in. */
+  for (int i = 0; i < tree->totleaf; i++) {
+    leafs_array[i] = build_leafs[i].node;
+  }
+  MEM_freeN(build_leafs);
 
   /* current code expects the branches to be linked to the nodes array
    * we perform that linkage here */
@@ -972,6 +1047,8 @@ void BLI_bvhtree_balance(BVHTree *tree)
     tree->nodes[tree->totleaf + i] = &tree->nodearray[tree->totleaf + i];
   }
 
+  BLI_bvhtree_update_tree(tree);
+
 #ifdef USE_SKIP_LINKS
   build_skip_links(tree, tree->nodes[tree->totleaf], NULL, NULL);
 #endif
@@ -1013,6 +1090,30 @@ void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoin
   bvhtree_node_inflate(tree, node, tree->epsilon);
 }
 
+/**
+ * Thread-safe version of #BLI_bvhtree_insert, which stores the leaf at `leaf_index` instead of
+ * after the previously inserted one, so that leafs can be inserted in parallel.
+ * Every leaf index up to the number of leafs must be inserted exactly once.
+ */
+void BLI_bvhtree_insert_leaf(
+    BVHTree *tree, int leaf_index, int index, const float co[3], int numpoints)
+{
+  BVHNode *node = &tree->nodearray[leaf_index];
+
+  BLI_assert(tree->totbranch <= 0);
+  BLI_assert((size_t)leaf_index < MEM_allocN_len(tree->nodes) / sizeof(*(tree->nodes)));
+
+  tree->nodes[leaf_index] = node;
+
+  create_kdop_hull(tree, node, co, numpoints, 0);
+  node->index = index;
+
+  /* inflate the bv with some epsilon */
+  bvhtree_node_inflate(tree, node, tree->epsilon);
+
+  atomic_add_and_fetch_int32((int32_t *)&tree->totleaf, 1);
+}
+
 /* call before BLI_bvhtree_update_tree() */
 bool BLI_bvhtree_update_node(
     BVHTree *tree, int index, const float co[3], const float co_moving[3], int numpoints)
@@ -1038,20 +1139,36 @@ bool BLI_bvhtree_update_node(
   return true;
 }
 
+static void bvhtree_update_tree_cb(void *__restrict userdata,
+                                   const int i,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHTree *tree = userdata;
+  node_join(tree, tree->nodes[tree->totleaf + i]);
+}
+
 /**
  * Call #BLI_bvhtree_update_node() first for every node/point/triangle.
  */
 void BLI_bvhtree_update_tree(BVHTree *tree)
 {
   /* Update bottom=>top
-   * TRICKY: the way we build the tree all the children have an index greater than the parent
-   * This allows us todo a bottom up update by starting on the bigger numbered branch. */
-
-  BVHNode **root = tree->nodes + tree->totleaf;
-  BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
-
-  for (; index >= root; index--) {
-    node_join(tree, *index);
+   * TRICKY: the way we build the tree all the children have an index greater than the parent,
+   * and the children of all branches on one depth are on the next depth. This allows us todo a
+   * bottom up update by joining all branches of a depth in parallel, starting on the deepest. */
+  int depth_first_branch[MAX_TREEDEPTH + 1];
+  const int num_depths = implicit_depth_first_branches(
+      tree->tree_type, tree->totbranch, depth_first_branch);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (tree->totleaf > KDOPBVH_THREAD_LEAF_THRESHOLD);
+
+  for (int depth = num_depths - 1; depth >= 0; depth--) {
+    /* Branch indices start at 1 for the root. */
+    const int begin = depth_first_branch[depth] - 1;
+    const int end = min_ii(depth_first_branch[depth + 1] - 1, tree->totbranch);
+    BLI_task_parallel_range(begin, end, tree, bvhtree_update_tree_cb, &settings);
   }
 }
 /**
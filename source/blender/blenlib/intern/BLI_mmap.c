@@ -0,0 +1,227 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * When an IO error occurs while accessing mapped memory (the file was truncated by another
+ * process, a network drive went away...) the OS raises `SIGBUS`. We install a handler that
+ * checks whether the faulting address belongs to one of our mappings, and if so replaces the
+ * mapping by zeroed memory and flags the file, so the error can be reported instead of crashing.
+ */
+
+#include "BLI_mmap.h"
+#include "BLI_fileops.h"
+#include "BLI_threads.h"
+#include "MEM_guardedalloc.h"
+
+#include <string.h>
+
+#ifndef WIN32
+#  include <signal.h>
+#  include <stdio.h>
+#  include <stdlib.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+struct BLI_mmap_file {
+  /* The address to which the file was mapped. */
+  char *memory;
+
+  /* The length of the file (and therefore the mapped region). */
+  size_t length;
+
+  /* Flag to indicate IO errors. Needs to be volatile since it's being set from
+   * within the signal handler, which is not part of the normal execution flow. */
+  volatile bool io_error;
+};
+
+#ifndef WIN32
+
+/* Slots for the files that are currently mapped. A fixed size array is used (instead of a list)
+ * so the signal handler can inspect it without taking a lock. */
+#  define MMAP_FILES_MAX 64
+
+static struct {
+  BLI_mmap_file *volatile files[MMAP_FILES_MAX];
+  bool configured;
+  struct sigaction next_handler;
+} mmap_error_handler = {{NULL}};
+
+static ThreadMutex mmap_error_handler_mutex = BLI_MUTEX_INITIALIZER;
+
+static void sigbus_handler(int sig, siginfo_t *siginfo, void *ptr)
+{
+  const char *error_addr = (const char *)siginfo->si_addr;
+
+  for (int i = 0; i < MMAP_FILES_MAX; i++) {
+    BLI_mmap_file *file = mmap_error_handler.files[i];
+    if (file == NULL) {
+      continue;
+    }
+    if (error_addr >= file->memory && error_addr < file->memory + file->length) {
+      file->io_error = true;
+      /* Replace the mapped memory with zeroes, so the faulting access can complete. */
+      const void *mapped_memory = mmap(
+          file->memory, file->length, PROT_READ, MAP_FIXED | MAP_PRIVATE | MAP_ANON, -1, 0);
+      if (mapped_memory == MAP_FAILED) {
+        fprintf(stderr, "SIGBUS handler: Error replacing mapped file with zeros\n");
+      }
+      return;
+    }
+  }
+
+  /* Fall back to the previous handler. */
+  if (mmap_error_handler.next_handler.sa_flags & SA_SIGINFO) {
+    mmap_error_handler.next_handler.sa_sigaction(sig, siginfo, ptr);
+  }
+  else if (!ELEM(mmap_error_handler.next_handler.sa_handler, SIG_DFL, SIG_IGN)) {
+    mmap_error_handler.next_handler.sa_handler(sig);
+  }
+  else {
+    fprintf(stderr, "Unhandled SIGBUS caught\n");
+    abort();
+  }
+}
+
+/* Ensures that the error handler is set up and ready.
+ * Must be called with #mmap_error_handler_mutex locked. */
+static bool sigbus_handler_setup(void)
+{
+  if (!mmap_error_handler.configured) {
+    struct sigaction newact = {0}, oldact = {0};
+
+    newact.sa_sigaction = sigbus_handler;
+    newact.sa_flags = SA_SIGINFO;
+
+    if (sigaction(SIGBUS, &newact, &oldact)) {
+      return false;
+    }
+
+    mmap_error_handler.next_handler = oldact;
+    mmap_error_handler.configured = true;
+  }
+  return true;
+}
+
+/* Registers the mapping with the error handler.
+ * \return false when no slot is available (the file shouldn't be mapped then). */
+static bool sigbus_handler_add(BLI_mmap_file *file)
+{
+  bool added = false;
+  BLI_mutex_lock(&mmap_error_handler_mutex);
+  if (sigbus_handler_setup()) {
+    for (int i = 0; i < MMAP_FILES_MAX; i++) {
+      if (mmap_error_handler.files[i] == NULL) {
+        mmap_error_handler.files[i] = file;
+        added = true;
+        break;
+      }
+    }
+  }
+  BLI_mutex_unlock(&mmap_error_handler_mutex);
+  return added;
+}
+
+static void sigbus_handler_remove(BLI_mmap_file *file)
+{
+  BLI_mutex_lock(&mmap_error_handler_mutex);
+  for (int i = 0; i < MMAP_FILES_MAX; i++) {
+    if (mmap_error_handler.files[i] == file) {
+      mmap_error_handler.files[i] = NULL;
+      break;
+    }
+  }
+  BLI_mutex_unlock(&mmap_error_handler_mutex);
+}
+
+#endif /* !WIN32 */
+
+BLI_mmap_file *BLI_mmap_open(int fd)
+{
+#ifdef WIN32
+  /* Not supported yet: page faults caused by IO errors would need structured exception handling
+   * around every access. Callers fall back to regular reading. */
+  UNUSED_VARS(fd);
+  return NULL;
+#else
+  void *memory;
+  const int64_t length = BLI_lseek(fd, 0, SEEK_END);
+  if (length <= 0) {
+    return NULL;
+  }
+
+  memory = mmap(NULL, (size_t)length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (memory == MAP_FAILED) {
+    return NULL;
+  }
+
+  /* Now that the mapping was successful, allocate memory and set up the BLI_mmap_file. */
+  BLI_mmap_file *file = MEM_callocN(sizeof(BLI_mmap_file), __func__);
+  file->memory = memory;
+  file->length = (size_t)length;
+
+  /* Register the file with the error handler, only then errors can be caught. */
+  if (!sigbus_handler_add(file)) {
+    munmap(memory, (size_t)length);
+    MEM_freeN(file);
+    return NULL;
+  }
+
+  return file;
+#endif
+}
+
+bool BLI_mmap_read(BLI_mmap_file *file, void *dest, size_t offset, size_t length)
+{
+  /* If a previous read has already failed or we try to read past the end,
+   * don't even attempt to read any further. */
+  if (file->io_error || (offset > file->length) || (length > file->length - offset)) {
+    return false;
+  }
+
+  memcpy(dest, file->memory + offset, length);
+
+  /* If an error occurred in this call, sigbus_handler will have been called
+   * and flagged the file. */
+  return !file->io_error;
+}
+
+const void *BLI_mmap_get_pointer(BLI_mmap_file *file)
+{
+  return file->memory;
+}
+
+size_t BLI_mmap_get_length(const BLI_mmap_file *file)
+{
+  return file->length;
+}
+
+bool BLI_mmap_has_io_error(const BLI_mmap_file *file)
+{
+  return file->io_error;
+}
+
+void BLI_mmap_free(BLI_mmap_file *file)
+{
+#ifndef WIN32
+  sigbus_handler_remove(file);
+  munmap((void *)file->memory, file->length);
+#endif
+
+  MEM_freeN(file);
+}
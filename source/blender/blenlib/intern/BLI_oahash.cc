@@ -0,0 +1,545 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * The implementation follows `blender::Map`, but the hash and comparison functions are only known
+ * at runtime and keys & values are untyped pointers, as with #GHash.
+ */
+
+#include "BLI_array.hh"
+#include "BLI_hash_tables.hh"
+#include "BLI_oahash.h"
+#include "BLI_probing_strategies.hh"
+#include "BLI_utildefines.h"
+
+enum eOAHashSlotState : uint32_t {
+  OAHASH_SLOT_EMPTY = 0,
+  OAHASH_SLOT_OCCUPIED = 1,
+  OAHASH_SLOT_REMOVED = 2,
+};
+
+/** Layout is shared with the iterator in the header. */
+struct OAHashSlot {
+  void *key = nullptr;
+  void *val = nullptr;
+  uint32_t hash = 0;
+  uint32_t state = OAHASH_SLOT_EMPTY;
+};
+
+BLI_STATIC_ASSERT(sizeof(OAHashSlot) == sizeof(void *) * 2 + sizeof(uint32_t) * 2,
+                  "OAHashSlot must match the slot layout of BLI_oahash.h")
+
+struct OAHash {
+  using ProbingStrategy = blender::DefaultProbingStrategy;
+  /* One inline slot, so an empty table doesn't allocate. */
+  using SlotArray = blender::Array<OAHashSlot, 1>;
+
+  GHashHashFP hashfp;
+  GHashCmpFP cmpfp;
+
+  int64_t removed_slots = 0;
+  int64_t occupied_and_removed_slots = 0;
+  int64_t usable_slots = 0;
+  uint64_t slot_mask = 0;
+
+  /* Same as the default of `blender::Map`. */
+  blender::LoadFactor max_load_factor = blender::LoadFactor(1, 2);
+
+  SlotArray slots = SlotArray(1);
+
+  OAHash(GHashHashFP hashfp, GHashCmpFP cmpfp) : hashfp(hashfp), cmpfp(cmpfp)
+  {
+  }
+
+  int64_t size() const
+  {
+    return occupied_and_removed_slots - removed_slots;
+  }
+
+  const OAHashSlot *lookup_slot(const void *key) const
+  {
+    const uint32_t hash = hashfp(key);
+    SLOT_PROBING_BEGIN (ProbingStrategy, hash, slot_mask, slot_index) {
+      const OAHashSlot &slot = slots[slot_index];
+      if (slot.state == OAHASH_SLOT_EMPTY) {
+        return nullptr;
+      }
+      if (slot.state == OAHASH_SLOT_OCCUPIED && slot.hash == hash && !cmpfp(key, slot.key)) {
+        return &slot;
+      }
+    }
+    SLOT_PROBING_END();
+  }
+
+  OAHashSlot *lookup_slot(const void *key)
+  {
+    return const_cast<OAHashSlot *>(const_cast<const OAHash *>(this)->lookup_slot(key));
+  }
+
+  /** Returns the slot of the key, or an empty slot to be occupied by the caller. */
+  OAHashSlot &lookup_or_add_slot(const void *key)
+  {
+    this->ensure_can_add();
+    const uint32_t hash = hashfp(key);
+    SLOT_PROBING_BEGIN (ProbingStrategy, hash, slot_mask, slot_index) {
+      OAHashSlot &slot = slots[slot_index];
+      if (slot.state == OAHASH_SLOT_EMPTY) {
+        slot.hash = hash;
+        return slot;
+      }
+      if (slot.state == OAHASH_SLOT_OCCUPIED && slot.hash == hash && !cmpfp(key, slot.key)) {
+        return slot;
+      }
+    }
+    SLOT_PROBING_END();
+  }
+
+  void occupy(OAHashSlot &slot, void *key, void *val)
+  {
+    BLI_assert(slot.state == OAHASH_SLOT_EMPTY);
+    slot.key = key;
+    slot.val = val;
+    slot.state = OAHASH_SLOT_OCCUPIED;
+    occupied_and_removed_slots++;
+  }
+
+  void add_new(void *key, void *val)
+  {
+    BLI_assert(this->lookup_slot(key) == nullptr);
+    this->ensure_can_add();
+    const uint32_t hash = hashfp(key);
+    SLOT_PROBING_BEGIN (ProbingStrategy, hash, slot_mask, slot_index) {
+      OAHashSlot &slot = slots[slot_index];
+      if (slot.state == OAHASH_SLOT_EMPTY) {
+        slot.hash = hash;
+        this->occupy(slot, key, val);
+        return;
+      }
+    }
+    SLOT_PROBING_END();
+  }
+
+  void remove_slot(OAHashSlot &slot)
+  {
+    slot.state = OAHASH_SLOT_REMOVED;
+    removed_slots++;
+  }
+
+  void ensure_can_add()
+  {
+    if (occupied_and_removed_slots >= usable_slots) {
+      this->realloc_and_reinsert(this->size() + 1);
+      BLI_assert(occupied_and_removed_slots < usable_slots);
+    }
+  }
+
+  BLI_NOINLINE void realloc_and_reinsert(const int64_t min_usable_slots)
+  {
+    int64_t total_slots, new_usable_slots;
+    max_load_factor.compute_total_and_usable_slots(
+        SlotArray::inline_buffer_capacity(), min_usable_slots, &total_slots, &new_usable_slots);
+    const uint64_t new_slot_mask = static_cast<uint64_t>(total_slots) - 1;
+
+    SlotArray new_slots(total_slots);
+    if (this->size() != 0) {
+      for (const OAHashSlot &old_slot : slots) {
+        if (old_slot.state != OAHASH_SLOT_OCCUPIED) {
+          continue;
+        }
+        add_after_grow(old_slot, new_slots, new_slot_mask);
+      }
+    }
+    slots = std::move(new_slots);
+
+    occupied_and_removed_slots -= removed_slots;
+    removed_slots = 0;
+    usable_slots = new_usable_slots;
+    slot_mask = new_slot_mask;
+  }
+
+  static void add_after_grow(const OAHashSlot &old_slot,
+                             SlotArray &new_slots,
+                             const uint64_t new_slot_mask)
+  {
+    SLOT_PROBING_BEGIN (ProbingStrategy, old_slot.hash, new_slot_mask, slot_index) {
+      OAHashSlot &slot = new_slots[slot_index];
+      if (slot.state == OAHASH_SLOT_EMPTY) {
+        slot = old_slot;
+        return;
+      }
+    }
+    SLOT_PROBING_END();
+  }
+
+  void free_items(GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+  {
+    if (keyfreefp == nullptr && valfreefp == nullptr) {
+      return;
+    }
+    for (OAHashSlot &slot : slots) {
+      if (slot.state == OAHASH_SLOT_OCCUPIED) {
+        if (keyfreefp) {
+          keyfreefp(slot.key);
+        }
+        if (valfreefp) {
+          valfreefp(slot.val);
+        }
+      }
+    }
+  }
+};
+
+/* -------------------------------------------------------------------- */
+/** \name OAHash API
+ * \{ */
+
+/**
+ * Creates a new, empty OAHash.
+ *
+ * \param hashfp: Hash callback.
+ * \param cmpfp: Comparison callback.
+ * \param info: Identifier string for the OAHash (unused, for compatibility with #GHash).
+ * \param nentries_reserve: Optionally reserve the number of members that the hash will hold.
+ * Use this to avoid resizing buckets if the size is known or can be closely approximated.
+ * \return  An empty OAHash.
+ */
+OAHash *BLI_oahash_new_ex(GHashHashFP hashfp,
+                          GHashCmpFP cmpfp,
+                          const char *UNUSED(info),
+                          const unsigned int nentries_reserve)
+{
+  OAHash *oh = new OAHash(hashfp, cmpfp);
+  if (nentries_reserve) {
+    oh->realloc_and_reinsert(nentries_reserve);
+  }
+  return oh;
+}
+
+/**
+ * Wraps #BLI_oahash_new_ex with zero entries reserved.
+ */
+OAHash *BLI_oahash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+  return BLI_oahash_new_ex(hashfp, cmpfp, info, 0);
+}
+
+/**
+ * Frees the OAHash and its members.
+ *
+ * \param oh: The OAHash to free.
+ * \param keyfreefp: Optional callback to free the key.
+ * \param valfreefp: Optional callback to free the value.
+ */
+void BLI_oahash_free(OAHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  oh->free_items(keyfreefp, valfreefp);
+  delete oh;
+}
+
+/**
+ * Reserve given amount of entries (resize \a oh accordingly if needed).
+ */
+void BLI_oahash_reserve(OAHash *oh, const unsigned int nentries_reserve)
+{
+  if (oh->usable_slots < nentries_reserve) {
+    oh->realloc_and_reinsert(nentries_reserve);
+  }
+}
+
+/**
+ * Insert a key/value pair into the \a oh.
+ *
+ * \note Duplicates are not checked,
+ * the caller is expected to ensure elements are unique.
+ */
+void BLI_oahash_insert(OAHash *oh, void *key, void *val)
+{
+  oh->add_new(key, val);
+}
+
+/**
+ * Inserts a new value to a key that may already be in OAHash.
+ *
+ * Avoids #BLI_oahash_remove, #BLI_oahash_insert calls (double lookups)
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_oahash_reinsert(
+    OAHash *oh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  OAHashSlot &slot = oh->lookup_or_add_slot(key);
+  if (slot.state == OAHASH_SLOT_EMPTY) {
+    oh->occupy(slot, key, val);
+    return true;
+  }
+  if (keyfreefp) {
+    keyfreefp(slot.key);
+  }
+  if (valfreefp) {
+    valfreefp(slot.val);
+  }
+  slot.key = key;
+  slot.val = val;
+  return false;
+}
+
+/**
+ * Lookup the value of \a key in \a oh.
+ *
+ * \param key: The key to lookup.
+ * \returns the value for \a key or NULL.
+ */
+void *BLI_oahash_lookup(const OAHash *oh, const void *key)
+{
+  const OAHashSlot *slot = oh->lookup_slot(key);
+  return slot ? slot->val : nullptr;
+}
+
+/**
+ * A version of #BLI_oahash_lookup which accepts a fallback argument.
+ */
+void *BLI_oahash_lookup_default(const OAHash *oh, const void *key, void *val_default)
+{
+  const OAHashSlot *slot = oh->lookup_slot(key);
+  return slot ? slot->val : val_default;
+}
+
+/**
+ * Lookup a pointer to the value of \a key in \a oh.
+ *
+ * \param key: The key to lookup.
+ * \returns the pointer to value for \a key or NULL.
+ *
+ * \note The pointer is only valid until the next insertion.
+ */
+void **BLI_oahash_lookup_p(OAHash *oh, const void *key)
+{
+  OAHashSlot *slot = oh->lookup_slot(key);
+  return slot ? &slot->val : nullptr;
+}
+
+/**
+ * Ensure \a key is exists in \a oh.
+ *
+ * This handles the common situation where the caller needs ensure a key is added to \a oh,
+ * constructing a new value in the case the key isn't found.
+ * Otherwise use the existing value.
+ *
+ * \returns true when the value didn't need to be added.
+ * (when false, the caller _must_ initialize the value).
+ */
+bool BLI_oahash_ensure_p(OAHash *oh, void *key, void ***r_val)
+{
+  OAHashSlot &slot = oh->lookup_or_add_slot(key);
+  const bool haskey = (slot.state != OAHASH_SLOT_EMPTY);
+  if (!haskey) {
+    oh->occupy(slot, key, nullptr);
+  }
+  *r_val = &slot.val;
+  return haskey;
+}
+
+/**
+ * A version of #BLI_oahash_ensure_p that allows caller to re-assign the key.
+ * Typically used when the key is to be duplicated.
+ *
+ * \warning Caller _must_ write to \a r_key when returning false.
+ */
+bool BLI_oahash_ensure_p_ex(OAHash *oh, const void *key, void ***r_key, void ***r_val)
+{
+  OAHashSlot &slot = oh->lookup_or_add_slot(key);
+  const bool haskey = (slot.state != OAHASH_SLOT_EMPTY);
+  if (!haskey) {
+    /* Until the caller assigns the key, the slot keeps 'key' (its hash is stored in the slot). */
+    oh->occupy(slot, (void *)key, nullptr);
+  }
+  *r_key = &slot.key;
+  *r_val = &slot.val;
+  return haskey;
+}
+
+/**
+ * Remove \a key from \a oh, or return false if the key wasn't found.
+ *
+ * \param key: The key to remove.
+ * \param keyfreefp: Optional callback to free the key.
+ * \param valfreefp: Optional callback to free the value.
+ * \return true if \a key was removed from \a oh.
+ */
+bool BLI_oahash_remove(OAHash *oh,
+                       const void *key,
+                       GHashKeyFreeFP keyfreefp,
+                       GHashValFreeFP valfreefp)
+{
+  OAHashSlot *slot = oh->lookup_slot(key);
+  if (slot == nullptr) {
+    return false;
+  }
+  if (keyfreefp) {
+    keyfreefp(slot->key);
+  }
+  if (valfreefp) {
+    valfreefp(slot->val);
+  }
+  oh->remove_slot(*slot);
+  return true;
+}
+
+/**
+ * Remove \a key from \a oh, returning the value or NULL if the key wasn't found.
+ *
+ * \param key: The key to remove.
+ * \param keyfreefp: Optional callback to free the key.
+ * \return the value of \a key int \a oh or NULL.
+ */
+void *BLI_oahash_popkey(OAHash *oh, const void *key, GHashKeyFreeFP keyfreefp)
+{
+  OAHashSlot *slot = oh->lookup_slot(key);
+  if (slot == nullptr) {
+    return nullptr;
+  }
+  void *val = slot->val;
+  if (keyfreefp) {
+    keyfreefp(slot->key);
+  }
+  oh->remove_slot(*slot);
+  return val;
+}
+
+/**
+ * Reset \a oh clearing all entries.
+ *
+ * \param keyfreefp: Optional callback to free the key.
+ * \param valfreefp: Optional callback to free the value.
+ * \param nentries_reserve: Optionally reserve the number of members that the hash will hold.
+ */
+void BLI_oahash_clear_ex(OAHash *oh,
+                         GHashKeyFreeFP keyfreefp,
+                         GHashValFreeFP valfreefp,
+                         const unsigned int nentries_reserve)
+{
+  oh->free_items(keyfreefp, valfreefp);
+
+  oh->slots = OAHash::SlotArray(1);
+  oh->removed_slots = 0;
+  oh->occupied_and_removed_slots = 0;
+  oh->usable_slots = 0;
+  oh->slot_mask = 0;
+  if (nentries_reserve) {
+    oh->realloc_and_reinsert(nentries_reserve);
+  }
+}
+
+/**
+ * Wraps #BLI_oahash_clear_ex with zero entries reserved.
+ */
+void BLI_oahash_clear(OAHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+  BLI_oahash_clear_ex(oh, keyfreefp, valfreefp, 0);
+}
+
+/**
+ * \return true if the \a key is in \a oh.
+ */
+bool BLI_oahash_haskey(const OAHash *oh, const void *key)
+{
+  return oh->lookup_slot(key) != nullptr;
+}
+
+/**
+ * \return size of the OAHash.
+ */
+unsigned int BLI_oahash_len(const OAHash *oh)
+{
+  return static_cast<unsigned int>(oh->size());
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name OAHash Iterator API
+ * \{ */
+
+static OAHashSlot *oahash_slot_skip_unoccupied(OAHashSlot *slot, OAHashSlot *slot_end)
+{
+  while (slot != slot_end && slot->state != OAHASH_SLOT_OCCUPIED) {
+    slot++;
+  }
+  return slot;
+}
+
+/**
+ * Init an already allocated OAHashIterator.
+ * The hash table must not be mutated while iterating (except for removing the current item).
+ *
+ * \param ohi: The OAHashIterator to initialize.
+ * \param oh: The OAHash to iterate over.
+ */
+void BLI_oahashIterator_init(OAHashIterator *ohi, OAHash *oh)
+{
+  ohi->oh = oh;
+  ohi->endSlot = oh->slots.end();
+  ohi->curSlot = oahash_slot_skip_unoccupied(oh->slots.begin(), ohi->endSlot);
+}
+
+/**
+ * Steps the iterator to the next index.
+ *
+ * \param ohi: The iterator.
+ */
+void BLI_oahashIterator_step(OAHashIterator *ohi)
+{
+  if (ohi->curSlot != ohi->endSlot) {
+    ohi->curSlot = oahash_slot_skip_unoccupied(ohi->curSlot + 1, ohi->endSlot);
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name OAHash Creation Helpers
+ * \{ */
+
+OAHash *BLI_oahash_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+  return BLI_oahash_new_ex(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info, nentries_reserve);
+}
+OAHash *BLI_oahash_ptr_new(const char *info)
+{
+  return BLI_oahash_ptr_new_ex(info, 0);
+}
+
+OAHash *BLI_oahash_str_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+  return BLI_oahash_new_ex(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, info, nentries_reserve);
+}
+OAHash *BLI_oahash_str_new(const char *info)
+{
+  return BLI_oahash_str_new_ex(info, 0);
+}
+
+OAHash *BLI_oahash_int_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+  return BLI_oahash_new_ex(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, info, nentries_reserve);
+}
+OAHash *BLI_oahash_int_new(const char *info)
+{
+  return BLI_oahash_int_new_ex(info, 0);
+}
+
+/** \} */
@@ -66,19 +66,35 @@ static void optimal_check_callback(void *userdata,
  * Note that a small epsilon is added to the BVH nodes bounds, even if we pass in zero.
  * Use rounding to ensure very close nodes don't cause the wrong node to be found as nearest.
  */
-static void find_nearest_points_test(
-    int points_len, float scale, int round, int random_seed, bool optimal = false)
+static void find_nearest_points_test(int points_len,
+                                     float scale,
+                                     int round,
+                                     int random_seed,
+                                     bool optimal = false,
+                                     int tree_type = 8,
+                                     bool insert_leafs_reversed = false)
 {
   struct RNG *rng = BLI_rng_new(random_seed);
-  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 8, 8);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, tree_type, 8);
 
   void *mem = MEM_mallocN(sizeof(float[3]) * points_len, __func__);
   float(*points)[3] = (float(*)[3])mem;
 
   for (int i = 0; i < points_len; i++) {
     rng_v3_round(points[i], 3, rng, round, scale);
-    BLI_bvhtree_insert(tree, i, points[i], 1);
   }
+  if (insert_leafs_reversed) {
+    /* Leafs can be inserted in any order, as is done when inserting them in parallel. */
+    for (int i = points_len - 1; i >= 0; i--) {
+      BLI_bvhtree_insert_leaf(tree, i, i, points[i], 1);
+    }
+  }
+  else {
+    for (int i = 0; i < points_len; i++) {
+      BLI_bvhtree_insert(tree, i, points[i], 1);
+    }
+  }
+  EXPECT_EQ(BLI_bvhtree_get_len(tree), points_len);
   BLI_bvhtree_balance(tree);
 
   /* first find each point */
@@ -132,3 +148,73 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+TEST(kdopbvh, FindNearest_Binary_5000)
+{
+  find_nearest_points_test(5000, 1.0, 10000, 42, false, 2);
+}
+TEST(kdopbvh, FindNearest_Quad_5000)
+{
+  find_nearest_points_test(5000, 1.0, 10000, 42, false, 4);
+}
+TEST(kdopbvh, OptimalFindNearest_Quad_5000)
+{
+  find_nearest_points_test(5000, 1.0, 10000, 42, true, 4);
+}
+
+TEST(kdopbvh, InsertLeaf_3)
+{
+  find_nearest_points_test(3, 1.0, 1000, 1234, true, 8, true);
+}
+TEST(kdopbvh, InsertLeaf_5000)
+{
+  find_nearest_points_test(5000, 1.0, 10000, 7, true, 4, true);
+}
+
+/**
+ * Move all points after balancing and check that the nearest points are still found
+ * after refitting the bounding volumes.
+ */
+static void update_tree_test(int points_len, int tree_type, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, tree_type, 8);
+
+  void *mem = MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  float(*points)[3] = (float(*)[3])mem;
+
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 2.0f);
+    EXPECT_TRUE(BLI_bvhtree_update_node(tree, i, points[i], nullptr, 1));
+  }
+  BLI_bvhtree_update_tree(tree);
+
+  for (int i = 0; i < points_len; i++) {
+    const int j = BLI_bvhtree_find_nearest(tree, points[i], nullptr, nullptr, nullptr);
+    EXPECT_GE(j, 0);
+    EXPECT_LT(j, points_len);
+    EXPECT_EQ_ARRAY(points[i], points[j], 3);
+  }
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+}
+
+TEST(kdopbvh, UpdateTree_1)
+{
+  update_tree_test(1, 8, 12);
+}
+TEST(kdopbvh, UpdateTree_Binary_2000)
+{
+  update_tree_test(2000, 2, 12);
+}
+TEST(kdopbvh, UpdateTree_Oct_2000)
+{
+  update_tree_test(2000, 8, 12);
+}
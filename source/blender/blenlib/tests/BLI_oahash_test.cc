@@ -0,0 +1,166 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "BLI_ghash.h"
+#include "BLI_oahash.h"
+#include "BLI_utildefines.h"
+
+#define TESTCASE_SIZE 10000
+
+/* Unique, but badly distributed keys, so probing is exercised. */
+static unsigned int testcase_key(const unsigned int i)
+{
+  return i * 1024 + 7;
+}
+
+TEST(oahash, InsertLookup)
+{
+  OAHash *oh = BLI_oahash_int_new(__func__);
+
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    const unsigned int k = testcase_key(i);
+    BLI_oahash_insert(oh, POINTER_FROM_UINT(k), POINTER_FROM_UINT(k));
+  }
+
+  EXPECT_EQ(BLI_oahash_len(oh), TESTCASE_SIZE);
+
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    const unsigned int k = testcase_key(i);
+    void *v = BLI_oahash_lookup(oh, POINTER_FROM_UINT(k));
+    EXPECT_EQ(POINTER_AS_UINT(v), k);
+  }
+  EXPECT_FALSE(BLI_oahash_haskey(oh, POINTER_FROM_UINT(1)));
+  EXPECT_EQ(BLI_oahash_lookup(oh, POINTER_FROM_UINT(1)), nullptr);
+  EXPECT_EQ(BLI_oahash_lookup_default(oh, POINTER_FROM_UINT(1), POINTER_FROM_INT(-1)),
+            POINTER_FROM_INT(-1));
+
+  BLI_oahash_free(oh, nullptr, nullptr);
+}
+
+TEST(oahash, InsertRemove)
+{
+  OAHash *oh = BLI_oahash_int_new_ex(__func__, TESTCASE_SIZE);
+
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    const unsigned int k = testcase_key(i);
+    BLI_oahash_insert(oh, POINTER_FROM_UINT(k), POINTER_FROM_UINT(k));
+  }
+
+  /* Remove every other key, the remaining ones must still be found. */
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i += 2) {
+    const unsigned int k = testcase_key(i);
+    void *v = BLI_oahash_popkey(oh, POINTER_FROM_UINT(k), nullptr);
+    EXPECT_EQ(POINTER_AS_UINT(v), k);
+  }
+  EXPECT_EQ(BLI_oahash_len(oh), TESTCASE_SIZE / 2);
+
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    const unsigned int k = testcase_key(i);
+    EXPECT_EQ(BLI_oahash_haskey(oh, POINTER_FROM_UINT(k)), (i % 2) != 0);
+  }
+
+  for (unsigned int i = 1; i < TESTCASE_SIZE; i += 2) {
+    const unsigned int k = testcase_key(i);
+    EXPECT_TRUE(BLI_oahash_remove(oh, POINTER_FROM_UINT(k), nullptr, nullptr));
+    EXPECT_FALSE(BLI_oahash_remove(oh, POINTER_FROM_UINT(k), nullptr, nullptr));
+  }
+  EXPECT_EQ(BLI_oahash_len(oh), 0);
+
+  /* Slots of removed items are reused. */
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    const unsigned int k = testcase_key(i);
+    BLI_oahash_insert(oh, POINTER_FROM_UINT(k), POINTER_FROM_UINT(i));
+  }
+  EXPECT_EQ(BLI_oahash_len(oh), TESTCASE_SIZE);
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    const unsigned int k = testcase_key(i);
+    EXPECT_EQ(POINTER_AS_UINT(BLI_oahash_lookup(oh, POINTER_FROM_UINT(k))), i);
+  }
+
+  BLI_oahash_free(oh, nullptr, nullptr);
+}
+
+TEST(oahash, EnsureReinsert)
+{
+  OAHash *oh = BLI_oahash_int_new(__func__);
+  void **val_p;
+
+  EXPECT_FALSE(BLI_oahash_ensure_p(oh, POINTER_FROM_INT(5), &val_p));
+  *val_p = POINTER_FROM_INT(50);
+  EXPECT_TRUE(BLI_oahash_ensure_p(oh, POINTER_FROM_INT(5), &val_p));
+  EXPECT_EQ(*val_p, POINTER_FROM_INT(50));
+
+  void **key_p;
+  EXPECT_FALSE(BLI_oahash_ensure_p_ex(oh, POINTER_FROM_INT(6), &key_p, &val_p));
+  *key_p = POINTER_FROM_INT(6);
+  *val_p = POINTER_FROM_INT(60);
+
+  EXPECT_FALSE(
+      BLI_oahash_reinsert(oh, POINTER_FROM_INT(5), POINTER_FROM_INT(51), nullptr, nullptr));
+  EXPECT_TRUE(
+      BLI_oahash_reinsert(oh, POINTER_FROM_INT(7), POINTER_FROM_INT(70), nullptr, nullptr));
+
+  EXPECT_EQ(BLI_oahash_len(oh), 3);
+  EXPECT_EQ(BLI_oahash_lookup(oh, POINTER_FROM_INT(5)), POINTER_FROM_INT(51));
+  EXPECT_EQ(*BLI_oahash_lookup_p(oh, POINTER_FROM_INT(6)), POINTER_FROM_INT(60));
+  EXPECT_EQ(BLI_oahash_lookup(oh, POINTER_FROM_INT(7)), POINTER_FROM_INT(70));
+  EXPECT_EQ(BLI_oahash_lookup_p(oh, POINTER_FROM_INT(8)), nullptr);
+
+  BLI_oahash_clear(oh, nullptr, nullptr);
+  EXPECT_EQ(BLI_oahash_len(oh), 0);
+  EXPECT_FALSE(BLI_oahash_haskey(oh, POINTER_FROM_INT(5)));
+
+  BLI_oahash_free(oh, nullptr, nullptr);
+}
+
+TEST(oahash, Iterator)
+{
+  OAHash *oh = BLI_oahash_int_new(__func__);
+  OAHashIterator ohi;
+
+  unsigned int count = 0;
+  OAHASH_ITER (ohi, oh) {
+    count++;
+  }
+  EXPECT_EQ(count, 0);
+
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i++) {
+    BLI_oahash_insert(oh, POINTER_FROM_UINT(testcase_key(i)), POINTER_FROM_UINT(i));
+  }
+
+  /* Removing the current item while iterating is allowed. */
+  uint64_t sum = 0;
+  OAHASH_ITER (ohi, oh) {
+    const unsigned int i = POINTER_AS_UINT(BLI_oahashIterator_getValue(&ohi));
+    EXPECT_EQ(POINTER_AS_UINT(BLI_oahashIterator_getKey(&ohi)), testcase_key(i));
+    sum += i;
+    if (i % 2) {
+      BLI_oahash_remove(oh, BLI_oahashIterator_getKey(&ohi), nullptr, nullptr);
+    }
+    else {
+      *BLI_oahashIterator_getValue_p(&ohi) = POINTER_FROM_UINT(i + 1);
+    }
+  }
+  EXPECT_EQ(sum, (uint64_t)TESTCASE_SIZE * (TESTCASE_SIZE - 1) / 2);
+  EXPECT_EQ(BLI_oahash_len(oh), TESTCASE_SIZE / 2);
+  for (unsigned int i = 0; i < TESTCASE_SIZE; i += 2) {
+    EXPECT_EQ(POINTER_AS_UINT(BLI_oahash_lookup(oh, POINTER_FROM_UINT(testcase_key(i)))), i + 1);
+  }
+
+  BLI_oahash_free(oh, nullptr, nullptr);
+}
+
+TEST(oahash, StringKeys)
+{
+  OAHash *oh = BLI_oahash_str_new(__func__);
+  char buf[2][16] = {"abc", "abc"};
+
+  BLI_oahash_insert(oh, buf[0], POINTER_FROM_INT(1));
+  /* Compared by content, not by pointer. */
+  EXPECT_TRUE(BLI_oahash_haskey(oh, buf[1]));
+  EXPECT_FALSE(BLI_oahash_haskey(oh, "abd"));
+  EXPECT_EQ(BLI_oahash_lookup(oh, "abc"), POINTER_FROM_INT(1));
+
+  BLI_oahash_free(oh, nullptr, nullptr);
+}
@@ -0,0 +1,211 @@
+/* Apache License, Version 2.0 */
+
+#include "BLI_ressource_strings.h"
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_ghash.h"
+#include "BLI_oahash.h"
+#include "BLI_rand.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+#include "PIL_time_utildefines.h"
+
+/* Compares #OAHash with #GHash, running the same operations on both with the same keys.
+ * The callbacks of both are identical, so the difference is only due to the table layout. */
+
+/* Run the longest tests! */
+//#define OAHASH_RUN_BIG
+
+/* Str: words from a 'corpus' text. */
+
+static int str_split_words(char *data, char ***r_words)
+{
+  int words_len = 0;
+  for (char *c = data; *c; c++) {
+    if (ELEM(*c, ' ', '.')) {
+      words_len++;
+    }
+  }
+  char **words = (char **)MEM_mallocN(sizeof(*words) * (size_t)(words_len + 1), __func__);
+  int i = 0;
+  char *w = data;
+  for (char *c = data; *c; c++) {
+    if (ELEM(*c, ' ', '.')) {
+      *c = '\0';
+      words[i++] = w;
+      w = c + 1;
+    }
+  }
+  words[i++] = w;
+  *r_words = words;
+  return i;
+}
+
+TEST(oahash, TextCompareGHash)
+{
+  printf("\n========== STARTING %s ==========\n", __func__);
+
+  char *data = BLI_strdup(words10k);
+  char **words;
+  const int words_len = str_split_words(data, &words);
+
+  {
+    GHash *ghash = BLI_ghash_str_new(__func__);
+
+    TIMEIT_START(ghash_string_insert);
+    for (int i = 0; i < words_len; i++) {
+      void **val_p;
+      if (!BLI_ghash_ensure_p(ghash, words[i], &val_p)) {
+        *val_p = POINTER_FROM_INT(words[i][0]);
+      }
+    }
+    TIMEIT_END(ghash_string_insert);
+
+    TIMEIT_START(ghash_string_lookup);
+    for (int i = 0; i < words_len; i++) {
+      void *v = BLI_ghash_lookup(ghash, words[i]);
+      EXPECT_EQ(POINTER_AS_INT(v), words[i][0]);
+    }
+    TIMEIT_END(ghash_string_lookup);
+
+    BLI_ghash_free(ghash, nullptr, nullptr);
+  }
+
+  {
+    OAHash *oh = BLI_oahash_str_new(__func__);
+
+    TIMEIT_START(oahash_string_insert);
+    for (int i = 0; i < words_len; i++) {
+      void **val_p;
+      if (!BLI_oahash_ensure_p(oh, words[i], &val_p)) {
+        *val_p = POINTER_FROM_INT(words[i][0]);
+      }
+    }
+    TIMEIT_END(oahash_string_insert);
+
+    TIMEIT_START(oahash_string_lookup);
+    for (int i = 0; i < words_len; i++) {
+      void *v = BLI_oahash_lookup(oh, words[i]);
+      EXPECT_EQ(POINTER_AS_INT(v), words[i][0]);
+    }
+    TIMEIT_END(oahash_string_lookup);
+
+    BLI_oahash_free(oh, nullptr, nullptr);
+  }
+
+  MEM_freeN(words);
+  MEM_freeN(data);
+
+  printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+/* Int: random integers (which may contain duplicates), as pointers. */
+
+static void randint_compare_tests(const char *id, const unsigned int nbr)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  unsigned int *data = (unsigned int *)MEM_mallocN(sizeof(*data) * (size_t)nbr, __func__);
+  {
+    RNG *rng = BLI_rng_new(1);
+    for (unsigned int i = 0; i < nbr; i++) {
+      data[i] = BLI_rng_get_uint(rng);
+    }
+    BLI_rng_free(rng);
+  }
+
+  {
+    GHash *ghash = BLI_ghash_ptr_new(__func__);
+
+    TIMEIT_START(ghash_int_insert);
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_ghash_reinsert(
+          ghash, POINTER_FROM_UINT(data[i]), POINTER_FROM_UINT(data[i]), nullptr, nullptr);
+    }
+    TIMEIT_END(ghash_int_insert);
+
+    TIMEIT_START(ghash_int_lookup);
+    for (unsigned int i = 0; i < nbr; i++) {
+      void *v = BLI_ghash_lookup(ghash, POINTER_FROM_UINT(data[i]));
+      EXPECT_EQ(POINTER_AS_UINT(v), data[i]);
+    }
+    TIMEIT_END(ghash_int_lookup);
+
+    uint64_t sum = 0;
+    TIMEIT_START(ghash_int_iter);
+    GHashIterator gh_iter;
+    GHASH_ITER (gh_iter, ghash) {
+      sum += POINTER_AS_UINT(BLI_ghashIterator_getValue(&gh_iter));
+    }
+    TIMEIT_END(ghash_int_iter);
+    EXPECT_NE(sum, 0);
+
+    TIMEIT_START(ghash_int_remove);
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_ghash_remove(ghash, POINTER_FROM_UINT(data[i]), nullptr, nullptr);
+    }
+    TIMEIT_END(ghash_int_remove);
+    EXPECT_EQ(BLI_ghash_len(ghash), 0);
+
+    BLI_ghash_free(ghash, nullptr, nullptr);
+  }
+
+  {
+    OAHash *oh = BLI_oahash_ptr_new(__func__);
+
+    TIMEIT_START(oahash_int_insert);
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_oahash_reinsert(
+          oh, POINTER_FROM_UINT(data[i]), POINTER_FROM_UINT(data[i]), nullptr, nullptr);
+    }
+    TIMEIT_END(oahash_int_insert);
+
+    TIMEIT_START(oahash_int_lookup);
+    for (unsigned int i = 0; i < nbr; i++) {
+      void *v = BLI_oahash_lookup(oh, POINTER_FROM_UINT(data[i]));
+      EXPECT_EQ(POINTER_AS_UINT(v), data[i]);
+    }
+    TIMEIT_END(oahash_int_lookup);
+
+    uint64_t sum = 0;
+    TIMEIT_START(oahash_int_iter);
+    OAHashIterator oh_iter;
+    OAHASH_ITER (oh_iter, oh) {
+      sum += POINTER_AS_UINT(BLI_oahashIterator_getValue(&oh_iter));
+    }
+    TIMEIT_END(oahash_int_iter);
+    EXPECT_NE(sum, 0);
+
+    TIMEIT_START(oahash_int_remove);
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_oahash_remove(oh, POINTER_FROM_UINT(data[i]), nullptr, nullptr);
+    }
+    TIMEIT_END(oahash_int_remove);
+    EXPECT_EQ(BLI_oahash_len(oh), 0);
+
+    BLI_oahash_free(oh, nullptr, nullptr);
+  }
+
+  MEM_freeN(data);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(oahash, IntRandCompareGHash12000)
+{
+  randint_compare_tests("RandInt - 12000", 12000);
+}
+
+TEST(oahash, IntRandCompareGHash1000000)
+{
+  randint_compare_tests("RandInt - 1000000", 1000000);
+}
+
+#ifdef OAHASH_RUN_BIG
+TEST(oahash, IntRandCompareGHash50000000)
+{
+  randint_compare_tests("RandInt - 50000000", 50000000);
+}
+#endif
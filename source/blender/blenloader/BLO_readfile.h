@@ -81,7 +81,7 @@ typedef struct BlendFileData {
 } BlendFileData;
 
 struct BlendFileReadParams {
-  uint skip_flags : 3; /* eBLOReadSkip */
+  uint skip_flags : 4; /* eBLOReadSkip */
   uint is_startup : 1;
 
   /** Whether we are reading the memfile for an undo (< 0) or a redo (> 0). */
@@ -95,6 +95,12 @@ typedef enum eBLOReadSkip {
   BLO_READ_SKIP_DATA = (1 << 1),
   /** Do not attempt to re-use IDs from old bmain for unchanged ones in case of undo. */
   BLO_READ_SKIP_UNDO_OLD_MAIN = (1 << 2),
+  /**
+   * Only read the data-blocks used by the active scene (and linked data), skipping everything
+   * that can't be reached from it. Meant for background processing (e.g. rendering) of large
+   * files, the UI data-blocks are not read either.
+   */
+  BLO_READ_SKIP_UNUSED_IDS = (1 << 3),
 } eBLOReadSkip;
 #define BLO_READ_SKIP_ALL (BLO_READ_SKIP_USERDEF | BLO_READ_SKIP_DATA)
 
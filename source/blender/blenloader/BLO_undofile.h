@@ -24,9 +24,18 @@
  * \ingroup blenloader
  */
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct GHash;
 struct Scene;
 
+/** File header of memfiles saved incrementally, see #BLO_memfile_write_file_incremental. */
+#define BLO_MEMFILE_JOURNAL_MAGIC "BLENDJNL"
+/** Journals are not `.blend` files, they're turned into one by #BLO_memfile_journal_recover. */
+#define BLO_MEMFILE_JOURNAL_EXT ".blend_journal"
+
 typedef struct {
   void *next, *prev;
   const char *buf;
@@ -84,3 +93,10 @@ extern struct Main *BLO_memfile_main_get(struct MemFile *memfile,
                                          struct Main *bmain,
                                          struct Scene **r_scene);
 extern bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename);
+extern bool BLO_memfile_write_file_incremental(struct MemFile *memfile, const char *filename);
+extern void BLO_memfile_journal_close(void);
+extern bool BLO_memfile_journal_recover(const char *journal_filepath, const char *filepath);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,519 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Frame layout (all integers are little endian):
+ *
+ * <pre>
+ * `1f 8b 08 04`     gzip magic, deflate, #FEXTRA flag.
+ * `00 00 00 00`     mtime (unused).
+ * `00 ff`           extra flags, OS (unknown).
+ * `0c 00`           extra field length (12).
+ * `42 4c 08 00`     sub-field `BL`, 8 bytes of data.
+ * `uint32`          compressed size of the whole member (header and trailer included).
+ * `uint32`          uncompressed size of the frame.
+ * ...               raw deflate stream.
+ * `uint32`          CRC32 of the uncompressed frame.
+ * `uint32`          uncompressed size of the frame (gzip ISIZE).
+ * </pre>
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#  include <unistd.h>
+#else
+#  include "BLI_winstuff.h"
+#  include <io.h>
+#endif
+
+#include <zlib.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "blend_frames.h"
+
+#define FRAME_HEADER_SIZE 24
+#define FRAME_TRAILER_SIZE 8
+
+/* -------------------------------------------------------------------- */
+/** \name Frame Header Encoding
+ * \{ */
+
+static void frame_uint32_encode(uchar *dst, uint32_t value)
+{
+  dst[0] = (uchar)(value & 0xff);
+  dst[1] = (uchar)((value >> 8) & 0xff);
+  dst[2] = (uchar)((value >> 16) & 0xff);
+  dst[3] = (uchar)((value >> 24) & 0xff);
+}
+
+static uint32_t frame_uint32_decode(const uchar *src)
+{
+  return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) |
+         ((uint32_t)src[3] << 24);
+}
+
+static void frame_header_encode(uchar header[FRAME_HEADER_SIZE],
+                                uint32_t member_size,
+                                uint32_t raw_size)
+{
+  const uchar prefix[16] = {
+      0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x0c, 0x00, 'B', 'L', 0x08, 0x00};
+  memcpy(header, prefix, sizeof(prefix));
+  frame_uint32_encode(&header[16], member_size);
+  frame_uint32_encode(&header[20], raw_size);
+}
+
+/**
+ * \return false when \a header isn't a frame written by #blo_frame_writer_open
+ * (a plain gzip stream for e.g.).
+ */
+static bool frame_header_decode(const uchar header[FRAME_HEADER_SIZE],
+                                uint32_t *r_member_size,
+                                uint32_t *r_raw_size)
+{
+  if (!(header[0] == 0x1f && header[1] == 0x8b && header[2] == 0x08 && header[3] == 0x04)) {
+    return false;
+  }
+  if (!(header[10] == 0x0c && header[11] == 0x00 && header[12] == 'B' && header[13] == 'L' &&
+        header[14] == 0x08 && header[15] == 0x00)) {
+    return false;
+  }
+  *r_member_size = frame_uint32_decode(&header[16]);
+  *r_raw_size = frame_uint32_decode(&header[20]);
+
+  if ((*r_member_size <= FRAME_HEADER_SIZE + FRAME_TRAILER_SIZE) ||
+      (*r_raw_size > BLO_FRAME_SIZE)) {
+    return false;
+  }
+  return true;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Frame Writing
+ *
+ * Data is accumulated into frames of #BLO_FRAME_SIZE, full frames are compressed in a task pool.
+ * Compressed frames are written in order by the calling thread, which also helps compressing
+ * whenever too many frames are in flight (this bounds memory use).
+ * \{ */
+
+typedef struct FrameWriterFrame {
+  uchar *raw;
+  size_t raw_len;
+  uchar *member;
+  size_t member_len;
+  int level;
+  bool error;
+} FrameWriterFrame;
+
+struct BLOFrameWriter {
+  int filedes;
+  int level;
+
+  TaskPool *task_pool;
+
+  /** Frames that have been pushed to the pool but not written yet. */
+  FrameWriterFrame **frames;
+  int frames_len;
+  int frames_max;
+
+  /** Frame currently being filled. */
+  uchar *buf;
+  size_t buf_used_len;
+
+  bool error;
+};
+
+static void frame_writer_compress_fn(TaskPool *__restrict UNUSED(pool), void *taskdata)
+{
+  FrameWriterFrame *frame = taskdata;
+
+  z_stream strm = {NULL};
+  if (deflateInit2(&strm, frame->level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    frame->error = true;
+    return;
+  }
+
+  const size_t bound = deflateBound(&strm, (uLong)frame->raw_len);
+  frame->member = MEM_mallocN(FRAME_HEADER_SIZE + bound + FRAME_TRAILER_SIZE, __func__);
+
+  strm.next_in = frame->raw;
+  strm.avail_in = (uInt)frame->raw_len;
+  strm.next_out = frame->member + FRAME_HEADER_SIZE;
+  strm.avail_out = (uInt)bound;
+
+  if (deflate(&strm, Z_FINISH) != Z_STREAM_END) {
+    deflateEnd(&strm);
+    frame->error = true;
+    return;
+  }
+  const size_t deflate_len = (size_t)strm.total_out;
+  deflateEnd(&strm);
+
+  const uint32_t crc = (uint32_t)crc32(0, frame->raw, (uInt)frame->raw_len);
+
+  frame->member_len = FRAME_HEADER_SIZE + deflate_len + FRAME_TRAILER_SIZE;
+  frame_header_encode(frame->member, (uint32_t)frame->member_len, (uint32_t)frame->raw_len);
+  uchar *trailer = frame->member + FRAME_HEADER_SIZE + deflate_len;
+  frame_uint32_encode(&trailer[0], crc);
+  frame_uint32_encode(&trailer[4], (uint32_t)frame->raw_len);
+
+  /* The raw data isn't needed anymore, free early to keep peak memory down. */
+  MEM_freeN(frame->raw);
+  frame->raw = NULL;
+}
+
+static void frame_writer_frame_free(FrameWriterFrame *frame)
+{
+  MEM_SAFE_FREE(frame->raw);
+  MEM_SAFE_FREE(frame->member);
+  MEM_freeN(frame);
+}
+
+/** Wait for all frames in flight and write them out in order. */
+static void frame_writer_flush_frames(BLOFrameWriter *fw)
+{
+  BLI_task_pool_work_and_wait(fw->task_pool);
+
+  for (int i = 0; i < fw->frames_len; i++) {
+    FrameWriterFrame *frame = fw->frames[i];
+    if (frame->error) {
+      fw->error = true;
+    }
+    if (!fw->error) {
+      if (write(fw->filedes, frame->member, frame->member_len) != (ssize_t)frame->member_len) {
+        fw->error = true;
+      }
+    }
+    frame_writer_frame_free(frame);
+  }
+  fw->frames_len = 0;
+}
+
+static void frame_writer_push_frame(BLOFrameWriter *fw)
+{
+  if (fw->buf_used_len == 0) {
+    return;
+  }
+
+  if (fw->frames_len == fw->frames_max) {
+    frame_writer_flush_frames(fw);
+  }
+
+  FrameWriterFrame *frame = MEM_callocN(sizeof(*frame), __func__);
+  frame->raw = fw->buf;
+  frame->raw_len = fw->buf_used_len;
+  frame->level = fw->level;
+  fw->frames[fw->frames_len++] = frame;
+
+  fw->buf = MEM_mallocN(BLO_FRAME_SIZE, __func__);
+  fw->buf_used_len = 0;
+
+  BLI_task_pool_push(fw->task_pool, frame_writer_compress_fn, frame, false, NULL);
+}
+
+/**
+ * \param level: The zlib compression level (1..9).
+ */
+BLOFrameWriter *blo_frame_writer_open(const char *filepath, int level)
+{
+  const int file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+  if (file == -1) {
+    return NULL;
+  }
+
+  BLOFrameWriter *fw = MEM_callocN(sizeof(*fw), __func__);
+  fw->filedes = file;
+  fw->level = level;
+  fw->task_pool = BLI_task_pool_create(NULL, TASK_PRIORITY_HIGH);
+  /* Enough frames in flight to keep all threads busy while the caller fills the next ones. */
+  fw->frames_max = MAX2(2, BLI_system_thread_count() * 2);
+  fw->frames = MEM_mallocN(sizeof(*fw->frames) * (size_t)fw->frames_max, __func__);
+  fw->buf = MEM_mallocN(BLO_FRAME_SIZE, __func__);
+
+  return fw;
+}
+
+bool blo_frame_writer_write(BLOFrameWriter *fw, const void *data, size_t data_len)
+{
+  const uchar *data_iter = data;
+  while (data_len > 0 && !fw->error) {
+    const size_t len = MIN2(data_len, BLO_FRAME_SIZE - fw->buf_used_len);
+    memcpy(&fw->buf[fw->buf_used_len], data_iter, len);
+    fw->buf_used_len += len;
+    data_iter += len;
+    data_len -= len;
+
+    if (fw->buf_used_len == BLO_FRAME_SIZE) {
+      frame_writer_push_frame(fw);
+    }
+  }
+  return !fw->error;
+}
+
+/**
+ * Write all pending frames, close the file and free \a fw.
+ * \return false on failure.
+ */
+bool blo_frame_writer_close(BLOFrameWriter *fw)
+{
+  frame_writer_push_frame(fw);
+  frame_writer_flush_frames(fw);
+
+  bool ok = !fw->error;
+  if (close(fw->filedes) == -1) {
+    ok = false;
+  }
+
+  BLI_task_pool_free(fw->task_pool);
+  MEM_freeN(fw->frames);
+  MEM_freeN(fw->buf);
+  MEM_freeN(fw);
+
+  return ok;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Frame Reading
+ * \{ */
+
+typedef struct FrameReaderFrame {
+  /** Offset of the gzip member in the file. */
+  int64_t member_offset;
+  uint32_t member_size;
+  /** Offset of the first byte of this frame in the uncompressed stream. */
+  int64_t raw_offset;
+  uint32_t raw_size;
+} FrameReaderFrame;
+
+struct BLOFrameReader {
+  int filedes;
+
+  FrameReaderFrame *frames;
+  int frames_len;
+  int64_t raw_size;
+
+  /** Position in the uncompressed stream. */
+  int64_t offset;
+
+  /** The frame currently decompressed into #BLOFrameReader.frame_buf (-1 for none). */
+  int frame_index;
+  uchar *frame_buf;
+  /** Scratch buffer holding the compressed member. */
+  uchar *member_buf;
+  size_t member_buf_len;
+  z_stream strm;
+};
+
+static bool frame_reader_read_at(int filedes, int64_t offset, void *buf, size_t len)
+{
+  if (BLI_lseek(filedes, offset, SEEK_SET) != offset) {
+    return false;
+  }
+  return read(filedes, buf, len) == (ssize_t)len;
+}
+
+/**
+ * Build the frame index by walking over the member headers.
+ * \return false if any member isn't a frame.
+ */
+static bool frame_reader_index_build(BLOFrameReader *fr)
+{
+  int frames_alloc = 64;
+  fr->frames = MEM_mallocN(sizeof(*fr->frames) * (size_t)frames_alloc, __func__);
+
+  const int64_t file_size = BLI_lseek(fr->filedes, 0, SEEK_END);
+  int64_t member_offset = 0;
+  int64_t raw_offset = 0;
+
+  while (member_offset < file_size) {
+    uchar header[FRAME_HEADER_SIZE];
+    uint32_t member_size, raw_size;
+    if (!frame_reader_read_at(fr->filedes, member_offset, header, sizeof(header)) ||
+        !frame_header_decode(header, &member_size, &raw_size) ||
+        (member_offset + member_size > file_size)) {
+      return false;
+    }
+
+    if (fr->frames_len == frames_alloc) {
+      frames_alloc *= 2;
+      fr->frames = MEM_reallocN(fr->frames, sizeof(*fr->frames) * (size_t)frames_alloc);
+    }
+    FrameReaderFrame *frame = &fr->frames[fr->frames_len++];
+    frame->member_offset = member_offset;
+    frame->member_size = member_size;
+    frame->raw_offset = raw_offset;
+    frame->raw_size = raw_size;
+
+    member_offset += member_size;
+    raw_offset += raw_size;
+  }
+
+  fr->raw_size = raw_offset;
+  return fr->frames_len != 0;
+}
+
+static int frame_reader_frame_find(const BLOFrameReader *fr, int64_t offset)
+{
+  int lo = 0, hi = fr->frames_len - 1;
+  while (lo < hi) {
+    const int mid = (lo + hi + 1) / 2;
+    if (fr->frames[mid].raw_offset <= offset) {
+      lo = mid;
+    }
+    else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+static bool frame_reader_frame_load(BLOFrameReader *fr, int frame_index)
+{
+  if (fr->frame_index == frame_index) {
+    return true;
+  }
+  fr->frame_index = -1;
+
+  const FrameReaderFrame *frame = &fr->frames[frame_index];
+  if (fr->member_buf_len < frame->member_size) {
+    MEM_SAFE_FREE(fr->member_buf);
+    fr->member_buf = MEM_mallocN(frame->member_size, __func__);
+    fr->member_buf_len = frame->member_size;
+  }
+  if (!frame_reader_read_at(
+          fr->filedes, frame->member_offset, fr->member_buf, frame->member_size)) {
+    return false;
+  }
+
+  if (inflateReset(&fr->strm) != Z_OK) {
+    return false;
+  }
+  fr->strm.next_in = fr->member_buf + FRAME_HEADER_SIZE;
+  fr->strm.avail_in = frame->member_size - FRAME_HEADER_SIZE - FRAME_TRAILER_SIZE;
+  fr->strm.next_out = fr->frame_buf;
+  fr->strm.avail_out = frame->raw_size;
+
+  const int err = inflate(&fr->strm, Z_FINISH);
+  if (!ELEM(err, Z_STREAM_END, Z_OK) || fr->strm.total_out != frame->raw_size) {
+    return false;
+  }
+
+  const uchar *trailer = fr->member_buf + frame->member_size - FRAME_TRAILER_SIZE;
+  if (frame_uint32_decode(trailer) != (uint32_t)crc32(0, fr->frame_buf, frame->raw_size)) {
+    return false;
+  }
+
+  fr->frame_index = frame_index;
+  return true;
+}
+
+/**
+ * \param filedes: An open file, the caller remains responsible for closing it.
+ * \return NULL when the file isn't a block-framed file.
+ */
+BLOFrameReader *blo_frame_reader_open(int filedes)
+{
+  BLOFrameReader *fr = MEM_callocN(sizeof(*fr), __func__);
+  fr->filedes = filedes;
+  fr->frame_index = -1;
+
+  if (!frame_reader_index_build(fr) || (inflateInit2(&fr->strm, -MAX_WBITS) != Z_OK)) {
+    MEM_SAFE_FREE(fr->frames);
+    MEM_freeN(fr);
+    return NULL;
+  }
+
+  fr->frame_buf = MEM_mallocN(BLO_FRAME_SIZE, __func__);
+  return fr;
+}
+
+int64_t blo_frame_reader_read(BLOFrameReader *fr, void *buffer, size_t size)
+{
+  uchar *buffer_iter = buffer;
+  int64_t readsize = 0;
+
+  while (size > 0 && fr->offset < fr->raw_size) {
+    const int frame_index = frame_reader_frame_find(fr, fr->offset);
+    if (!frame_reader_frame_load(fr, frame_index)) {
+      return -1;
+    }
+    const FrameReaderFrame *frame = &fr->frames[frame_index];
+    const size_t frame_offset = (size_t)(fr->offset - frame->raw_offset);
+    const size_t len = MIN2(size, frame->raw_size - frame_offset);
+
+    memcpy(buffer_iter, fr->frame_buf + frame_offset, len);
+    buffer_iter += len;
+    size -= len;
+    readsize += (int64_t)len;
+    fr->offset += (int64_t)len;
+  }
+
+  return readsize;
+}
+
+/**
+ * Seeking only moves the read position, the frame is decompressed on the next read.
+ * \return The new offset in the uncompressed stream or -1 on failure.
+ */
+int64_t blo_frame_reader_seek(BLOFrameReader *fr, int64_t offset, int whence)
+{
+  int64_t new_offset;
+  switch (whence) {
+    case SEEK_SET:
+      new_offset = offset;
+      break;
+    case SEEK_CUR:
+      new_offset = fr->offset + offset;
+      break;
+    case SEEK_END:
+      new_offset = fr->raw_size + offset;
+      break;
+    default:
+      return -1;
+  }
+  if (new_offset < 0 || new_offset > fr->raw_size) {
+    return -1;
+  }
+  fr->offset = new_offset;
+  return new_offset;
+}
+
+void blo_frame_reader_free(BLOFrameReader *fr)
+{
+  inflateEnd(&fr->strm);
+  MEM_SAFE_FREE(fr->member_buf);
+  MEM_freeN(fr->frame_buf);
+  MEM_freeN(fr->frames);
+  MEM_freeN(fr);
+}
+
+/** \} */
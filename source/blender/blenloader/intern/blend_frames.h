@@ -0,0 +1,63 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Seekable, block-framed compression for `.blend` files.
+ *
+ * The uncompressed stream is split into frames of #BLO_FRAME_SIZE bytes which are deflated
+ * independently (so they can be compressed on multiple threads). Each frame is stored as a
+ * complete gzip member, the file as a whole is a valid multi-member gzip stream that any gzip
+ * reader (including older Blender versions) can decompress sequentially.
+ *
+ * Every member header carries an extra field (`SI1 = 'B'`, `SI2 = 'L'`) storing the compressed
+ * size of the member and the uncompressed size of the frame. On reading, these are used to build
+ * a frame index without decompressing anything, which gives random access into the stream.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Uncompressed size of every frame (except the last one). */
+#define BLO_FRAME_SIZE (1 << 20)
+
+typedef struct BLOFrameWriter BLOFrameWriter;
+typedef struct BLOFrameReader BLOFrameReader;
+
+/* Writing. */
+
+BLOFrameWriter *blo_frame_writer_open(const char *filepath, int level);
+bool blo_frame_writer_write(BLOFrameWriter *fw, const void *data, size_t data_len);
+bool blo_frame_writer_close(BLOFrameWriter *fw);
+
+/* Reading. */
+
+BLOFrameReader *blo_frame_reader_open(int filedes);
+int64_t blo_frame_reader_read(BLOFrameReader *fr, void *buffer, size_t size);
+int64_t blo_frame_reader_seek(BLOFrameReader *fr, int64_t offset, int whence);
+void blo_frame_reader_free(BLOFrameReader *fr);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,561 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Journal layout (integers use the native byte order, like the memfile content itself):
+ *
+ * <pre>
+ * `BLENDJNL`        #BLO_MEMFILE_JOURNAL_MAGIC.
+ * `uint32`          version.
+ * `uint32`          reserved.
+ *
+ * Followed by records, each starting with:
+ * `char[4]`         `DATA` or `SNAP`.
+ * `uint32`          hash of the payload (`SNAP` only).
+ * `uint64`          size of the payload.
+ *
+ * `DATA` payload:   raw chunk data.
+ * `SNAP` payload:   `uint64` file offset and `uint64` size of every range making up the file.
+ * </pre>
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#  include <unistd.h>
+#else
+#  include "BLI_winstuff.h"
+#  include <io.h>
+#endif
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_listBase.h"
+
+#include "BLI_fileops.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+
+#include "BLO_undofile.h"
+
+#include "blend_journal.h"
+
+#define JOURNAL_VERSION 1
+#define JOURNAL_HEADER_SIZE 16
+#define JOURNAL_RECORD_HEADER_SIZE 16
+
+typedef struct JournalRecordHeader {
+  char code[4];
+  uint32_t hash;
+  uint64_t size;
+} JournalRecordHeader;
+
+/** A contiguous part of the file stored in the journal. */
+typedef struct JournalRange {
+  uint64_t offset;
+  uint64_t size;
+} JournalRange;
+
+BLI_STATIC_ASSERT(sizeof(JournalRecordHeader) == JOURNAL_RECORD_HEADER_SIZE,
+                  "Journal record header size mismatch")
+
+/* -------------------------------------------------------------------- */
+/** \name Journal Writing
+ * \{ */
+
+/** Where a chunk buffer was written in the journal. */
+typedef struct JournalChunk {
+  uint64_t offset;
+  size_t size;
+} JournalChunk;
+
+/**
+ * The journal is only used for auto-save, so there is a single one at a time.
+ * Only accessed from the main thread (like the undo stack).
+ */
+static struct {
+  char filepath[FILE_MAX];
+  int filedes;
+  /** Maps #MemFileChunk.buf to its #JournalChunk. */
+  GHash *chunks;
+  uint64_t file_size;
+  /** Size of the data referenced by the last snapshot. */
+  uint64_t live_size;
+} g_journal = {.filedes = -1};
+
+static bool journal_write(int filedes, const void *data, size_t size)
+{
+  const char *ptr = data;
+  while (size > 0) {
+    /* Limit the size of a single call, needed on WIN32 and safe everywhere. */
+    const uint write_size = (uint)MIN2(size, (size_t)INT_MAX);
+    const int64_t written = write(filedes, ptr, write_size);
+    if (written <= 0) {
+      return false;
+    }
+    ptr += written;
+    size -= (size_t)written;
+  }
+  return true;
+}
+
+static bool journal_write_record_header(const char code[4], uint32_t hash, uint64_t size)
+{
+  JournalRecordHeader header;
+  memcpy(header.code, code, sizeof(header.code));
+  header.hash = hash;
+  header.size = size;
+  if (!journal_write(g_journal.filedes, &header, sizeof(header))) {
+    return false;
+  }
+  g_journal.file_size += sizeof(header);
+  return true;
+}
+
+static int journal_open_flags(void)
+{
+  int oflags = O_BINARY | O_WRONLY;
+#ifdef O_NOFOLLOW
+  /* Same as #BLO_memfile_write_file, don't write through symbolic links. */
+  oflags |= O_NOFOLLOW;
+#endif
+  return oflags;
+}
+
+static void journal_chunk_free(void *chunk)
+{
+  MEM_freeN(chunk);
+}
+
+static void journal_close(void)
+{
+  if (g_journal.filedes != -1) {
+    close(g_journal.filedes);
+    g_journal.filedes = -1;
+  }
+  if (g_journal.chunks != NULL) {
+    BLI_ghash_free(g_journal.chunks, NULL, journal_chunk_free);
+    g_journal.chunks = NULL;
+  }
+  g_journal.filepath[0] = '\0';
+  g_journal.file_size = 0;
+  g_journal.live_size = 0;
+}
+
+/** Start a new (empty) journal, at a temporary location until the first snapshot is written. */
+static bool journal_create(const char *filepath)
+{
+  char filepath_tmp[FILE_MAX];
+  BLI_snprintf(filepath_tmp, sizeof(filepath_tmp), "%s@", filepath);
+
+  journal_close();
+
+  g_journal.filedes = BLI_open(filepath_tmp, journal_open_flags() | O_CREAT | O_TRUNC, 0666);
+  if (g_journal.filedes == -1) {
+    return false;
+  }
+
+  char header[JOURNAL_HEADER_SIZE] = {0};
+  const uint32_t version = JOURNAL_VERSION;
+  memcpy(header, BLO_MEMFILE_JOURNAL_MAGIC, 8);
+  memcpy(header + 8, &version, sizeof(version));
+  if (!journal_write(g_journal.filedes, header, sizeof(header))) {
+    journal_close();
+    return false;
+  }
+
+  BLI_strncpy(g_journal.filepath, filepath, sizeof(g_journal.filepath));
+  g_journal.chunks = BLI_ghash_ptr_new(__func__);
+  g_journal.file_size = JOURNAL_HEADER_SIZE;
+  return true;
+}
+
+/** Move a journal created by #journal_create in place, once it holds a snapshot. */
+static bool journal_create_finish(void)
+{
+  char filepath_tmp[FILE_MAX];
+  BLI_snprintf(filepath_tmp, sizeof(filepath_tmp), "%s@", g_journal.filepath);
+
+  /* Renaming open files isn't supported everywhere, re-open the journal afterwards. */
+  close(g_journal.filedes);
+  g_journal.filedes = -1;
+
+  if (BLI_rename(filepath_tmp, g_journal.filepath) != 0) {
+    return false;
+  }
+  g_journal.filedes = BLI_open(g_journal.filepath, journal_open_flags(), 0);
+  if (g_journal.filedes == -1) {
+    return false;
+  }
+  return BLI_lseek(g_journal.filedes, 0, SEEK_END) == (int64_t)g_journal.file_size;
+}
+
+static bool journal_is_valid_for(const char *filepath)
+{
+  if (g_journal.filedes == -1 || !STREQ(g_journal.filepath, filepath)) {
+    return false;
+  }
+  /* The file may have been removed or overwritten by a regular save in the meantime. */
+  if (BLI_file_size(filepath) != (size_t)g_journal.file_size) {
+    return false;
+  }
+  /* Rewrite once most of the journal is unused data. */
+  return (g_journal.file_size - g_journal.live_size) <= g_journal.live_size;
+}
+
+static bool journal_write_memfile(MemFile *memfile)
+{
+  JournalRange *ranges = MEM_malloc_arrayN(
+      MAX2((uint)BLI_listbase_count(&memfile->chunks), 1), sizeof(*ranges), __func__);
+  uint ranges_used = 0;
+  uint64_t live_size = 0;
+  bool ok = true;
+
+  /* Append the chunks not written yet and gather the ranges of the snapshot. */
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+    void **val_p;
+    if (!BLI_ghash_ensure_p(g_journal.chunks, (void *)chunk->buf, &val_p)) {
+      *val_p = MEM_mallocN(sizeof(JournalChunk), __func__);
+    }
+    else if (((JournalChunk *)*val_p)->size == chunk->size) {
+      /* Unchanged since it was written. */
+      val_p = NULL;
+    }
+
+    if (val_p != NULL) {
+      JournalChunk *jchunk = *val_p;
+      ok = journal_write_record_header("DATA", 0, chunk->size);
+      jchunk->offset = g_journal.file_size;
+      jchunk->size = chunk->size;
+      ok = ok && journal_write(g_journal.filedes, chunk->buf, chunk->size);
+      g_journal.file_size += chunk->size;
+      if (!ok) {
+        break;
+      }
+    }
+
+    const JournalChunk *jchunk = BLI_ghash_lookup(g_journal.chunks, chunk->buf);
+    JournalRange *range_prev = ranges_used ? &ranges[ranges_used - 1] : NULL;
+    if (range_prev && range_prev->offset + range_prev->size == jchunk->offset) {
+      range_prev->size += jchunk->size;
+    }
+    else {
+      ranges[ranges_used].offset = jchunk->offset;
+      ranges[ranges_used].size = jchunk->size;
+      ranges_used++;
+    }
+    live_size += jchunk->size;
+  }
+
+  if (ok) {
+    const size_t snapshot_size = sizeof(*ranges) * ranges_used;
+    const uint32_t hash = BLI_hash_mm2((const uchar *)ranges, snapshot_size, 0);
+    ok = journal_write_record_header("SNAP", hash, snapshot_size) &&
+         journal_write(g_journal.filedes, ranges, snapshot_size);
+    g_journal.file_size += snapshot_size;
+  }
+
+  MEM_freeN(ranges);
+
+  g_journal.live_size = live_size;
+  return ok;
+}
+
+/**
+ * Saves an undo buffer to a journal, only writing the chunks that changed since the last call
+ * with the same file path. The journal can be read like a regular `.blend` file by this version
+ * of Blender, other programs need the `.blend` file written by #BLO_memfile_journal_recover.
+ *
+ * \return success.
+ */
+bool BLO_memfile_write_file_incremental(MemFile *memfile, const char *filename)
+{
+  bool is_new = false;
+
+  if (!journal_is_valid_for(filename)) {
+    if (!journal_create(filename)) {
+      fprintf(stderr,
+              "Unable to save '%s': %s\n",
+              filename,
+              errno ? strerror(errno) : "Unknown error opening file");
+      return false;
+    }
+    is_new = true;
+  }
+
+  bool ok = journal_write_memfile(memfile);
+  if (ok && is_new) {
+    ok = journal_create_finish();
+  }
+
+  if (!ok) {
+    fprintf(stderr,
+            "Unable to save '%s': %s\n",
+            filename,
+            errno ? strerror(errno) : "Unknown error writing file");
+    /* Start over on the next save. */
+    journal_close();
+  }
+  return ok;
+}
+
+/**
+ * Forget about the journal written by #BLO_memfile_write_file_incremental,
+ * the next save writes a new one.
+ */
+void BLO_memfile_journal_close(void)
+{
+  journal_close();
+}
+
+/**
+ * Called when a #MemFileChunk buffer is freed,
+ * another buffer may be allocated at the same address later.
+ */
+void blo_journal_chunk_buffer_freed(const char *buf)
+{
+  if (g_journal.chunks != NULL) {
+    BLI_ghash_remove(g_journal.chunks, buf, NULL, journal_chunk_free);
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Journal Reading
+ * \{ */
+
+struct BLOJournalReader {
+  int filedes;
+
+  JournalRange *ranges;
+  /** Offset of every range in the uncompressed file, with one extra item for the total size. */
+  int64_t *ranges_start;
+  uint ranges_len;
+
+  int64_t position;
+  /** Range containing #position, avoids searching on sequential reads. */
+  uint range_index;
+};
+
+static bool journal_read(int filedes, void *buffer, size_t size)
+{
+  return read(filedes, buffer, (uint)size) == (int64_t)size;
+}
+
+static uint journal_reader_range_find(const BLOJournalReader *jr, int64_t position)
+{
+  if (jr->range_index < jr->ranges_len && jr->ranges_start[jr->range_index] <= position &&
+      position < jr->ranges_start[jr->range_index + 1]) {
+    return jr->range_index;
+  }
+  uint low = 0, high = jr->ranges_len;
+  while (low + 1 < high) {
+    const uint mid = (low + high) / 2;
+    if (jr->ranges_start[mid] <= position) {
+      low = mid;
+    }
+    else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/**
+ * \return NULL when the file isn't a journal or holds no complete snapshot.
+ * The file descriptor is still owned by the caller.
+ */
+BLOJournalReader *blo_journal_reader_open(int filedes)
+{
+  char header[JOURNAL_HEADER_SIZE];
+  uint32_t version;
+
+  const int64_t file_size = BLI_lseek(filedes, 0, SEEK_END);
+  BLI_lseek(filedes, 0, SEEK_SET);
+  if (!journal_read(filedes, header, sizeof(header)) ||
+      memcmp(header, BLO_MEMFILE_JOURNAL_MAGIC, 8) != 0) {
+    return NULL;
+  }
+  memcpy(&version, header + 8, sizeof(version));
+  if (version != JOURNAL_VERSION) {
+    return NULL;
+  }
+
+  /* Find the last complete snapshot, an interrupted save may have left a partial record. */
+  JournalRange *ranges = NULL;
+  uint64_t ranges_size = 0;
+  int64_t offset = JOURNAL_HEADER_SIZE;
+  while (offset + JOURNAL_RECORD_HEADER_SIZE <= file_size) {
+    JournalRecordHeader record;
+    BLI_lseek(filedes, offset, SEEK_SET);
+    if (!journal_read(filedes, &record, sizeof(record))) {
+      break;
+    }
+    offset += JOURNAL_RECORD_HEADER_SIZE;
+    if (record.size > (uint64_t)(file_size - offset)) {
+      break;
+    }
+
+    if (memcmp(record.code, "SNAP", 4) == 0 && record.size % sizeof(JournalRange) == 0) {
+      JournalRange *snapshot = MEM_mallocN(MAX2(record.size, 1), __func__);
+      if (journal_read(filedes, snapshot, record.size) &&
+          BLI_hash_mm2((const uchar *)snapshot, record.size, 0) == record.hash) {
+        MEM_SAFE_FREE(ranges);
+        ranges = snapshot;
+        ranges_size = record.size;
+      }
+      else {
+        MEM_freeN(snapshot);
+      }
+    }
+    offset += (int64_t)record.size;
+  }
+
+  if (ranges == NULL) {
+    return NULL;
+  }
+
+  BLOJournalReader *jr = MEM_callocN(sizeof(BLOJournalReader), __func__);
+  jr->filedes = filedes;
+  jr->ranges = ranges;
+  jr->ranges_len = (uint)(ranges_size / sizeof(JournalRange));
+  jr->ranges_start = MEM_malloc_arrayN(jr->ranges_len + 1, sizeof(int64_t), __func__);
+  jr->ranges_start[0] = 0;
+  for (uint i = 0; i < jr->ranges_len; i++) {
+    jr->ranges_start[i + 1] = jr->ranges_start[i] + (int64_t)ranges[i].size;
+  }
+  return jr;
+}
+
+int64_t blo_journal_reader_read(BLOJournalReader *jr, void *buffer, size_t size)
+{
+  const int64_t total_size = jr->ranges_start[jr->ranges_len];
+  char *dst = buffer;
+  int64_t done = 0;
+
+  while ((size_t)done < size && jr->position < total_size) {
+    const uint index = journal_reader_range_find(jr, jr->position);
+    const int64_t range_offset = jr->position - jr->ranges_start[index];
+    const size_t read_size = (size_t)MIN2((int64_t)(size - (size_t)done),
+                                          (int64_t)jr->ranges[index].size - range_offset);
+
+    BLI_lseek(jr->filedes, (int64_t)jr->ranges[index].offset + range_offset, SEEK_SET);
+    if (!journal_read(jr->filedes, dst + done, read_size)) {
+      return -1;
+    }
+    done += (int64_t)read_size;
+    jr->position += (int64_t)read_size;
+    jr->range_index = index;
+  }
+  return done;
+}
+
+int64_t blo_journal_reader_seek(BLOJournalReader *jr, int64_t offset, int whence)
+{
+  const int64_t total_size = jr->ranges_start[jr->ranges_len];
+  int64_t position;
+
+  if (whence == SEEK_CUR) {
+    position = jr->position + offset;
+  }
+  else if (whence == SEEK_END) {
+    position = total_size + offset;
+  }
+  else {
+    position = offset;
+  }
+
+  if (position < 0 || position > total_size) {
+    return -1;
+  }
+  jr->position = position;
+  return position;
+}
+
+void blo_journal_reader_free(BLOJournalReader *jr)
+{
+  MEM_freeN(jr->ranges);
+  MEM_freeN(jr->ranges_start);
+  MEM_freeN(jr);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Journal Recovery
+ * \{ */
+
+/**
+ * Write the file stored by the last complete snapshot of a journal as a regular `.blend` file,
+ * the previous content of \a filepath is kept when this fails.
+ *
+ * \return false when the journal can't be read or holds no complete snapshot.
+ */
+bool BLO_memfile_journal_recover(const char *journal_filepath, const char *filepath)
+{
+  const int filedes_journal = BLI_open(journal_filepath, O_BINARY | O_RDONLY, 0);
+  if (filedes_journal == -1) {
+    return false;
+  }
+
+  BLOJournalReader *jr = blo_journal_reader_open(filedes_journal);
+  if (jr == NULL) {
+    close(filedes_journal);
+    return false;
+  }
+
+  char filepath_tmp[FILE_MAX];
+  BLI_snprintf(filepath_tmp, sizeof(filepath_tmp), "%s@", filepath);
+
+  const int filedes = BLI_open(filepath_tmp, journal_open_flags() | O_CREAT | O_TRUNC, 0666);
+  bool ok = (filedes != -1);
+  if (ok) {
+    const size_t buffer_size = 1024 * 1024;
+    char *buffer = MEM_mallocN(buffer_size, __func__);
+    int64_t read_size;
+    while ((read_size = blo_journal_reader_read(jr, buffer, buffer_size)) > 0) {
+      if (!journal_write(filedes, buffer, (size_t)read_size)) {
+        ok = false;
+        break;
+      }
+    }
+    ok = ok && (read_size == 0);
+    MEM_freeN(buffer);
+    close(filedes);
+
+    ok = ok && (BLI_rename(filepath_tmp, filepath) == 0);
+    if (!ok) {
+      BLI_delete(filepath_tmp, false, false);
+    }
+  }
+
+  blo_journal_reader_free(jr);
+  close(filedes_journal);
+  return ok;
+}
+
+/** \} */
@@ -0,0 +1,57 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Append-only journal of #MemFile chunks, used to save undo memfiles incrementally.
+ *
+ * Chunks that are shared between undo steps keep the same buffer, so a buffer that was written
+ * to the journal before doesn't need to be written again. Every save appends the chunks that
+ * were not written yet, followed by a snapshot record listing where each chunk of the memfile
+ * is stored in the journal. The last complete snapshot defines the content of the file, an
+ * interrupted save leaves the previous snapshot intact.
+ *
+ * Once more than half of the journal is taken by data no longer referenced, it's rewritten
+ * from scratch (compaction).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct BLOJournalReader BLOJournalReader;
+
+/* Writing, see #BLO_memfile_write_file_incremental. */
+
+void blo_journal_chunk_buffer_freed(const char *buf);
+
+/* Reading, gives access to the `.blend` file stored by the last snapshot. */
+
+BLOJournalReader *blo_journal_reader_open(int filedes);
+int64_t blo_journal_reader_read(BLOJournalReader *jr, void *buffer, size_t size);
+int64_t blo_journal_reader_seek(BLOJournalReader *jr, int64_t offset, int whence);
+void blo_journal_reader_free(BLOJournalReader *jr);
+
+#ifdef __cplusplus
+}
+#endif
@@ -58,6 +58,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_blenlib.h"
 #include "BLI_endian_switch.h"
 #include "BLI_ghash.h"
@@ -65,6 +67,8 @@
 #include "BLI_math.h"
 #include "BLI_memarena.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BLT_translation.h"
@@ -103,6 +107,8 @@
 
 #include "SEQ_sequencer.h"
 
+#include "blend_frames.h"
+#include "blend_journal.h"
 #include "readfile.h"
 
 #include <errno.h>
@@ -164,8 +170,9 @@
  * Delay reading blocks we might not use (especially applies to library linking).
  * which keeps large arrays in memory from data-blocks we may not even use.
  *
- * \note This is disabled when using compression,
+ * \note This is disabled when reading plain gzip streams,
  * while zlib supports seek it's unusably slow, see: T61880.
+ * Block-framed compressed files (see: `blend_frames.h`) support fast seeking.
  */
 #define USE_BHEAD_READ_ON_DEMAND
 
@@ -243,6 +250,9 @@ static const char *library_parent_filepath(Library *lib)
 
 /* -------------------------------------------------------------------- */
 /** \name OldNewMap API
+ *
+ * Lookups (including the user count increment) are safe to run from multiple threads,
+ * as long as no entries are inserted at the same time.
  * \{ */
 
 typedef struct OldNew {
@@ -380,7 +390,7 @@ static void *oldnewmap_lookup_and_inc(OldNewMap *onm, const void *addr, bool inc
     return NULL;
   }
   if (increase_users) {
-    entry->nr++;
+    atomic_add_and_fetch_int32((int32_t *)&entry->nr, 1);
   }
   return entry->newp;
 }
@@ -955,6 +965,24 @@ static BHead *blo_bhead_read_full(FileData *fd, BHead *thisblock)
 }
 #endif /* USE_BHEAD_READ_ON_DEMAND */
 
+#ifdef USE_BHEAD_READ_ON_DEMAND
+/**
+ * For memory-mapped files, access the data of a block that hasn't been read yet
+ * directly in the mapping. The returned memory is read-only.
+ *
+ * \return NULL when the file isn't memory-mapped.
+ */
+static const void *blo_bhead_data_mapped(FileData *fd, BHead *thisblock)
+{
+  if (fd->mmap_file == NULL) {
+    return NULL;
+  }
+  BHeadN *new_bhead = BHEADN_FROM_BHEAD(thisblock);
+  BLI_assert(new_bhead->has_data == false && new_bhead->file_offset != 0);
+  return POINTER_OFFSET(BLI_mmap_get_pointer(fd->mmap_file), new_bhead->file_offset);
+}
+#endif /* USE_BHEAD_READ_ON_DEMAND */
+
 /* Warning! Caller's responsibility to ensure given bhead **is** and ID one! */
 const char *blo_bhead_id_name(const FileData *fd, const BHead *bhead)
 {
@@ -1124,6 +1152,51 @@ static off64_t fd_seek_data_from_file(FileData *filedata, off64_t offset, int wh
   return filedata->file_offset;
 }
 
+/* Memory-mapped file reading. */
+
+static ssize_t fd_read_from_mmap(FileData *filedata,
+                                 void *buffer,
+                                 size_t size,
+                                 bool *UNUSED(r_is_memchunck_identical))
+{
+  /* don't read more bytes than there are available in the file */
+  const size_t file_len = BLI_mmap_get_length(filedata->mmap_file);
+  const size_t readsize = MIN2(size, file_len - (size_t)filedata->file_offset);
+
+  if (!BLI_mmap_read(filedata->mmap_file, buffer, (size_t)filedata->file_offset, readsize)) {
+    return EOF;
+  }
+  filedata->file_offset += (off64_t)readsize;
+
+  return (ssize_t)readsize;
+}
+
+static off64_t fd_seek_from_mmap(FileData *filedata, off64_t offset, int whence)
+{
+  const off64_t file_len = (off64_t)BLI_mmap_get_length(filedata->mmap_file);
+  off64_t new_pos;
+
+  if (whence == SEEK_CUR) {
+    new_pos = filedata->file_offset + offset;
+  }
+  else if (whence == SEEK_SET) {
+    new_pos = offset;
+  }
+  else if (whence == SEEK_END) {
+    new_pos = file_len + offset;
+  }
+  else {
+    return -1;
+  }
+
+  if (new_pos < 0 || new_pos > file_len) {
+    return -1;
+  }
+
+  filedata->file_offset = new_pos;
+  return filedata->file_offset;
+}
+
 /* GZip file reading. */
 
 static ssize_t fd_read_gzip_from_file(FileData *filedata,
@@ -1145,6 +1218,56 @@ static ssize_t fd_read_gzip_from_file(FileData *filedata,
   return readsize;
 }
 
+/* Block-framed compressed file reading. */
+
+static ssize_t fd_read_frames_from_file(FileData *filedata,
+                                        void *buffer,
+                                        size_t size,
+                                        bool *UNUSED(r_is_memchunck_identical))
+{
+  ssize_t readsize = (ssize_t)blo_frame_reader_read(filedata->frame_reader, buffer, size);
+
+  if (readsize < 0) {
+    readsize = EOF;
+  }
+  else {
+    filedata->file_offset += readsize;
+  }
+
+  return readsize;
+}
+
+static off64_t fd_seek_frames_from_file(FileData *filedata, off64_t offset, int whence)
+{
+  filedata->file_offset = blo_frame_reader_seek(filedata->frame_reader, offset, whence);
+  return filedata->file_offset;
+}
+
+/* Journal reading (incrementally saved memfiles). */
+
+static ssize_t fd_read_from_journal(FileData *filedata,
+                                    void *buffer,
+                                    size_t size,
+                                    bool *UNUSED(r_is_memchunck_identical))
+{
+  ssize_t readsize = (ssize_t)blo_journal_reader_read(filedata->journal_reader, buffer, size);
+
+  if (readsize < 0) {
+    readsize = EOF;
+  }
+  else {
+    filedata->file_offset += readsize;
+  }
+
+  return readsize;
+}
+
+static off64_t fd_seek_from_journal(FileData *filedata, off64_t offset, int whence)
+{
+  filedata->file_offset = blo_journal_reader_seek(filedata->journal_reader, offset, whence);
+  return filedata->file_offset;
+}
+
 /* Memory reading. */
 
 static ssize_t fd_read_from_memory(FileData *filedata,
@@ -1290,6 +1413,9 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   FileDataSeekFn *seek_fn = NULL; /* Optional. */
 
   gzFile gzfile = (gzFile)Z_NULL;
+  BLOFrameReader *frame_reader = NULL;
+  BLOJournalReader *journal_reader = NULL;
+  BLI_mmap_file *mmap_file = NULL;
 
   char header[7];
 
@@ -1308,8 +1434,42 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   /* Regular file. */
   if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
-    read_fn = fd_read_data_from_file;
-    seek_fn = fd_seek_data_from_file;
+    /* Map the file when possible, blocks are then copied straight from the page cache
+     * (without a system call per block) and seeking is free. */
+    mmap_file = BLI_mmap_open(file);
+    if (mmap_file != NULL) {
+      read_fn = fd_read_from_mmap;
+      seek_fn = fd_seek_from_mmap;
+    }
+    else {
+      read_fn = fd_read_data_from_file;
+      seek_fn = fd_seek_data_from_file;
+    }
+    BLI_lseek(file, 0, SEEK_SET);
+  }
+
+  /* Journal written by incremental saving. */
+  if ((read_fn == NULL) && memcmp(header, BLO_MEMFILE_JOURNAL_MAGIC, sizeof(header)) == 0) {
+    journal_reader = blo_journal_reader_open(file);
+    if (journal_reader != NULL) {
+      read_fn = fd_read_from_journal;
+      seek_fn = fd_seek_from_journal;
+    }
+    BLI_lseek(file, 0, SEEK_SET);
+  }
+
+  /* Block-framed gzip file, supports seeking. */
+  if ((read_fn == NULL) &&
+      /* Check header magic. */
+      (header[0] == 0x1f && header[1] == 0x8b)) {
+    frame_reader = blo_frame_reader_open(file);
+    if (frame_reader != NULL) {
+      read_fn = fd_read_frames_from_file;
+      seek_fn = fd_seek_frames_from_file;
+    }
+    else {
+      BLI_lseek(file, 0, SEEK_SET);
+    }
   }
 
   /* Gzip file. */
@@ -1342,6 +1502,9 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   fd->filedes = file;
   fd->gzfiledes = gzfile;
+  fd->frame_reader = frame_reader;
+  fd->journal_reader = journal_reader;
+  fd->mmap_file = mmap_file;
 
   fd->read = read_fn;
   fd->seek = seek_fn;
@@ -1409,20 +1572,26 @@ static ssize_t fd_read_gzip_from_memory(FileData *filedata,
   filedata->strm.next_out = (Bytef *)buffer;
   filedata->strm.avail_out = (uint)size;
 
-  /* Inflate another chunk. */
-  err = inflate(&filedata->strm, Z_SYNC_FLUSH);
+  while (filedata->strm.avail_out != 0) {
+    /* Inflate another chunk. */
+    err = inflate(&filedata->strm, Z_SYNC_FLUSH);
 
-  if (err == Z_STREAM_END) {
-    return 0;
-  }
-  if (err != Z_OK) {
-    printf("fd_read_gzip_from_memory: zlib error\n");
-    return 0;
+    if (err == Z_STREAM_END) {
+      /* Block-framed files are made of many gzip members, continue with the next one. */
+      if (filedata->strm.avail_in == 0 || inflateReset(&filedata->strm) != Z_OK) {
+        break;
+      }
+    }
+    else if (err != Z_OK) {
+      printf("fd_read_gzip_from_memory: zlib error\n");
+      return 0;
+    }
   }
 
-  filedata->file_offset += size;
+  const size_t readsize = size - filedata->strm.avail_out;
+  filedata->file_offset += readsize;
 
-  return (ssize_t)size;
+  return (ssize_t)readsize;
 }
 
 static int fd_read_gzip_from_memory_init(FileData *fd)
@@ -1502,6 +1671,18 @@ void blo_filedata_free(FileData *fd)
       gzclose(fd->gzfiledes);
     }
 
+    if (fd->frame_reader != NULL) {
+      blo_frame_reader_free(fd->frame_reader);
+    }
+
+    if (fd->journal_reader != NULL) {
+      blo_journal_reader_free(fd->journal_reader);
+    }
+
+    if (fd->mmap_file != NULL) {
+      BLI_mmap_free(fd->mmap_file);
+    }
+
     if (fd->strm.next_in) {
       if (inflateEnd(&fd->strm) != Z_OK) {
         printf("close gzip stream error\n");
@@ -2068,6 +2249,28 @@ static void switch_endian_structs(const struct SDNA *filesdna, BHead *bhead)
   }
 }
 
+typedef struct ReconstructParallelFor {
+  void *userdata;
+  void (*fn)(void *userdata, int index);
+} ReconstructParallelFor;
+
+static void reconstruct_parallel_for_cb(void *__restrict userdata,
+                                        const int index,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ReconstructParallelFor *data = userdata;
+  data->fn(data->userdata, index);
+}
+
+/* Lets DNA reconstruct ranges of large arrays in parallel. */
+static void reconstruct_parallel_for(int len, void *userdata, void (*fn)(void *, int))
+{
+  ReconstructParallelFor data = {.userdata = userdata, .fn = fn};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, len, &data, reconstruct_parallel_for_cb, &settings);
+}
+
 static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 {
   void *temp = NULL;
@@ -2095,6 +2298,19 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
       if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
 #ifdef USE_BHEAD_READ_ON_DEMAND
         if (BHEADN_FROM_BHEAD(bh)->has_data == false) {
+          /* Memory-mapped files can be reconstructed from the mapping without a temporary copy. */
+          const void *data_mapped = blo_bhead_data_mapped(fd, bh);
+          if (data_mapped != NULL) {
+            temp = DNA_struct_reconstruct_ex(
+                fd->reconstruct_info, bh->SDNAnr, bh->nr, data_mapped, reconstruct_parallel_for);
+            if (UNLIKELY(BLI_mmap_has_io_error(fd->mmap_file))) {
+              fd->flags &= ~FD_FLAGS_FILE_OK;
+              MEM_freeN(temp);
+              temp = NULL;
+            }
+            return temp;
+          }
+
           bh = blo_bhead_read_full(fd, bh);
           if (UNLIKELY(bh == NULL)) {
             fd->flags &= ~FD_FLAGS_FILE_OK;
@@ -2102,7 +2318,8 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
           }
         }
 #endif
-        temp = DNA_struct_reconstruct(fd->reconstruct_info, bh->SDNAnr, bh->nr, (bh + 1));
+        temp = DNA_struct_reconstruct_ex(
+            fd->reconstruct_info, bh->SDNAnr, bh->nr, (bh + 1), reconstruct_parallel_for);
       }
       else {
         /* SDNA_CMP_EQUAL */
@@ -3756,12 +3973,81 @@ static void do_versions_after_linking(Main *main, ReportList *reports)
 /** \name Read Library Data Block (all)
  * \{ */
 
+static void lib_link_all_id(BlendLibReader *reader, ID *id)
+{
+  lib_link_id(reader, id);
+
+  const IDTypeInfo *id_type = BKE_idtype_get_info_from_id(id);
+  if (id_type->blend_read_lib != NULL) {
+    id_type->blend_read_lib(reader, id);
+  }
+
+  if (GS(id->name) == ID_LI) {
+    lib_link_library(reader, (Library *)id); /* Only init users. */
+  }
+
+  id->tag &= ~LIB_TAG_NEED_LINK;
+
+  /* Some data that should be persistent, like the 3DCursor or the tool settings, are
+   * stored in IDs affected by undo, like Scene. So this requires some specific handling. */
+  if (id_type->blend_read_undo_preserve != NULL && id->orig_id != NULL) {
+    id_type->blend_read_undo_preserve(reader, id, id->orig_id);
+  }
+}
+
+/**
+ * IDs whose type has a thread-safe `blend_read_lib` callback are gathered and lib-linked in
+ * parallel. The batch is flushed before any other ID is linked, so the order in which
+ * different ID types are processed doesn't change.
+ */
+typedef struct LibLinkBatch {
+  BlendLibReader *reader;
+  ID **ids;
+  int ids_len;
+  int ids_alloc;
+} LibLinkBatch;
+
+static void lib_link_batch_add(LibLinkBatch *batch, ID *id)
+{
+  if (batch->ids_len == batch->ids_alloc) {
+    batch->ids_alloc = batch->ids_alloc ? batch->ids_alloc * 2 : 256;
+    batch->ids = MEM_reallocN(batch->ids, sizeof(*batch->ids) * (size_t)batch->ids_alloc);
+  }
+  batch->ids[batch->ids_len++] = id;
+}
+
+static void lib_link_batch_cb(void *__restrict userdata,
+                              const int index,
+                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  LibLinkBatch *batch = userdata;
+  lib_link_all_id(batch->reader, batch->ids[index]);
+}
+
+static void lib_link_batch_flush(LibLinkBatch *batch)
+{
+  if (batch->ids_len == 0) {
+    return;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 64;
+  BLI_task_parallel_range(0, batch->ids_len, batch, lib_link_batch_cb, &settings);
+
+  batch->ids_len = 0;
+}
+
 static void lib_link_all(FileData *fd, Main *bmain)
 {
   const bool do_partial_undo = (fd->skip_flags & BLO_READ_SKIP_UNDO_OLD_MAIN) == 0;
 
   BlendLibReader reader = {fd, bmain};
 
+  /* Undo only re-links changed IDs, not worth the threading overhead. */
+  const bool use_threading = (fd->memfile == NULL);
+  LibLinkBatch batch = {&reader};
+
   ID *id;
   FOREACH_MAIN_ID_BEGIN (bmain, id) {
     if ((id->tag & LIB_TAG_NEED_LINK) == 0) {
@@ -3782,27 +4068,20 @@ static void lib_link_all(FileData *fd, Main *bmain)
       continue;
     }
 
-    lib_link_id(&reader, id);
-
     const IDTypeInfo *id_type = BKE_idtype_get_info_from_id(id);
-    if (id_type->blend_read_lib != NULL) {
-      id_type->blend_read_lib(&reader, id);
-    }
-
-    if (GS(id->name) == ID_LI) {
-      lib_link_library(&reader, (Library *)id); /* Only init users. */
+    if (use_threading && (id_type->flags & IDTYPE_FLAGS_THREADSAFE_READ_LIB)) {
+      lib_link_batch_add(&batch, id);
+      continue;
     }
 
-    id->tag &= ~LIB_TAG_NEED_LINK;
-
-    /* Some data that should be persistent, like the 3DCursor or the tool settings, are
-     * stored in IDs affected by undo, like Scene. So this requires some specific handling. */
-    if (id_type->blend_read_undo_preserve != NULL && id->orig_id != NULL) {
-      id_type->blend_read_undo_preserve(&reader, id, id->orig_id);
-    }
+    lib_link_batch_flush(&batch);
+    lib_link_all_id(&reader, id);
   }
   FOREACH_MAIN_ID_END;
 
+  lib_link_batch_flush(&batch);
+  MEM_SAFE_FREE(batch.ids);
+
   /* Cleanup `ID.orig_id`, this is now reserved for depsgraph/COW usage only. */
   FOREACH_MAIN_ID_BEGIN (bmain, id) {
     id->orig_id = NULL;
@@ -3936,6 +4215,8 @@ static BHead *read_userdef(BlendFileData *bfd, FileData *fd, BHead *bhead)
 /** \name Read File (Internal)
  * \{ */
 
+static void read_libblocks_used_by_scene(FileData *fd, BlendFileData *bfd);
+
 BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 {
   BHead *bhead = blo_bhead_first(fd);
@@ -3953,6 +4234,10 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 
   bfd->type = BLENFILETYPE_BLEND;
 
+  /* Never used for undo, the memfile has to be restored as a whole. */
+  const bool use_scene_only = (fd->skip_flags & BLO_READ_SKIP_UNUSED_IDS) &&
+                              (fd->skip_flags & BLO_READ_SKIP_DATA) == 0 && fd->memfile == NULL;
+
   if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
     BLI_addtail(&mainlist, bfd->main);
     fd->mainlist = &mainlist;
@@ -4026,12 +4311,21 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
         if (fd->skip_flags & BLO_READ_SKIP_DATA) {
           bhead = blo_bhead_next(fd, bhead);
         }
+        else if (use_scene_only && bhead->code != ID_LI) {
+          /* Read later on if used by the active scene, see #read_libblocks_used_by_scene. */
+          bhead = blo_bhead_next(fd, bhead);
+        }
         else {
           bhead = read_libblock(fd, bfd->main, bhead, LIB_TAG_LOCAL, false, NULL);
         }
     }
   }
 
+  if (use_scene_only) {
+    bfd->main->is_partially_read = true;
+    read_libblocks_used_by_scene(fd, bfd);
+  }
+
   /* do before read_libraries, but skip undo case */
   if (fd->memfile == NULL) {
     if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
@@ -4363,6 +4657,55 @@ static void expand_doit_library(void *fdhandle, Main *mainvar, void *old)
   }
 }
 
+static void expand_doit_local(void *fdhandle, Main *mainvar, void *old)
+{
+  FileData *fd = fdhandle;
+
+  BHead *bhead = find_bhead(fd, old);
+  if (bhead == NULL) {
+    return;
+  }
+
+  /* Placeholders and libraries were all read already, only local data-blocks are pending. */
+  if (ELEM(bhead->code, ID_LINK_PLACEHOLDER, ID_LI) || !BKE_idtype_idcode_is_valid(bhead->code)) {
+    return;
+  }
+
+  /* Everything read so far is in the lib-map, which is much cheaper than #is_yet_read. */
+  if (oldnewmap_liblookup(fd->libmap, bhead->old, NULL) == NULL) {
+    read_libblock(fd, mainvar, bhead, LIB_TAG_LOCAL | LIB_TAG_NEED_EXPAND, false, NULL);
+  }
+}
+
+/**
+ * Read the local data-blocks that can be reached from the active scene, used with
+ * #BLO_READ_SKIP_UNUSED_IDS. The main bhead loop only read libraries and placeholders, the
+ * scene gets read here and is expanded recursively, reading every data-block it uses.
+ */
+static void read_libblocks_used_by_scene(FileData *fd, BlendFileData *bfd)
+{
+  /* Not converted yet, this is still the address stored in the file (see #link_global). */
+  BHead *bhead = find_bhead(fd, bfd->curscene);
+  if (bhead == NULL || bhead->code != ID_SCE) {
+    /* Fall back to the first scene in the file. */
+    for (bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
+      if (bhead->code == ID_SCE) {
+        break;
+      }
+    }
+  }
+  if (bhead == NULL) {
+    return;
+  }
+  bfd->curscene = (Scene *)bhead->old;
+
+  read_libblock(fd, bfd->main, bhead, LIB_TAG_LOCAL | LIB_TAG_NEED_EXPAND, false, NULL);
+
+  BLO_main_expander(expand_doit_local);
+  BLO_expand_main(fd, bfd->main);
+  BLO_main_expander(expand_doit_library);
+}
+
 static BLOExpandDoitCallback expand_doit;
 
 static void expand_id(BlendExpander *expander, ID *id);
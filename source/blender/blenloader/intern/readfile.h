@@ -34,6 +34,8 @@
 #include "zlib.h"
 
 struct BLOCacheStorage;
+struct BLOFrameReader;
+struct BLI_mmap_file;
 struct GSet;
 struct IDNameLib_Map;
 struct Key;
@@ -96,6 +98,12 @@ typedef struct FileData {
 
   /** Variables needed for reading from file. */
   gzFile gzfiledes;
+  /** Seekable block-framed compressed file reading. */
+  struct BLOFrameReader *frame_reader;
+  /** Journal of an incrementally saved memfile. */
+  struct BLOJournalReader *journal_reader;
+  /** Memory-mapped reading of uncompressed files. */
+  struct BLI_mmap_file *mmap_file;
   /** Gzip stream for memory decompression. */
   z_stream strm;
 
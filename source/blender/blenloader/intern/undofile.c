@@ -49,6 +49,8 @@
 #include "BKE_lib_id.h"
 #include "BKE_main.h"
 
+#include "blend_journal.h"
+
 /* keep last */
 #include "BLI_strict_flags.h"
 
@@ -61,6 +63,7 @@ void BLO_memfile_free(MemFile *memfile)
 
   while ((chunk = BLI_pophead(&memfile->chunks))) {
     if (chunk->is_identical == false) {
+      blo_journal_chunk_buffer_freed(chunk->buf);
       MEM_freeN((void *)chunk->buf);
     }
     MEM_freeN(chunk);
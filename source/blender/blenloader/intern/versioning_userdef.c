@@ -827,6 +827,7 @@ void blo_do_versions_userdef(UserDef *userdef)
    */
   {
     /* Keep this block, even when empty. */
+    userdef->compositor_cache_limit = 1024;
   }
 
   LISTBASE_FOREACH (bTheme *, btheme, &userdef->themes) {
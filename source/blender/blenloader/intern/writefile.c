@@ -123,6 +123,7 @@
 #include "BLO_undofile.h"
 #include "BLO_writefile.h"
 
+#include "blend_frames.h"
 #include "readfile.h"
 
 #include <errno.h>
@@ -161,7 +162,7 @@ struct WriteWrap {
   /* internal */
   union {
     int file_handle;
-    gzFile gz_handle;
+    BLOFrameWriter *frame_writer;
   } _user_data;
 };
 
@@ -191,17 +192,17 @@ static size_t ww_write_none(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
-/* zlib */
-#define FILE_HANDLE(ww) (ww)->_user_data.gz_handle
+/* zlib, block-framed (see: blend_frames.h) */
+#define FILE_HANDLE(ww) (ww)->_user_data.frame_writer
 
 static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 {
-  gzFile file;
+  BLOFrameWriter *fw;
 
-  file = BLI_gzopen(filepath, "wb1");
+  fw = blo_frame_writer_open(filepath, 1);
 
-  if (file != Z_NULL) {
-    FILE_HANDLE(ww) = file;
+  if (fw != NULL) {
+    FILE_HANDLE(ww) = fw;
     return true;
   }
 
@@ -209,11 +210,11 @@ static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
 }
 static bool ww_close_zlib(WriteWrap *ww)
 {
-  return (gzclose(FILE_HANDLE(ww)) == Z_OK);
+  return blo_frame_writer_close(FILE_HANDLE(ww));
 }
 static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 {
-  return gzwrite(FILE_HANDLE(ww), buf, buf_len);
+  return blo_frame_writer_write(FILE_HANDLE(ww), buf, buf_len) ? buf_len : 0;
 }
 #undef FILE_HANDLE
 
@@ -1134,6 +1135,14 @@ bool BLO_write_file(Main *mainvar,
   void *path_list_backup = NULL;
   const int path_list_flag = (BKE_BPATH_TRAVERSE_SKIP_LIBRARY | BKE_BPATH_TRAVERSE_SKIP_MULTIFILE);
 
+  if (mainvar->is_partially_read) {
+    BKE_report(reports,
+               RPT_ERROR,
+               "Cannot save a file loaded with --load-scene-only, data-blocks not used by the "
+               "scene were not loaded");
+    return false;
+  }
+
   if (G.debug & G_DEBUG_IO && mainvar->lock != NULL) {
     BKE_report(reports, RPT_INFO, "Checking sanity of current .blend file *BEFORE* save to disk");
     BLO_main_validate_libraries(mainvar, reports);
@@ -0,0 +1,179 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2021 by Blender Foundation.
+ */
+#include "testing/testing.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <string>
+#include <zlib.h>
+
+#ifndef WIN32
+#  include <unistd.h>
+#else
+#  include <io.h>
+#endif
+
+#include "BKE_appdir.h"
+
+#include "BLI_fileops.h"
+#include "BLI_path_util.h"
+
+#include "intern/blend_frames.h"
+
+namespace blender::blenloader::tests {
+
+/* Compressible, but different in every frame. */
+static std::string test_content(const size_t size)
+{
+  std::string content(size, '\0');
+  for (size_t i = 0; i < size; i++) {
+    content[i] = (char)((i / 7) ^ (i >> 12));
+  }
+  return content;
+}
+
+class BlendFramesTest : public testing::Test {
+ protected:
+  char filepath[FILE_MAX];
+  int filedes = -1;
+  BLOFrameReader *fr = nullptr;
+
+  void SetUp() override
+  {
+    BKE_tempdir_init(nullptr);
+    BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_session(), "frames_test.blend");
+  }
+
+  void TearDown() override
+  {
+    if (fr != nullptr) {
+      blo_frame_reader_free(fr);
+    }
+    if (filedes != -1) {
+      close(filedes);
+    }
+    BLI_delete(filepath, false, false);
+  }
+
+  /* Writes in pieces of \a write_size, so writes cross the frame boundaries. */
+  void write(const std::string &content, const size_t write_size)
+  {
+    BLOFrameWriter *fw = blo_frame_writer_open(filepath, 1);
+    ASSERT_NE(fw, nullptr);
+    for (size_t offset = 0; offset < content.size(); offset += write_size) {
+      const size_t len = std::min(write_size, content.size() - offset);
+      EXPECT_TRUE(blo_frame_writer_write(fw, content.data() + offset, len));
+    }
+    EXPECT_TRUE(blo_frame_writer_close(fw));
+  }
+
+  void open()
+  {
+    filedes = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+    ASSERT_NE(filedes, -1);
+    fr = blo_frame_reader_open(filedes);
+    ASSERT_NE(fr, nullptr);
+  }
+
+  std::string read(const size_t size)
+  {
+    std::string content(size, '\0');
+    const int64_t read_size = blo_frame_reader_read(fr, &content[0], size);
+    EXPECT_GE(read_size, 0);
+    content.resize((size_t)std::max(read_size, (int64_t)0));
+    return content;
+  }
+
+  /* Any gzip reader decompresses the members one after another. */
+  std::string gzip_read()
+  {
+    gzFile file = (gzFile)BLI_gzopen(filepath, "rb");
+    EXPECT_NE(file, nullptr);
+    std::string content;
+    char buffer[65536];
+    int read_size;
+    while ((read_size = gzread(file, buffer, sizeof(buffer))) > 0) {
+      content.append(buffer, (size_t)read_size);
+    }
+    EXPECT_EQ(read_size, 0);
+    gzclose(file);
+    return content;
+  }
+};
+
+TEST_F(BlendFramesTest, RoundTrip)
+{
+  const std::string content = test_content(BLO_FRAME_SIZE * 2 + 1234);
+  write(content, 100000);
+
+  open();
+  EXPECT_EQ(read(content.size() + 1), content);
+  EXPECT_EQ(read(1), "");
+  EXPECT_EQ(gzip_read(), content);
+}
+
+TEST_F(BlendFramesTest, RoundTripFrameSize)
+{
+  /* Ends exactly at a frame boundary. */
+  const std::string content = test_content(BLO_FRAME_SIZE * 2);
+  write(content, BLO_FRAME_SIZE);
+
+  open();
+  EXPECT_EQ(read(content.size()), content);
+  EXPECT_EQ(read(1), "");
+  EXPECT_EQ(gzip_read(), content);
+}
+
+TEST_F(BlendFramesTest, SeekAcrossFrames)
+{
+  const std::string content = test_content(BLO_FRAME_SIZE * 3 + 10);
+  write(content, 4096);
+  open();
+
+  /* Reading across the boundary of the first and second frame. */
+  EXPECT_EQ(blo_frame_reader_seek(fr, BLO_FRAME_SIZE - 10, SEEK_SET), BLO_FRAME_SIZE - 10);
+  EXPECT_EQ(read(20), content.substr(BLO_FRAME_SIZE - 10, 20));
+
+  /* Back to an earlier frame. */
+  EXPECT_EQ(blo_frame_reader_seek(fr, 5, SEEK_SET), 5);
+  EXPECT_EQ(read(10), content.substr(5, 10));
+
+  /* Over a whole frame. */
+  EXPECT_EQ(blo_frame_reader_seek(fr, BLO_FRAME_SIZE * 2, SEEK_CUR), BLO_FRAME_SIZE * 2 + 15);
+  EXPECT_EQ(read(BLO_FRAME_SIZE), content.substr(BLO_FRAME_SIZE * 2 + 15, BLO_FRAME_SIZE));
+
+  /* The last frame. */
+  EXPECT_EQ(blo_frame_reader_seek(fr, -15, SEEK_END), (int64_t)content.size() - 15);
+  EXPECT_EQ(read(100), content.substr(content.size() - 15));
+}
+
+TEST_F(BlendFramesTest, PlainGzip)
+{
+  /* Files written by gzwrite have no frame index, they are read through gzread. */
+  gzFile file = (gzFile)BLI_gzopen(filepath, "wb1");
+  ASSERT_NE(file, nullptr);
+  const std::string content = test_content(1000);
+  EXPECT_EQ(gzwrite(file, content.data(), content.size()), (int)content.size());
+  gzclose(file);
+
+  filedes = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+  ASSERT_NE(filedes, -1);
+  EXPECT_EQ(blo_frame_reader_open(filedes), nullptr);
+}
+
+}  // namespace blender::blenloader::tests
@@ -0,0 +1,258 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2021 by Blender Foundation.
+ */
+#include "testing/testing.h"
+
+#include <fcntl.h>
+#include <string>
+
+#ifndef WIN32
+#  include <unistd.h>
+#else
+#  include <io.h>
+#endif
+
+#include "MEM_guardedalloc.h"
+
+#include "BKE_appdir.h"
+
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+
+#include "BLO_undofile.h"
+
+#include "intern/blend_journal.h"
+
+namespace blender::blenloader::tests {
+
+/* Large enough for the journal records to be small in comparison. */
+static const size_t chunk_size = 4096;
+
+static MemFileChunk *memfile_add_chunk(MemFile *memfile, const char fill)
+{
+  char *buf = (char *)MEM_mallocN(chunk_size, __func__);
+  memset(buf, fill, chunk_size);
+
+  MemFileChunk *chunk = (MemFileChunk *)MEM_callocN(sizeof(MemFileChunk), __func__);
+  chunk->buf = buf;
+  chunk->size = chunk_size;
+  BLI_addtail(&memfile->chunks, chunk);
+  memfile->size += chunk_size;
+  return chunk;
+}
+
+/* Like undo steps do for unchanged data, the buffer is owned by \a chunk_src. */
+static void memfile_add_chunk_identical(MemFile *memfile, const MemFileChunk *chunk_src)
+{
+  MemFileChunk *chunk = (MemFileChunk *)MEM_callocN(sizeof(MemFileChunk), __func__);
+  chunk->buf = chunk_src->buf;
+  chunk->size = chunk_src->size;
+  chunk->is_identical = true;
+  BLI_addtail(&memfile->chunks, chunk);
+  memfile->size += chunk->size;
+}
+
+static std::string memfile_content(const MemFile *memfile)
+{
+  std::string content;
+  LISTBASE_FOREACH (const MemFileChunk *, chunk, &memfile->chunks) {
+    content.append(chunk->buf, chunk->size);
+  }
+  return content;
+}
+
+static std::string file_content(const char *filepath)
+{
+  size_t size = 0;
+  char *data = (char *)BLI_file_read_binary_as_mem(filepath, 0, &size);
+  if (data == nullptr) {
+    return "";
+  }
+  std::string content(data, size);
+  MEM_freeN(data);
+  return content;
+}
+
+static void file_write(const char *filepath, const std::string &content)
+{
+  FILE *file = BLI_fopen(filepath, "wb");
+  ASSERT_NE(file, nullptr);
+  EXPECT_EQ(fwrite(content.data(), 1, content.size(), file), content.size());
+  fclose(file);
+}
+
+class BlendJournalTest : public testing::Test {
+ protected:
+  char journal_filepath[FILE_MAX];
+  char filepath[FILE_MAX];
+  MemFile memfile_a = {{nullptr}};
+  MemFile memfile_b = {{nullptr}};
+
+  void SetUp() override
+  {
+    BKE_tempdir_init(nullptr);
+    BLI_join_dirfile(journal_filepath,
+                     sizeof(journal_filepath),
+                     BKE_tempdir_session(),
+                     "journal_test" BLO_MEMFILE_JOURNAL_EXT);
+    BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_session(), "journal_test.blend");
+
+    memfile_add_chunk(&memfile_a, 'a');
+    memfile_add_chunk(&memfile_a, 'b');
+    memfile_add_chunk(&memfile_a, 'c');
+
+    /* The next undo step, only the second chunk changed. */
+    memfile_add_chunk_identical(&memfile_b, (MemFileChunk *)BLI_findlink(&memfile_a.chunks, 0));
+    memfile_add_chunk(&memfile_b, 'B');
+    memfile_add_chunk_identical(&memfile_b, (MemFileChunk *)BLI_findlink(&memfile_a.chunks, 2));
+  }
+
+  void TearDown() override
+  {
+    BLO_memfile_free(&memfile_b);
+    BLO_memfile_free(&memfile_a);
+    BLO_memfile_journal_close();
+    BLI_delete(journal_filepath, false, false);
+    BLI_delete(filepath, false, false);
+  }
+
+  /* Content of the last complete snapshot, empty when there is none. */
+  std::string journal_replay()
+  {
+    const int filedes = BLI_open(journal_filepath, O_BINARY | O_RDONLY, 0);
+    if (filedes == -1) {
+      return "";
+    }
+    std::string content;
+    BLOJournalReader *jr = blo_journal_reader_open(filedes);
+    if (jr != nullptr) {
+      char buffer[1000];
+      int64_t read_size;
+      while ((read_size = blo_journal_reader_read(jr, buffer, sizeof(buffer))) > 0) {
+        content.append(buffer, (size_t)read_size);
+      }
+      EXPECT_EQ(read_size, 0);
+      blo_journal_reader_free(jr);
+    }
+    close(filedes);
+    return content;
+  }
+};
+
+TEST_F(BlendJournalTest, WriteReplay)
+{
+  ASSERT_TRUE(BLO_memfile_write_file_incremental(&memfile_a, journal_filepath));
+  EXPECT_EQ(journal_replay(), memfile_content(&memfile_a));
+
+  /* Seeking into the middle of a chunk. */
+  const int filedes = BLI_open(journal_filepath, O_BINARY | O_RDONLY, 0);
+  BLOJournalReader *jr = blo_journal_reader_open(filedes);
+  ASSERT_NE(jr, nullptr);
+  char c = 0;
+  EXPECT_EQ(blo_journal_reader_seek(jr, chunk_size + 10, SEEK_SET), (int64_t)chunk_size + 10);
+  EXPECT_EQ(blo_journal_reader_read(jr, &c, 1), 1);
+  EXPECT_EQ(c, 'b');
+  EXPECT_EQ(blo_journal_reader_seek(jr, -1, SEEK_END), (int64_t)chunk_size * 3 - 1);
+  EXPECT_EQ(blo_journal_reader_read(jr, &c, 1), 1);
+  EXPECT_EQ(c, 'c');
+  EXPECT_EQ(blo_journal_reader_read(jr, &c, 1), 0);
+  blo_journal_reader_free(jr);
+  close(filedes);
+}
+
+TEST_F(BlendJournalTest, WriteIncremental)
+{
+  ASSERT_TRUE(BLO_memfile_write_file_incremental(&memfile_a, journal_filepath));
+  const size_t size_a = BLI_file_size(journal_filepath);
+
+  ASSERT_TRUE(BLO_memfile_write_file_incremental(&memfile_b, journal_filepath));
+  const size_t size_b = BLI_file_size(journal_filepath);
+
+  /* Only the changed chunk and the records describing the file are appended. */
+  EXPECT_GE(size_b - size_a, chunk_size);
+  EXPECT_LT(size_b - size_a, chunk_size * 2);
+  EXPECT_EQ(journal_replay(), memfile_content(&memfile_b));
+}
+
+TEST_F(BlendJournalTest, Recover)
+{
+  ASSERT_TRUE(BLO_memfile_write_file_incremental(&memfile_a, journal_filepath));
+  ASSERT_TRUE(BLO_memfile_write_file_incremental(&memfile_b, journal_filepath));
+
+  ASSERT_TRUE(BLO_memfile_journal_recover(journal_filepath, filepath));
+  EXPECT_EQ(file_content(filepath), memfile_content(&memfile_b));
+}
+
+TEST_F(BlendJournalTest, InterruptedSave)
+{
+  ASSERT_TRUE(BLO_memfile_write_file_incremental(&memfile_a, journal_filepath));
+  ASSERT_TRUE(BLO_memfile_write_file_incremental(&memfile_b, journal_filepath));
+  BLO_memfile_journal_close();
+
+  /* Cut the journal in the middle of the last snapshot record. */
+  const std::string journal = file_content(journal_filepath);
+  file_write(journal_filepath, journal.substr(0, journal.size() - 8));
+  EXPECT_EQ(journal_replay(), memfile_content(&memfile_a));
+
+  /* Cut in the middle of the changed chunk. */
+  file_write(journal_filepath, journal.substr(0, journal.size() - chunk_size / 2));
+  EXPECT_EQ(journal_replay(), memfile_content(&memfile_a));
+
+  ASSERT_TRUE(BLO_memfile_journal_recover(journal_filepath, filepath));
+  EXPECT_EQ(file_content(filepath), memfile_content(&memfile_a));
+}
+
+TEST_F(BlendJournalTest, CorruptSnapshot)
+{
+  ASSERT_TRUE(BLO_memfile_write_file_incremental(&memfile_a, journal_filepath));
+  ASSERT_TRUE(BLO_memfile_write_file_incremental(&memfile_b, journal_filepath));
+  BLO_memfile_journal_close();
+
+  /* The hash of the last snapshot doesn't match anymore. */
+  std::string journal = file_content(journal_filepath);
+  journal[journal.size() - 1] ^= 0xff;
+  file_write(journal_filepath, journal);
+  EXPECT_EQ(journal_replay(), memfile_content(&memfile_a));
+}
+
+TEST_F(BlendJournalTest, NotAJournal)
+{
+  file_write(journal_filepath, std::string(chunk_size, 'x'));
+  file_write(filepath, "previous");
+
+  EXPECT_EQ(journal_replay(), "");
+  EXPECT_FALSE(BLO_memfile_journal_recover(journal_filepath, filepath));
+  /* The previous file is kept. */
+  EXPECT_EQ(file_content(filepath), "previous");
+}
+
+TEST_F(BlendJournalTest, NoSnapshot)
+{
+  ASSERT_TRUE(BLO_memfile_write_file_incremental(&memfile_a, journal_filepath));
+  BLO_memfile_journal_close();
+
+  /* Only the header and the first chunk made it to disk. */
+  const std::string journal = file_content(journal_filepath);
+  file_write(journal_filepath, journal.substr(0, 16 + 16 + chunk_size));
+
+  EXPECT_EQ(journal_replay(), "");
+  EXPECT_FALSE(BLO_memfile_journal_recover(journal_filepath, filepath));
+  EXPECT_FALSE(BLI_exists(filepath));
+}
+
+}  // namespace blender::blenloader::tests
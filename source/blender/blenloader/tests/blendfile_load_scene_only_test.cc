@@ -0,0 +1,118 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2021 by Blender Foundation.
+ */
+#include "blendfile_loading_base_test.h"
+
+#include "BKE_appdir.h"
+#include "BKE_collection.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_material.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "BLI_fileops.h"
+#include "BLI_path_util.h"
+
+#include "BLO_readfile.h"
+#include "BLO_writefile.h"
+
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+class BlendfileLoadSceneOnlyTest : public BlendfileLoadingBaseTest {
+ protected:
+  char filepath[FILE_MAX];
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+
+    BKE_tempdir_init(nullptr);
+    BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_session(), "load_scene_only.blend");
+    write_test_file();
+  }
+
+  void TearDown() override
+  {
+    BLI_delete(filepath, false, false);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  /* A scene using a mesh object, next to data-blocks it doesn't use. */
+  void write_test_file()
+  {
+    Main *bmain = BKE_main_new();
+
+    Scene *scene = BKE_scene_add(bmain, "Scene");
+    Object *ob = BKE_object_add_only_object(bmain, OB_MESH, "UsedObject");
+    ob->data = BKE_mesh_add(bmain, "UsedMesh");
+    BKE_collection_object_add(bmain, scene->master_collection, ob);
+
+    BKE_object_add_only_object(bmain, OB_EMPTY, "UnusedObject");
+    BKE_mesh_add(bmain, "UnusedMesh");
+    BKE_material_add(bmain, "UnusedMaterial");
+
+    BlendFileWriteParams params = {};
+    EXPECT_TRUE(BLO_write_file(bmain, filepath, 0, &params, nullptr));
+
+    BKE_main_free(bmain);
+  }
+
+  bool has_id(const short type, const char *name)
+  {
+    return BKE_libblock_find_name(bfile->main, type, name) != nullptr;
+  }
+};
+
+TEST_F(BlendfileLoadSceneOnlyTest, ReadAll)
+{
+  bfile = BLO_read_from_file(filepath, BLO_READ_SKIP_USERDEF, nullptr);
+  ASSERT_NE(bfile, nullptr);
+
+  EXPECT_FALSE(bfile->main->is_partially_read);
+  EXPECT_TRUE(has_id(ID_SCE, "Scene"));
+  EXPECT_TRUE(has_id(ID_OB, "UsedObject"));
+  EXPECT_TRUE(has_id(ID_ME, "UsedMesh"));
+  EXPECT_TRUE(has_id(ID_OB, "UnusedObject"));
+  EXPECT_TRUE(has_id(ID_ME, "UnusedMesh"));
+  EXPECT_TRUE(has_id(ID_MA, "UnusedMaterial"));
+}
+
+TEST_F(BlendfileLoadSceneOnlyTest, SkipUnusedIDs)
+{
+  bfile = BLO_read_from_file(
+      filepath, eBLOReadSkip(BLO_READ_SKIP_USERDEF | BLO_READ_SKIP_UNUSED_IDS), nullptr);
+  ASSERT_NE(bfile, nullptr);
+
+  EXPECT_TRUE(bfile->main->is_partially_read);
+  EXPECT_TRUE(has_id(ID_SCE, "Scene"));
+  EXPECT_TRUE(has_id(ID_OB, "UsedObject"));
+  EXPECT_TRUE(has_id(ID_ME, "UsedMesh"));
+  EXPECT_FALSE(has_id(ID_OB, "UnusedObject"));
+  EXPECT_FALSE(has_id(ID_ME, "UnusedMesh"));
+  EXPECT_FALSE(has_id(ID_MA, "UnusedMaterial"));
+
+  Object *ob = (Object *)BKE_libblock_find_name(bfile->main, ID_OB, "UsedObject");
+  ASSERT_NE(ob, nullptr);
+  EXPECT_EQ(ob->data, BKE_libblock_find_name(bfile->main, ID_ME, "UsedMesh"));
+
+  /* Saving would lose the data-blocks which were not read. */
+  BlendFileWriteParams params = {};
+  EXPECT_FALSE(BLO_write_file(bfile->main, filepath, 0, &params, nullptr));
+}
@@ -67,8 +67,16 @@ typedef enum CompositorPriority {
 
 // workscheduler threading models
 /**
- * COM_TM_QUEUE is a multi-threaded model, which uses the BLI_thread_queue pattern.
- * This is the default option.
+ * COM_TM_TASK is a multi-threaded model, CPU work is pushed to a BLI_task pool so it's executed by
+ * the threads of the task scheduler shared with the rest of Blender.
+ * Only multi-threaded when Blender is built with TBB, without it task pools run their tasks in
+ * the thread waiting for them.
+ */
+#define COM_TM_TASK 2
+
+/**
+ * COM_TM_QUEUE is a multi-threaded model, which uses the BLI_thread_queue pattern with a thread
+ * for every CPUDevice.
  */
 #define COM_TM_QUEUE 1
 
@@ -79,9 +87,14 @@ typedef enum CompositorPriority {
 #define COM_TM_NOTHREAD 0
 
 /**
- * COM_CURRENT_THREADING_MODEL can be one of the above, COM_TM_QUEUE is currently default.
+ * COM_CURRENT_THREADING_MODEL can be one of the above, COM_TM_TASK is currently default when
+ * building with TBB and COM_TM_QUEUE otherwise.
  */
-#define COM_CURRENT_THREADING_MODEL COM_TM_QUEUE
+#ifdef WITH_TBB
+#  define COM_CURRENT_THREADING_MODEL COM_TM_TASK
+#else
+#  define COM_CURRENT_THREADING_MODEL COM_TM_QUEUE
+#endif
 // chunk order
 /**
  * \brief The order of chunks to be scheduled
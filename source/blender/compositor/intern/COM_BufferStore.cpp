@@ -0,0 +1,151 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#ifndef WIN32
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+#ifdef __linux__
+#  include <linux/magic.h>
+#  include <sys/vfs.h>
+#endif
+
+#include <cstdio>
+
+#include "atomic_ops.h"
+
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_appdir.h"
+#include "BKE_main.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "COM_BufferStore.h"
+#include "COM_Profiler.h"
+
+/** Memory of the buffers that are not mapped files. */
+static size_t g_memory_size = 0;
+
+#ifndef WIN32
+/* Files in such a directory take memory just like the buffers. */
+static bool directory_is_in_memory(const char *dirpath)
+{
+#  ifdef __linux__
+  struct statfs fs;
+  if (statfs(dirpath, &fs) == 0) {
+    return ELEM(fs.f_type, TMPFS_MAGIC, RAMFS_MAGIC);
+  }
+#  else
+  UNUSED_VARS(dirpath);
+#  endif
+  return false;
+}
+
+static float *map_temporary_file(size_t size, const char *directory)
+{
+  char dirpath[FILE_MAX];
+  if (directory && directory[0]) {
+    BLI_strncpy(dirpath, directory, sizeof(dirpath));
+    BLI_path_abs(dirpath, BKE_main_blendfile_path_from_global());
+  }
+  else {
+    BLI_strncpy(dirpath, BKE_tempdir_session(), sizeof(dirpath));
+  }
+
+  if (directory_is_in_memory(dirpath)) {
+    static bool reported = false;
+    if (!reported) {
+      printf("Compositor: %s is in memory, buffers over the limit are not kept on disk\n",
+             dirpath);
+      reported = true;
+    }
+    return nullptr;
+  }
+
+  char filepath[FILE_MAX];
+  BLI_join_dirfile(filepath, sizeof(filepath), dirpath, "compositor_buffer_XXXXXX");
+  const int file = mkstemp(filepath);
+  if (file == -1) {
+    return nullptr;
+  }
+  /* Nothing else needs the file, it's removed when unmapped or when Blender exits. */
+  unlink(filepath);
+
+  void *buffer = MAP_FAILED;
+#  ifdef __linux__
+  /* Reserve the space, running out of disk while writing pixels would crash. */
+  const bool resized = posix_fallocate(file, 0, (off_t)size) == 0;
+#  else
+  const bool resized = ftruncate(file, (off_t)size) == 0;
+#  endif
+  if (resized) {
+    buffer = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+  }
+  close(file);
+
+  return (buffer == MAP_FAILED) ? nullptr : (float *)buffer;
+}
+#endif
+
+float *BufferStore::allocate(size_t size,
+                             size_t memory_limit,
+                             const char *directory,
+                             bool *r_mapped)
+{
+  if (Profiler::is_enabled()) {
+    Profiler::buffer_allocated(size);
+  }
+
+#ifndef WIN32
+  /* Buffers allocated at the same time may both stay in memory, the limit isn't exact. */
+  if (memory_limit != 0 && g_memory_size + size > memory_limit) {
+    float *buffer = map_temporary_file(size, directory);
+    if (buffer) {
+      *r_mapped = true;
+      return buffer;
+    }
+  }
+#else
+  UNUSED_VARS(memory_limit, directory);
+#endif
+
+  atomic_add_and_fetch_z(&g_memory_size, size);
+  *r_mapped = false;
+  return (float *)MEM_mallocN_aligned(size, 16, "COM_MemoryBuffer");
+}
+
+void BufferStore::free(float *buffer, size_t size, bool mapped)
+{
+  if (Profiler::is_enabled()) {
+    Profiler::buffer_freed(size);
+  }
+
+#ifndef WIN32
+  if (mapped) {
+    munmap(buffer, size);
+    return;
+  }
+#endif
+
+  atomic_sub_and_fetch_z(&g_memory_size, size);
+  MEM_freeN(buffer);
+}
@@ -0,0 +1,51 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * \brief Allocates the pixels of MemoryBuffers, keeping buffers over a memory limit on disk.
+ *
+ * Buffers which would take the memory of all buffers over the limit are stored in an unlinked
+ * temporary file which is mapped in memory. Operations keep reading and writing the pixels as
+ * usual, the system pages the parts that are used in and writes parts that weren't used for a
+ * while back to the file, so chunks stream through without the whole image being resident.
+ *
+ * Mapping files is only supported on POSIX systems, elsewhere buffers are always allocated in
+ * memory. The files have to be on disk, files in memory file systems (tmpfs, which the temporary
+ * directory often is on Linux) would take as much memory as the buffers. On Linux such
+ * directories are detected, and buffers are allocated in memory instead.
+ */
+class BufferStore {
+ public:
+  /**
+   * \brief allocate \a size bytes aligned to 16 bytes
+   * \param memory_limit: keep the buffer on disk when the buffers in memory would take more
+   * than this, 0 for no limit
+   * \param directory: directory of the file, may be relative to the blend file. The temporary
+   * directory when NULL or empty.
+   * \param r_mapped: set when the buffer is a mapped file
+   */
+  static float *allocate(size_t size,
+                         size_t memory_limit,
+                         const char *directory,
+                         bool *r_mapped);
+  static void free(float *buffer, size_t size, bool mapped);
+};
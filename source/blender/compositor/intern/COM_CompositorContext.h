@@ -267,4 +267,13 @@ class CompositorContext {
   {
     return (this->getbNodeTree()->flag & NTREE_COM_GROUPNODE_BUFFER) != 0;
   }
+
+  /**
+   * \brief are operations executed one after the other on whole buffers, instead of per tile
+   * \see FullFrameExecutionModel
+   */
+  bool isFullFrameExecution() const
+  {
+    return this->getbNodeTree()->execution_mode == NTREE_EXECUTION_MODE_FULL_FRAME;
+  }
 };
@@ -27,6 +27,7 @@
 #include "COM_Debug.h"
 #include "COM_ExecutionGroup.h"
 #include "COM_ExecutionSystem.h"
+#include "COM_Profiler.h"
 #include "COM_ReadBufferOperation.h"
 #include "COM_ViewerOperation.h"
 #include "COM_WorkScheduler.h"
@@ -320,6 +321,7 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
   }
 
   DebugInfo::execution_group_started(this);
+  Profiler::group_started(this);
   DebugInfo::graphviz(graph);
 
   bool breaked = false;
@@ -328,6 +330,7 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
   const int maxNumberEvaluated = BLI_system_thread_count() * 2;
 
   while (!finished && !breaked) {
+    const unsigned int numFinishedWork = WorkScheduler::get_num_finished_work();
     bool startEvaluated = false;
     finished = true;
     int numberEvaluated = 0;
@@ -359,13 +362,17 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
       }
     }
 
-    WorkScheduler::finish();
+    /* Continue as soon as a chunk finished instead of waiting for all scheduled chunks, so chunks
+     * depending on it are scheduled while the threads are still busy with the other chunks. */
+    WorkScheduler::wait_for_work(numFinishedWork);
 
     if (bTree->test_break && bTree->test_break(bTree->tbh)) {
       breaked = true;
     }
   }
+  WorkScheduler::finish();
   DebugInfo::execution_group_finished(this);
+  Profiler::group_finished(this);
   DebugInfo::graphviz(graph);
 
   MEM_freeN(chunkOrder);
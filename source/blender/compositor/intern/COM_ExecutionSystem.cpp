@@ -18,6 +18,7 @@
 
 #include "COM_ExecutionSystem.h"
 
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "PIL_time.h"
 
@@ -28,8 +29,10 @@
 #include "COM_Converter.h"
 #include "COM_Debug.h"
 #include "COM_ExecutionGroup.h"
+#include "COM_FullFrameExecutionModel.h"
 #include "COM_NodeOperation.h"
 #include "COM_NodeOperationBuilder.h"
+#include "COM_Profiler.h"
 #include "COM_ReadBufferOperation.h"
 #include "COM_WorkScheduler.h"
 
@@ -59,8 +62,10 @@ ExecutionSystem::ExecutionSystem(RenderData *rd,
     this->m_context.setQuality((CompositorQuality)editingtree->edit_quality);
   }
   this->m_context.setRendering(rendering);
+  /* OpenCL executes tiles of execution groups, which full-frame execution doesn't have. */
   this->m_context.setHasActiveOpenCLDevices(WorkScheduler::hasGPUDevices() &&
-                                            (editingtree->flag & NTREE_COM_OPENCL));
+                                            (editingtree->flag & NTREE_COM_OPENCL) &&
+                                            !this->m_context.isFullFrameExecution());
 
   this->m_context.setRenderData(rd);
   this->m_context.setViewSettings(viewSettings);
@@ -134,6 +139,16 @@ void ExecutionSystem::execute()
 
   DebugInfo::execute_started(this);
 
+  if (this->m_context.isFullFrameExecution()) {
+    Profiler::execution_started(BLI_task_scheduler_num_threads());
+    FullFrameExecutionModel execution_model(this->m_context, this->m_operations);
+    execution_model.execute();
+    Profiler::execution_finished();
+    return;
+  }
+
+  Profiler::execution_started(WorkScheduler::get_num_cpu_threads());
+
   unsigned int order = 0;
   for (vector<NodeOperation *>::iterator iter = this->m_operations.begin();
        iter != this->m_operations.end();
@@ -197,6 +212,8 @@ void ExecutionSystem::execute()
     ExecutionGroup *executionGroup = this->m_groups[index];
     executionGroup->deinitExecution();
   }
+
+  Profiler::execution_finished();
 }
 
 void ExecutionSystem::executeGroups(CompositorPriority priority)
@@ -0,0 +1,607 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#include "COM_FullFrameExecutionModel.h"
+
+#include "BLI_rect.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+
+#include "BLT_translation.h"
+
+#include "DNA_color_types.h"
+#include "DNA_scene_types.h"
+
+#include "COM_MemoryBuffer.h"
+#include "COM_MemoryBufferCache.h"
+#include "COM_NodeOperation.h"
+#include "COM_Profiler.h"
+#include "COM_ReadBufferOperation.h"
+#include "COM_WriteBufferOperation.h"
+
+#ifdef WITH_CXX_GUARDEDALLOC
+#  include "MEM_guardedalloc.h"
+#endif
+
+FullFrameExecutionModel::FullFrameExecutionModel(const CompositorContext &context,
+                                                 const vector<NodeOperation *> &operations)
+    : m_context(context), m_operations(operations)
+{
+}
+
+FullFrameExecutionModel::~FullFrameExecutionModel()
+{
+  for (std::map<NodeOperation *, OperationState>::iterator it = m_states.begin();
+       it != m_states.end();
+       ++it) {
+    OperationState &state = it->second;
+    release_buffer(state);
+    delete state.reader;
+  }
+}
+
+void FullFrameExecutionModel::execute()
+{
+  const bNodeTree *editingtree = m_context.getbNodeTree();
+  const bool rendering = m_context.isRendering();
+
+  for (unsigned int index = 0; index < m_operations.size(); index++) {
+    m_operations[index]->setbNodeTree(editingtree);
+  }
+
+  /* Output operations of lower priority are executed after all higher priority ones, including
+   * the operations they read. Fast calculation only executes high priority outputs. */
+  const CompositorPriority priorities[] = {
+      COM_PRIORITY_HIGH, COM_PRIORITY_MEDIUM, COM_PRIORITY_LOW};
+  const int priorities_len = m_context.isFastCalculation() ? 1 : ARRAY_SIZE(priorities);
+  for (int i = 0; i < priorities_len; i++) {
+    for (unsigned int index = 0; index < m_operations.size(); index++) {
+      NodeOperation *operation = m_operations[index];
+      if (operation->isOutputOperation(rendering) &&
+          operation->getRenderPriority() == priorities[i]) {
+        schedule(operation);
+      }
+    }
+  }
+
+  link_readers();
+
+  const bool use_cache = MemoryBufferCache::isEnabled();
+  if (use_cache) {
+    determine_keys();
+  }
+  determine_needed_operations(use_cache);
+
+  for (unsigned int index = 0; index < m_order.size(); index++) {
+    NodeOperation *operation = m_order[index];
+    if (operation->isBraked()) {
+      break;
+    }
+    OperationState &state = m_states[operation];
+    if (!state.needed || state.buffer) {
+      continue;
+    }
+
+    char buf[128];
+    BLI_snprintf(buf,
+                 sizeof(buf),
+                 TIP_("Compositing | Operation %u-%u"),
+                 index + 1,
+                 (unsigned int)m_order.size());
+    editingtree->stats_draw(editingtree->sdh, buf);
+
+    execute_operation(operation);
+    if (use_cache) {
+      cache_buffer(operation);
+    }
+    release_inputs(operation);
+
+    editingtree->progress(editingtree->prh, (float)(index + 1) / m_order.size());
+  }
+
+  editingtree->stats_draw(editingtree->sdh, TIP_("Compositing | De-initializing execution"));
+  for (unsigned int index = 0; index < m_order.size(); index++) {
+    deinit_operation(m_order[index]);
+  }
+
+  unlink_readers();
+}
+
+/**
+ * Add \a operation to the execution order, after all operations it reads.
+ */
+void FullFrameExecutionModel::schedule(NodeOperation *operation)
+{
+  OperationState &state = m_states[operation];
+  if (state.scheduled) {
+    return;
+  }
+  state.scheduled = true;
+
+  for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+    NodeOperationInput *input = operation->getInputSocket(index);
+    NodeOperation *input_operation = nullptr;
+    if (input->isConnected()) {
+      input_operation = &input->getLink()->getOperation();
+      schedule(input_operation);
+    }
+    state.input_operations.push_back(input_operation);
+  }
+
+  /* Buffers of read operations are written by the write operation of their memory proxy. */
+  if (operation->isReadBufferOperation()) {
+    MemoryProxy *memory_proxy = ((ReadBufferOperation *)operation)->getMemoryProxy();
+    if (memory_proxy) {
+      schedule(memory_proxy->getWriteBufferOperation());
+    }
+  }
+
+  m_order.push_back(operation);
+}
+
+/**
+ * Link the inputs of all operations to readers of the buffers of their input operations.
+ * Read operations already read a buffer, they are kept as they are.
+ */
+void FullFrameExecutionModel::link_readers()
+{
+  for (unsigned int index = 0; index < m_order.size(); index++) {
+    NodeOperation *operation = m_order[index];
+    if (operation->getNumberOfOutputSockets() == 0 || operation->isReadBufferOperation()) {
+      continue;
+    }
+    ReadBufferOperation *reader = new ReadBufferOperation(
+        operation->getOutputSocket()->getDataType());
+    unsigned int resolution[2] = {operation->getWidth(), operation->getHeight()};
+    reader->setResolution(resolution);
+    reader->setbNodeTree(m_context.getbNodeTree());
+    m_states[operation].reader = reader;
+  }
+
+  for (unsigned int index = 0; index < m_order.size(); index++) {
+    NodeOperation *operation = m_order[index];
+    for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+      NodeOperationInput *input = operation->getInputSocket(i);
+      if (!input->isConnected()) {
+        continue;
+      }
+      ReadBufferOperation *reader = m_states[&input->getLink()->getOperation()].reader;
+      if (reader) {
+        m_replaced_links.push_back(std::make_pair(input, input->getLink()));
+        input->setLink(reader->getOutputSocket());
+      }
+    }
+  }
+}
+
+void FullFrameExecutionModel::unlink_readers()
+{
+  for (unsigned int index = 0; index < m_replaced_links.size(); index++) {
+    m_replaced_links[index].first->setLink(m_replaced_links[index].second);
+  }
+  m_replaced_links.clear();
+}
+
+/**
+ * Like write buffer operations, store a single value when the operation has no resolution.
+ */
+static bool is_single_value(NodeOperation *operation)
+{
+  return operation->getWidth() == 0 || operation->getHeight() == 0;
+}
+
+/**
+ * Hash the settings of the execution that change the output of operations.
+ */
+static uint64_t context_hash(const CompositorContext &context)
+{
+  const CompositorQuality quality = context.getQuality();
+  const bool rendering = context.isRendering();
+  uint64_t hash = MemoryBufferCache::hash(&quality, sizeof(quality), 0);
+  hash = MemoryBufferCache::hash(&rendering, sizeof(rendering), hash);
+
+  const RenderData *rd = context.getRenderData();
+  if (rd) {
+    hash = MemoryBufferCache::hash(&rd->size, sizeof(rd->size), hash);
+    hash = MemoryBufferCache::hash(&rd->xsch, sizeof(rd->xsch), hash);
+    hash = MemoryBufferCache::hash(&rd->ysch, sizeof(rd->ysch), hash);
+  }
+  const char *view_name = context.getViewName();
+  if (view_name) {
+    hash = MemoryBufferCache::hash(view_name, strlen(view_name), hash);
+  }
+  const ColorManagedViewSettings *view_settings = context.getViewSettings();
+  if (view_settings) {
+    hash = MemoryBufferCache::hash(
+        view_settings, offsetof(ColorManagedViewSettings, curve_mapping), hash);
+  }
+  const ColorManagedDisplaySettings *display_settings = context.getDisplaySettings();
+  if (display_settings) {
+    hash = MemoryBufferCache::hash(
+        display_settings->display_device, strlen(display_settings->display_device), hash);
+  }
+  return hash;
+}
+
+/**
+ * Determine the cache keys of the operations, in execution order so the keys of their inputs
+ * are known. Operations with unknown settings that only read constant inputs, like images, are
+ * executed to key them by the content of their buffer. Other operations with unknown settings or
+ * inputs are not cached.
+ */
+void FullFrameExecutionModel::determine_keys()
+{
+  const uint64_t base_hash = context_hash(m_context);
+
+  for (unsigned int index = 0; index < m_order.size(); index++) {
+    NodeOperation *operation = m_order[index];
+    OperationState &state = m_states[operation];
+    state.key = 0;
+    if (operation->getNumberOfOutputSockets() == 0 || operation->isReadBufferOperation()) {
+      continue;
+    }
+
+    const unsigned int resolution[2] = {operation->getWidth(), operation->getHeight()};
+    const DataType datatype = operation->getOutputSocket()->getDataType();
+    uint64_t hash = MemoryBufferCache::hash(resolution, sizeof(resolution), base_hash);
+    hash = MemoryBufferCache::hash(&datatype, sizeof(datatype), hash);
+
+    if (operation->isSetOperation()) {
+      float value[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+      operation->readSampled(value, 0, 0, COM_PS_NEAREST);
+      state.key = MemoryBufferCache::hash(value, sizeof(value), hash);
+      continue;
+    }
+
+    bool inputs_known = true;
+    bool inputs_constant = true;
+    for (unsigned int i = 0; i < state.input_operations.size(); i++) {
+      NodeOperation *input_operation = state.input_operations[i];
+      const uint64_t input_key = input_operation ? m_states[input_operation].key : 0;
+      if (input_key == 0) {
+        inputs_known = false;
+      }
+      if (input_operation && !input_operation->isSetOperation()) {
+        inputs_constant = false;
+      }
+      hash = MemoryBufferCache::hash(&input_key, sizeof(input_key), hash);
+    }
+
+    if (operation->getSettingsHash() != 0) {
+      if (inputs_known) {
+        const uint64_t settings_hash = operation->getSettingsHash();
+        state.key = MemoryBufferCache::hash(&settings_hash, sizeof(settings_hash), hash);
+      }
+    }
+    else if (inputs_constant) {
+      for (unsigned int i = 0; i < state.input_operations.size(); i++) {
+        NodeOperation *input_operation = state.input_operations[i];
+        if (input_operation && m_states[input_operation].buffer == nullptr) {
+          execute_operation(input_operation);
+        }
+      }
+      execute_operation(operation);
+      MemoryBuffer *buffer = state.buffer;
+      const size_t size = sizeof(float) * buffer->getWidth() * buffer->getHeight() *
+                          buffer->get_num_channels();
+      state.key = MemoryBufferCache::hash(buffer->getBuffer(), size, hash);
+    }
+  }
+}
+
+/**
+ * Mark the operations that have to be executed, starting from the outputs. Operations with a
+ * cached buffer use it and don't need their inputs, buffers that aren't read are released.
+ */
+void FullFrameExecutionModel::determine_needed_operations(bool use_cache)
+{
+  const bool rendering = m_context.isRendering();
+  for (unsigned int index = 0; index < m_order.size(); index++) {
+    m_states[m_order[index]].needed = m_order[index]->isOutputOperation(rendering);
+  }
+
+  for (int index = (int)m_order.size() - 1; index >= 0; index--) {
+    NodeOperation *operation = m_order[index];
+    OperationState &state = m_states[operation];
+    if (!state.needed || state.buffer) {
+      continue;
+    }
+
+    if (use_cache && state.key != 0 && !operation->isSetOperation()) {
+      state.buffer = MemoryBufferCache::acquire(state.key);
+      if (state.buffer) {
+        const double time = PIL_check_seconds_timer();
+        Profiler::operation_executed(operation, time, time, true);
+        state.cached = true;
+        state.reader->setMemoryBuffer(state.buffer, is_single_value(operation));
+        continue;
+      }
+    }
+
+    for (unsigned int i = 0; i < state.input_operations.size(); i++) {
+      NodeOperation *input_operation = state.input_operations[i];
+      if (input_operation) {
+        m_states[input_operation].needed = true;
+        m_states[input_operation].pending_reads++;
+      }
+    }
+    if (operation->isReadBufferOperation()) {
+      MemoryProxy *memory_proxy = ((ReadBufferOperation *)operation)->getMemoryProxy();
+      if (memory_proxy) {
+        m_states[memory_proxy->getWriteBufferOperation()].needed = true;
+      }
+    }
+  }
+
+  /* Buffers of operations executed to determine their key may not be read. */
+  for (unsigned int index = 0; index < m_order.size(); index++) {
+    OperationState &state = m_states[m_order[index]];
+    if (state.pending_reads == 0) {
+      release_buffer(state);
+    }
+  }
+}
+
+void FullFrameExecutionModel::init_operation(NodeOperation *operation)
+{
+  OperationState &state = m_states[operation];
+  if (operation->isReadBufferOperation()) {
+    ReadBufferOperation *read_operation = (ReadBufferOperation *)operation;
+    if (read_operation->getMemoryProxy()) {
+      read_operation->updateMemoryBuffer();
+    }
+  }
+  operation->initExecution();
+  state.initialized = true;
+}
+
+void FullFrameExecutionModel::deinit_operation(NodeOperation *operation)
+{
+  OperationState &state = m_states[operation];
+  if (state.initialized) {
+    operation->deinitExecution();
+    state.initialized = false;
+  }
+}
+
+void FullFrameExecutionModel::execute_operation(NodeOperation *operation)
+{
+  const double start_time = Profiler::is_enabled() ? PIL_check_seconds_timer() : 0.0;
+  init_operation(operation);
+
+  if (operation->isReadBufferOperation()) {
+    /* Read by the operations using it, until the end of the execution. */
+  }
+  else if (operation->getNumberOfOutputSockets() > 0) {
+    execute_buffer_operation(operation);
+    deinit_operation(operation);
+  }
+  else {
+    execute_region_operation(operation);
+    /* The memory proxy buffer of a write operation is freed when de-initializing it. */
+    if (!operation->isWriteBufferOperation()) {
+      deinit_operation(operation);
+      operation->updateDraw();
+    }
+  }
+
+  if (Profiler::is_enabled()) {
+    Profiler::operation_executed(operation, start_time, PIL_check_seconds_timer(), false);
+  }
+}
+
+struct ExecuteAreaData {
+  NodeOperation *operation;
+  /** Buffer to write to, when null NodeOperation.executeRegion is used. */
+  MemoryBuffer *output;
+  /** Input buffers for NodeOperation.executeArea, when null pixels are read one by one. */
+  MemoryBuffer **inputs;
+  rcti area;
+  int strip_height;
+};
+
+/**
+ * Write the pixels of \a operation in \a rect to \a output, reading them one by one like the
+ * #WriteBufferOperation does.
+ */
+static void read_operation_pixels(NodeOperation *operation, MemoryBuffer *output, rcti *rect)
+{
+  const int num_channels = output->get_num_channels();
+  if (operation->isComplex()) {
+    void *data = operation->initializeTileData(rect);
+    for (int y = rect->ymin; y < rect->ymax; y++) {
+      float *pixel = output->getElem(rect->xmin, y);
+      for (int x = rect->xmin; x < rect->xmax; x++) {
+        operation->read(pixel, x, y, data);
+        pixel += num_channels;
+      }
+    }
+    if (data) {
+      operation->deinitializeTileData(rect, data);
+    }
+  }
+  else {
+    for (int y = rect->ymin; y < rect->ymax; y++) {
+      float *pixel = output->getElem(rect->xmin, y);
+      for (int x = rect->xmin; x < rect->xmax; x++) {
+        operation->readSampled(pixel, x, y, COM_PS_NEAREST);
+        pixel += num_channels;
+      }
+    }
+  }
+}
+
+static void execute_area_strip(void *__restrict userdata,
+                               const int strip,
+                               const TaskParallelTLS *__restrict tls)
+{
+  ExecuteAreaData *data = (ExecuteAreaData *)userdata;
+  NodeOperation *operation = data->operation;
+  if (operation->isBraked()) {
+    return;
+  }
+  const double start_time = Profiler::is_enabled() ? PIL_check_seconds_timer() : 0.0;
+
+  rcti rect;
+  const int ymin = data->area.ymin + strip * data->strip_height;
+  const int ymax = min(ymin + data->strip_height, data->area.ymax);
+  BLI_rcti_init(&rect, data->area.xmin, data->area.xmax, ymin, ymax);
+
+  if (data->output == nullptr) {
+    operation->executeRegion(&rect, strip);
+  }
+  else if (data->inputs) {
+    operation->executeArea(data->output, &rect, data->inputs);
+  }
+  else {
+    read_operation_pixels(operation, data->output, &rect);
+  }
+
+  if (Profiler::is_enabled()) {
+    Profiler::area_executed(
+        operation, BLI_task_parallel_thread_id(tls), start_time, PIL_check_seconds_timer());
+  }
+}
+
+/**
+ * Execute \a data in horizontal strips of about as many pixels as a chunk, in parallel unless
+ * the operation is single threaded.
+ */
+static void execute_area(ExecuteAreaData *data, const int chunksize)
+{
+  const int width = BLI_rcti_size_x(&data->area);
+  const int height = BLI_rcti_size_y(&data->area);
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  if (data->operation->isSingleThreaded()) {
+    data->strip_height = height;
+    settings.use_threading = false;
+  }
+  else {
+    data->strip_height = max(1, chunksize * chunksize / width);
+  }
+  const int strips_len = (height + data->strip_height - 1) / data->strip_height;
+  BLI_task_parallel_range(0, strips_len, data, execute_area_strip, &settings);
+}
+
+void FullFrameExecutionModel::execute_buffer_operation(NodeOperation *operation)
+{
+  OperationState &state = m_states[operation];
+
+  const bool single_value = is_single_value(operation);
+  rcti rect;
+  BLI_rcti_init(&rect,
+                0,
+                single_value ? 1 : operation->getWidth(),
+                0,
+                single_value ? 1 : operation->getHeight());
+  state.buffer = new MemoryBuffer(operation->getOutputSocket()->getDataType(), &rect);
+
+  /* Operations reading the buffers of their inputs can only do so when all inputs have one,
+   * which is not the case for unconnected inputs and read operations. */
+  vector<MemoryBuffer *> inputs;
+  bool use_inputs = operation->isFullFrameOperation();
+  for (unsigned int index = 0; index < state.input_operations.size() && use_inputs; index++) {
+    NodeOperation *input_operation = state.input_operations[index];
+    MemoryBuffer *buffer = input_operation ? m_states[input_operation].buffer : nullptr;
+    if (buffer == nullptr) {
+      use_inputs = false;
+    }
+    inputs.push_back(buffer);
+  }
+
+  ExecuteAreaData data;
+  data.operation = operation;
+  data.output = state.buffer;
+  data.inputs = use_inputs ? inputs.data() : nullptr;
+  data.area = rect;
+  data.strip_height = 1;
+  execute_area(&data, m_context.getChunksize());
+
+  state.buffer->setCreatedState();
+  state.reader->setMemoryBuffer(state.buffer, single_value);
+}
+
+/**
+ * Add the buffer of \a operation to the cache, when its key is known and the operation is worth
+ * caching: set operations are cheaper to execute than to look up and operations without settings
+ * hash always have to be executed to know their key.
+ */
+void FullFrameExecutionModel::cache_buffer(NodeOperation *operation)
+{
+  OperationState &state = m_states[operation];
+  if (state.buffer == nullptr || state.key == 0 || operation->getSettingsHash() == 0 ||
+      operation->isSetOperation() || operation->isBraked()) {
+    return;
+  }
+  if (MemoryBufferCache::add(state.key, state.buffer)) {
+    state.cached = true;
+  }
+}
+
+void FullFrameExecutionModel::execute_region_operation(NodeOperation *operation)
+{
+  ExecuteAreaData data;
+  data.operation = operation;
+  data.output = nullptr;
+  data.inputs = nullptr;
+  BLI_rcti_init(&data.area, 0, operation->getWidth(), 0, operation->getHeight());
+  data.strip_height = 1;
+  execute_area(&data, m_context.getChunksize());
+}
+
+/**
+ * Free the buffers of the inputs of \a operation that are not read anymore.
+ */
+void FullFrameExecutionModel::release_inputs(NodeOperation *operation)
+{
+  const vector<NodeOperation *> &input_operations = m_states[operation].input_operations;
+  for (unsigned int index = 0; index < input_operations.size(); index++) {
+    if (input_operations[index] == nullptr) {
+      continue;
+    }
+    OperationState &input_state = m_states[input_operations[index]];
+    input_state.pending_reads--;
+    if (input_state.pending_reads == 0) {
+      release_buffer(input_state);
+    }
+  }
+}
+
+void FullFrameExecutionModel::release_buffer(OperationState &state)
+{
+  if (state.buffer == nullptr) {
+    return;
+  }
+  if (state.cached) {
+    MemoryBufferCache::release(state.key);
+    state.cached = false;
+  }
+  else {
+    delete state.buffer;
+  }
+  state.buffer = nullptr;
+  state.reader->setMemoryBuffer(nullptr, false);
+}
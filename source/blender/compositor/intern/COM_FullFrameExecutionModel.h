@@ -0,0 +1,108 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "COM_CompositorContext.h"
+
+using std::vector;
+
+class MemoryBuffer;
+class NodeOperation;
+class NodeOperationInput;
+class NodeOperationOutput;
+class ReadBufferOperation;
+
+/**
+ * \brief Executes the operations one after the other, each one on its whole output at once.
+ *
+ * Instead of pulling pixels through the operations per tile, every operation writes its output
+ * to a MemoryBuffer of its full resolution, which is read by the operations using its output.
+ * Operations implementing NodeOperation.executeArea fill the buffer directly from the buffers of
+ * their inputs, other operations are read per pixel into the buffer.
+ *
+ * Buffers are freed as soon as all operations reading them are executed.
+ * Viewer and render borders are not used, the full resolution is always calculated.
+ *
+ * When the node tree has a cache limit, buffers are kept in the MemoryBufferCache and operations
+ * whose buffer is in the cache are not executed, nor are the operations only they read.
+ *
+ * \see CompositorContext.isFullFrameExecution
+ */
+class FullFrameExecutionModel {
+ private:
+  struct OperationState {
+    /** Reads #buffer for all operations using the output of the operation. */
+    ReadBufferOperation *reader;
+    MemoryBuffer *buffer;
+    /** Operations linked to the inputs, in the order of the input sockets. */
+    vector<NodeOperation *> input_operations;
+    /** Number of operation inputs that still have to read #buffer. */
+    int pending_reads;
+    /** Cache key of the buffer, zero when it can't be cached. */
+    uint64_t key;
+    /** #buffer is owned by the MemoryBufferCache. */
+    bool cached;
+    /** The buffer is read by an operation that is executed, or the operation is an output. */
+    bool needed;
+    bool scheduled;
+    bool initialized;
+  };
+
+  const CompositorContext &m_context;
+  const vector<NodeOperation *> &m_operations;
+  std::map<NodeOperation *, OperationState> m_states;
+
+  /** Operations in execution order, every operation comes after the operations it reads. */
+  vector<NodeOperation *> m_order;
+
+  /** Links replaced by links to the readers, restored after execution. */
+  vector<std::pair<NodeOperationInput *, NodeOperationOutput *>> m_replaced_links;
+
+ public:
+  FullFrameExecutionModel(const CompositorContext &context,
+                          const vector<NodeOperation *> &operations);
+  ~FullFrameExecutionModel();
+
+  void execute();
+
+ private:
+  void schedule(NodeOperation *operation);
+  void link_readers();
+  void unlink_readers();
+
+  void determine_keys();
+  void determine_needed_operations(bool use_cache);
+  void cache_buffer(NodeOperation *operation);
+  void release_buffer(OperationState &state);
+
+  void execute_operation(NodeOperation *operation);
+  void execute_buffer_operation(NodeOperation *operation);
+  void execute_region_operation(NodeOperation *operation);
+  void release_inputs(NodeOperation *operation);
+
+  void init_operation(NodeOperation *operation);
+  void deinit_operation(NodeOperation *operation);
+
+#ifdef WITH_CXX_GUARDEDALLOC
+  MEM_CXX_CLASS_ALLOC_FUNCS("COM:FullFrameExecutionModel")
+#endif
+};
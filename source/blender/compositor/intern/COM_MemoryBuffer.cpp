@@ -18,7 +18,7 @@
 
 #include "COM_MemoryBuffer.h"
 
-#include "MEM_guardedalloc.h"
+#include "COM_BufferStore.h"
 
 using std::max;
 using std::min;
@@ -50,7 +50,11 @@ int MemoryBuffer::getHeight() const
   return this->m_height;
 }
 
-MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, rcti *rect)
+MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy,
+                           unsigned int chunkNumber,
+                           rcti *rect,
+                           size_t memory_limit,
+                           const char *directory)
 {
   BLI_rcti_init(&this->m_rect, rect->xmin, rect->xmax, rect->ymin, rect->ymax);
   this->m_width = BLI_rcti_size_x(&this->m_rect);
@@ -58,8 +62,11 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, r
   this->m_memoryProxy = memoryProxy;
   this->m_chunkNumber = chunkNumber;
   this->m_num_channels = determine_num_channels(memoryProxy->getDataType());
-  this->m_buffer = (float *)MEM_mallocN_aligned(
-      sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+  this->m_buffer = BufferStore::allocate(sizeof(float) * determineBufferSize() *
+                                             this->m_num_channels,
+                                         memory_limit,
+                                         directory,
+                                         &this->m_mapped);
   this->m_state = COM_MB_ALLOCATED;
   this->m_datatype = memoryProxy->getDataType();
 }
@@ -72,8 +79,8 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
   this->m_memoryProxy = memoryProxy;
   this->m_chunkNumber = -1;
   this->m_num_channels = determine_num_channels(memoryProxy->getDataType());
-  this->m_buffer = (float *)MEM_mallocN_aligned(
-      sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+  this->m_buffer = BufferStore::allocate(
+      sizeof(float) * determineBufferSize() * this->m_num_channels, 0, nullptr, &this->m_mapped);
   this->m_state = COM_MB_TEMPORARILY;
   this->m_datatype = memoryProxy->getDataType();
 }
@@ -86,8 +93,8 @@ MemoryBuffer::MemoryBuffer(DataType dataType, rcti *rect)
   this->m_memoryProxy = nullptr;
   this->m_chunkNumber = -1;
   this->m_num_channels = determine_num_channels(dataType);
-  this->m_buffer = (float *)MEM_mallocN_aligned(
-      sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+  this->m_buffer = BufferStore::allocate(
+      sizeof(float) * determineBufferSize() * this->m_num_channels, 0, nullptr, &this->m_mapped);
   this->m_state = COM_MB_TEMPORARILY;
   this->m_datatype = dataType;
 }
@@ -104,6 +111,17 @@ void MemoryBuffer::clear()
   memset(this->m_buffer, 0, this->determineBufferSize() * this->m_num_channels * sizeof(float));
 }
 
+void MemoryBuffer::fill(const rcti *area, const float *value)
+{
+  for (int y = area->ymin; y < area->ymax; y++) {
+    float *pixel = getElem(area->xmin, y);
+    for (int x = area->xmin; x < area->xmax; x++) {
+      memcpy(pixel, value, sizeof(float) * this->m_num_channels);
+      pixel += this->m_num_channels;
+    }
+  }
+}
+
 float MemoryBuffer::getMaximumValue()
 {
   float result = this->m_buffer[0];
@@ -144,7 +162,9 @@ float MemoryBuffer::getMaximumValue(rcti *rect)
 MemoryBuffer::~MemoryBuffer()
 {
   if (this->m_buffer) {
-    MEM_freeN(this->m_buffer);
+    BufferStore::free(this->m_buffer,
+                      sizeof(float) * determineBufferSize() * this->m_num_channels,
+                      this->m_mapped);
     this->m_buffer = nullptr;
   }
 }
@@ -175,6 +195,19 @@ void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
   }
 }
 
+const float *MemoryBuffer::getRow(int y, int x_start, int x_end, float *r_temp)
+{
+  if (y >= m_rect.ymin && y < m_rect.ymax && x_start >= m_rect.xmin && x_end <= m_rect.xmax) {
+    return getElem(x_start, y);
+  }
+  float *pixel = r_temp;
+  for (int x = x_start; x < x_end; x++) {
+    read(pixel, x, y);
+    pixel += this->m_num_channels;
+  }
+  return r_temp;
+}
+
 void MemoryBuffer::writePixel(int x, int y, const float color[4])
 {
   if (x >= this->m_rect.xmin && x < this->m_rect.xmax && y >= this->m_rect.ymin &&
@@ -85,6 +85,12 @@ class MemoryBuffer {
    */
   float *m_buffer;
 
+  /**
+   * \brief the buffer is a temporary file mapped in memory
+   * \see BufferStore
+   */
+  bool m_mapped;
+
   /**
    * \brief the number of channels of a single value in the buffer.
    * For value buffers this is 1, vector 3 and color 4
@@ -97,8 +103,14 @@ class MemoryBuffer {
  public:
   /**
    * \brief construct new MemoryBuffer for a chunk
+   * \param memory_limit: keep the buffer on disk when the buffers in memory would exceed this
+   * \param directory: where buffers are kept on disk, see #BufferStore::allocate
    */
-  MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, rcti *rect);
+  MemoryBuffer(MemoryProxy *memoryProxy,
+               unsigned int chunkNumber,
+               rcti *rect,
+               size_t memory_limit,
+               const char *directory);
 
   /**
    * \brief construct new temporarily MemoryBuffer for an area
@@ -244,7 +256,7 @@ class MemoryBuffer {
       int u = x;
       int v = y;
       this->wrap_pixel(u, v, extend_x, extend_y);
-      const int offset = (this->m_width * y + x) * this->m_num_channels;
+      const int offset = (this->m_width * v + u) * this->m_num_channels;
       float *buffer = &this->m_buffer[offset];
       memcpy(result, buffer, sizeof(float) * this->m_num_channels);
     }
@@ -275,6 +287,24 @@ class MemoryBuffer {
     memcpy(result, buffer, sizeof(float) * this->m_num_channels);
   }
 
+  /**
+   * \brief get the pixel at \a x, \a y, which must be inside the rect of this MemoryBuffer
+   */
+  inline float *getElem(int x, int y)
+  {
+    BLI_assert(x >= m_rect.xmin && x < m_rect.xmax && y >= m_rect.ymin && y < m_rect.ymax);
+    return &this->m_buffer[(this->m_width * (y - m_rect.ymin) + (x - m_rect.xmin)) *
+                           this->m_num_channels];
+  }
+
+  /**
+   * \brief get the pixels from \a x_start up to \a x_end of row \a y
+   *
+   * Points into this MemoryBuffer when the pixels are inside its rect. Otherwise they are read
+   * into \a r_temp (pixels outside the rect are zero), which must have room for all pixels.
+   */
+  const float *getRow(int y, int x_start, int x_end, float *r_temp);
+
   void writePixel(int x, int y, const float color[4]);
   void addPixel(int x, int y, const float color[4]);
   inline void readBilinear(float *result,
@@ -344,6 +374,11 @@ class MemoryBuffer {
    */
   void clear();
 
+  /**
+   * \brief set all pixels in \a area to \a value, which has the number of channels of the buffer
+   */
+  void fill(const rcti *area, const float *value);
+
   MemoryBuffer *duplicate();
 
   float getMaximumValue();
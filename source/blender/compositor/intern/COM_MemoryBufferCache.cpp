@@ -0,0 +1,131 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#include <unordered_map>
+
+#include "BLI_assert.h"
+#include "BLI_hash_mm2a.h"
+
+#include "COM_MemoryBuffer.h"
+#include "COM_MemoryBufferCache.h"
+
+struct CachedBuffer {
+  MemoryBuffer *buffer;
+  size_t size;
+  /** Number of executions using the buffer, it's not freed while used. */
+  int users;
+  /** Value of #g_use_counter when last acquired. */
+  uint64_t last_used;
+};
+
+typedef std::unordered_map<uint64_t, CachedBuffer> CachedBuffers;
+
+static CachedBuffers g_buffers;
+static size_t g_size = 0;
+static size_t g_limit = 0;
+static uint64_t g_use_counter = 0;
+
+static size_t buffer_size(MemoryBuffer *buffer)
+{
+  return sizeof(float) * buffer->getWidth() * buffer->getHeight() * buffer->get_num_channels();
+}
+
+/**
+ * Free least recently used buffers until \a size more bytes fit in the limit.
+ * \return false when that isn't possible because of buffers in use.
+ */
+static bool free_unused(size_t size)
+{
+  while (g_size + size > g_limit) {
+    CachedBuffers::iterator oldest = g_buffers.end();
+    for (CachedBuffers::iterator it = g_buffers.begin(); it != g_buffers.end(); ++it) {
+      if (it->second.users == 0 &&
+          (oldest == g_buffers.end() || it->second.last_used < oldest->second.last_used)) {
+        oldest = it;
+      }
+    }
+    if (oldest == g_buffers.end()) {
+      return false;
+    }
+    g_size -= oldest->second.size;
+    delete oldest->second.buffer;
+    g_buffers.erase(oldest);
+  }
+  return true;
+}
+
+uint64_t MemoryBufferCache::hash(const void *data, size_t len, uint64_t seed)
+{
+  /* Two 32 bit hashes, collisions would show wrong results. */
+  const uint32_t low = BLI_hash_mm2((const unsigned char *)data, len, (uint32_t)seed);
+  const uint32_t high = BLI_hash_mm2(
+      (const unsigned char *)data, len, (uint32_t)(seed >> 32) ^ 0x9e3779b9u);
+  return ((uint64_t)high << 32) | low;
+}
+
+MemoryBuffer *MemoryBufferCache::acquire(uint64_t key)
+{
+  CachedBuffers::iterator it = g_buffers.find(key);
+  if (it == g_buffers.end()) {
+    return nullptr;
+  }
+  it->second.users++;
+  it->second.last_used = ++g_use_counter;
+  return it->second.buffer;
+}
+
+bool MemoryBufferCache::add(uint64_t key, MemoryBuffer *buffer)
+{
+  BLI_assert(g_buffers.find(key) == g_buffers.end());
+  const size_t size = buffer_size(buffer);
+  if (size > g_limit || !free_unused(size)) {
+    return false;
+  }
+  CachedBuffer cached_buffer = {buffer, size, 1, ++g_use_counter};
+  g_buffers[key] = cached_buffer;
+  g_size += size;
+  return true;
+}
+
+void MemoryBufferCache::release(uint64_t key)
+{
+  CachedBuffers::iterator it = g_buffers.find(key);
+  BLI_assert(it != g_buffers.end() && it->second.users > 0);
+  it->second.users--;
+}
+
+void MemoryBufferCache::setLimit(size_t limit)
+{
+  g_limit = limit;
+  free_unused(0);
+}
+
+bool MemoryBufferCache::isEnabled()
+{
+  return g_limit > 0;
+}
+
+void MemoryBufferCache::clear()
+{
+  for (CachedBuffers::iterator it = g_buffers.begin(); it != g_buffers.end(); ++it) {
+    BLI_assert(it->second.users == 0);
+    delete it->second.buffer;
+  }
+  g_buffers.clear();
+  g_size = 0;
+}
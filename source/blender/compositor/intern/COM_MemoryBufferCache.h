@@ -0,0 +1,78 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class MemoryBuffer;
+
+/**
+ * \brief Keeps the output buffers of operations between executions of the compositor.
+ *
+ * Buffers are identified by a key hashing everything that determines the output of the
+ * operation: its settings, resolution and the keys of its inputs. An operation with a cached
+ * buffer doesn't need to be executed, and neither do the operations only it reads.
+ *
+ * There is one cache for all node trees, least recently used buffers are freed to stay within
+ * the compositor cache limit of the user preferences. Buffers in use by an execution are never freed, they are acquired and released again.
+ * Only accessed while the compositor mutex is locked, so there is no locking of its own.
+ *
+ * \see FullFrameExecutionModel
+ */
+class MemoryBufferCache {
+ public:
+  /**
+   * \brief hash \a len bytes of \a data, combined with \a seed
+   */
+  static uint64_t hash(const void *data, size_t len, uint64_t seed);
+
+  /**
+   * \brief get the cached buffer of \a key, which can't be freed until it's released
+   * \return nullptr when there is no such buffer
+   */
+  static MemoryBuffer *acquire(uint64_t key);
+
+  /**
+   * \brief add \a buffer to the cache, which takes ownership and acquires it for the caller
+   * \return false when the buffer doesn't fit in the limit, the caller keeps ownership then
+   */
+  static bool add(uint64_t key, MemoryBuffer *buffer);
+
+  /**
+   * \brief release a buffer returned by #acquire or added by #add
+   */
+  static void release(uint64_t key);
+
+  /**
+   * \brief set the memory limit, freeing least recently used buffers not fitting anymore
+   * \param limit: limit in bytes, 0 frees all buffers not in use
+   */
+  static void setLimit(size_t limit);
+
+  /**
+   * \brief whether the limit allows caching buffers
+   */
+  static bool isEnabled();
+
+  /**
+   * \brief free all cached buffers, none may be in use
+   */
+  static void clear();
+};
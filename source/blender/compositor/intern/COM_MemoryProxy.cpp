@@ -25,7 +25,10 @@ MemoryProxy::MemoryProxy(DataType datatype)
   this->m_datatype = datatype;
 }
 
-void MemoryProxy::allocate(unsigned int width, unsigned int height)
+void MemoryProxy::allocate(unsigned int width,
+                           unsigned int height,
+                           size_t memory_limit,
+                           const char *directory)
 {
   rcti result;
   result.xmin = 0;
@@ -33,7 +36,7 @@ void MemoryProxy::allocate(unsigned int width, unsigned int height)
   result.ymin = 0;
   result.ymax = height;
 
-  this->m_buffer = new MemoryBuffer(this, 1, &result);
+  this->m_buffer = new MemoryBuffer(this, 1, &result, memory_limit, directory);
 }
 
 void MemoryProxy::free()
@@ -104,8 +104,13 @@ class MemoryProxy {
 
   /**
    * \brief allocate memory of size width x height
+   * \param memory_limit: keep the buffer on disk when the buffers in memory would exceed this
+   * \param directory: where buffers are kept on disk, see #BufferStore::allocate
    */
-  void allocate(unsigned int width, unsigned int height);
+  void allocate(unsigned int width,
+                unsigned int height,
+                size_t memory_limit,
+                const char *directory);
 
   /**
    * \brief free the allocated memory
@@ -102,6 +102,24 @@ class NodeOperation : public SocketReader {
    */
   bool m_openCL;
 
+  /**
+   * \brief can this operation render whole areas at once in full-frame execution.
+   * \see executeArea
+   */
+  bool m_fullFrame;
+
+  /**
+   * \brief hash of the settings determining the output, besides the inputs and the resolution.
+   * Zero when the output depends on other data, like images or the frame.
+   * \see MemoryBufferCache
+   */
+  uint64_t m_settingsHash;
+
+  /**
+   * \brief name of the node that added this operation, for profiling.
+   */
+  std::string m_nodeName;
+
   /**
    * \brief mutex reference for very special node initializations
    * \note only use when you really know what you are doing.
@@ -187,6 +205,10 @@ class NodeOperation : public SocketReader {
   {
     this->m_btree = tree;
   }
+  const bNodeTree *getbNodeTree() const
+  {
+    return this->m_btree;
+  }
   virtual void initExecution();
 
   /**
@@ -200,6 +222,20 @@ class NodeOperation : public SocketReader {
   {
   }
 
+  /**
+   * \brief when an area is executed in full-frame execution, this method is called
+   * \ingroup execution
+   * \note only called when #isFullFrameOperation is true, other operations are read per pixel.
+   * Called from multiple threads at once for different parts of the output, unless the operation
+   * is single threaded.
+   * \param output: buffer of this operation covering at least the area
+   * \param area: the part of the output to calculate
+   * \param inputs: buffers of the input operations, in the order of the input sockets
+   */
+  virtual void executeArea(MemoryBuffer * /*output*/, rcti * /*area*/, MemoryBuffer ** /*inputs*/)
+  {
+  }
+
   /**
    * \brief when a chunk is executed by an OpenCLDevice, this method is called
    * \ingroup execution
@@ -281,6 +317,32 @@ class NodeOperation : public SocketReader {
     return false;
   }
 
+  void setSettingsHash(uint64_t settingsHash)
+  {
+    this->m_settingsHash = settingsHash;
+  }
+  uint64_t getSettingsHash() const
+  {
+    return this->m_settingsHash;
+  }
+
+  void setNodeName(const std::string &nodeName)
+  {
+    this->m_nodeName = nodeName;
+  }
+  const std::string &getNodeName() const
+  {
+    return this->m_nodeName;
+  }
+
+  /**
+   * \brief does this operation implement #executeArea for full-frame execution
+   */
+  bool isFullFrameOperation() const
+  {
+    return this->m_fullFrame;
+  }
+
   /**
    * \brief is this operation of type ReadBufferOperation
    * \return [true:false]
@@ -420,6 +482,14 @@ class NodeOperation : public SocketReader {
     this->m_openCL = openCL;
   }
 
+  /**
+   * \brief set if this NodeOperation implements #executeArea
+   */
+  void setFullFrameOperation(bool fullFrame)
+  {
+    this->m_fullFrame = fullFrame;
+  }
+
   /* allow the DebugInfo class to look at internals */
   friend class DebugInfo;
 
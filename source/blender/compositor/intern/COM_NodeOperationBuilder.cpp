@@ -16,11 +16,24 @@
  * Copyright 2013, Blender Foundation.
  */
 
+#include <cstring>
+#include <typeinfo>
+
+#include "BLI_listbase.h"
 #include "BLI_utildefines.h"
 
+#include "DNA_color_types.h"
+#include "DNA_genfile.h"
+#include "DNA_sdna_types.h"
+
+#include "BKE_node.h"
+
+#include "MEM_guardedalloc.h"
+
 #include "COM_Converter.h"
 #include "COM_Debug.h"
 #include "COM_ExecutionSystem.h"
+#include "COM_MemoryBufferCache.h"
 #include "COM_Node.h"
 #include "COM_NodeConverter.h"
 #include "COM_SocketProxyNode.h"
@@ -37,8 +50,137 @@
 
 #include "COM_NodeOperationBuilder.h" /* own include */
 
+/**
+ * Hash the members of DNA struct \a struct_nr at \a data, except for padding and pointers.
+ */
+static uint64_t dna_struct_members_hash(const SDNA *sdna,
+                                        const int struct_nr,
+                                        const char *data,
+                                        uint64_t hash)
+{
+  const SDNA_Struct *struct_info = sdna->structs[struct_nr];
+  for (int i = 0; i < struct_info->members_len; i++) {
+    const SDNA_StructMember *member = &struct_info->members[i];
+    const char *name = sdna->names[member->name];
+    const int size = DNA_elem_size_nr(sdna, member->type, member->name);
+
+    if (name[0] == '*' || name[0] == '(' || STRPREFIX(name, "_pad")) {
+      /* pass */
+    }
+    else {
+      const int member_struct_nr = DNA_struct_find_nr(sdna, sdna->types[member->type]);
+      if (member_struct_nr == -1) {
+        hash = MemoryBufferCache::hash(data, size, hash);
+      }
+      else {
+        const int array_len = sdna->names_array_len[member->name];
+        const int element_size = size / array_len;
+        for (int j = 0; j < array_len; j++) {
+          hash = dna_struct_members_hash(sdna, member_struct_nr, data + j * element_size, hash);
+        }
+      }
+    }
+    data += size;
+  }
+  return hash;
+}
+
+/**
+ * Combine \a r_hash with the hash of \a data, a DNA struct named \a struct_name.
+ * \return false when there is no such struct.
+ */
+static bool dna_struct_hash(const char *struct_name, const void *data, uint64_t *r_hash)
+{
+  const SDNA *sdna = DNA_sdna_current_get();
+  const int struct_nr = DNA_struct_find_nr(sdna, struct_name);
+  if (struct_nr == -1) {
+    return false;
+  }
+  *r_hash = dna_struct_members_hash(sdna, struct_nr, (const char *)data, *r_hash);
+  return true;
+}
+
+static const char *socket_default_value_struct_name(const bNodeSocket *sock)
+{
+  switch (sock->type) {
+    case SOCK_FLOAT:
+      return "bNodeSocketValueFloat";
+    case SOCK_VECTOR:
+      return "bNodeSocketValueVector";
+    case SOCK_RGBA:
+      return "bNodeSocketValueRGBA";
+    case SOCK_BOOLEAN:
+      return "bNodeSocketValueBoolean";
+    case SOCK_INT:
+      return "bNodeSocketValueInt";
+    case SOCK_STRING:
+      return "bNodeSocketValueString";
+  }
+  return nullptr;
+}
+
+/**
+ * Hash the settings of \a node, which determine the settings of its operations.
+ * \return zero when its operations depend on data outside the node, like images or the scene.
+ */
+static uint64_t node_settings_hash(const bNode *node)
+{
+  /* Defocus reads the scene camera, time the scene frame. */
+  if (node == nullptr || node->id != nullptr ||
+      ELEM(node->type, CMP_NODE_DEFOCUS, CMP_NODE_TIME)) {
+    return 0;
+  }
+
+  uint64_t hash = MemoryBufferCache::hash(&node->type, sizeof(node->type), 0);
+  hash = MemoryBufferCache::hash(&node->custom1, sizeof(node->custom1), hash);
+  hash = MemoryBufferCache::hash(&node->custom2, sizeof(node->custom2), hash);
+  hash = MemoryBufferCache::hash(&node->custom3, sizeof(node->custom3), hash);
+  hash = MemoryBufferCache::hash(&node->custom4, sizeof(node->custom4), hash);
+
+  /* Pointers are different for every copy of the node tree, hash the data they point to. */
+  if (node->storage != nullptr) {
+    const char *storagename = node->typeinfo->storagename;
+    if (!dna_struct_hash(storagename, node->storage, &hash)) {
+      return 0;
+    }
+    if (STREQ(storagename, "CurveMapping")) {
+      const CurveMapping *cumap = (const CurveMapping *)node->storage;
+      for (int i = 0; i < CM_TOT; i++) {
+        const CurveMap *cuma = &cumap->cm[i];
+        if (cuma->curve) {
+          hash = MemoryBufferCache::hash(cuma->curve, sizeof(*cuma->curve) * cuma->totpoint, hash);
+        }
+      }
+    }
+    else if (STREQ(storagename, "NodeCryptomatte")) {
+      const NodeCryptomatte *crypto = (const NodeCryptomatte *)node->storage;
+      if (crypto->matte_id) {
+        hash = MemoryBufferCache::hash(crypto->matte_id, strlen(crypto->matte_id), hash);
+      }
+    }
+  }
+
+  LISTBASE_FOREACH (const bNodeSocket *, sock, &node->inputs) {
+    if (sock->default_value == nullptr) {
+      continue;
+    }
+    const char *default_value_name = socket_default_value_struct_name(sock);
+    if (default_value_name == nullptr ||
+        !dna_struct_hash(default_value_name, sock->default_value, &hash)) {
+      return 0;
+    }
+  }
+
+  /* Zero is reserved for unknown settings. */
+  return hash ? hash : 1;
+}
+
 NodeOperationBuilder::NodeOperationBuilder(const CompositorContext *context, bNodeTree *b_nodetree)
-    : m_context(context), m_current_node(nullptr), m_active_viewer(nullptr)
+    : m_context(context),
+      m_current_node(nullptr),
+      m_current_node_hash(0),
+      m_current_node_operations(0),
+      m_active_viewer(nullptr)
 {
   m_graph.from_bNodeTree(*context, b_nodetree);
 }
@@ -56,6 +198,8 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
     Node *node = (Node *)m_graph.nodes()[index];
 
     m_current_node = node;
+    m_current_node_hash = node_settings_hash(node->getbNode());
+    m_current_node_operations = 0;
 
     DebugInfo::node_to_operations(node);
     node->convertToOperations(converter, *m_context);
@@ -104,8 +248,11 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 
   determineResolutions();
 
-  /* surround complex ops with read/write buffer */
-  add_complex_operation_buffers();
+  /* surround complex ops with read/write buffer,
+   * full-frame execution stores the output of every operation in a buffer already */
+  if (!m_context->isFullFrameExecution()) {
+    add_complex_operation_buffers();
+  }
 
   /* links not available from here on */
   /* XXX make m_links a local variable to avoid confusion! */
@@ -117,7 +264,9 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
   /*sort_operations();*/ /* not needed yet */
 
   /* create execution groups */
-  group_operations();
+  if (!m_context->isFullFrameExecution()) {
+    group_operations();
+  }
 
   /* transfer resulting operations to the system */
   system->set_operations(m_operations, m_groups);
@@ -126,6 +275,26 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 void NodeOperationBuilder::addOperation(NodeOperation *operation)
 {
   m_operations.push_back(operation);
+  if (m_current_node && m_current_node->getbNode()) {
+    operation->setNodeName(m_current_node->getbNode()->name);
+  }
+
+  /* Operations added by nodes are identified by their order, operations added here only depend
+   * on their inputs and resolution. */
+  uint64_t settings_hash = 1;
+  if (m_current_node) {
+    settings_hash = m_current_node_hash;
+    if (settings_hash != 0) {
+      settings_hash = MemoryBufferCache::hash(
+          &m_current_node_operations, sizeof(m_current_node_operations), settings_hash);
+    }
+    m_current_node_operations++;
+  }
+  if (settings_hash != 0) {
+    const char *type_name = typeid(*operation).name();
+    settings_hash = MemoryBufferCache::hash(type_name, strlen(type_name), settings_hash);
+    operation->setSettingsHash(settings_hash);
+  }
 }
 
 void NodeOperationBuilder::mapInputSocket(NodeInput *node_socket,
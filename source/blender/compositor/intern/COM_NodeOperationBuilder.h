@@ -88,6 +88,9 @@ class NodeOperationBuilder {
   OutputSocketMap m_output_map;
 
   Node *m_current_node;
+  /** Settings hash of the current node and the number of operations it added so far. */
+  uint64_t m_current_node_hash;
+  int m_current_node_operations;
 
   /** Operation that will be writing to the viewer image
    *  Only one operation can occupy this place at a time,
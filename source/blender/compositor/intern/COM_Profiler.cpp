@@ -0,0 +1,444 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "BLI_fileops.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_appdir.h"
+#include "BKE_global.h"
+
+#include "PIL_time.h"
+
+#include "COM_ExecutionGroup.h"
+#include "COM_NodeOperation.h"
+#include "COM_Profiler.h"
+
+enum ProfileEventType {
+  PROFILE_EVENT_GROUP,
+  PROFILE_EVENT_CHUNK,
+  PROFILE_EVENT_OPERATION,
+  PROFILE_EVENT_AREA,
+  PROFILE_EVENT_MEMORY,
+};
+
+struct ProfileEvent {
+  ProfileEventType type;
+  /** The ExecutionGroup or NodeOperation, none for memory events. */
+  const void *owner;
+  /** Index of the thread doing the work, -1 for the thread running the execution. */
+  int thread;
+  double start_time;
+  double end_time;
+  unsigned int chunk_number;
+  bool cached;
+  /** Bytes allocated by memory events, negative when freed. */
+  int64_t memory;
+};
+
+/** Events recorded by one thread, so recording needs no locking. */
+struct ThreadEvents {
+  std::vector<ProfileEvent> events;
+};
+
+/** Totals of a group or operation for the summary. */
+struct ProfileTotal {
+  std::string name;
+  double wall_time;
+  double busy_time;
+  int calls;
+  int chunks;
+  int recomputed_chunks;
+  bool cached;
+};
+
+bool Profiler::m_enabled = false;
+
+/** Only locked when a thread records its first event of an execution. */
+static ThreadMutex g_mutex = BLI_MUTEX_INITIALIZER;
+static std::vector<std::unique_ptr<ThreadEvents>> g_thread_events;
+/** Events of all threads sorted by time, when the execution finished. */
+static std::vector<ProfileEvent> g_events;
+/** Incremented for every execution, invalidates the #t_events of all threads. */
+static int g_execution_index = 0;
+static std::map<const ExecutionGroup *, double> g_group_start_times;
+static double g_start_time = 0.0;
+static int g_num_threads = 1;
+/** Highest thread index in the events, can be above the number of threads for GPU devices. */
+static int g_max_thread = 0;
+static int g_file_index = 0;
+
+/** Peak of the memory of buffers allocated during the execution. */
+static int64_t g_peak_memory = 0;
+
+static thread_local ThreadEvents *t_events = nullptr;
+static thread_local int t_execution_index = -1;
+
+static void add_event(const ProfileEvent &event)
+{
+  if (t_events == nullptr || t_execution_index != g_execution_index) {
+    BLI_mutex_lock(&g_mutex);
+    g_thread_events.push_back(std::unique_ptr<ThreadEvents>(new ThreadEvents()));
+    t_events = g_thread_events.back().get();
+    t_execution_index = g_execution_index;
+    BLI_mutex_unlock(&g_mutex);
+  }
+  t_events->events.push_back(event);
+}
+
+static bool event_compare(const ProfileEvent &a, const ProfileEvent &b)
+{
+  return a.start_time < b.start_time;
+}
+
+/**
+ * Gather the events of all threads in #g_events, turning the memory changes into the total
+ * memory of buffers allocated during the execution.
+ */
+static void merge_thread_events()
+{
+  g_events.clear();
+  for (size_t index = 0; index < g_thread_events.size(); index++) {
+    const std::vector<ProfileEvent> &events = g_thread_events[index]->events;
+    g_events.insert(g_events.end(), events.begin(), events.end());
+  }
+  g_thread_events.clear();
+  std::stable_sort(g_events.begin(), g_events.end(), event_compare);
+
+  int64_t live_memory = 0;
+  g_peak_memory = 0;
+  for (size_t index = 0; index < g_events.size(); index++) {
+    ProfileEvent &event = g_events[index];
+    g_max_thread = std::max(g_max_thread, event.thread);
+    if (event.type == PROFILE_EVENT_MEMORY) {
+      live_memory += event.memory;
+      g_peak_memory = std::max(g_peak_memory, live_memory);
+      event.memory = live_memory;
+    }
+  }
+}
+
+static std::string operation_name(const NodeOperation *operation)
+{
+  /* Strip the length prefix of mangled names, or the keyword of MSVC names. */
+  std::string name = typeid(*operation).name();
+  if (name.compare(0, 6, "class ") == 0) {
+    name = name.substr(6);
+  }
+  else {
+    name = name.substr(std::min(name.find_first_not_of("0123456789"), name.size()));
+  }
+  if (!operation->getNodeName().empty()) {
+    name = operation->getNodeName() + " | " + name;
+  }
+  return name;
+}
+
+static std::string event_name(const ProfileEvent &event)
+{
+  switch (event.type) {
+    case PROFILE_EVENT_GROUP:
+    case PROFILE_EVENT_CHUNK: {
+      const ExecutionGroup *group = (const ExecutionGroup *)event.owner;
+      return "Group: " + operation_name(((ExecutionGroup *)group)->getOutputOperation());
+    }
+    case PROFILE_EVENT_OPERATION:
+    case PROFILE_EVENT_AREA:
+      return operation_name((const NodeOperation *)event.owner);
+    case PROFILE_EVENT_MEMORY:
+      break;
+  }
+  return "Buffer Memory";
+}
+
+static std::string json_escape(const std::string &str)
+{
+  std::string result;
+  for (size_t i = 0; i < str.size(); i++) {
+    const unsigned char c = str[i];
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    }
+    else if (c < 0x20) {
+      char buf[8];
+      BLI_snprintf(buf, sizeof(buf), "\\u%04x", c);
+      result += buf;
+    }
+    else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+/** Chrome trace timestamps are in microseconds. */
+static double trace_time(double time)
+{
+  return (time - g_start_time) * 1e6;
+}
+
+static void write_trace(FILE *fp)
+{
+  fprintf(fp, "{\"traceEvents\": [\n");
+  fprintf(fp,
+          "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, "
+          "\"args\": {\"name\": \"Execution\"}}");
+  for (int thread = 0; thread <= g_max_thread; thread++) {
+    fprintf(fp,
+            ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+            "\"args\": {\"name\": \"Thread %d\"}}",
+            thread + 1,
+            thread + 1);
+  }
+
+  for (size_t index = 0; index < g_events.size(); index++) {
+    const ProfileEvent &event = g_events[index];
+    if (event.type == PROFILE_EVENT_MEMORY) {
+      fprintf(fp,
+              ",\n{\"name\": \"Buffer Memory\", \"ph\": \"C\", \"pid\": 1, \"ts\": %.3f, "
+              "\"args\": {\"MB\": %.3f}}",
+              trace_time(event.start_time),
+              (double)event.memory / (1024.0 * 1024.0));
+      continue;
+    }
+
+    const char *category = (event.type == PROFILE_EVENT_GROUP) ? "group" :
+                           (event.type == PROFILE_EVENT_CHUNK) ? "chunk" :
+                           (event.type == PROFILE_EVENT_OPERATION) ? "operation" :
+                                                                     "area";
+    fprintf(fp,
+            ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+            "\"ts\": %.3f, \"dur\": %.3f",
+            json_escape(event_name(event)).c_str(),
+            category,
+            event.thread + 1,
+            trace_time(event.start_time),
+            (event.end_time - event.start_time) * 1e6);
+    if (event.type == PROFILE_EVENT_CHUNK) {
+      fprintf(fp, ", \"args\": {\"chunk\": %u}", event.chunk_number);
+    }
+    else if (event.type == PROFILE_EVENT_OPERATION) {
+      fprintf(fp, ", \"args\": {\"cached\": %s}", event.cached ? "true" : "false");
+    }
+    fprintf(fp, "}");
+  }
+  fprintf(fp, "\n]}\n");
+}
+
+static bool total_compare(const ProfileTotal &a, const ProfileTotal &b)
+{
+  return a.wall_time > b.wall_time;
+}
+
+static void print_summary(double end_time)
+{
+  std::map<const void *, ProfileTotal> totals;
+  std::map<std::pair<const void *, unsigned int>, int> chunk_counts;
+  double busy_time = 0.0;
+
+  for (size_t index = 0; index < g_events.size(); index++) {
+    const ProfileEvent &event = g_events[index];
+    if (event.type == PROFILE_EVENT_MEMORY) {
+      continue;
+    }
+    ProfileTotal &total = totals[event.owner];
+    const double duration = event.end_time - event.start_time;
+    switch (event.type) {
+      case PROFILE_EVENT_GROUP:
+      case PROFILE_EVENT_OPERATION:
+        total.wall_time += duration;
+        total.calls++;
+        total.cached |= event.cached;
+        break;
+      case PROFILE_EVENT_CHUNK:
+        if (chunk_counts[std::make_pair(event.owner, event.chunk_number)]++ > 0) {
+          total.recomputed_chunks++;
+        }
+        ATTR_FALLTHROUGH;
+      case PROFILE_EVENT_AREA:
+        total.busy_time += duration;
+        total.chunks++;
+        busy_time += duration;
+        break;
+      case PROFILE_EVENT_MEMORY:
+        break;
+    }
+    if (total.name.empty()) {
+      total.name = event_name(event);
+    }
+  }
+
+  std::vector<ProfileTotal> sorted;
+  for (std::map<const void *, ProfileTotal>::iterator it = totals.begin(); it != totals.end();
+       ++it) {
+    sorted.push_back(it->second);
+  }
+  std::sort(sorted.begin(), sorted.end(), total_compare);
+
+  const double wall_time = end_time - g_start_time;
+  const double utilization = (wall_time > 0.0) ? busy_time / (wall_time * g_num_threads) : 0.0;
+  printf("Compositor profile: %.3f s, %d threads, %.1f%% utilization, %.2f MB peak buffers\n",
+         wall_time,
+         g_num_threads,
+         utilization * 100.0,
+         (double)g_peak_memory / (1024.0 * 1024.0));
+  printf("  %10s %10s %6s %7s %10s  %s\n",
+         "Wall (ms)",
+         "Busy (ms)",
+         "Calls",
+         "Chunks",
+         "Recomputed",
+         "Name");
+  for (size_t index = 0; index < sorted.size(); index++) {
+    const ProfileTotal &total = sorted[index];
+    printf("  %10.3f %10.3f %6d %7d %10d  %s%s\n",
+           total.wall_time * 1e3,
+           total.busy_time * 1e3,
+           total.calls,
+           total.chunks,
+           total.recomputed_chunks,
+           total.name.c_str(),
+           total.cached ? " (cached)" : "");
+  }
+}
+
+void Profiler::execution_started(int num_threads)
+{
+  if ((G.debug & G_DEBUG_COMPOSITOR) == 0) {
+    return;
+  }
+  g_execution_index++;
+  g_thread_events.clear();
+  g_group_start_times.clear();
+  g_num_threads = std::max(num_threads, 1);
+  g_max_thread = g_num_threads - 1;
+  m_enabled = true;
+  g_start_time = PIL_check_seconds_timer();
+}
+
+void Profiler::execution_finished()
+{
+  if (!m_enabled) {
+    return;
+  }
+  m_enabled = false;
+  const double end_time = PIL_check_seconds_timer();
+
+  merge_thread_events();
+  print_summary(end_time);
+
+  char basename[FILE_MAX];
+  char filename[FILE_MAX];
+  BLI_snprintf(basename, sizeof(basename), "compositor_profile_%d.json", g_file_index++);
+  BLI_join_dirfile(filename, sizeof(filename), BKE_tempdir_session(), basename);
+  FILE *fp = BLI_fopen(filename, "wb");
+  if (fp) {
+    write_trace(fp);
+    fclose(fp);
+    printf("Compositor profile trace written to: %s\n", filename);
+  }
+  else {
+    printf("Compositor profile trace could not be written to: %s\n", filename);
+  }
+
+  g_events.clear();
+  g_group_start_times.clear();
+}
+
+void Profiler::group_started(const ExecutionGroup *group)
+{
+  if (m_enabled) {
+    g_group_start_times[group] = PIL_check_seconds_timer();
+  }
+}
+
+void Profiler::group_finished(const ExecutionGroup *group)
+{
+  if (m_enabled) {
+    ProfileEvent event = {PROFILE_EVENT_GROUP, group, -1, g_group_start_times[group]};
+    event.end_time = PIL_check_seconds_timer();
+    add_event(event);
+  }
+}
+
+void Profiler::chunk_executed(const ExecutionGroup *group,
+                              unsigned int chunk_number,
+                              int thread,
+                              double start_time,
+                              double end_time)
+{
+  if (m_enabled) {
+    ProfileEvent event = {PROFILE_EVENT_CHUNK, group, thread, start_time, end_time, chunk_number};
+    add_event(event);
+  }
+}
+
+void Profiler::operation_executed(const NodeOperation *operation,
+                                  double start_time,
+                                  double end_time,
+                                  bool cached)
+{
+  if (m_enabled) {
+    ProfileEvent event = {PROFILE_EVENT_OPERATION, operation, -1, start_time, end_time, 0, cached};
+    add_event(event);
+  }
+}
+
+void Profiler::area_executed(const NodeOperation *operation,
+                             int thread,
+                             double start_time,
+                             double end_time)
+{
+  if (m_enabled) {
+    ProfileEvent event = {PROFILE_EVENT_AREA, operation, thread, start_time, end_time};
+    add_event(event);
+  }
+}
+
+static void memory_changed(const int64_t memory)
+{
+  ProfileEvent event = {PROFILE_EVENT_MEMORY, nullptr, -1, PIL_check_seconds_timer()};
+  event.end_time = event.start_time;
+  event.memory = memory;
+  add_event(event);
+}
+
+void Profiler::buffer_allocated(size_t size)
+{
+  if (m_enabled) {
+    memory_changed((int64_t)size);
+  }
+}
+
+void Profiler::buffer_freed(size_t size)
+{
+  if (m_enabled) {
+    memory_changed(-(int64_t)size);
+  }
+}
@@ -0,0 +1,81 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+class ExecutionGroup;
+class NodeOperation;
+
+/**
+ * \brief Profiles executions of the compositor, enabled by `--debug-compositor`.
+ *
+ * Records the wall time of execution groups and the chunks they calculate in tiled execution,
+ * of operations and the areas they calculate in full-frame execution, the threads that did the
+ * work and the memory of the MemoryBuffers allocated during the execution. Every thread records
+ * its own events, they are only combined when the execution finished.
+ *
+ * When an execution finishes a summary table is printed and a Chrome trace is written to
+ * `compositor_profile_N.json` in the temporary directory, which can be opened with
+ * `chrome://tracing` or Perfetto.
+ */
+class Profiler {
+ public:
+  /**
+   * \brief start recording when profiling is enabled
+   * \param num_threads: number of threads available to the execution, for the utilization
+   */
+  static void execution_started(int num_threads);
+  static void execution_finished();
+
+  static void group_started(const ExecutionGroup *group);
+  static void group_finished(const ExecutionGroup *group);
+  static void chunk_executed(const ExecutionGroup *group,
+                             unsigned int chunk_number,
+                             int thread,
+                             double start_time,
+                             double end_time);
+
+  /**
+   * \brief an operation was executed in full-frame execution, or used its cached buffer
+   */
+  static void operation_executed(const NodeOperation *operation,
+                                 double start_time,
+                                 double end_time,
+                                 bool cached);
+  static void area_executed(const NodeOperation *operation,
+                            int thread,
+                            double start_time,
+                            double end_time);
+
+  /**
+   * \brief keep track of the memory of buffers, buffers allocated before the execution started
+   * (like cached ones) are not included
+   */
+  static void buffer_allocated(size_t size);
+  static void buffer_freed(size_t size);
+
+  static bool is_enabled()
+  {
+    return m_enabled;
+  }
+
+ private:
+  static bool m_enabled;
+};
@@ -16,12 +16,15 @@
  * Copyright 2011, Blender Foundation.
  */
 
+#include <condition_variable>
 #include <list>
+#include <mutex>
 #include <stdio.h>
 
 #include "COM_CPUDevice.h"
 #include "COM_OpenCLDevice.h"
 #include "COM_OpenCLKernels.cl.h"
+#include "COM_Profiler.h"
 #include "COM_WorkScheduler.h"
 #include "COM_WriteBufferOperation.h"
 #include "COM_compositor.h"
@@ -29,7 +32,9 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_task.h"
 #include "BLI_threads.h"
+#include "BLI_utildefines.h"
 #include "PIL_time.h"
 
 #include "BKE_global.h"
@@ -39,6 +44,8 @@
 #    warning COM_CURRENT_THREADING_MODEL COM_TM_NOTHREAD is activated. Use only for debugging.
 #  endif
 #elif COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+/* do nothing */
+#elif COM_CURRENT_THREADING_MODEL == COM_TM_TASK
 /* do nothing - default */
 #else
 #  error COM_CURRENT_THREADING_MODEL No threading model selected
@@ -51,9 +58,20 @@ static ThreadLocal(CPUDevice *) g_thread_device;
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
 /** \brief list of all thread for every CPUDevice in cpudevices a thread exists. */
 static ListBase g_cputhreads;
-static bool g_cpuInitialized = false;
 /** \brief all scheduled work for the cpu */
 static ThreadQueue *g_cpuqueue;
+#elif COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+/** \brief all scheduled work for the cpu, executed by the threads of the task scheduler */
+static TaskPool *g_cpu_task_pool;
+/**
+ * \brief CPUDevice of every thread of the task scheduler, indexed by
+ * #BLI_task_parallel_thread_id. Created by the thread when it executes its first work package.
+ */
+static CPUDevice *g_task_cpudevices[BLENDER_MAX_THREADS];
+#endif
+
+#if COM_CURRENT_THREADING_MODEL != COM_TM_NOTHREAD
+static bool g_cpuInitialized = false;
 static ThreadQueue *g_gpuqueue;
 #  ifdef COM_OPENCL_ENABLED
 static cl_context g_context;
@@ -69,6 +87,37 @@ static bool g_openclInitialized = false;
 #  endif
 #endif
 
+/** \brief number of scheduled and finished work packages, guarded by #g_work_mutex */
+static unsigned int g_num_scheduled_work = 0;
+static unsigned int g_num_finished_work = 0;
+static std::mutex g_work_mutex;
+static std::condition_variable g_work_finished;
+
+/**
+ * Execute \a work on \a device, timing it when profiling.
+ */
+static void execute_work(Device *device, WorkPackage *work, int thread)
+{
+  if (!Profiler::is_enabled()) {
+    device->execute(work);
+  }
+  else {
+    const double start_time = PIL_check_seconds_timer();
+    device->execute(work);
+    Profiler::chunk_executed(work->getExecutionGroup(),
+                             work->getChunkNumber(),
+                             thread,
+                             start_time,
+                             PIL_check_seconds_timer());
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(g_work_mutex);
+    g_num_finished_work++;
+  }
+  g_work_finished.notify_all();
+}
+
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
 void *WorkScheduler::thread_execute_cpu(void *data)
 {
@@ -76,20 +125,43 @@ void *WorkScheduler::thread_execute_cpu(void *data)
   WorkPackage *work;
   BLI_thread_local_set(g_thread_device, device);
   while ((work = (WorkPackage *)BLI_thread_queue_pop(g_cpuqueue))) {
-    device->execute(work);
+    execute_work(device, work, device->thread_id());
     delete work;
   }
 
   return nullptr;
 }
+#elif COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+static void task_execute_cpu(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  WorkPackage *work = (WorkPackage *)taskdata;
+  const int thread = BLI_task_parallel_thread_id(nullptr);
+  /* Only this thread accesses its device. */
+  CPUDevice *device = g_task_cpudevices[thread];
+  if (device == nullptr) {
+    device = new CPUDevice(thread);
+    device->initialize();
+    g_task_cpudevices[thread] = device;
+  }
+  BLI_thread_local_set(g_thread_device, device);
+  execute_work(device, work, thread);
+}
 
+static void task_free_work(TaskPool *__restrict /*pool*/, void *taskdata)
+{
+  delete (WorkPackage *)taskdata;
+}
+#endif
+
+#if COM_CURRENT_THREADING_MODEL != COM_TM_NOTHREAD
 void *WorkScheduler::thread_execute_gpu(void *data)
 {
   Device *device = (Device *)data;
   WorkPackage *work;
 
+  /* Profiled as threads after the CPU threads. */
   while ((work = (WorkPackage *)BLI_thread_queue_pop(g_gpuqueue))) {
-    device->execute(work);
+    execute_work(device, work, get_num_cpu_threads());
     delete work;
   }
 
@@ -97,37 +169,51 @@ void *WorkScheduler::thread_execute_gpu(void *data)
 }
 #endif
 
-void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber)
+static void schedule_cpu(WorkPackage *package)
 {
-  WorkPackage *package = new WorkPackage(group, chunkNumber);
 #if COM_CURRENT_THREADING_MODEL == COM_TM_NOTHREAD
   CPUDevice device(0);
-  device.execute(package);
+  execute_work(&device, package, 0);
   delete package;
 #elif COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-#  ifdef COM_OPENCL_ENABLED
+  BLI_thread_queue_push(g_cpuqueue, package);
+#elif COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+  BLI_task_pool_push(g_cpu_task_pool, task_execute_cpu, package, false, task_free_work);
+#endif
+}
+
+void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber)
+{
+  WorkPackage *package = new WorkPackage(group, chunkNumber);
+  {
+    std::lock_guard<std::mutex> lock(g_work_mutex);
+    g_num_scheduled_work++;
+  }
+#if COM_CURRENT_THREADING_MODEL != COM_TM_NOTHREAD && defined(COM_OPENCL_ENABLED)
   if (group->isOpenCL() && g_openclActive) {
     BLI_thread_queue_push(g_gpuqueue, package);
+    return;
   }
-  else {
-    BLI_thread_queue_push(g_cpuqueue, package);
-  }
-#  else
-  BLI_thread_queue_push(g_cpuqueue, package);
-#  endif
 #endif
+  schedule_cpu(package);
 }
 
 void WorkScheduler::start(CompositorContext &context)
 {
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+  g_num_scheduled_work = 0;
+  g_num_finished_work = 0;
+#if COM_CURRENT_THREADING_MODEL != COM_TM_NOTHREAD
   unsigned int index;
+#  if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
   g_cpuqueue = BLI_thread_queue_init();
   BLI_threadpool_init(&g_cputhreads, thread_execute_cpu, g_cpudevices.size());
   for (index = 0; index < g_cpudevices.size(); index++) {
     Device *device = g_cpudevices[index];
     BLI_threadpool_insert(&g_cputhreads, device);
   }
+#  else
+  g_cpu_task_pool = BLI_task_pool_create(nullptr, TASK_PRIORITY_HIGH);
+#  endif
 #  ifdef COM_OPENCL_ENABLED
   if (context.getHasActiveOpenCLDevices()) {
     g_gpuqueue = BLI_thread_queue_init();
@@ -144,22 +230,41 @@ void WorkScheduler::start(CompositorContext &context)
 #  endif
 #endif
 }
-void WorkScheduler::finish()
+
+static void finish_cpu()
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-#  ifdef COM_OPENCL_ENABLED
+  BLI_thread_queue_wait_finish(g_cpuqueue);
+#elif COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+  BLI_task_pool_work_and_wait(g_cpu_task_pool);
+#endif
+}
+
+void WorkScheduler::finish()
+{
+#if COM_CURRENT_THREADING_MODEL != COM_TM_NOTHREAD && defined(COM_OPENCL_ENABLED)
   if (g_openclActive) {
     BLI_thread_queue_wait_finish(g_gpuqueue);
-    BLI_thread_queue_wait_finish(g_cpuqueue);
-  }
-  else {
-    BLI_thread_queue_wait_finish(g_cpuqueue);
   }
-#  else
-  BLI_thread_queue_wait_finish(cpuqueue);
-#  endif
 #endif
+  finish_cpu();
+}
+
+unsigned int WorkScheduler::get_num_finished_work()
+{
+  std::lock_guard<std::mutex> lock(g_work_mutex);
+  return g_num_finished_work;
 }
+
+void WorkScheduler::wait_for_work(unsigned int num_finished_work)
+{
+  std::unique_lock<std::mutex> lock(g_work_mutex);
+  g_work_finished.wait(lock, [num_finished_work]() {
+    return g_num_finished_work != num_finished_work ||
+           g_num_finished_work == g_num_scheduled_work;
+  });
+}
+
 void WorkScheduler::stop()
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
@@ -167,20 +272,23 @@ void WorkScheduler::stop()
   BLI_threadpool_end(&g_cputhreads);
   BLI_thread_queue_free(g_cpuqueue);
   g_cpuqueue = nullptr;
-#  ifdef COM_OPENCL_ENABLED
+#elif COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+  BLI_task_pool_free(g_cpu_task_pool);
+  g_cpu_task_pool = nullptr;
+#endif
+#if COM_CURRENT_THREADING_MODEL != COM_TM_NOTHREAD && defined(COM_OPENCL_ENABLED)
   if (g_openclActive) {
     BLI_thread_queue_nowait(g_gpuqueue);
     BLI_threadpool_end(&g_gputhreads);
     BLI_thread_queue_free(g_gpuqueue);
     g_gpuqueue = nullptr;
   }
-#  endif
 #endif
 }
 
 bool WorkScheduler::hasGPUDevices()
 {
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+#if COM_CURRENT_THREADING_MODEL != COM_TM_NOTHREAD
 #  ifdef COM_OPENCL_ENABLED
   return !g_gpudevices.empty();
 #  else
@@ -191,7 +299,7 @@ bool WorkScheduler::hasGPUDevices()
 #endif
 }
 
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+#if COM_CURRENT_THREADING_MODEL != COM_TM_NOTHREAD
 static void CL_CALLBACK clContextError(const char *errinfo,
                                        const void * /*private_info*/,
                                        size_t /*cb*/,
@@ -203,7 +311,8 @@ static void CL_CALLBACK clContextError(const char *errinfo,
 
 void WorkScheduler::initialize(bool use_opencl, int num_cpu_threads)
 {
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+#if COM_CURRENT_THREADING_MODEL != COM_TM_NOTHREAD
+#  if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
   /* deinitialize if number of threads doesn't match */
   if (g_cpudevices.size() != num_cpu_threads) {
     Device *device;
@@ -230,6 +339,14 @@ void WorkScheduler::initialize(bool use_opencl, int num_cpu_threads)
     BLI_thread_local_create(g_thread_device);
     g_cpuInitialized = true;
   }
+#  else
+  /* The threads of the task scheduler execute the CPU work, they create their devices. */
+  UNUSED_VARS(num_cpu_threads);
+  if (!g_cpuInitialized) {
+    BLI_thread_local_create(g_thread_device);
+    g_cpuInitialized = true;
+  }
+#  endif
 
 #  ifdef COM_OPENCL_ENABLED
   /* deinitialize OpenCL GPU's */
@@ -325,7 +442,7 @@ void WorkScheduler::initialize(bool use_opencl, int num_cpu_threads)
 
 void WorkScheduler::deinitialize()
 {
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+#if COM_CURRENT_THREADING_MODEL != COM_TM_NOTHREAD
   /* deinitialize CPU threads */
   if (g_cpuInitialized) {
     Device *device;
@@ -335,6 +452,15 @@ void WorkScheduler::deinitialize()
       device->deinitialize();
       delete device;
     }
+#  if COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+    for (CPUDevice *&task_device : g_task_cpudevices) {
+      if (task_device != nullptr) {
+        task_device->deinitialize();
+        delete task_device;
+        task_device = nullptr;
+      }
+    }
+#  endif
     BLI_thread_local_delete(g_thread_device);
     g_cpuInitialized = false;
   }
@@ -367,5 +493,18 @@ void WorkScheduler::deinitialize()
 int WorkScheduler::current_thread_id()
 {
   CPUDevice *device = (CPUDevice *)BLI_thread_local_get(g_thread_device);
+  if (device == nullptr) {
+    /* Task of the full-frame execution, not running on a CPUDevice. */
+    return BLI_task_parallel_thread_id(nullptr);
+  }
   return device->thread_id();
 }
+
+int WorkScheduler::get_num_cpu_threads()
+{
+#if COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+  return BLI_task_scheduler_num_threads();
+#else
+  return g_cpudevices.size();
+#endif
+}
@@ -42,7 +42,9 @@ class WorkScheduler {
    * inside this loop new work is queried and being executed
    */
   static void *thread_execute_cpu(void *data);
+#endif
 
+#if COM_CURRENT_THREADING_MODEL != COM_TM_NOTHREAD
   /**
    * \brief main thread loop for gpudevices
    * inside this loop new work is queried and being executed
@@ -101,6 +103,20 @@ class WorkScheduler {
    */
   static void finish();
 
+  /**
+   * \brief number of work packages that finished since the start of the execution
+   * \see wait_for_work
+   */
+  static unsigned int get_num_finished_work();
+
+  /**
+   * \brief wait until more than \a num_finished_work work packages finished.
+   *
+   * Returns immediately when no work is being executed, so an execution group can schedule the
+   * chunks depending on a chunk as soon as it finished while other chunks are calculated.
+   */
+  static void wait_for_work(unsigned int num_finished_work);
+
   /**
    * \brief Are there OpenCL capable GPU devices initialized?
    * the result of this method is stored in the CompositorContext
@@ -111,6 +127,11 @@ class WorkScheduler {
 
   static int current_thread_id();
 
+  /**
+   * \brief number of threads executing work on the CPU
+   */
+  static int get_num_cpu_threads();
+
 #ifdef WITH_CXX_GUARDEDALLOC
   MEM_CXX_CLASS_ALLOC_FUNCS("COM:WorkScheduler")
 #endif
@@ -23,7 +23,10 @@
 #include "BKE_node.h"
 #include "BKE_scene.h"
 
+#include "DNA_userdef_types.h"
+
 #include "COM_ExecutionSystem.h"
+#include "COM_MemoryBufferCache.h"
 #include "COM_MovieDistortionOperation.h"
 #include "COM_WorkScheduler.h"
 #include "COM_compositor.h"
@@ -84,6 +87,10 @@ void COM_execute(RenderData *rd,
   editingtree->progress(editingtree->prh, 0.0);
   editingtree->stats_draw(editingtree->sdh, IFACE_("Compositing"));
 
+  /* The cache is shared by all node trees, only full-frame execution uses it. */
+  const bool use_cache = editingtree->execution_mode == NTREE_EXECUTION_MODE_FULL_FRAME;
+  MemoryBufferCache::setLimit(use_cache ? (size_t)U.compositor_cache_limit * 1024 * 1024 : 0);
+
   bool twopass = (editingtree->flag & NTREE_TWO_PASS) && !rendering;
   /* initialize execution system */
   if (twopass) {
@@ -113,6 +120,7 @@ void COM_deinitialize()
   if (is_compositorMutex_init) {
     BLI_mutex_lock(&s_compositorMutex);
     WorkScheduler::deinitialize();
+    MemoryBufferCache::clear();
     is_compositorMutex_init = false;
     BLI_mutex_unlock(&s_compositorMutex);
     BLI_mutex_end(&s_compositorMutex);
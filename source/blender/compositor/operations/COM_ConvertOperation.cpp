@@ -20,6 +20,8 @@
 
 #include "IMB_colormanagement.h"
 
+#include "MEM_guardedalloc.h"
+
 ConvertBaseOperation::ConvertBaseOperation()
 {
   this->m_inputOperation = nullptr;
@@ -35,12 +37,24 @@ void ConvertBaseOperation::deinitExecution()
   this->m_inputOperation = nullptr;
 }
 
+void ConvertBaseOperation::executeArea(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs)
+{
+  const int width = BLI_rcti_size_x(area);
+  float *temp = (float *)MEM_mallocN(sizeof(float) * COM_NUM_CHANNELS_COLOR * width, __func__);
+  for (int y = area->ymin; y < area->ymax; y++) {
+    const float *input = inputs[0]->getRow(y, area->xmin, area->xmax, temp);
+    convertRow(output->getElem(area->xmin, y), input, width);
+  }
+  MEM_freeN(temp);
+}
+
 /* ******** Value to Color ******** */
 
 ConvertValueToColorOperation::ConvertValueToColorOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_VALUE);
   this->addOutputSocket(COM_DT_COLOR);
+  this->setFullFrameOperation(true);
 }
 
 void ConvertValueToColorOperation::executePixelSampled(float output[4],
@@ -54,12 +68,21 @@ void ConvertValueToColorOperation::executePixelSampled(float output[4],
   output[3] = 1.0f;
 }
 
+void ConvertValueToColorOperation::convertRow(float *output, const float *input, int len)
+{
+  for (int i = 0; i < len; i++, output += 4) {
+    output[0] = output[1] = output[2] = input[i];
+    output[3] = 1.0f;
+  }
+}
+
 /* ******** Color to Value ******** */
 
 ConvertColorToValueOperation::ConvertColorToValueOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_VALUE);
+  this->setFullFrameOperation(true);
 }
 
 void ConvertColorToValueOperation::executePixelSampled(float output[4],
@@ -72,12 +95,20 @@ void ConvertColorToValueOperation::executePixelSampled(float output[4],
   output[0] = (inputColor[0] + inputColor[1] + inputColor[2]) / 3.0f;
 }
 
+void ConvertColorToValueOperation::convertRow(float *output, const float *input, int len)
+{
+  for (int i = 0; i < len; i++, input += 4) {
+    output[i] = (input[0] + input[1] + input[2]) / 3.0f;
+  }
+}
+
 /* ******** Color to BW ******** */
 
 ConvertColorToBWOperation::ConvertColorToBWOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_VALUE);
+  this->setFullFrameOperation(true);
 }
 
 void ConvertColorToBWOperation::executePixelSampled(float output[4],
@@ -90,12 +121,20 @@ void ConvertColorToBWOperation::executePixelSampled(float output[4],
   output[0] = IMB_colormanagement_get_luminance(inputColor);
 }
 
+void ConvertColorToBWOperation::convertRow(float *output, const float *input, int len)
+{
+  for (int i = 0; i < len; i++, input += 4) {
+    output[i] = IMB_colormanagement_get_luminance(input);
+  }
+}
+
 /* ******** Color to Vector ******** */
 
 ConvertColorToVectorOperation::ConvertColorToVectorOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_VECTOR);
+  this->setFullFrameOperation(true);
 }
 
 void ConvertColorToVectorOperation::executePixelSampled(float output[4],
@@ -108,12 +147,20 @@ void ConvertColorToVectorOperation::executePixelSampled(float output[4],
   copy_v3_v3(output, color);
 }
 
+void ConvertColorToVectorOperation::convertRow(float *output, const float *input, int len)
+{
+  for (int i = 0; i < len; i++, input += 4, output += 3) {
+    copy_v3_v3(output, input);
+  }
+}
+
 /* ******** Value to Vector ******** */
 
 ConvertValueToVectorOperation::ConvertValueToVectorOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_VALUE);
   this->addOutputSocket(COM_DT_VECTOR);
+  this->setFullFrameOperation(true);
 }
 
 void ConvertValueToVectorOperation::executePixelSampled(float output[4],
@@ -126,12 +173,20 @@ void ConvertValueToVectorOperation::executePixelSampled(float output[4],
   output[0] = output[1] = output[2] = value;
 }
 
+void ConvertValueToVectorOperation::convertRow(float *output, const float *input, int len)
+{
+  for (int i = 0; i < len; i++, output += 3) {
+    output[0] = output[1] = output[2] = input[i];
+  }
+}
+
 /* ******** Vector to Color ******** */
 
 ConvertVectorToColorOperation::ConvertVectorToColorOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_VECTOR);
   this->addOutputSocket(COM_DT_COLOR);
+  this->setFullFrameOperation(true);
 }
 
 void ConvertVectorToColorOperation::executePixelSampled(float output[4],
@@ -143,12 +198,21 @@ void ConvertVectorToColorOperation::executePixelSampled(float output[4],
   output[3] = 1.0f;
 }
 
+void ConvertVectorToColorOperation::convertRow(float *output, const float *input, int len)
+{
+  for (int i = 0; i < len; i++, input += 3, output += 4) {
+    copy_v3_v3(output, input);
+    output[3] = 1.0f;
+  }
+}
+
 /* ******** Vector to Value ******** */
 
 ConvertVectorToValueOperation::ConvertVectorToValueOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_VECTOR);
   this->addOutputSocket(COM_DT_VALUE);
+  this->setFullFrameOperation(true);
 }
 
 void ConvertVectorToValueOperation::executePixelSampled(float output[4],
@@ -161,6 +225,13 @@ void ConvertVectorToValueOperation::executePixelSampled(float output[4],
   output[0] = (input[0] + input[1] + input[2]) / 3.0f;
 }
 
+void ConvertVectorToValueOperation::convertRow(float *output, const float *input, int len)
+{
+  for (int i = 0; i < len; i++, input += 3) {
+    output[i] = (input[0] + input[1] + input[2]) / 3.0f;
+  }
+}
+
 /* ******** RGB to YCC ******** */
 
 ConvertRGBToYCCOperation::ConvertRGBToYCCOperation() : ConvertBaseOperation()
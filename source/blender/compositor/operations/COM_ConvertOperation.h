@@ -29,6 +29,17 @@ class ConvertBaseOperation : public NodeOperation {
 
   void initExecution();
   void deinitExecution();
+
+  void executeArea(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
+
+ protected:
+  /**
+   * Convert \a len pixels of the input for #executeArea,
+   * only used when the operation is a full-frame operation.
+   */
+  virtual void convertRow(float * /*output*/, const float * /*input*/, int /*len*/)
+  {
+  }
 };
 
 class ConvertValueToColorOperation : public ConvertBaseOperation {
@@ -36,6 +47,9 @@ class ConvertValueToColorOperation : public ConvertBaseOperation {
   ConvertValueToColorOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+ protected:
+  void convertRow(float *output, const float *input, int len);
 };
 
 class ConvertColorToValueOperation : public ConvertBaseOperation {
@@ -43,6 +57,9 @@ class ConvertColorToValueOperation : public ConvertBaseOperation {
   ConvertColorToValueOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+ protected:
+  void convertRow(float *output, const float *input, int len);
 };
 
 class ConvertColorToBWOperation : public ConvertBaseOperation {
@@ -50,6 +67,9 @@ class ConvertColorToBWOperation : public ConvertBaseOperation {
   ConvertColorToBWOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+ protected:
+  void convertRow(float *output, const float *input, int len);
 };
 
 class ConvertColorToVectorOperation : public ConvertBaseOperation {
@@ -57,6 +77,9 @@ class ConvertColorToVectorOperation : public ConvertBaseOperation {
   ConvertColorToVectorOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+ protected:
+  void convertRow(float *output, const float *input, int len);
 };
 
 class ConvertValueToVectorOperation : public ConvertBaseOperation {
@@ -64,6 +87,9 @@ class ConvertValueToVectorOperation : public ConvertBaseOperation {
   ConvertValueToVectorOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+ protected:
+  void convertRow(float *output, const float *input, int len);
 };
 
 class ConvertVectorToColorOperation : public ConvertBaseOperation {
@@ -71,6 +97,9 @@ class ConvertVectorToColorOperation : public ConvertBaseOperation {
   ConvertVectorToColorOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+ protected:
+  void convertRow(float *output, const float *input, int len);
 };
 
 class ConvertVectorToValueOperation : public ConvertBaseOperation {
@@ -78,6 +107,9 @@ class ConvertVectorToValueOperation : public ConvertBaseOperation {
   ConvertVectorToValueOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+ protected:
+  void convertRow(float *output, const float *input, int len);
 };
 
 class ConvertRGBToYCCOperation : public ConvertBaseOperation {
@@ -0,0 +1,732 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "BLI_math.h"
+#include "BLI_rect.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "COM_Convolution.h"
+#include "COM_MemoryBuffer.h"
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+/* -------------------------------------------------------------------- */
+/** \name Separable Passes
+ * \{ */
+
+/**
+ * dst += src * weight, for \a len floats.
+ */
+static void madd_array(float *dst, const float *src, const float weight, const int len)
+{
+  int i = 0;
+#ifdef __SSE2__
+  const __m128 weight4 = _mm_set1_ps(weight);
+  for (; i + 4 <= len; i += 4) {
+    const __m128 product = _mm_mul_ps(_mm_loadu_ps(&src[i]), weight4);
+    _mm_storeu_ps(&dst[i], _mm_add_ps(_mm_loadu_ps(&dst[i]), product));
+  }
+#endif
+  for (; i < len; i++) {
+    dst[i] += src[i] * weight;
+  }
+}
+
+/**
+ * Sums of the first weights of \a kernel, the weights of taps `a..b` relative to the center
+ * add up to `sums[b + radius + 1] - sums[a + radius]`.
+ */
+static float *make_kernel_sums(const float *kernel, const int radius)
+{
+  const int size = 2 * radius + 1;
+  float *sums = (float *)MEM_mallocN(sizeof(float) * (size + 1), __func__);
+  sums[0] = 0.0f;
+  for (int i = 0; i < size; i++) {
+    sums[i + 1] = sums[i] + kernel[i];
+  }
+  return sums;
+}
+
+void Convolution::convolveRows(MemoryBuffer *output,
+                               MemoryBuffer *input,
+                               const rcti *area,
+                               const float *kernel,
+                               int radius)
+{
+  BLI_assert(input->get_num_channels() == 4 && output->get_num_channels() == 4);
+  const rcti &rect = *input->getRect();
+  const int width = BLI_rcti_size_x(area);
+  if (width <= 0) {
+    return;
+  }
+  float *sums = make_kernel_sums(kernel, radius);
+
+  for (int y = area->ymin; y < area->ymax; y++) {
+    float *out = output->getElem(area->xmin, y);
+    memset(out, 0, sizeof(float) * 4 * width);
+
+    /* Add the whole row for one tap at a time, shifted by the tap offset. */
+    for (int offset = -radius; offset <= radius; offset++) {
+      const int xmin = max_ii(area->xmin, rect.xmin - offset);
+      const int xmax = min_ii(area->xmax, rect.xmax - offset);
+      if (xmin < xmax) {
+        madd_array(&out[(xmin - area->xmin) * 4],
+                   input->getElem(xmin + offset, y),
+                   kernel[offset + radius],
+                   (xmax - xmin) * 4);
+      }
+    }
+
+    for (int x = area->xmin; x < area->xmax; x++, out += 4) {
+      const int first = max_ii(-radius, rect.xmin - x);
+      const int last = min_ii(radius, rect.xmax - 1 - x);
+      const float weight = sums[last + radius + 1] - sums[first + radius];
+      if (weight > 0.0f) {
+        mul_v4_fl(out, 1.0f / weight);
+      }
+    }
+  }
+
+  MEM_freeN(sums);
+}
+
+void Convolution::convolveColumns(MemoryBuffer *output,
+                                  MemoryBuffer *input,
+                                  const rcti *area,
+                                  const float *kernel,
+                                  int radius)
+{
+  BLI_assert(input->get_num_channels() == 4 && output->get_num_channels() == 4);
+  const rcti &rect = *input->getRect();
+  const int width = BLI_rcti_size_x(area);
+  if (width <= 0) {
+    return;
+  }
+
+  for (int y = area->ymin; y < area->ymax; y++) {
+    float *out = output->getElem(area->xmin, y);
+    memset(out, 0, sizeof(float) * 4 * width);
+
+    /* Add whole rows weighted by the tap, which keeps the memory access sequential. */
+    const int first = max_ii(-radius, rect.ymin - y);
+    const int last = min_ii(radius, rect.ymax - 1 - y);
+    float weight = 0.0f;
+    for (int offset = first; offset <= last; offset++) {
+      madd_array(out, input->getElem(area->xmin, y + offset), kernel[offset + radius], width * 4);
+      weight += kernel[offset + radius];
+    }
+
+    if (weight > 0.0f) {
+      const float weight_inv = 1.0f / weight;
+      for (int i = 0; i < width * 4; i++) {
+        out[i] *= weight_inv;
+      }
+    }
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Recursive Gaussian
+ *
+ * See "Recursive Gabor Filtering" by Young/VanVliet.
+ * \{ */
+
+struct IIRGaussData {
+  /* All factors here in double precision, single precision seems to blow up if sigma > ~200. */
+  double cf[4];
+  double tsM[9];
+
+  float *buffer;
+  unsigned int width;
+  unsigned int height;
+  unsigned int num_channels;
+  unsigned int channel;
+};
+
+/** Per thread buffers for a single line. */
+struct IIRGaussLine {
+  double *X;
+  double *Y;
+  double *W;
+};
+
+static void iir_gauss_coefficients(IIRGaussData *data, const float sigma)
+{
+  double q, q2, sc;
+  double *cf = data->cf;
+  double *tsM = data->tsM;
+
+  if (sigma >= 3.556f) {
+    q = 0.9804f * (sigma - 3.556f) + 2.5091f;
+  }
+  else { /* sigma >= 0.5 */
+    q = (0.0561f * sigma + 0.5784f) * sigma - 0.2568f;
+  }
+  q2 = q * q;
+  sc = (1.1668 + q) * (3.203729649 + (2.21566 + q) * q);
+  /* No gabor filtering here, so no complex multiplies, just the regular coefs.
+   * All negated here, so as not to have to recalc Triggs/Sdika matrix. */
+  cf[1] = q * (5.788961737 + (6.76492 + 3.0 * q) * q) / sc;
+  cf[2] = -q2 * (3.38246 + 3.0 * q) / sc;
+  /* 0 & 3 unchanged. */
+  cf[3] = q2 * q / sc;
+  cf[0] = 1.0 - cf[1] - cf[2] - cf[3];
+
+  /* Triggs/Sdika border corrections,
+   * it seems to work, not entirely sure if it is actually totally correct,
+   * Besides J.M.Geusebroek's anigauss.c (see http://www.science.uva.nl/~mark),
+   * found one other implementation by Cristoph Lampert,
+   * but neither seem to be quite the same, result seems to be ok so far anyway.
+   * Extra scale factor here to not have to do it in filter,
+   * though maybe this had something to with the precision errors. */
+  sc = cf[0] / ((1.0 + cf[1] - cf[2] + cf[3]) * (1.0 - cf[1] - cf[2] - cf[3]) *
+                (1.0 + cf[2] + (cf[1] - cf[3]) * cf[3]));
+  tsM[0] = sc * (-cf[3] * cf[1] + 1.0 - cf[3] * cf[3] - cf[2]);
+  tsM[1] = sc * ((cf[3] + cf[1]) * (cf[2] + cf[3] * cf[1]));
+  tsM[2] = sc * (cf[3] * (cf[1] + cf[3] * cf[2]));
+  tsM[3] = sc * (cf[1] + cf[3] * cf[2]);
+  tsM[4] = sc * (-(cf[2] - 1.0) * (cf[2] + cf[3] * cf[1]));
+  tsM[5] = sc * (-(cf[3] * cf[1] + cf[3] * cf[3] + cf[2] - 1.0) * cf[3]);
+  tsM[6] = sc * (cf[3] * cf[1] + cf[2] + cf[1] * cf[1] - cf[2] * cf[2]);
+  tsM[7] = sc * (cf[1] * cf[2] + cf[3] * cf[2] * cf[2] - cf[1] * cf[3] * cf[3] -
+                 cf[3] * cf[3] * cf[3] - cf[3] * cf[2] + cf[3]);
+  tsM[8] = sc * (cf[3] * (cf[1] + cf[3] * cf[2]));
+}
+
+/**
+ * Filter \a L values from X to Y, forward and backward.
+ */
+static void iir_gauss_filter(const IIRGaussData *data, IIRGaussLine *line, const unsigned int L)
+{
+  const double *cf = data->cf;
+  const double *tsM = data->tsM;
+  const double *X = line->X;
+  double *Y = line->Y;
+  double *W = line->W;
+  double tsu[3], tsv[3];
+  unsigned int i;
+
+  W[0] = cf[0] * X[0] + cf[1] * X[0] + cf[2] * X[0] + cf[3] * X[0];
+  W[1] = cf[0] * X[1] + cf[1] * W[0] + cf[2] * X[0] + cf[3] * X[0];
+  W[2] = cf[0] * X[2] + cf[1] * W[1] + cf[2] * W[0] + cf[3] * X[0];
+  for (i = 3; i < L; i++) {
+    W[i] = cf[0] * X[i] + cf[1] * W[i - 1] + cf[2] * W[i - 2] + cf[3] * W[i - 3];
+  }
+  tsu[0] = W[L - 1] - X[L - 1];
+  tsu[1] = W[L - 2] - X[L - 1];
+  tsu[2] = W[L - 3] - X[L - 1];
+  tsv[0] = tsM[0] * tsu[0] + tsM[1] * tsu[1] + tsM[2] * tsu[2] + X[L - 1];
+  tsv[1] = tsM[3] * tsu[0] + tsM[4] * tsu[1] + tsM[5] * tsu[2] + X[L - 1];
+  tsv[2] = tsM[6] * tsu[0] + tsM[7] * tsu[1] + tsM[8] * tsu[2] + X[L - 1];
+  Y[L - 1] = cf[0] * W[L - 1] + cf[1] * tsv[0] + cf[2] * tsv[1] + cf[3] * tsv[2];
+  Y[L - 2] = cf[0] * W[L - 2] + cf[1] * Y[L - 1] + cf[2] * tsv[0] + cf[3] * tsv[1];
+  Y[L - 3] = cf[0] * W[L - 3] + cf[1] * Y[L - 2] + cf[2] * Y[L - 1] + cf[3] * tsv[0];
+  /* 'i != UINT_MAX' is really 'i >= 0', but necessary for unsigned int wrapping */
+  for (i = L - 4; i != UINT_MAX; i--) {
+    Y[i] = cf[0] * W[i] + cf[1] * Y[i + 1] + cf[2] * Y[i + 2] + cf[3] * Y[i + 3];
+  }
+}
+
+static IIRGaussLine *iir_gauss_line(const IIRGaussData *data, const TaskParallelTLS *tls)
+{
+  IIRGaussLine *line = (IIRGaussLine *)tls->userdata_chunk;
+  if (line->X == nullptr) {
+    const unsigned int size = max(data->width, data->height);
+    line->X = (double *)MEM_mallocN(size * sizeof(double), "IIR_gauss X buf");
+    line->Y = (double *)MEM_mallocN(size * sizeof(double), "IIR_gauss Y buf");
+    line->W = (double *)MEM_mallocN(size * sizeof(double), "IIR_gauss W buf");
+  }
+  return line;
+}
+
+static void iir_gauss_free(const void *__restrict /*userdata*/, void *__restrict chunk)
+{
+  IIRGaussLine *line = (IIRGaussLine *)chunk;
+  MEM_SAFE_FREE(line->X);
+  MEM_SAFE_FREE(line->Y);
+  MEM_SAFE_FREE(line->W);
+}
+
+static void iir_gauss_row(void *__restrict userdata,
+                          const int y,
+                          const TaskParallelTLS *__restrict tls)
+{
+  const IIRGaussData *data = (const IIRGaussData *)userdata;
+  IIRGaussLine *line = iir_gauss_line(data, tls);
+  const unsigned int num_channels = data->num_channels;
+  float *row = &data->buffer[y * data->width * num_channels + data->channel];
+
+  for (unsigned int x = 0, offset = 0; x < data->width; x++, offset += num_channels) {
+    line->X[x] = row[offset];
+  }
+  iir_gauss_filter(data, line, data->width);
+  for (unsigned int x = 0, offset = 0; x < data->width; x++, offset += num_channels) {
+    row[offset] = line->Y[x];
+  }
+}
+
+static void iir_gauss_column(void *__restrict userdata,
+                             const int x,
+                             const TaskParallelTLS *__restrict tls)
+{
+  const IIRGaussData *data = (const IIRGaussData *)userdata;
+  IIRGaussLine *line = iir_gauss_line(data, tls);
+  const unsigned int add = data->width * data->num_channels;
+  float *column = &data->buffer[x * data->num_channels + data->channel];
+
+  for (unsigned int y = 0, offset = 0; y < data->height; y++, offset += add) {
+    line->X[y] = column[offset];
+  }
+  iir_gauss_filter(data, line, data->height);
+  for (unsigned int y = 0, offset = 0; y < data->height; y++, offset += add) {
+    column[offset] = line->Y[y];
+  }
+}
+
+void Convolution::gaussianIIR(MemoryBuffer *buffer,
+                              float sigma,
+                              unsigned int channel,
+                              unsigned int xy)
+{
+  IIRGaussData data;
+  data.buffer = buffer->getBuffer();
+  data.width = buffer->getWidth();
+  data.height = buffer->getHeight();
+  data.num_channels = buffer->get_num_channels();
+  data.channel = channel;
+
+  /* <0.5 not valid, though can have a possibly useful sort of sharpening effect. */
+  if (sigma < 0.5f) {
+    return;
+  }
+
+  if ((xy < 1) || (xy > 3)) {
+    xy = 3;
+  }
+
+  /* The filter explicitly expects sources of at least 3x3 pixels,
+   * so just skipping blur along faulty direction if src's def is below that limit! */
+  if (data.width < 3) {
+    xy &= ~1;
+  }
+  if (data.height < 3) {
+    xy &= ~2;
+  }
+  if (xy < 1) {
+    return;
+  }
+
+  iir_gauss_coefficients(&data, sigma);
+
+  IIRGaussLine line = {nullptr, nullptr, nullptr};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.userdata_chunk = &line;
+  settings.userdata_chunk_size = sizeof(line);
+  settings.func_free = iir_gauss_free;
+  settings.min_iter_per_thread = 16;
+
+  if (xy & 1) { /* H */
+    BLI_task_parallel_range(0, data.height, &data, iir_gauss_row, &settings);
+  }
+  if (xy & 2) { /* V */
+    BLI_task_parallel_range(0, data.width, &data, iir_gauss_column, &settings);
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name FFT Convolution
+ *
+ * 2D Fast Hartley Transform.
+ * \{ */
+
+typedef float fREAL;
+
+/* Returns next highest power of 2 of x, as well its log2 in L2. */
+static unsigned int nextPow2(unsigned int x, unsigned int *L2)
+{
+  unsigned int pw, x_notpow2 = x & (x - 1);
+  *L2 = 0;
+  while (x >>= 1) {
+    ++(*L2);
+  }
+  pw = 1 << (*L2);
+  if (x_notpow2) {
+    (*L2)++;
+    pw <<= 1;
+  }
+  return pw;
+}
+
+/* From FXT library by Joerg Arndt, faster in order bitreversal
+ * use: r = revbin_upd(r, h) where h = N>>1 */
+static unsigned int revbin_upd(unsigned int r, unsigned int h)
+{
+  while (!((r ^= h) & h)) {
+    h >>= 1;
+  }
+  return r;
+}
+
+static void FHT(fREAL *data, unsigned int M, unsigned int inverse)
+{
+  double tt, fc, dc, fs, ds, a = M_PI;
+  fREAL t1, t2;
+  int n2, bd, bl, istep, k, len = 1 << M, n = 1;
+
+  int i, j = 0;
+  unsigned int Nh = len >> 1;
+  for (i = 1; i < (len - 1); i++) {
+    j = revbin_upd(j, Nh);
+    if (j > i) {
+      t1 = data[i];
+      data[i] = data[j];
+      data[j] = t1;
+    }
+  }
+
+  do {
+    fREAL *data_n = &data[n];
+
+    istep = n << 1;
+    for (k = 0; k < len; k += istep) {
+      t1 = data_n[k];
+      data_n[k] = data[k] - t1;
+      data[k] += t1;
+    }
+
+    n2 = n >> 1;
+    if (n > 2) {
+      fc = dc = cos(a);
+      fs = ds = sqrt(1.0 - fc * fc); /* sin(a); */
+      bd = n - 2;
+      for (bl = 1; bl < n2; bl++) {
+        fREAL *data_nbd = &data_n[bd];
+        fREAL *data_bd = &data[bd];
+        for (k = bl; k < len; k += istep) {
+          t1 = fc * (double)data_n[k] + fs * (double)data_nbd[k];
+          t2 = fs * (double)data_n[k] - fc * (double)data_nbd[k];
+          data_n[k] = data[k] - t1;
+          data_nbd[k] = data_bd[k] - t2;
+          data[k] += t1;
+          data_bd[k] += t2;
+        }
+        tt = fc * dc - fs * ds;
+        fs = fs * dc + fc * ds;
+        fc = tt;
+        bd -= 2;
+      }
+    }
+
+    if (n > 1) {
+      for (k = n2; k < len; k += istep) {
+        t1 = data_n[k];
+        data_n[k] = data[k] - t1;
+        data[k] += t1;
+      }
+    }
+
+    n = istep;
+    a *= 0.5;
+  } while (n < len);
+
+  if (inverse) {
+    fREAL sc = (fREAL)1 / (fREAL)len;
+    for (k = 0; k < len; k++) {
+      data[k] *= sc;
+    }
+  }
+}
+
+/* 2D Fast Hartley Transform, Mx/My -> log2 of width/height,
+ * nzp -> the row where zero pad data starts,
+ * inverse -> see above */
+static void FHT2D(
+    fREAL *data, unsigned int Mx, unsigned int My, unsigned int nzp, unsigned int inverse)
+{
+  unsigned int i, j, Nx, Ny, maxy;
+
+  Nx = 1 << Mx;
+  Ny = 1 << My;
+
+  /* Rows (forward transform skips 0 pad data). */
+  maxy = inverse ? Ny : nzp;
+  for (j = 0; j < maxy; j++) {
+    FHT(&data[Nx * j], Mx, inverse);
+  }
+
+  /* Transpose data. */
+  if (Nx == Ny) { /* Square. */
+    for (j = 0; j < Ny; j++) {
+      for (i = j + 1; i < Nx; i++) {
+        unsigned int op = i + (j << Mx), np = j + (i << My);
+        SWAP(fREAL, data[op], data[np]);
+      }
+    }
+  }
+  else { /* Rectangular. */
+    unsigned int k, Nym = Ny - 1, stm = 1 << (Mx + My);
+    for (i = 0; stm > 0; i++) {
+#define PRED(k) (((k & Nym) << Mx) + (k >> My))
+      for (j = PRED(i); j > i; j = PRED(j)) {
+        /* pass */
+      }
+      if (j < i) {
+        continue;
+      }
+      for (k = i, j = PRED(i); j != i; k = j, j = PRED(j), stm--) {
+        SWAP(fREAL, data[j], data[k]);
+      }
+#undef PRED
+      stm--;
+    }
+  }
+
+  SWAP(unsigned int, Nx, Ny);
+  SWAP(unsigned int, Mx, My);
+
+  /* Now columns == transposed rows. */
+  for (j = 0; j < Ny; j++) {
+    FHT(&data[Nx * j], Mx, inverse);
+  }
+
+  /* Finalize. */
+  for (j = 0; j <= (Ny >> 1); j++) {
+    unsigned int jm = (Ny - j) & (Ny - 1);
+    unsigned int ji = j << Mx;
+    unsigned int jmi = jm << Mx;
+    for (i = 0; i <= (Nx >> 1); i++) {
+      unsigned int im = (Nx - i) & (Nx - 1);
+      fREAL A = data[ji + i];
+      fREAL B = data[jmi + i];
+      fREAL C = data[ji + im];
+      fREAL D = data[jmi + im];
+      fREAL E = (fREAL)0.5 * ((A + D) - (B + C));
+      data[ji + i] = A - E;
+      data[jmi + i] = B + E;
+      data[ji + im] = C + E;
+      data[jmi + im] = D - E;
+    }
+  }
+}
+
+/* 2D convolution calc, d1 *= d2, M/N - > log2 of width/height */
+static void fht_convolve(fREAL *d1, const fREAL *d2, unsigned int M, unsigned int N)
+{
+  fREAL a, b;
+  unsigned int i, j, k, L, mj, mL;
+  unsigned int m = 1 << M, n = 1 << N;
+  unsigned int m2 = 1 << (M - 1), n2 = 1 << (N - 1);
+  unsigned int mn2 = m << (N - 1);
+
+  d1[0] *= d2[0];
+  d1[mn2] *= d2[mn2];
+  d1[m2] *= d2[m2];
+  d1[m2 + mn2] *= d2[m2 + mn2];
+  for (i = 1; i < m2; i++) {
+    k = m - i;
+    a = d1[i] * d2[i] - d1[k] * d2[k];
+    b = d1[k] * d2[i] + d1[i] * d2[k];
+    d1[i] = (b + a) * (fREAL)0.5;
+    d1[k] = (b - a) * (fREAL)0.5;
+    a = d1[i + mn2] * d2[i + mn2] - d1[k + mn2] * d2[k + mn2];
+    b = d1[k + mn2] * d2[i + mn2] + d1[i + mn2] * d2[k + mn2];
+    d1[i + mn2] = (b + a) * (fREAL)0.5;
+    d1[k + mn2] = (b - a) * (fREAL)0.5;
+  }
+  for (j = 1; j < n2; j++) {
+    L = n - j;
+    mj = j << M;
+    mL = L << M;
+    a = d1[mj] * d2[mj] - d1[mL] * d2[mL];
+    b = d1[mL] * d2[mj] + d1[mj] * d2[mL];
+    d1[mj] = (b + a) * (fREAL)0.5;
+    d1[mL] = (b - a) * (fREAL)0.5;
+    a = d1[m2 + mj] * d2[m2 + mj] - d1[m2 + mL] * d2[m2 + mL];
+    b = d1[m2 + mL] * d2[m2 + mj] + d1[m2 + mj] * d2[m2 + mL];
+    d1[m2 + mj] = (b + a) * (fREAL)0.5;
+    d1[m2 + mL] = (b - a) * (fREAL)0.5;
+  }
+  for (i = 1; i < m2; i++) {
+    k = m - i;
+    for (j = 1; j < n2; j++) {
+      L = n - j;
+      mj = j << M;
+      mL = L << M;
+      a = d1[i + mj] * d2[i + mj] - d1[k + mL] * d2[k + mL];
+      b = d1[k + mL] * d2[i + mj] + d1[i + mj] * d2[k + mL];
+      d1[i + mj] = (b + a) * (fREAL)0.5;
+      d1[k + mL] = (b - a) * (fREAL)0.5;
+      a = d1[i + mL] * d2[i + mL] - d1[k + mj] * d2[k + mj];
+      b = d1[k + mj] * d2[i + mL] + d1[i + mL] * d2[k + mj];
+      d1[i + mL] = (b + a) * (fREAL)0.5;
+      d1[k + mj] = (b - a) * (fREAL)0.5;
+    }
+  }
+}
+
+struct FFTConvolveData {
+  float *dst;
+  const float *image;
+  int image_width;
+  int image_height;
+  int kernel_width;
+  int kernel_height;
+  /** Transformed kernel of each channel. */
+  fREAL *kernel_fht;
+  unsigned int w2, h2, log2_w, log2_h;
+};
+
+/**
+ * Convolve one channel of the image in blocks that are added to the destination, the channels
+ * write to different floats of the destination so they can run in parallel.
+ */
+static void fft_convolve_channel(void *__restrict userdata,
+                                 const int ch,
+                                 const TaskParallelTLS *__restrict /*tls*/)
+{
+  const FFTConvolveData *data = (const FFTConvolveData *)userdata;
+  const unsigned int w2 = data->w2, h2 = data->h2;
+  const int image_width = data->image_width;
+  const int image_height = data->image_height;
+  const fREAL *kernel_fht = &data->kernel_fht[ch * w2 * h2];
+  fREAL *block = (fREAL *)MEM_mallocN(w2 * h2 * sizeof(fREAL), "convolve_fast FHT data2");
+
+  /* Block add-overlap. */
+  const int hw = data->kernel_width >> 1;
+  const int hh = data->kernel_height >> 1;
+  const int xbsz = (w2 + 1) - data->kernel_width;
+  const int ybsz = (h2 + 1) - data->kernel_height;
+  const int nxb = (image_width + xbsz - 1) / xbsz;
+  const int nyb = (image_height + ybsz - 1) / ybsz;
+  for (int ybl = 0; ybl < nyb; ybl++) {
+    for (int xbl = 0; xbl < nxb; xbl++) {
+      memset(block, 0, w2 * h2 * sizeof(fREAL));
+      for (int y = 0; y < ybsz; y++) {
+        const int yy = ybl * ybsz + y;
+        if (yy >= image_height) {
+          continue;
+        }
+        fREAL *fp = &block[y * w2];
+        const float *colp = &data->image[yy * image_width * 4];
+        for (int x = 0; x < xbsz; x++) {
+          const int xx = xbl * xbsz + x;
+          if (xx >= image_width) {
+            continue;
+          }
+          fp[x] = colp[xx * 4 + ch];
+        }
+      }
+
+      /* Zero pad data start is different for each == height+1. */
+      FHT2D(block, data->log2_w, data->log2_h, data->kernel_height + 1, 0);
+
+      /* FHT2D transposed data, row/col now swapped, convolve & inverse FHT. */
+      fht_convolve(block, kernel_fht, data->log2_h, data->log2_w);
+      FHT2D(block, data->log2_h, data->log2_w, 0, 1);
+      /* Data again transposed, so in order again. */
+
+      /* Overlap-add result. */
+      for (int y = 0; y < (int)h2; y++) {
+        const int yy = ybl * ybsz + y - hh;
+        if ((yy < 0) || (yy >= image_height)) {
+          continue;
+        }
+        const fREAL *fp = &block[y * w2];
+        float *colp = &data->dst[yy * image_width * 4];
+        for (int x = 0; x < (int)w2; x++) {
+          const int xx = xbl * xbsz + x - hw;
+          if ((xx < 0) || (xx >= image_width)) {
+            continue;
+          }
+          colp[xx * 4 + ch] += fp[x];
+        }
+      }
+    }
+  }
+
+  MEM_freeN(block);
+}
+
+void Convolution::convolveFFT(float *dst, MemoryBuffer *image, MemoryBuffer *kernel)
+{
+  FFTConvolveData data;
+  data.dst = dst;
+  data.image = image->getBuffer();
+  data.image_width = image->getWidth();
+  data.image_height = image->getHeight();
+  data.kernel_width = kernel->getWidth();
+  data.kernel_height = kernel->getHeight();
+  float *kernel_buffer = kernel->getBuffer();
+
+  memset(dst, 0, sizeof(float) * data.image_width * data.image_height * 4);
+
+  /* Normalize convolutor. */
+  float wt[3] = {0.0f, 0.0f, 0.0f};
+  const int kernel_len = data.kernel_width * data.kernel_height;
+  for (int i = 0; i < kernel_len; i++) {
+    add_v3_v3(wt, &kernel_buffer[i * 4]);
+  }
+  for (int ch = 0; ch < 3; ch++) {
+    if (wt[ch] != 0.0f) {
+      wt[ch] = 1.0f / wt[ch];
+    }
+  }
+  for (int i = 0; i < kernel_len; i++) {
+    mul_v3_v3(&kernel_buffer[i * 4], wt);
+  }
+
+  /* Convolution result width & height, FFT pow2 required size & log2. */
+  data.w2 = nextPow2(2 * data.kernel_width - 1, &data.log2_w);
+  data.h2 = nextPow2(2 * data.kernel_height - 1, &data.log2_h);
+
+  /* The kernel is transformed once, and used for every block. */
+  const unsigned int size = data.w2 * data.h2;
+  data.kernel_fht = (fREAL *)MEM_callocN(3 * size * sizeof(fREAL), "convolve_fast FHT data1");
+  for (int ch = 0; ch < 3; ch++) {
+    fREAL *kernel_fht = &data.kernel_fht[ch * size];
+    for (int y = 0; y < data.kernel_height; y++) {
+      fREAL *fp = &kernel_fht[y * data.w2];
+      const float *colp = &kernel_buffer[y * data.kernel_width * 4];
+      for (int x = 0; x < data.kernel_width; x++) {
+        fp[x] = colp[x * 4 + ch];
+      }
+    }
+    FHT2D(kernel_fht, data.log2_w, data.log2_h, data.kernel_height + 1, 0);
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, 3, &data, fft_convolve_channel, &settings);
+
+  MEM_freeN(data.kernel_fht);
+}
+
+/** \} */
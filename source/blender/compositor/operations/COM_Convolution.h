@@ -0,0 +1,77 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+#pragma once
+
+#include "DNA_vec_types.h"
+
+class MemoryBuffer;
+
+/**
+ * \brief Convolution kernels shared by the blur and glare operations.
+ *
+ * - Separable passes convolve the rows or columns of a color buffer with a symmetric kernel,
+ *   one whole row at a time so the inner loops are SIMD multiply-adds over contiguous memory.
+ * - The recursive (IIR) gaussian costs the same for every sigma, for large radii.
+ * - The FFT convolution applies big non-separable kernels.
+ *
+ * The recursive gaussian and FFT convolution are multi-threaded over lines and channels, the
+ * separable passes write an area so callers can split the work.
+ */
+class Convolution {
+ public:
+  /**
+   * \brief convolve the rows of \a input with \a kernel, writing \a area of \a output
+   *
+   * \a kernel has `2 * radius + 1` weights centered on the pixel. Weights of pixels outside of
+   * \a input are left out, the result is normalized by the sum of the used weights.
+   * Both buffers have 4 channels and the same rect.
+   */
+  static void convolveRows(MemoryBuffer *output,
+                           MemoryBuffer *input,
+                           const rcti *area,
+                           const float *kernel,
+                           int radius);
+
+  /**
+   * \brief convolve the columns of \a input with \a kernel, writing \a area of \a output
+   * \see convolveRows
+   */
+  static void convolveColumns(MemoryBuffer *output,
+                              MemoryBuffer *input,
+                              const rcti *area,
+                              const float *kernel,
+                              int radius);
+
+  /**
+   * \brief recursive gaussian blur of \a channel of \a buffer, in place
+   * \param xy: 1 to blur horizontally, 2 vertically and 3 in both directions
+   */
+  static void gaussianIIR(MemoryBuffer *buffer,
+                          float sigma,
+                          unsigned int channel,
+                          unsigned int xy);
+
+  /**
+   * \brief convolve the RGB channels of \a image with \a kernel, writing them to \a dst
+   *
+   * Uses the fast Hartley transform on blocks of the image which are added together, the kernel
+   * is normalized in place. \a dst has 4 channels and the size of \a image.
+   */
+  static void convolveFFT(float *dst, MemoryBuffer *image, MemoryBuffer *kernel);
+};
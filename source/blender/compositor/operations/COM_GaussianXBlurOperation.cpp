@@ -18,6 +18,7 @@
 
 #include "COM_GaussianXBlurOperation.h"
 #include "BLI_math.h"
+#include "COM_Convolution.h"
 #include "COM_OpenCLDevice.h"
 #include "MEM_guardedalloc.h"
 
@@ -30,6 +31,7 @@ GaussianXBlurOperation::GaussianXBlurOperation() : BlurBaseOperation(COM_DT_COLO
   this->m_gausstab_sse = nullptr;
 #endif
   this->m_filtersize = 0;
+  this->setFullFrameOperation(true);
 }
 
 void *GaussianXBlurOperation::initializeTileData(rcti * /*rect*/)
@@ -117,6 +119,27 @@ void GaussianXBlurOperation::executePixel(float output[4], int x, int y, void *d
   mul_v4_v4fl(output, color_accum, 1.0f / multiplier_accum);
 }
 
+void GaussianXBlurOperation::executeArea(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs)
+{
+  lockMutex();
+  if (!this->m_sizeavailable) {
+    updateGauss();
+  }
+  unlockMutex();
+
+  if (getStep() == 1) {
+    Convolution::convolveRows(output, inputs[0], area, this->m_gausstab, this->m_filtersize);
+    return;
+  }
+
+  /* Lower quality skips taps depending on the pixel position. */
+  for (int y = area->ymin; y < area->ymax; y++) {
+    for (int x = area->xmin; x < area->xmax; x++) {
+      executePixel(output->getElem(x, y), x, y, inputs[0]);
+    }
+  }
+}
+
 void GaussianXBlurOperation::executeOpenCL(OpenCLDevice *device,
                                            MemoryBuffer *outputMemoryBuffer,
                                            cl_mem clOutputBuffer,
@@ -37,6 +37,7 @@ class GaussianXBlurOperation : public BlurBaseOperation {
    * \brief the inner loop of this program
    */
   void executePixel(float output[4], int x, int y, void *data);
+  void executeArea(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 
   void executeOpenCL(OpenCLDevice *device,
                      MemoryBuffer *outputMemoryBuffer,
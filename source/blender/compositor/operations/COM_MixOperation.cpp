@@ -20,6 +20,8 @@
 
 #include "BLI_math.h"
 
+#include "MEM_guardedalloc.h"
+
 /* ******** Mix Base Operation ******** */
 
 MixBaseOperation::MixBaseOperation()
@@ -95,11 +97,27 @@ void MixBaseOperation::deinitExecution()
   this->m_inputColor2Operation = nullptr;
 }
 
+void MixBaseOperation::executeArea(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs)
+{
+  const int width = BLI_rcti_size_x(area);
+  float *temp = (float *)MEM_mallocN(sizeof(float) * 6 * width, __func__);
+  float *temp_value = temp;
+  float *temp_color1 = temp + width;
+  float *temp_color2 = temp + width * 5;
+  for (int y = area->ymin; y < area->ymax; y++) {
+    const float *value = inputs[0]->getRow(y, area->xmin, area->xmax, temp_value);
+    const float *color1 = inputs[1]->getRow(y, area->xmin, area->xmax, temp_color1);
+    const float *color2 = inputs[2]->getRow(y, area->xmin, area->xmax, temp_color2);
+    mixRow(output->getElem(area->xmin, y), value, color1, color2, width);
+  }
+  MEM_freeN(temp);
+}
+
 /* ******** Mix Add Operation ******** */
 
 MixAddOperation::MixAddOperation()
 {
-  /* pass */
+  this->setFullFrameOperation(true);
 }
 
 void MixAddOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -124,11 +142,28 @@ void MixAddOperation::executePixelSampled(float output[4], float x, float y, Pix
   clampIfNeeded(output);
 }
 
+void MixAddOperation::mixRow(
+    float *output, const float *values, const float *color1, const float *color2, int len)
+{
+  for (int i = 0; i < len; i++, output += 4, color1 += 4, color2 += 4) {
+    float value = values[i];
+    if (this->useValueAlphaMultiply()) {
+      value *= color2[3];
+    }
+    output[0] = color1[0] + value * color2[0];
+    output[1] = color1[1] + value * color2[1];
+    output[2] = color1[2] + value * color2[2];
+    output[3] = color1[3];
+
+    clampIfNeeded(output);
+  }
+}
+
 /* ******** Mix Blend Operation ******** */
 
 MixBlendOperation::MixBlendOperation()
 {
-  /* pass */
+  this->setFullFrameOperation(true);
 }
 
 void MixBlendOperation::executePixelSampled(float output[4],
@@ -158,6 +193,24 @@ void MixBlendOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MixBlendOperation::mixRow(
+    float *output, const float *values, const float *color1, const float *color2, int len)
+{
+  for (int i = 0; i < len; i++, output += 4, color1 += 4, color2 += 4) {
+    float value = values[i];
+    if (this->useValueAlphaMultiply()) {
+      value *= color2[3];
+    }
+    float valuem = 1.0f - value;
+    output[0] = valuem * (color1[0]) + value * (color2[0]);
+    output[1] = valuem * (color1[1]) + value * (color2[1]);
+    output[2] = valuem * (color1[2]) + value * (color2[2]);
+    output[3] = color1[3];
+
+    clampIfNeeded(output);
+  }
+}
+
 /* ******** Mix Burn Operation ******** */
 
 MixColorBurnOperation::MixColorBurnOperation()
@@ -676,7 +729,7 @@ void MixLinearLightOperation::executePixelSampled(float output[4],
 
 MixMultiplyOperation::MixMultiplyOperation()
 {
-  /* pass */
+  this->setFullFrameOperation(true);
 }
 
 void MixMultiplyOperation::executePixelSampled(float output[4],
@@ -705,6 +758,24 @@ void MixMultiplyOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MixMultiplyOperation::mixRow(
+    float *output, const float *values, const float *color1, const float *color2, int len)
+{
+  for (int i = 0; i < len; i++, output += 4, color1 += 4, color2 += 4) {
+    float value = values[i];
+    if (this->useValueAlphaMultiply()) {
+      value *= color2[3];
+    }
+    float valuem = 1.0f - value;
+    output[0] = color1[0] * (valuem + value * color2[0]);
+    output[1] = color1[1] * (valuem + value * color2[1]);
+    output[2] = color1[2] * (valuem + value * color2[2]);
+    output[3] = color1[3];
+
+    clampIfNeeded(output);
+  }
+}
+
 /* ******** Mix Ovelray Operation ******** */
 
 MixOverlayOperation::MixOverlayOperation()
@@ -881,7 +952,7 @@ void MixSoftLightOperation::executePixelSampled(float output[4],
 
 MixSubtractOperation::MixSubtractOperation()
 {
-  /* pass */
+  this->setFullFrameOperation(true);
 }
 
 void MixSubtractOperation::executePixelSampled(float output[4],
@@ -909,6 +980,23 @@ void MixSubtractOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MixSubtractOperation::mixRow(
+    float *output, const float *values, const float *color1, const float *color2, int len)
+{
+  for (int i = 0; i < len; i++, output += 4, color1 += 4, color2 += 4) {
+    float value = values[i];
+    if (this->useValueAlphaMultiply()) {
+      value *= color2[3];
+    }
+    output[0] = color1[0] - value * (color2[0]);
+    output[1] = color1[1] - value * (color2[1]);
+    output[2] = color1[2] - value * (color2[2]);
+    output[3] = color1[3];
+
+    clampIfNeeded(output);
+  }
+}
+
 /* ******** Mix Value Operation ******** */
 
 MixValueOperation::MixValueOperation()
@@ -43,6 +43,18 @@ class MixBaseOperation : public NodeOperation {
     }
   }
 
+  /**
+   * Mix \a len pixels of the inputs for #executeArea,
+   * only used when the operation is a full-frame operation.
+   */
+  virtual void mixRow(float * /*output*/,
+                      const float * /*value*/,
+                      const float * /*color1*/,
+                      const float * /*color2*/,
+                      int /*len*/)
+  {
+  }
+
  public:
   /**
    * Default constructor
@@ -66,6 +78,8 @@ class MixBaseOperation : public NodeOperation {
 
   void determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2]);
 
+  void executeArea(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
+
   void setUseValueAlphaMultiply(const bool value)
   {
     this->m_valueAlphaMultiply = value;
@@ -84,12 +98,20 @@ class MixAddOperation : public MixBaseOperation {
  public:
   MixAddOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+ protected:
+  void mixRow(
+      float *output, const float *value, const float *color1, const float *color2, int len);
 };
 
 class MixBlendOperation : public MixBaseOperation {
  public:
   MixBlendOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+ protected:
+  void mixRow(
+      float *output, const float *value, const float *color1, const float *color2, int len);
 };
 
 class MixColorBurnOperation : public MixBaseOperation {
@@ -156,6 +178,10 @@ class MixMultiplyOperation : public MixBaseOperation {
  public:
   MixMultiplyOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+ protected:
+  void mixRow(
+      float *output, const float *value, const float *color1, const float *color2, int len);
 };
 
 class MixOverlayOperation : public MixBaseOperation {
@@ -186,6 +212,10 @@ class MixSubtractOperation : public MixBaseOperation {
  public:
   MixSubtractOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+ protected:
+  void mixRow(
+      float *output, const float *value, const float *color1, const float *color2, int len);
 };
 
 class MixValueOperation : public MixBaseOperation {
@@ -23,6 +23,7 @@
 ReadBufferOperation::ReadBufferOperation(DataType datatype)
 {
   this->addOutputSocket(datatype);
+  this->m_memoryProxy = nullptr;
   this->m_single_value = false;
   this->m_offset = 0;
   this->m_buffer = nullptr;
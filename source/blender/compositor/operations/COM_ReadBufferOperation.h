@@ -71,4 +71,15 @@ class ReadBufferOperation : public NodeOperation {
   }
   void readResolutionFromWriteBuffer();
   void updateMemoryBuffer();
+
+  /**
+   * \brief read from \a buffer directly instead of the buffer of a memory proxy
+   * \param single_value: the buffer holds a single value at (0,0) to use for all pixels.
+   * \see FullFrameExecutionModel
+   */
+  void setMemoryBuffer(MemoryBuffer *buffer, bool single_value)
+  {
+    this->m_buffer = buffer;
+    this->m_single_value = single_value;
+  }
 };
@@ -21,6 +21,7 @@
 SetColorOperation::SetColorOperation()
 {
   this->addOutputSocket(COM_DT_COLOR);
+  this->setFullFrameOperation(true);
 }
 
 void SetColorOperation::executePixelSampled(float output[4],
@@ -31,6 +32,11 @@ void SetColorOperation::executePixelSampled(float output[4],
   copy_v4_v4(output, this->m_color);
 }
 
+void SetColorOperation::executeArea(MemoryBuffer *output, rcti *area, MemoryBuffer ** /*inputs*/)
+{
+  output->fill(area, this->m_color);
+}
+
 void SetColorOperation::determineResolution(unsigned int resolution[2],
                                             unsigned int preferredResolution[2])
 {
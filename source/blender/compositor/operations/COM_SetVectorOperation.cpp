@@ -22,6 +22,7 @@
 SetVectorOperation::SetVectorOperation()
 {
   this->addOutputSocket(COM_DT_VECTOR);
+  this->setFullFrameOperation(true);
 }
 
 void SetVectorOperation::executePixelSampled(float output[4],
@@ -34,6 +35,12 @@ void SetVectorOperation::executePixelSampled(float output[4],
   output[2] = this->m_z;
 }
 
+void SetVectorOperation::executeArea(MemoryBuffer *output, rcti *area, MemoryBuffer ** /*inputs*/)
+{
+  const float vector[3] = {this->m_x, this->m_y, this->m_z};
+  output->fill(area, vector);
+}
+
 void SetVectorOperation::determineResolution(unsigned int resolution[2],
                                              unsigned int preferredResolution[2])
 {
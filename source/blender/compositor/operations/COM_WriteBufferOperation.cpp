@@ -47,7 +47,9 @@ void WriteBufferOperation::executePixelSampled(float output[4],
 void WriteBufferOperation::initExecution()
 {
   this->m_input = this->getInputOperation(0);
-  this->m_memoryProxy->allocate(this->m_width, this->m_height);
+  const bNodeTree *ntree = this->getbNodeTree();
+  this->m_memoryProxy->allocate(
+      this->m_width, this->m_height, (size_t)ntree->buffer_limit * 1024 * 1024, ntree->buffer_dir);
 }
 
 void WriteBufferOperation::deinitExecution()
@@ -72,6 +72,17 @@ void DepsgraphDebug::end_graph_evaluation()
   is_ever_evaluated = true;
 }
 
+DepsgraphTrace *DepsgraphDebug::ensure_trace()
+{
+  if (!DepsgraphTrace::is_enabled()) {
+    return nullptr;
+  }
+  if (!trace_) {
+    trace_ = std::make_unique<DepsgraphTrace>(name);
+  }
+  return trace_.get();
+}
+
 bool terminal_do_color()
 {
   return (G.debug & G_DEBUG_DEPSGRAPH_PRETTY) != 0;
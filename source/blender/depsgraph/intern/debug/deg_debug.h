@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include "intern/debug/deg_debug_trace.h"
 #include "intern/debug/deg_time_average.h"
 #include "intern/depsgraph_type.h"
 
@@ -42,6 +43,9 @@ class DepsgraphDebug {
   void begin_graph_evaluation();
   void end_graph_evaluation();
 
+  /* Trace of the evaluations, created once tracing is enabled. Null when tracing is disabled. */
+  DepsgraphTrace *ensure_trace();
+
   /* NOTE: Corresponds to G_DEBUG_DEPSGRAPH_* flags. */
   int flags;
 
@@ -63,6 +67,8 @@ class DepsgraphDebug {
   double graph_evaluation_start_time_;
 
   AveragedTimeSampler<MAX_FPS_COUNTERS> fps_samples_;
+
+  unique_ptr<DepsgraphTrace> trace_;
 };
 
 #define DEG_DEBUG_PRINTF(depsgraph, type, ...) \
@@ -0,0 +1,210 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/debug/deg_debug_trace.h"
+
+#include "BLI_fileops.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_appdir.h"
+#include "BKE_global.h"
+
+#include "PIL_time.h"
+
+#include "atomic_ops.h"
+
+#include "intern/node/deg_node.h"
+#include "intern/node/deg_node_component.h"
+#include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
+
+namespace blender::deg {
+
+static int32_t trace_file_index = 0;
+
+static string json_escape(const string &str)
+{
+  string result;
+  for (const char ch : str) {
+    const unsigned char c = (unsigned char)ch;
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += ch;
+    }
+    else if (c < 0x20) {
+      char buffer[8];
+      BLI_snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+      result += buffer;
+    }
+    else {
+      result += ch;
+    }
+  }
+  return result;
+}
+
+DepsgraphTrace::DepsgraphTrace(const string &name)
+    : name_(name),
+      file_(nullptr),
+      start_time_(PIL_check_seconds_timer()),
+      evaluation_start_time_(0.0),
+      evaluation_frame_(0.0f),
+      num_evaluations_(0),
+      thread_events_(BLENDER_MAX_THREADS),
+      thread_named_(BLENDER_MAX_THREADS, false)
+{
+  char basename[64], filename[FILE_MAX];
+  BLI_snprintf(basename,
+               sizeof(basename),
+               "depsgraph_trace_%d.json",
+               atomic_fetch_and_add_int32(&trace_file_index, 1));
+  BLI_join_dirfile(filename, sizeof(filename), BKE_tempdir_session(), basename);
+
+  file_ = BLI_fopen(filename, "wb");
+  if (file_ == nullptr) {
+    fprintf(stderr, "Depsgraph trace: could not write to %s\n", filename);
+    return;
+  }
+  printf("Depsgraph trace: writing %s\n", filename);
+
+  /* The JSON array format, which allows leaving out the closing bracket when Blender exits
+   * without freeing the dependency graph. */
+  fprintf(file_,
+          "[\n{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+          "\"args\": {\"name\": \"Depsgraph %s\"}},\n"
+          "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, "
+          "\"args\": {\"name\": \"Evaluation\"}}",
+          json_escape(name_).c_str());
+}
+
+DepsgraphTrace::~DepsgraphTrace()
+{
+  if (file_ != nullptr) {
+    fprintf(file_, "\n]\n");
+    fclose(file_);
+  }
+}
+
+bool DepsgraphTrace::is_enabled()
+{
+  return (G.debug & G_DEBUG_DEPSGRAPH_TRACE) != 0;
+}
+
+void DepsgraphTrace::begin_evaluation(float frame)
+{
+  evaluation_frame_ = frame;
+  evaluation_start_time_ = PIL_check_seconds_timer();
+}
+
+void DepsgraphTrace::end_evaluation()
+{
+  const double end_time = PIL_check_seconds_timer();
+
+  if (file_ == nullptr) {
+    return;
+  }
+
+  /* Written after the evaluation, while the nodes of the events still exist. */
+  fprintf(file_,
+          ",\n{\"name\": \"Frame %g\", \"cat\": \"evaluation\", \"ph\": \"X\", \"pid\": 1, "
+          "\"tid\": 0, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"frame\": %g, \"index\": %d}}",
+          evaluation_frame_,
+          (evaluation_start_time_ - start_time_) * 1e6,
+          (end_time - evaluation_start_time_) * 1e6,
+          evaluation_frame_,
+          num_evaluations_++);
+
+  for (int thread = 0; thread < thread_events_.size(); thread++) {
+    Vector<Event> &events = thread_events_[thread];
+    if (events.is_empty()) {
+      continue;
+    }
+    if (!thread_named_[thread]) {
+      fprintf(file_,
+              ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+              "\"args\": {\"name\": \"Thread %d\"}}",
+              thread + 1,
+              thread + 1);
+      thread_named_[thread] = true;
+    }
+    for (const Event &event : events) {
+      write_event(event, thread);
+    }
+    events.clear();
+  }
+  fflush(file_);
+}
+
+void DepsgraphTrace::operation_evaluated(const OperationNode *operation_node,
+                                         double start_time,
+                                         double end_time)
+{
+  const int thread = BLI_task_parallel_thread_id(nullptr);
+  thread_events_[thread].append({operation_node, start_time, end_time});
+}
+
+void DepsgraphTrace::copy_on_write_updated(const IDNode *id_node,
+                                           double start_time,
+                                           double end_time)
+{
+  const int thread = BLI_task_parallel_thread_id(nullptr);
+  thread_events_[thread].append({id_node, start_time, end_time});
+}
+
+void DepsgraphTrace::write_event(const Event &event, int thread)
+{
+  string name, id_name;
+  const char *category;
+
+  if (event.node->type == NodeType::OPERATION) {
+    const OperationNode *operation_node = (const OperationNode *)event.node;
+    const ComponentNode *component_node = operation_node->owner;
+    name = operation_node->full_identifier();
+    id_name = component_node->owner->name;
+    category = (component_node->type == NodeType::COPY_ON_WRITE) ?
+                   "copy_on_write" :
+                   nodeTypeAsString(component_node->type);
+  }
+  else {
+    const IDNode *id_node = (const IDNode *)event.node;
+    name = id_node->name + "/COPY_ON_WRITE";
+    id_name = id_node->name;
+    category = "copy_on_write";
+  }
+
+  fprintf(file_,
+          ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+          "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"id\": \"%s\", \"frame\": %g}}",
+          json_escape(name).c_str(),
+          category,
+          thread + 1,
+          (event.start_time - start_time_) * 1e6,
+          (event.end_time - event.start_time) * 1e6,
+          json_escape(id_name).c_str(),
+          evaluation_frame_);
+}
+
+}  // namespace blender::deg
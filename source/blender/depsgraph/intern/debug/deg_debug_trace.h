@@ -0,0 +1,85 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include "BLI_array.hh"
+
+#include "intern/depsgraph_type.h"
+
+namespace blender {
+namespace deg {
+
+struct IDNode;
+struct Node;
+struct OperationNode;
+
+/* Timeline of the evaluations of a dependency graph, enabled by `--debug-depsgraph-trace`.
+ *
+ * Records which thread evaluated every operation and when, including copy-on-write updates, for
+ * every evaluation together with the frame it was evaluated at. After every evaluation its
+ * events are appended to `depsgraph_trace_N.json` in the temporary directory, which can be
+ * opened with `chrome://tracing` or Perfetto. */
+class DepsgraphTrace {
+ public:
+  DepsgraphTrace(const string &name);
+  ~DepsgraphTrace();
+
+  static bool is_enabled();
+
+  void begin_evaluation(float frame);
+  void end_evaluation();
+
+  /* Thread safe, every thread records its events separately. */
+  void operation_evaluated(const OperationNode *operation_node,
+                           double start_time,
+                           double end_time);
+  void copy_on_write_updated(const IDNode *id_node, double start_time, double end_time);
+
+ protected:
+  struct Event {
+    const Node *node;
+    double start_time;
+    double end_time;
+  };
+
+  void write_event(const Event &event, int thread);
+
+  string name_;
+  FILE *file_;
+  /* Timestamps of the trace are relative to this time. */
+  double start_time_;
+
+  double evaluation_start_time_;
+  float evaluation_frame_;
+  int num_evaluations_;
+
+  /* Events of the current evaluation, indexed by thread. */
+  Array<Vector<Event>> thread_events_;
+  /* Threads named in the trace already. */
+  Array<bool> thread_named_;
+};
+
+}  // namespace deg
+}  // namespace blender
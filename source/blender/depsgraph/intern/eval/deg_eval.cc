@@ -29,7 +29,9 @@
 
 #include "BLI_compiler_attrs.h"
 #include "BLI_gsqueue.h"
+#include "BLI_heap.h"
 #include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_global.h"
@@ -68,11 +70,6 @@ void schedule_children(DepsgraphEvalState *state,
                        ScheduleFunction *schedule_function,
                        ScheduleFunctionArgs... schedule_function_args);
 
-void schedule_node_to_pool(OperationNode *node, const int UNUSED(thread_id), TaskPool *pool)
-{
-  BLI_task_pool_push(pool, deg_task_run_func, node, false, nullptr);
-}
-
 /* Denotes which part of dependency graph is being evaluated. */
 enum class EvaluationStage {
   /* Stage 1: Only  Copy-on-Write operations are to be evaluated, prior to anything else.
@@ -93,41 +90,138 @@ enum class EvaluationStage {
 struct DepsgraphEvalState {
   Depsgraph *graph;
   bool do_stats;
+  /* Timeline of the evaluation, null unless tracing is enabled. */
+  DepsgraphTrace *trace;
   EvaluationStage stage;
   bool need_single_thread_pass;
+
+  /* Operations ready for evaluation, ordered by the estimated time of their critical path.
+   * Every task pushed to the pool evaluates the longest one available at that moment. */
+  Heap *ready_operations;
+  SpinLock ready_operations_lock;
+};
+
+/* Operations estimated to be cheaper than this are evaluated by the task which made them ready,
+ * instead of paying the overhead of a task of their own. */
+constexpr float CHEAP_OPERATION_TIME = 5e-6f;
+/* Limit of the estimated time of cheap operations evaluated by a single task, so a lot of them
+ * becoming ready at once still spread over all threads. */
+constexpr float MAX_BATCH_TIME = 50e-6f;
+
+/* Cheap operations evaluated by the current task after the operation it was pushed for. */
+struct EvaluationBatch {
+  TaskPool *pool;
+  Vector<OperationNode *, 16> operations;
+  float time;
 };
 
+/* Used for operations which were never measured. Evaluation of geometry, simulations and IK
+ * solvers is expected to dominate over the rest. */
+float operation_default_time(const OperationNode *operation_node)
+{
+  switch (operation_node->opcode) {
+    case OperationCode::GEOMETRY_EVAL:
+    case OperationCode::PARTICLE_SYSTEM_EVAL:
+    case OperationCode::RIGIDBODY_SIM:
+    case OperationCode::POSE_IK_SOLVER:
+    case OperationCode::POSE_SPLINE_IK_SOLVER:
+    case OperationCode::SIMULATION_EVAL:
+      return 1e-3f;
+    case OperationCode::ANIMATION_EVAL:
+    case OperationCode::DRIVER:
+    case OperationCode::BONE_CONSTRAINTS:
+    case OperationCode::TRANSFORM_CONSTRAINTS:
+      return 2e-5f;
+    default:
+      return CHEAP_OPERATION_TIME;
+  }
+}
+
+float operation_estimated_time(const OperationNode *operation_node)
+{
+  if (operation_node->is_noop()) {
+    return 0.0f;
+  }
+  if (operation_node->estimated_time < 0.0f) {
+    return operation_default_time(operation_node);
+  }
+  return operation_node->estimated_time;
+}
+
+void schedule_node_to_pool(OperationNode *node, const int UNUSED(thread_id), TaskPool *pool)
+{
+  DepsgraphEvalState *state = (DepsgraphEvalState *)BLI_task_pool_user_data(pool);
+
+  BLI_spin_lock(&state->ready_operations_lock);
+  BLI_heap_insert(state->ready_operations, -node->critical_path_time, node);
+  BLI_spin_unlock(&state->ready_operations_lock);
+
+  BLI_task_pool_push(pool, deg_task_run_func, nullptr, false, nullptr);
+}
+
+void schedule_node_to_batch(OperationNode *node, const int thread_id, EvaluationBatch *batch)
+{
+  const float time = operation_estimated_time(node);
+  if (time < CHEAP_OPERATION_TIME && batch->time + time < MAX_BATCH_TIME) {
+    batch->operations.append(node);
+    batch->time += time;
+    return;
+  }
+  schedule_node_to_pool(node, thread_id, batch->pool);
+}
+
 void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_node)
 {
   ::Depsgraph *depsgraph = reinterpret_cast<::Depsgraph *>(state->graph);
 
   /* Sanity checks. */
   BLI_assert(!operation_node->is_noop() && "NOOP nodes should not actually be scheduled");
-  /* Perform operation. */
-  if (state->do_stats) {
-    const double start_time = PIL_check_seconds_timer();
-    operation_node->evaluate(depsgraph);
-    operation_node->stats.current_time += PIL_check_seconds_timer() - start_time;
-  }
-  else {
-    operation_node->evaluate(depsgraph);
+  /* Perform operation. Timing is always gathered, it costs next to nothing compared to the
+   * evaluation of an operation. */
+  const double start_time = PIL_check_seconds_timer();
+  operation_node->evaluate(depsgraph);
+  const double end_time = PIL_check_seconds_timer();
+
+  const float time = (float)(end_time - start_time);
+  operation_node->stats.current_time += time;
+  /* Exponential moving average, follows changes of the scene within a few frames. */
+  operation_node->estimated_time = (operation_node->estimated_time < 0.0f) ?
+                                       time :
+                                       operation_node->estimated_time * 0.75f + time * 0.25f;
+
+  if (state->trace != nullptr) {
+    state->trace->operation_evaluated(operation_node, start_time, end_time);
   }
 }
 
-void deg_task_run_func(TaskPool *pool, void *taskdata)
+void deg_task_run_func(TaskPool *pool, void *UNUSED(taskdata))
 {
   void *userdata_v = BLI_task_pool_user_data(pool);
   DepsgraphEvalState *state = (DepsgraphEvalState *)userdata_v;
 
-  /* Evaluate node. */
-  OperationNode *operation_node = reinterpret_cast<OperationNode *>(taskdata);
-  evaluate_node(state, operation_node);
+  /* Every task has an operation pushed for it, but not necessarily the one it evaluates. */
+  BLI_spin_lock(&state->ready_operations_lock);
+  OperationNode *operation_node = (OperationNode *)BLI_heap_pop_min(state->ready_operations);
+  BLI_spin_unlock(&state->ready_operations_lock);
+  BLI_assert(operation_node != nullptr);
+
+  EvaluationBatch batch;
+  batch.pool = pool;
+  batch.time = 0.0f;
+  batch.operations.append(operation_node);
 
-  /* Schedule children. */
-  schedule_children(state, operation_node, schedule_node_to_pool, pool);
+  while (!batch.operations.is_empty()) {
+    operation_node = batch.operations.pop_last();
+
+    /* Evaluate node. */
+    evaluate_node(state, operation_node);
+
+    /* Schedule children. */
+    schedule_children(state, operation_node, schedule_node_to_batch, &batch);
+  }
 }
 
-bool check_operation_node_visible(OperationNode *op_node)
+bool check_operation_node_visible(const OperationNode *op_node)
 {
   const ComponentNode *comp_node = op_node->owner;
   /* Special exception, copy on write component is to be always evaluated,
@@ -177,15 +271,62 @@ void calculate_pending_parents(Depsgraph *graph)
   }
 }
 
-void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
+bool is_operation_node_pending(const OperationNode *node)
+{
+  return check_operation_node_visible(node) && (node->flag & DEPSOP_FLAG_NEEDS_UPDATE);
+}
+
+/* Calculate the critical path time of all operations which are to be evaluated, the same
+ * relations as for the pending parents are followed. Uses custom_flags as the number of parents
+ * not visited yet. */
+void calculate_critical_path_times(Depsgraph *graph)
+{
+  Vector<OperationNode *> order;
+
+  for (OperationNode *node : graph->operations) {
+    node->custom_flags = node->num_links_pending;
+    if (node->num_links_pending == 0 && is_operation_node_pending(node)) {
+      order.append(node);
+    }
+  }
+  /* Topological order of the pending operations, cyclic relations are ignored so the relations
+   * form an acyclic graph. */
+  for (int64_t i = 0; i < order.size(); i++) {
+    for (Relation *rel : order[i]->outlinks) {
+      if ((rel->flag & RELATION_FLAG_CYCLIC) != 0) {
+        continue;
+      }
+      OperationNode *child = (OperationNode *)rel->to;
+      if (!is_operation_node_pending(child)) {
+        continue;
+      }
+      BLI_assert(child->custom_flags > 0);
+      if (--child->custom_flags == 0) {
+        order.append(child);
+      }
+    }
+  }
+  /* Children come before their parents in reverse order. */
+  for (int64_t i = order.size() - 1; i >= 0; i--) {
+    OperationNode *node = order[i];
+    float children_time = 0.0f;
+    for (Relation *rel : node->outlinks) {
+      OperationNode *child = (OperationNode *)rel->to;
+      if ((rel->flag & RELATION_FLAG_CYCLIC) == 0 && is_operation_node_pending(child)) {
+        children_time = max(children_time, child->critical_path_time);
+      }
+    }
+    node->critical_path_time = operation_estimated_time(node) + children_time;
+  }
+}
+
+void initialize_execution(DepsgraphEvalState *UNUSED(state), Depsgraph *graph)
 {
-  const bool do_stats = state->do_stats;
   calculate_pending_parents(graph);
+  calculate_critical_path_times(graph);
   /* Clear tags and other things which needs to be clear. */
   for (OperationNode *node : graph->operations) {
-    if (do_stats) {
-      node->stats.reset_current();
-    }
+    node->stats.reset_current();
   }
 }
 
@@ -329,7 +470,7 @@ void evaluate_graph_single_threaded(DepsgraphEvalState *state)
   BLI_gsqueue_free(evaluation_queue);
 }
 
-void depsgraph_ensure_view_layer(Depsgraph *graph)
+void depsgraph_ensure_view_layer(Depsgraph *graph, DepsgraphTrace *trace)
 {
   /* We update copy-on-write scene in the following cases:
    * - It was not expanded yet.
@@ -342,7 +483,11 @@ void depsgraph_ensure_view_layer(Depsgraph *graph)
   }
 
   const IDNode *scene_id_node = graph->find_id_node(&graph->scene->id);
+  const double start_time = PIL_check_seconds_timer();
   deg_update_copy_on_write_datablock(graph, scene_id_node);
+  if (trace != nullptr) {
+    trace->copy_on_write_updated(scene_id_node, start_time, PIL_check_seconds_timer());
+  }
 }
 
 }  // namespace
@@ -371,14 +516,21 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   }
 
   graph->debug.begin_graph_evaluation();
+  DepsgraphTrace *trace = graph->debug.ensure_trace();
+  if (trace != nullptr) {
+    trace->begin_evaluation(graph->ctime);
+  }
 
   graph->is_evaluating = true;
-  depsgraph_ensure_view_layer(graph);
+  depsgraph_ensure_view_layer(graph, trace);
   /* Set up evaluation state. */
   DepsgraphEvalState state;
   state.graph = graph;
   state.do_stats = graph->debug.do_time_debug();
+  state.trace = trace;
   state.need_single_thread_pass = false;
+  state.ready_operations = BLI_heap_new();
+  BLI_spin_init(&state.ready_operations_lock);
   /* Prepare all nodes for evaluation. */
   initialize_execution(&state, graph);
 
@@ -402,6 +554,9 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
     evaluate_graph_single_threaded(&state);
   }
 
+  BLI_heap_free(state.ready_operations, nullptr);
+  BLI_spin_end(&state.ready_operations_lock);
+
   /* Finalize statistics gathering. This is because we only gather single
    * operation timing here, without aggregating anything to avoid any extra
    * synchronization. */
@@ -412,6 +567,9 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   deg_graph_clear_tags(graph);
   graph->is_evaluating = false;
 
+  if (trace != nullptr) {
+    trace->end_evaluation();
+  }
   graph->debug.end_graph_evaluation();
 }
 
@@ -283,8 +283,9 @@ struct ValidateData {
 };
 
 /* Similar to generic BKE_id_copy() but does not require main and assumes pointer
- * is already allocated. */
-bool id_copy_inplace_no_main(const ID *id, ID *newid)
+ * is already allocated.
+ * The flag can request additional ID type specific copy options. */
+bool id_copy_inplace_no_main(const ID *id, ID *newid, const int flag = 0)
 {
   const ID *id_for_copy = id;
 
@@ -304,7 +305,8 @@ bool id_copy_inplace_no_main(const ID *id, ID *newid)
   bool result = (BKE_id_copy_ex(nullptr,
                                 (ID *)id_for_copy,
                                 &newid,
-                                LIB_ID_COPY_LOCALIZE | LIB_ID_CREATE_NO_ALLOCATE) != nullptr);
+                                LIB_ID_COPY_LOCALIZE | LIB_ID_CREATE_NO_ALLOCATE | flag) !=
+                 nullptr);
 
 #ifdef NESTED_ID_NASTY_WORKAROUND
   if (result) {
@@ -863,8 +865,6 @@ ID *deg_expand_copy_on_write_datablock(const Depsgraph *depsgraph,
   }
   // BLI_assert(check_datablock_expanded(id_cow) == false);
   /* Copy data from original ID to a copied version. */
-  /* TODO(sergey): Avoid doing full ID copy somehow, make Mesh to reference
-   * original geometry arrays for until those are modified. */
   /* TODO(sergey): We do some trickery with temp bmain and extra ID pointer
    * just to be able to use existing API. Ideally we need to replace this with
    * in-place copy from existing datablock to a prepared memory.
@@ -888,8 +888,12 @@ ID *deg_expand_copy_on_write_datablock(const Depsgraph *depsgraph,
       break;
     }
     case ID_ME: {
-      /* TODO(sergey): Ideally we want to handle meshes in a special
-       * manner here to avoid initial copy of all the geometry arrays. */
+      /* Share the geometry arrays with the original mesh instead of copying them, evaluation
+       * duplicates the layers it writes to. Render dependency graphs are evaluated and used in
+       * other threads than the one editing the original, they keep their own copy. */
+      if (depsgraph->mode == DAG_EVAL_VIEWPORT) {
+        done = id_copy_inplace_no_main(id_orig, id_cow, LIB_ID_COPY_CD_SHARE);
+      }
       break;
     }
     default:
@@ -266,6 +266,14 @@ struct OperationNode : public Node {
   uint32_t num_links_pending;
   bool scheduled;
 
+  /* Estimated evaluation time in seconds. Every evaluation of the operation is timed, this is an
+   * exponential moving average of those times (3/4 previous estimate, 1/4 latest time). Negative
+   * when the operation was never evaluated. */
+  float estimated_time;
+  /* Estimated time of the longest chain of operations starting with this one. Operations on the
+   * critical path of the evaluation are scheduled first. */
+  float critical_path_time;
+
   /* Identifier for the operation being performed. */
   OperationCode opcode;
   int name_tag;
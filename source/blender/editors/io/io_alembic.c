@@ -135,6 +135,7 @@ static int wm_alembic_export_exec(bContext *C, wmOperator *op)
       .export_particles = RNA_boolean_get(op->ptr, "export_particles"),
       .export_custom_properties = RNA_boolean_get(op->ptr, "export_custom_properties"),
       .use_instancing = RNA_boolean_get(op->ptr, "use_instancing"),
+      .use_parallel_evaluation = RNA_boolean_get(op->ptr, "use_parallel_evaluation"),
       .packuv = RNA_boolean_get(op->ptr, "packuv"),
       .triangulate = RNA_boolean_get(op->ptr, "triangulate"),
       .quad_method = RNA_enum_get(op->ptr, "quad_method"),
@@ -191,6 +192,7 @@ static void ui_alembic_export_settings(uiLayout *layout, PointerRNA *imfptr)
   uiItemS(col);
 
   uiItemR(col, imfptr, "flatten", 0, NULL, ICON_NONE);
+  uiItemR(col, imfptr, "use_parallel_evaluation", 0, NULL, ICON_NONE);
   uiItemR(sub, imfptr, "use_instancing", 0, IFACE_("Use Instancing"), ICON_NONE);
   uiItemR(sub, imfptr, "export_custom_properties", 0, IFACE_("Custom Properties"), ICON_NONE);
 
@@ -413,6 +415,14 @@ void WM_OT_alembic_export(wmOperatorType *ot)
                   "Export data of duplicated objects as Alembic instances; speeds up the export "
                   "and can be disabled for compatibility with other software");
 
+  RNA_def_boolean(ot->srna,
+                  "use_parallel_evaluation",
+                  false,
+                  "Parallel Frames",
+                  "Evaluate several frames at the same time, in separate copies of the scene; uses "
+                  "more memory. Scenes with simulations or image sequences are still evaluated "
+                  "one frame at a time, and frame change handlers are not run");
+
   RNA_def_float(
       ot->srna,
       "global_scale",
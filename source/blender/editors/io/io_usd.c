@@ -121,6 +121,7 @@ static int wm_usd_export_exec(bContext *C, wmOperator *op)
   const bool export_materials = RNA_boolean_get(op->ptr, "export_materials");
   const bool use_instancing = RNA_boolean_get(op->ptr, "use_instancing");
   const bool evaluation_mode = RNA_enum_get(op->ptr, "evaluation_mode");
+  const bool use_parallel_evaluation = RNA_boolean_get(op->ptr, "use_parallel_evaluation");
 
   struct USDExportParams params = {
       export_animation,
@@ -132,6 +133,7 @@ static int wm_usd_export_exec(bContext *C, wmOperator *op)
       visible_objects_only,
       use_instancing,
       evaluation_mode,
+      use_parallel_evaluation,
   };
 
   bool ok = USD_export(C, filename, &params, as_background_job);
@@ -162,6 +164,7 @@ static void wm_usd_export_draw(bContext *UNUSED(C), wmOperator *op)
 
   col = uiLayoutColumn(box, true);
   uiItemR(col, ptr, "evaluation_mode", 0, NULL, ICON_NONE);
+  uiItemR(col, ptr, "use_parallel_evaluation", 0, NULL, ICON_NONE);
 
   box = uiLayoutBox(layout);
   uiItemL(box, IFACE_("Experimental"), ICON_NONE);
@@ -240,6 +243,14 @@ void WM_OT_usd_export(struct wmOperatorType *ot)
                "Use Settings for",
                "Determines visibility of objects, modifier settings, and other areas where there "
                "are different settings for viewport and rendering");
+
+  RNA_def_boolean(ot->srna,
+                  "use_parallel_evaluation",
+                  false,
+                  "Parallel Frames",
+                  "When checked, several frames of the animation are evaluated at the same time, "
+                  "in separate copies of the scene. Scenes with simulations or image sequences "
+                  "are still evaluated one frame at a time, and frame change handlers are not run");
 }
 
 #endif /* WITH_USD */
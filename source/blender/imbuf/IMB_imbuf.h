@@ -350,6 +350,12 @@ void IMB_anim_index_rebuild(struct IndexBuildContext *context,
 /* Finish rebuilding proxies/time-codes and free temporary contexts used. */
 void IMB_anim_index_rebuild_finish(struct IndexBuildContext *context, short stop);
 
+/**
+ * Return the memory used by decoded frames kept by all open movies, shared with the memory
+ * cache limit.
+ */
+size_t IMB_anim_decoded_frames_memory(void);
+
 /**
  * Return the length (in frames) of the given \a anim.
  */
@@ -462,6 +468,30 @@ bool IMB_scalefastImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy
  */
 void IMB_scaleImBuf_threaded(struct ImBuf *ibuf, unsigned int newx, unsigned int newy);
 
+typedef enum eIMBResampleFilter {
+  /** Average of the covered pixels when reducing, linear interpolation when enlarging. */
+  IMB_FILTER_AREA = 0,
+  IMB_FILTER_BILINEAR = 1,
+  /** Mitchell-Netravali cubic. */
+  IMB_FILTER_BICUBIC = 2,
+  /** Three lobed Lanczos windowed sinc, the sharpest. */
+  IMB_FILTER_LANCZOS = 3,
+} eIMBResampleFilter;
+
+/**
+ * Resample with a separable \a filter, multi-threaded over rows. A size of zero keeps the size
+ * of that axis, Z-buffers are not scaled. Return true if \a ibuf is modified.
+ *
+ * Results differ from #IMB_scaleImBuf and #IMB_scaleImBuf_threaded, which keep their own
+ * filtering: pixel centers are aligned and byte buffers are filtered premultiplied.
+ *
+ * \attention Defined in resample.c
+ */
+bool IMB_resampleImBuf(struct ImBuf *ibuf,
+                       unsigned int newx,
+                       unsigned int newy,
+                       eIMBResampleFilter filter);
+
 /**
  *
  * \attention Defined in writeimage.c
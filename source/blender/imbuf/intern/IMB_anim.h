@@ -62,6 +62,9 @@
 #  include <libavcodec/avcodec.h>
 #  include <libavformat/avformat.h>
 #  include <libswscale/swscale.h>
+
+#  include "BLI_threads.h"
+#  include "DNA_listBase.h"
 #endif
 
 /* more endianness... should move to a separate file... */
@@ -136,6 +139,29 @@ struct anim {
   int64_t last_pts;
   int64_t next_pts;
   AVPacket next_packet;
+
+  /* The most recently decoded frames in presentation order, the last one is `pFrame`. */
+  AVFrame **frame_ring;
+  int64_t *frame_ring_pts;
+  int frame_ring_size, frame_ring_start, frame_ring_len;
+  /* Memory of one decoded frame, the frames of all movies share one budget. */
+  size_t frame_ring_frame_size;
+
+  /* Keyframes of the video stream, sorted by PTS. Built by the decoder thread. */
+  struct anim_index *keyframe_index;
+  bool keyframe_index_tried;
+
+  /* Decoder thread, decodes ahead of sequential playback and exits once it is ahead. All
+   * decoding state above and `index_dir` are protected by `decode_mutex`. */
+  ListBase decoder_thread;
+  ThreadMutex decode_mutex;
+  int decoder_fetch_waiting;
+  int decoder_lookahead;
+  int fetch_count;
+  bool decoder_running;
+  bool decoder_playing;
+  bool decoder_eof;
+  bool decoder_stop;
 #endif
 
   char index_dir[768];
@@ -30,6 +30,9 @@
 extern "C" {
 #endif
 
+struct ColorManagedDisplaySettings;
+struct ColorManagedViewSettings;
+struct ColormanageProcessor;
 struct ImBuf;
 struct OCIO_ConstProcessorRcPtr;
 
@@ -126,6 +129,11 @@ void colorspace_set_default_role(char *colorspace, int size, int role);
 void colormanage_imbuf_set_default_spaces(struct ImBuf *ibuf);
 void colormanage_imbuf_make_linear(struct ImBuf *ibuf, const char *from_colorspace);
 
+void colormanage_processor_use_display_lut(
+    struct ColormanageProcessor *cm_processor,
+    const struct ColorManagedViewSettings *view_settings,
+    const struct ColorManagedDisplaySettings *display_settings);
+
 #ifdef __cplusplus
 }
 #endif
@@ -103,12 +103,24 @@ int IMB_indexer_get_duration(struct anim_index *idx);
 
 int IMB_indexer_can_scan(struct anim_index *idx, int old_frame_index, int new_frame_index);
 
+/* Keyframe indices, entry of the last keyframe at or before pts or -1. */
+int IMB_indexer_get_keyframe(struct anim_index *idx, long long pts);
+
 void IMB_indexer_close(struct anim_index *idx);
 
 void IMB_free_indices(struct anim *anim);
 
 struct anim *IMB_anim_open_proxy(struct anim *anim, IMB_Proxy_Size preview_size);
 struct anim_index *IMB_anim_open_index(struct anim *anim, IMB_Timecode_Type tc);
+/* File of the keyframe index, reads `anim->index_dir` so the caller has to lock it against
+ * #IMB_anim_set_index_dir. */
+void IMB_anim_keyframe_index_filepath(struct anim *anim, char *r_filepath);
+/* Load the keyframe index of a movie from \a filepath, building it when there is none.
+ * \a is_stopped is polled while building to cancel. */
+struct anim_index *IMB_anim_keyframe_index_ensure(struct anim *anim,
+                                                  const char *filepath,
+                                                  bool (*is_stopped)(void *userdata),
+                                                  void *userdata);
 
 int IMB_proxy_size_to_array_index(IMB_Proxy_Size pr_size);
 int IMB_timecode_to_array_index(IMB_Timecode_Type tc);
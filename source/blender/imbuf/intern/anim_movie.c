@@ -53,8 +53,11 @@
 #  include <io.h>
 #endif
 
+#include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "MEM_guardedalloc.h"
@@ -82,6 +85,10 @@
 #  include <libswscale/swscale.h>
 
 #  include "ffmpeg_compat.h"
+
+#  include "MEM_CacheLimiterC-Api.h"
+
+#  include "atomic_ops.h"
 #endif /* WITH_FFMPEG */
 
 int ismovie(const char *UNUSED(filepath))
@@ -505,6 +512,153 @@ BLI_INLINE bool need_aligned_ffmpeg_buffer(struct anim *anim)
   return (anim->x & 31) != 0;
 }
 
+/* Decoded frames are kept in a ring, the last one is the frame in `pFrame`. Seeking decodes
+ * from the previous keyframe, keeping the frames before the requested one makes stepping back
+ * cheap. During sequential playback the decoder thread adds the frames after the requested
+ * one, so playback does not wait for the decoder. */
+
+/* Memory of the decoded frames kept by all movies together, at most a quarter of the memory
+ * cache limit. The sequencer counts it towards its cache limit, see
+ * #IMB_anim_decoded_frames_memory(). Every movie keeps at least two frames regardless. */
+#  define FFMPEG_FRAME_RING_MEMORY (128 * 1024 * 1024)
+#  define FFMPEG_FRAME_RING_MAX 64
+/* Frames decoded ahead of sequential playback. */
+#  define FFMPEG_LOOKAHEAD_MAX 8
+/* Reading a single frame or the preview (first and middle frame) doesn't start the thread. */
+#  define FFMPEG_DECODER_THREAD_FETCHES 3
+/* Every open movie has its own codec threads, timelines can have many movie strips. */
+#  define FFMPEG_CODEC_THREADS_MAX 8
+
+static size_t ffmpeg_frame_ring_memory = 0;
+
+static size_t ffmpeg_frame_ring_memory_limit(void)
+{
+  return min_zz(FFMPEG_FRAME_RING_MEMORY, MEM_CacheLimiter_get_maximum() / 4);
+}
+
+static void ffmpeg_frame_ring_init(struct anim *anim)
+{
+  const int frame_size = avpicture_get_size(
+      anim->pCodecCtx->pix_fmt, anim->pCodecCtx->width, anim->pCodecCtx->height);
+  int size = (frame_size > 0) ? (int)(ffmpeg_frame_ring_memory_limit() / frame_size) : 2;
+
+  CLAMP(size, 2, FFMPEG_FRAME_RING_MAX);
+
+  anim->frame_ring = MEM_callocN(sizeof(AVFrame *) * size, "ffmpeg frame ring");
+  anim->frame_ring_pts = MEM_callocN(sizeof(int64_t) * size, "ffmpeg frame ring pts");
+  for (int i = 0; i < size; i++) {
+    anim->frame_ring[i] = av_frame_alloc();
+  }
+  anim->frame_ring_size = size;
+  anim->frame_ring_start = 0;
+  anim->frame_ring_len = 0;
+  anim->frame_ring_frame_size = (size_t)max_ii(frame_size, 0);
+
+  anim->decoder_lookahead = min_ii(FFMPEG_LOOKAHEAD_MAX, size / 2);
+}
+
+BLI_INLINE int ffmpeg_frame_ring_slot(const struct anim *anim, int index)
+{
+  return (anim->frame_ring_start + index) % anim->frame_ring_size;
+}
+
+static void ffmpeg_frame_ring_clear(struct anim *anim)
+{
+  for (int i = 0; i < anim->frame_ring_len; i++) {
+    av_frame_unref(anim->frame_ring[ffmpeg_frame_ring_slot(anim, i)]);
+  }
+  atomic_sub_and_fetch_z(&ffmpeg_frame_ring_memory,
+                         anim->frame_ring_frame_size * (size_t)anim->frame_ring_len);
+  anim->frame_ring_start = 0;
+  anim->frame_ring_len = 0;
+}
+
+/* Whether the ring can keep one more frame instead of dropping its oldest one. */
+static bool ffmpeg_frame_ring_can_grow(const struct anim *anim)
+{
+  if (anim->frame_ring_len == anim->frame_ring_size) {
+    return false;
+  }
+  /* The frame shown and the one after it are always kept. */
+  if (anim->frame_ring_len < 2) {
+    return true;
+  }
+  return atomic_add_and_fetch_z(&ffmpeg_frame_ring_memory, 0) + anim->frame_ring_frame_size <=
+         ffmpeg_frame_ring_memory_limit();
+}
+
+static void ffmpeg_frame_ring_free(struct anim *anim)
+{
+  if (anim->frame_ring == NULL) {
+    return;
+  }
+
+  ffmpeg_frame_ring_clear(anim);
+  for (int i = 0; i < anim->frame_ring_size; i++) {
+    av_frame_free(&anim->frame_ring[i]);
+  }
+  MEM_freeN(anim->frame_ring);
+  MEM_freeN(anim->frame_ring_pts);
+  anim->frame_ring = NULL;
+  anim->frame_ring_pts = NULL;
+  anim->frame_ring_size = 0;
+}
+
+/* Add the frame just decoded into `pFrame`, dropping the oldest one when the ring is full. */
+static void ffmpeg_frame_ring_push(struct anim *anim)
+{
+  int slot;
+
+  if (!ffmpeg_frame_ring_can_grow(anim)) {
+    slot = anim->frame_ring_start;
+    av_frame_unref(anim->frame_ring[slot]);
+    anim->frame_ring_start = (anim->frame_ring_start + 1) % anim->frame_ring_size;
+  }
+  else {
+    slot = ffmpeg_frame_ring_slot(anim, anim->frame_ring_len);
+    anim->frame_ring_len++;
+    atomic_add_and_fetch_z(&ffmpeg_frame_ring_memory, anim->frame_ring_frame_size);
+  }
+
+  if (av_frame_ref(anim->frame_ring[slot], anim->pFrame) < 0) {
+    /* The ring only holds consecutive frames. */
+    ffmpeg_frame_ring_clear(anim);
+    return;
+  }
+  anim->frame_ring_pts[slot] = anim->next_pts;
+}
+
+/* Index of the frame shown at \a pts_to_search: the last one at or before it. Unless the PTS
+ * matches exactly the frame after it has to be decoded as well, otherwise the frame shown might
+ * just not be decoded yet. */
+static int ffmpeg_frame_ring_find(const struct anim *anim, int64_t pts_to_search)
+{
+  for (int i = anim->frame_ring_len - 1; i >= 0; i--) {
+    const int64_t pts = anim->frame_ring_pts[ffmpeg_frame_ring_slot(anim, i)];
+
+    if (pts == pts_to_search) {
+      return i;
+    }
+    if (pts < pts_to_search) {
+      return (i < anim->frame_ring_len - 1) ? i : -1;
+    }
+  }
+  return -1;
+}
+
+static int ffmpeg_frame_ring_count_after(const struct anim *anim, int64_t pts)
+{
+  int count = 0;
+
+  for (int i = anim->frame_ring_len - 1; i >= 0; i--) {
+    if (anim->frame_ring_pts[ffmpeg_frame_ring_slot(anim, i)] <= pts) {
+      break;
+    }
+    count++;
+  }
+  return count;
+}
+
 static int startffmpeg(struct anim *anim)
 {
   int i, video_stream_index;
@@ -573,6 +727,12 @@ static int startffmpeg(struct anim *anim)
 
   pCodecCtx->workaround_bugs = 1;
 
+  /* Decode with frame and slice threads. Reference counted frames can be kept in the frame ring
+   * after decoding the next ones. */
+  pCodecCtx->thread_count = min_ii(BLI_system_thread_count(), FFMPEG_CODEC_THREADS_MAX);
+  pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+  pCodecCtx->refcounted_frames = 1;
+
   if (avcodec_open2(pCodecCtx, pCodec, NULL) < 0) {
     avformat_close_input(&pFormatCtx);
     return -1;
@@ -743,22 +903,35 @@ static int startffmpeg(struct anim *anim)
   }
 #  endif
 
+  ffmpeg_frame_ring_init(anim);
+
+  anim->keyframe_index = NULL;
+  anim->keyframe_index_tried = false;
+  BLI_listbase_clear(&anim->decoder_thread);
+  BLI_mutex_init(&anim->decode_mutex);
+  anim->decoder_fetch_waiting = 0;
+  anim->fetch_count = 0;
+  anim->decoder_running = false;
+  anim->decoder_playing = false;
+  anim->decoder_eof = false;
+  anim->decoder_stop = false;
+
   return 0;
 }
 
-/* postprocess the image in anim->pFrame and do color conversion
+/* postprocess the decoded image in frame and do color conversion
  * and deinterlacing stuff.
  *
  * Output is anim->last_frame
  */
 
-static void ffmpeg_postprocess(struct anim *anim)
+static void ffmpeg_postprocess(struct anim *anim, AVFrame *frame)
 {
-  AVFrame *input = anim->pFrame;
+  AVFrame *input = frame;
   ImBuf *ibuf = anim->last_frame;
   int filter_y = 0;
 
-  if (!anim->pFrameComplete) {
+  if (frame == NULL) {
     return;
   }
 
@@ -781,7 +954,7 @@ static void ffmpeg_postprocess(struct anim *anim)
 
   if (anim->ib_flags & IB_animdeinterlace) {
     if (avpicture_deinterlace((AVPicture *)anim->pFrameDeinterlaced,
-                              (const AVPicture *)anim->pFrame,
+                              (const AVPicture *)frame,
                               anim->pCodecCtx->pix_fmt,
                               anim->pCodecCtx->width,
                               anim->pCodecCtx->height) < 0) {
@@ -908,6 +1081,7 @@ static int ffmpeg_decode_video_frame(struct anim *anim)
 
       if (anim->pFrameComplete) {
         anim->next_pts = av_get_pts_from_frame(anim->pFormatCtx, anim->pFrame);
+        ffmpeg_frame_ring_push(anim);
 
         av_log(anim->pFormatCtx,
                AV_LOG_DEBUG,
@@ -943,6 +1117,7 @@ static int ffmpeg_decode_video_frame(struct anim *anim)
 
     if (anim->pFrameComplete) {
       anim->next_pts = av_get_pts_from_frame(anim->pFormatCtx, anim->pFrame);
+      ffmpeg_frame_ring_push(anim);
 
       av_log(anim->pFormatCtx,
              AV_LOG_DEBUG,
@@ -1048,7 +1223,43 @@ static int ffmpeg_seek_by_byte(AVFormatContext *pFormatCtx)
   return false;
 }
 
-static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Type tc)
+/* True when decoding forward to \a pts_to_search passes no keyframe, so it is never slower than
+ * seeking. */
+static bool ffmpeg_keyframe_index_can_scan(const struct anim *anim, int64_t pts_to_search)
+{
+  struct anim_index *idx = anim->keyframe_index;
+
+  if (idx == NULL) {
+    return false;
+  }
+
+  const int keyframe = IMB_indexer_get_keyframe(idx, pts_to_search);
+  return keyframe == -1 || (int64_t)idx->entries[keyframe].pts <= anim->next_pts;
+}
+
+static int ffmpeg_seek_to_index_pos(struct anim *anim, long long pos, unsigned long long dts)
+{
+  AVStream *v_st = anim->pFormatCtx->streams[anim->videoStream];
+  int ret;
+
+  av_log(anim->pFormatCtx, AV_LOG_DEBUG, "INDEX seek pos = %lld\n", pos);
+  av_log(anim->pFormatCtx, AV_LOG_DEBUG, "INDEX seek dts = %llu\n", dts);
+
+  if (ffmpeg_seek_by_byte(anim->pFormatCtx)) {
+    av_log(anim->pFormatCtx, AV_LOG_DEBUG, "... using BYTE pos\n");
+
+    ret = av_seek_frame(anim->pFormatCtx, -1, pos, AVSEEK_FLAG_BYTE);
+    av_update_cur_dts(anim->pFormatCtx, v_st, dts);
+  }
+  else {
+    av_log(anim->pFormatCtx, AV_LOG_DEBUG, "... using DTS pos\n");
+    ret = av_seek_frame(anim->pFormatCtx, anim->videoStream, dts, AVSEEK_FLAG_BACKWARD);
+  }
+
+  return ret;
+}
+
+static ImBuf *ffmpeg_fetchibuf_locked(struct anim *anim, int position, IMB_Timecode_Type tc)
 {
   int64_t pts_to_search = 0;
   double frame_rate;
@@ -1058,10 +1269,7 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
   AVStream *v_st;
   int new_frame_index = 0; /* To quiet gcc barking... */
   int old_frame_index = 0; /* To quiet gcc barking... */
-
-  if (anim == NULL) {
-    return 0;
-  }
+  int ring_index;
 
   av_log(anim->pFormatCtx, AV_LOG_DEBUG, "FETCH: pos=%d\n", position);
 
@@ -1098,24 +1306,24 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
          frame_rate,
          st_time);
 
-  if (anim->last_frame && anim->last_pts <= pts_to_search && anim->next_pts > pts_to_search) {
-    av_log(anim->pFormatCtx,
-           AV_LOG_DEBUG,
-           "FETCH: frame repeat: last: %lld next: %lld\n",
-           (long long int)anim->last_pts,
-           (long long int)anim->next_pts);
-    IMB_refImBuf(anim->last_frame);
-    anim->curposition = position;
-    return anim->last_frame;
-  }
+  anim->decoder_playing = (position == anim->curposition + 1);
+
+  /* Decoding forward only finds frames after the last one decoded. */
+  const bool is_ahead = anim->frame_ring_len > 0 && pts_to_search > anim->next_pts;
 
-  if (position > anim->curposition + 1 && anim->preseek && !tc_index &&
-      position - (anim->curposition + 1) < anim->preseek) {
+  ring_index = ffmpeg_frame_ring_find(anim, pts_to_search);
+
+  if (ring_index != -1) {
+    av_log(anim->pFormatCtx, AV_LOG_DEBUG, "FETCH: frame decoded before\n");
+  }
+  else if (is_ahead && position > anim->curposition + 1 && anim->preseek && !tc_index &&
+           !anim->keyframe_index && position - (anim->curposition + 1) < anim->preseek) {
     av_log(anim->pFormatCtx, AV_LOG_DEBUG, "FETCH: within preseek interval (no index)\n");
 
     ffmpeg_decode_video_frame_scan(anim, pts_to_search);
   }
-  else if (tc_index && IMB_indexer_can_scan(tc_index, old_frame_index, new_frame_index)) {
+  else if (is_ahead && tc_index &&
+           IMB_indexer_can_scan(tc_index, old_frame_index, new_frame_index)) {
     av_log(anim->pFormatCtx,
            AV_LOG_DEBUG,
            "FETCH: within preseek interval "
@@ -1123,29 +1331,39 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
 
     ffmpeg_decode_video_frame_scan(anim, pts_to_search);
   }
-  else if (position != anim->curposition + 1) {
+  else if (is_ahead && !tc_index && ffmpeg_keyframe_index_can_scan(anim, pts_to_search)) {
+    av_log(anim->pFormatCtx,
+           AV_LOG_DEBUG,
+           "FETCH: no keyframe in between "
+           "(keyframe index tells us)\n");
+
+    ffmpeg_decode_video_frame_scan(anim, pts_to_search);
+  }
+  else if (is_ahead && position == anim->curposition + 1) {
+    av_log(anim->pFormatCtx, AV_LOG_DEBUG, "FETCH: no seek necessary, just continue...\n");
+
+    ffmpeg_decode_video_frame_scan(anim, pts_to_search);
+  }
+  else if (position == 0 && anim->curposition == -1 && anim->frame_ring_len == 0) {
+    /* first frame without seeking special case... */
+    ffmpeg_decode_video_frame(anim);
+  }
+  else {
     long long pos;
     int ret;
 
     if (tc_index) {
-      unsigned long long dts;
-
       pos = IMB_indexer_get_seek_pos(tc_index, new_frame_index);
-      dts = IMB_indexer_get_seek_pos_dts(tc_index, new_frame_index);
-
-      av_log(anim->pFormatCtx, AV_LOG_DEBUG, "TC INDEX seek pos = %lld\n", pos);
-      av_log(anim->pFormatCtx, AV_LOG_DEBUG, "TC INDEX seek dts = %llu\n", dts);
-
-      if (ffmpeg_seek_by_byte(anim->pFormatCtx)) {
-        av_log(anim->pFormatCtx, AV_LOG_DEBUG, "... using BYTE pos\n");
+      ret = ffmpeg_seek_to_index_pos(
+          anim, pos, IMB_indexer_get_seek_pos_dts(tc_index, new_frame_index));
+    }
+    else if (anim->keyframe_index) {
+      const int keyframe = max_ii(IMB_indexer_get_keyframe(anim->keyframe_index, pts_to_search),
+                                  0);
+      const anim_index_entry *entry = &anim->keyframe_index->entries[keyframe];
 
-        ret = av_seek_frame(anim->pFormatCtx, -1, pos, AVSEEK_FLAG_BYTE);
-        av_update_cur_dts(anim->pFormatCtx, v_st, dts);
-      }
-      else {
-        av_log(anim->pFormatCtx, AV_LOG_DEBUG, "... using DTS pos\n");
-        ret = av_seek_frame(anim->pFormatCtx, anim->videoStream, dts, AVSEEK_FLAG_BACKWARD);
-      }
+      pos = entry->seek_pos;
+      ret = ffmpeg_seek_to_index_pos(anim, pos, entry->seek_pos_dts);
     }
     else {
       pos = (long long)(position - anim->preseek) * AV_TIME_BASE / frame_rate;
@@ -1182,8 +1400,10 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
     }
 
     avcodec_flush_buffers(anim->pCodecCtx);
+    ffmpeg_frame_ring_clear(anim);
 
     anim->next_pts = -1;
+    anim->decoder_eof = false;
 
     if (anim->next_packet.stream_index == anim->videoStream) {
       av_free_packet(&anim->next_packet);
@@ -1196,12 +1416,30 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
       ffmpeg_decode_video_frame_scan(anim, pts_to_search);
     }
   }
-  else if (position == 0 && anim->curposition == -1) {
-    /* first frame without seeking special case... */
-    ffmpeg_decode_video_frame(anim);
+
+  /* Otherwise the scan stopped at the first frame after pts_to_search, or the stream ended. */
+  if (ring_index == -1) {
+    ring_index = anim->frame_ring_len - 1;
   }
-  else {
-    av_log(anim->pFormatCtx, AV_LOG_DEBUG, "FETCH: no seek necessary, just continue...\n");
+
+  AVFrame *frame = NULL;
+  int64_t frame_pts = -1;
+
+  if (ring_index != -1) {
+    const int slot = ffmpeg_frame_ring_slot(anim, ring_index);
+    frame = anim->frame_ring[slot];
+    frame_pts = anim->frame_ring_pts[slot];
+  }
+
+  if (anim->last_frame && frame && frame_pts == anim->last_pts) {
+    av_log(anim->pFormatCtx,
+           AV_LOG_DEBUG,
+           "FETCH: frame repeat: last: %lld next: %lld\n",
+           (long long int)anim->last_pts,
+           (long long int)anim->next_pts);
+    IMB_refImBuf(anim->last_frame);
+    anim->curposition = position;
+    return anim->last_frame;
   }
 
   IMB_freeImBuf(anim->last_frame);
@@ -1230,11 +1468,14 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
 
   anim->last_frame->rect_colorspace = colormanage_colorspace_get_named(anim->colorspace);
 
-  ffmpeg_postprocess(anim);
+  ffmpeg_postprocess(anim, frame);
 
-  anim->last_pts = anim->next_pts;
+  anim->last_pts = frame_pts;
 
-  ffmpeg_decode_video_frame(anim);
+  /* Without the decoder thread decode the next frame here, to know how long this one lasts. */
+  if (!anim->decoder_running && ring_index == anim->frame_ring_len - 1) {
+    ffmpeg_decode_video_frame(anim);
+  }
 
   anim->curposition = position;
 
@@ -1243,6 +1484,123 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
   return anim->last_frame;
 }
 
+static bool ffmpeg_decoder_should_decode(const struct anim *anim)
+{
+  if (!anim->decoder_playing || anim->decoder_eof || anim->decoder_fetch_waiting != 0 ||
+      anim->frame_ring_len == 0) {
+    return false;
+  }
+  if (ffmpeg_frame_ring_count_after(anim, anim->last_pts) >= anim->decoder_lookahead) {
+    return false;
+  }
+  /* Never drop frames which were not shown yet to make room for the next ones. */
+  return ffmpeg_frame_ring_can_grow(anim) ||
+         anim->frame_ring_pts[anim->frame_ring_start] < anim->last_pts;
+}
+
+static bool ffmpeg_decoder_is_stopped(void *anim_v)
+{
+  struct anim *anim = anim_v;
+
+  BLI_mutex_lock(&anim->decode_mutex);
+  const bool stop = anim->decoder_stop;
+  BLI_mutex_unlock(&anim->decode_mutex);
+
+  return stop;
+}
+
+/* Builds the keyframe index once, then decodes ahead of sequential playback until the lookahead
+ * is filled. The thread exits when there is nothing left to do, the next fetch starts it again. */
+static void *ffmpeg_decoder_thread(void *anim_v)
+{
+  struct anim *anim = anim_v;
+
+  BLI_mutex_lock(&anim->decode_mutex);
+
+  if (!anim->keyframe_index_tried) {
+    char filepath[FILE_MAX];
+
+    anim->keyframe_index_tried = true;
+    IMB_anim_keyframe_index_filepath(anim, filepath);
+    BLI_mutex_unlock(&anim->decode_mutex);
+
+    struct anim_index *keyframe_index = IMB_anim_keyframe_index_ensure(
+        anim, filepath, ffmpeg_decoder_is_stopped, anim);
+
+    BLI_mutex_lock(&anim->decode_mutex);
+    anim->keyframe_index = keyframe_index;
+  }
+
+  while (!anim->decoder_stop && ffmpeg_decoder_should_decode(anim)) {
+    if (!ffmpeg_decode_video_frame(anim) || !anim->pFrameComplete) {
+      anim->decoder_eof = true;
+    }
+  }
+
+  anim->decoder_running = false;
+  BLI_mutex_unlock(&anim->decode_mutex);
+
+  return NULL;
+}
+
+/* Start the decoder thread again once it exited and there is work for it, `decode_mutex` must be
+ * locked. */
+static void ffmpeg_decoder_thread_ensure(struct anim *anim)
+{
+  if (anim->decoder_running || anim->fetch_count < FFMPEG_DECODER_THREAD_FETCHES ||
+      BLI_system_thread_count() <= 1) {
+    return;
+  }
+  if (anim->keyframe_index_tried && !ffmpeg_decoder_should_decode(anim)) {
+    return;
+  }
+
+  /* Joining doesn't wait on the mutex, the previous thread already returned. */
+  if (!BLI_listbase_is_empty(&anim->decoder_thread)) {
+    BLI_threadpool_end(&anim->decoder_thread);
+  }
+  anim->decoder_running = true;
+  BLI_threadpool_init(&anim->decoder_thread, ffmpeg_decoder_thread, 1);
+  BLI_threadpool_insert(&anim->decoder_thread, anim);
+}
+
+static void ffmpeg_decoder_thread_end(struct anim *anim)
+{
+  if (BLI_listbase_is_empty(&anim->decoder_thread)) {
+    return;
+  }
+
+  BLI_mutex_lock(&anim->decode_mutex);
+  anim->decoder_stop = true;
+  BLI_mutex_unlock(&anim->decode_mutex);
+
+  BLI_threadpool_end(&anim->decoder_thread);
+  anim->decoder_running = false;
+  anim->decoder_stop = false;
+}
+
+static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Type tc)
+{
+  ImBuf *ibuf;
+
+  if (anim == NULL) {
+    return 0;
+  }
+
+  /* Let the decoder thread give up the decoder between frames. */
+  atomic_add_and_fetch_int32(&anim->decoder_fetch_waiting, 1);
+  BLI_mutex_lock(&anim->decode_mutex);
+  atomic_sub_and_fetch_int32(&anim->decoder_fetch_waiting, 1);
+
+  anim->fetch_count++;
+  ibuf = ffmpeg_fetchibuf_locked(anim, position, tc);
+  ffmpeg_decoder_thread_ensure(anim);
+
+  BLI_mutex_unlock(&anim->decode_mutex);
+
+  return ibuf;
+}
+
 static void free_anim_ffmpeg(struct anim *anim)
 {
   if (anim == NULL) {
@@ -1250,16 +1608,14 @@ static void free_anim_ffmpeg(struct anim *anim)
   }
 
   if (anim->pCodecCtx) {
+    ffmpeg_decoder_thread_end(anim);
+    ffmpeg_frame_ring_free(anim);
+
     avcodec_close(anim->pCodecCtx);
     avformat_close_input(&anim->pFormatCtx);
 
-    /* Special case here: pFrame could share pointers with codec,
-     * so in order to avoid double-free we don't use av_frame_free()
-     * to free the frame.
-     *
-     * Could it be a bug in FFmpeg?
-     */
-    av_free(anim->pFrame);
+    /* Decoded frames are reference counted, they don't share pointers with the codec. */
+    av_frame_free(&anim->pFrame);
 
     if (!need_aligned_ffmpeg_buffer(anim)) {
       /* If there's no need for own aligned buffer it means that FFmpeg's
@@ -1276,6 +1632,13 @@ static void free_anim_ffmpeg(struct anim *anim)
     if (anim->next_packet.stream_index != -1) {
       av_free_packet(&anim->next_packet);
     }
+
+    if (anim->keyframe_index) {
+      IMB_indexer_close(anim->keyframe_index);
+      anim->keyframe_index = NULL;
+    }
+    BLI_mutex_end(&anim->decode_mutex);
+    anim->pCodecCtx = NULL;
   }
   anim->duration_in_frames = 0;
 }
@@ -1449,6 +1812,15 @@ struct ImBuf *IMB_anim_absolute(struct anim *anim,
 
 /***/
 
+size_t IMB_anim_decoded_frames_memory(void)
+{
+#ifdef WITH_FFMPEG
+  return atomic_add_and_fetch_z(&ffmpeg_frame_ring_memory, 0);
+#else
+  return 0;
+#endif
+}
+
 int IMB_anim_get_duration(struct anim *anim, IMB_Timecode_Type tc)
 {
   struct anim_index *idx;
@@ -32,6 +32,7 @@
 #include "DNA_movieclip_types.h"
 #include "DNA_scene_types.h"
 #include "DNA_space_types.h"
+#include "DNA_userdef_types.h"
 
 #include "IMB_filetype.h"
 #include "IMB_filter.h"
@@ -61,6 +62,10 @@
 
 #include <ocio_capi.h>
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 /* -------------------------------------------------------------------- */
 /** \name Global declarations
  * \{ */
@@ -104,6 +109,11 @@ typedef struct ColormanageProcessor {
   OCIO_ConstProcessorRcPtr *processor;
   CurveMapping *curve_mapping;
   bool is_data_result;
+
+  /* Display transform baked into a LUT, applied to buffers instead of the processor. */
+  struct DisplayLUT *display_lut;
+  /* Exposure is applied as gain, so it's not part of the LUT. */
+  float display_lut_gain;
 } ColormanageProcessor;
 
 static struct global_glsl_state {
@@ -131,6 +141,9 @@ static struct global_glsl_state {
   struct OCIO_GLSLDrawState *ocio_glsl_state;
 } global_glsl_state = {NULL};
 
+static void display_lut_init_shaper(void);
+static void display_lut_cache_free(void);
+
 static struct global_color_picking_state {
   /* Cached processor for color picking conversion. */
   OCIO_ConstProcessorRcPtr *processor_to;
@@ -723,6 +736,7 @@ void colormanagement_init(void)
   }
 
   BLI_init_srgb_conversion();
+  display_lut_init_shaper();
 }
 
 void colormanagement_exit(void)
@@ -758,6 +772,8 @@ void colormanagement_exit(void)
   memset(&global_glsl_state, 0, sizeof(global_glsl_state));
   memset(&global_color_picking_state, 0, sizeof(global_color_picking_state));
 
+  display_lut_cache_free();
+
   colormanage_free_config();
 }
 
@@ -1481,6 +1497,377 @@ const float *IMB_colormangement_get_xyz_to_rgb()
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Display LUT
+ *
+ * Display transforms of float buffers into byte display buffers are baked into a 3D LUT, which
+ * is much cheaper to apply than the OCIO processor and only needs to be accurate to 8 bits.
+ *
+ * Values are mapped to the LUT by a shaper, `log2(x / DISPLAY_LUT_EPSILON + 1)` normalized to
+ * the range up to #DISPLAY_LUT_MAX, so the LUT has the same precision for every stop of scene
+ * linear values. The shaper itself is a 1D table looked up with the bits of the float value.
+ * Exposure is applied as a gain before the shaper, so changing it doesn't need a new LUT.
+ * Negative values and values above #DISPLAY_LUT_MAX are transformed by the OCIO processor.
+ * \{ */
+
+#define DISPLAY_LUT_EPSILON (1.0f / 4096.0f)
+/* Chosen so 1.0 maps to 0.5 and is a grid point of the LUT, display transforms clipping values
+ * above 1.0 have a kink there which can't be interpolated. */
+#define DISPLAY_LUT_MAX (4096.0f + 2.0f)
+/* Shaper table entries are 1/1024th of an octave apart, from 2^-24 to 2^13. */
+#define DISPLAY_LUT_SHAPER_SHIFT 13
+#define DISPLAY_LUT_SHAPER_MIN_EXPONENT -24
+#define DISPLAY_LUT_SHAPER_MAX_EXPONENT 13
+#define DISPLAY_LUT_SHAPER_BASE \
+  ((uint32_t)(127 + DISPLAY_LUT_SHAPER_MIN_EXPONENT) << (23 - DISPLAY_LUT_SHAPER_SHIFT))
+#define DISPLAY_LUT_SHAPER_SIZE \
+  (((DISPLAY_LUT_SHAPER_MAX_EXPONENT - DISPLAY_LUT_SHAPER_MIN_EXPONENT) \
+    << (23 - DISPLAY_LUT_SHAPER_SHIFT)) + \
+   1)
+/* Number of LUTs kept for different view settings. */
+#define DISPLAY_LUT_CACHE_SIZE 4
+
+typedef struct DisplayLUT {
+  struct DisplayLUT *next, *prev;
+
+  /* Settings the LUT is baked for. */
+  char look[MAX_COLORSPACE_NAME];
+  char view[MAX_COLORSPACE_NAME];
+  char display[MAX_COLORSPACE_NAME];
+  char input[MAX_COLORSPACE_NAME];
+  float gamma;
+  int size;
+
+  /* The cache and processors using the LUT, guarded by #display_lut_lock. */
+  int users;
+
+  /* RGB entries with unused alpha, so they're interpolated with SIMD. Red changes fastest. */
+  float (*table)[4];
+} DisplayLUT;
+
+static float display_lut_shaper[DISPLAY_LUT_SHAPER_SIZE];
+/* Most recently used first. */
+static ListBase global_display_luts = {NULL, NULL};
+/* Not held while baking, which can take a while. */
+static pthread_mutex_t display_lut_lock = BLI_MUTEX_INITIALIZER;
+
+static float display_lut_shape_exact(float x)
+{
+  return logf(x / DISPLAY_LUT_EPSILON + 1.0f) /
+         logf(DISPLAY_LUT_MAX / DISPLAY_LUT_EPSILON + 1.0f);
+}
+
+static float display_lut_unshape(float s)
+{
+  return DISPLAY_LUT_EPSILON *
+         (expf(s * logf(DISPLAY_LUT_MAX / DISPLAY_LUT_EPSILON + 1.0f)) - 1.0f);
+}
+
+static void display_lut_init_shaper(void)
+{
+  for (uint32_t i = 0; i < DISPLAY_LUT_SHAPER_SIZE; i++) {
+    union {
+      uint32_t i;
+      float f;
+    } value;
+    value.i = (i + DISPLAY_LUT_SHAPER_BASE) << DISPLAY_LUT_SHAPER_SHIFT;
+    display_lut_shaper[i] = display_lut_shape_exact(value.f);
+  }
+}
+
+/* Whether \a x is in the range of the LUT, false for NaN. */
+BLI_INLINE bool display_lut_covers(float x)
+{
+  return x >= 0.0f && x <= DISPLAY_LUT_MAX;
+}
+
+/* Only for values covered by the LUT. */
+BLI_INLINE float display_lut_shape(float x)
+{
+  /* Below the shaper table, these are black. */
+  if (x <= 1.0f / (1 << -DISPLAY_LUT_SHAPER_MIN_EXPONENT)) {
+    return 0.0f;
+  }
+  if (x >= DISPLAY_LUT_MAX) {
+    return 1.0f;
+  }
+
+  union {
+    float f;
+    uint32_t i;
+  } value;
+  value.f = x;
+  const uint32_t index = (value.i >> DISPLAY_LUT_SHAPER_SHIFT) - DISPLAY_LUT_SHAPER_BASE;
+  const float t = (float)(value.i & ((1u << DISPLAY_LUT_SHAPER_SHIFT) - 1)) *
+                  (1.0f / (1u << DISPLAY_LUT_SHAPER_SHIFT));
+  return display_lut_shaper[index] +
+         (display_lut_shaper[index + 1] - display_lut_shaper[index]) * t;
+}
+
+static bool display_lut_bake(DisplayLUT *lut)
+{
+  OCIO_ConstProcessorRcPtr *processor = create_display_buffer_processor(
+      lut->look, lut->view, lut->display, 0.0f, lut->gamma, lut->input, false);
+  if (processor == NULL) {
+    return false;
+  }
+
+  const int size = lut->size;
+  const size_t tot_entries = (size_t)size * size * size;
+  float(*rgb)[3] = MEM_mallocN(sizeof(*rgb) * tot_entries, "display LUT bake");
+
+  float *grid = MEM_mallocN(sizeof(float) * size, "display LUT grid");
+  for (int i = 0; i < size; i++) {
+    grid[i] = display_lut_unshape((float)i / (size - 1));
+  }
+
+  size_t index = 0;
+  for (int b = 0; b < size; b++) {
+    for (int g = 0; g < size; g++) {
+      for (int r = 0; r < size; r++, index++) {
+        rgb[index][0] = grid[r];
+        rgb[index][1] = grid[g];
+        rgb[index][2] = grid[b];
+      }
+    }
+  }
+
+  OCIO_PackedImageDesc *img = OCIO_createOCIO_PackedImageDesc((float *)rgb,
+                                                              size,
+                                                              size * size,
+                                                              3,
+                                                              sizeof(float),
+                                                              3 * sizeof(float),
+                                                              3 * sizeof(float) * size);
+  OCIO_processorApply(processor, img);
+  OCIO_PackedImageDescRelease(img);
+  OCIO_processorRelease(processor);
+
+  lut->table = MEM_mallocN_aligned(sizeof(*lut->table) * tot_entries, 16, "display LUT");
+  for (index = 0; index < tot_entries; index++) {
+    copy_v3_v3(lut->table[index], rgb[index]);
+    lut->table[index][3] = 0.0f;
+  }
+
+  MEM_freeN(grid);
+  MEM_freeN(rgb);
+  return true;
+}
+
+static void display_lut_release_locked(DisplayLUT *lut)
+{
+  lut->users--;
+  if (lut->users == 0) {
+    if (lut->table) {
+      MEM_freeN(lut->table);
+    }
+    MEM_freeN(lut);
+  }
+}
+
+static void display_lut_release(DisplayLUT *lut)
+{
+  BLI_mutex_lock(&display_lut_lock);
+  display_lut_release_locked(lut);
+  BLI_mutex_unlock(&display_lut_lock);
+}
+
+static void display_lut_cache_free(void)
+{
+  BLI_mutex_lock(&display_lut_lock);
+  LISTBASE_FOREACH_MUTABLE (DisplayLUT *, lut, &global_display_luts) {
+    BLI_remlink(&global_display_luts, lut);
+    display_lut_release_locked(lut);
+  }
+  BLI_mutex_unlock(&display_lut_lock);
+}
+
+static int display_lut_size_get(void)
+{
+  switch (U.display_lut_accuracy) {
+    case USER_DISPLAY_LUT_HIGH:
+      return 65;
+    case USER_DISPLAY_LUT_LOW:
+      return 33;
+    default:
+      return 0;
+  }
+}
+
+/* Cached LUT for the settings of \a lut_key, with a new user. */
+static DisplayLUT *display_lut_cache_find_locked(const DisplayLUT *lut_key)
+{
+  LISTBASE_FOREACH (DisplayLUT *, lut, &global_display_luts) {
+    if (lut->size == lut_key->size && lut->gamma == lut_key->gamma &&
+        STREQ(lut->look, lut_key->look) && STREQ(lut->view, lut_key->view) &&
+        STREQ(lut->display, lut_key->display) && STREQ(lut->input, lut_key->input)) {
+      BLI_remlink(&global_display_luts, lut);
+      BLI_addhead(&global_display_luts, lut);
+      lut->users++;
+      return lut;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Get the LUT for the display transform of scene linear values, baking it when it's not cached.
+ * Returns NULL when the display transform is to be applied exactly.
+ */
+static DisplayLUT *display_lut_acquire(const ColorManagedViewSettings *view_settings,
+                                       const ColorManagedDisplaySettings *display_settings)
+{
+  const int size = display_lut_size_get();
+  if (size == 0) {
+    return NULL;
+  }
+
+  DisplayLUT *lut = MEM_callocN(sizeof(DisplayLUT), "DisplayLUT");
+  STRNCPY(lut->look, view_settings->look);
+  STRNCPY(lut->view, view_settings->view_transform);
+  STRNCPY(lut->display, display_settings->display_device);
+  STRNCPY(lut->input, global_role_scene_linear);
+  lut->gamma = view_settings->gamma;
+  lut->size = size;
+
+  BLI_mutex_lock(&display_lut_lock);
+  DisplayLUT *cached_lut = display_lut_cache_find_locked(lut);
+  BLI_mutex_unlock(&display_lut_lock);
+  if (cached_lut) {
+    MEM_freeN(lut);
+    return cached_lut;
+  }
+
+  if (!display_lut_bake(lut)) {
+    MEM_freeN(lut);
+    return NULL;
+  }
+
+  /* Threads needing the same LUT may have baked it at the same time, only one is kept. */
+  BLI_mutex_lock(&display_lut_lock);
+  cached_lut = display_lut_cache_find_locked(lut);
+  if (cached_lut) {
+    BLI_mutex_unlock(&display_lut_lock);
+    MEM_freeN(lut->table);
+    MEM_freeN(lut);
+    return cached_lut;
+  }
+
+  /* One user for the cache and one for the caller. */
+  lut->users = 2;
+  BLI_addhead(&global_display_luts, lut);
+
+  if (BLI_listbase_count_at_most(&global_display_luts, DISPLAY_LUT_CACHE_SIZE + 1) >
+      DISPLAY_LUT_CACHE_SIZE) {
+    DisplayLUT *last = global_display_luts.last;
+    BLI_remlink(&global_display_luts, last);
+    display_lut_release_locked(last);
+  }
+
+  BLI_mutex_unlock(&display_lut_lock);
+  return lut;
+}
+
+BLI_INLINE void display_lut_interpolate(const DisplayLUT *lut, const float gain, float rgb[3])
+{
+  const int size = lut->size;
+  const int last = size - 1;
+  float t[3];
+  int offset = 0;
+  const int stride[3] = {1, size, size * size};
+
+  for (int i = 0; i < 3; i++) {
+    const float s = display_lut_shape(rgb[i] * gain) * last;
+    const int index = min_ii((int)s, last - 1);
+    t[i] = s - index;
+    offset += index * stride[i];
+  }
+
+  const float(*c)[4] = lut->table + offset;
+  const int r = stride[0], g = stride[1], b = stride[2];
+
+#ifdef __SSE2__
+  const __m128 tr = _mm_set1_ps(t[0]);
+  const __m128 tg = _mm_set1_ps(t[1]);
+  const __m128 tb = _mm_set1_ps(t[2]);
+#  define LERP(a, b, t) _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t))
+  const __m128 c00 = LERP(_mm_load_ps(c[0]), _mm_load_ps(c[r]), tr);
+  const __m128 c10 = LERP(_mm_load_ps(c[g]), _mm_load_ps(c[g + r]), tr);
+  const __m128 c01 = LERP(_mm_load_ps(c[b]), _mm_load_ps(c[b + r]), tr);
+  const __m128 c11 = LERP(_mm_load_ps(c[b + g]), _mm_load_ps(c[b + g + r]), tr);
+  const __m128 result = LERP(LERP(c00, c10, tg), LERP(c01, c11, tg), tb);
+#  undef LERP
+  float result_v4[4];
+  _mm_storeu_ps(result_v4, result);
+  copy_v3_v3(rgb, result_v4);
+#else
+  float c00[3], c10[3], c01[3], c11[3], c0[3], c1[3];
+  interp_v3_v3v3(c00, c[0], c[r], t[0]);
+  interp_v3_v3v3(c10, c[g], c[g + r], t[0]);
+  interp_v3_v3v3(c01, c[b], c[b + r], t[0]);
+  interp_v3_v3v3(c11, c[b + g], c[b + g + r], t[0]);
+  interp_v3_v3v3(c0, c00, c10, t[1]);
+  interp_v3_v3v3(c1, c01, c11, t[1]);
+  interp_v3_v3v3(rgb, c0, c1, t[2]);
+#endif
+}
+
+/* Display transform of \a rgb, by the LUT when it covers the values. */
+BLI_INLINE void display_lut_apply_v3(const ColormanageProcessor *cm_processor, float rgb[3])
+{
+  const float gain = cm_processor->display_lut_gain;
+  if (display_lut_covers(rgb[0] * gain) && display_lut_covers(rgb[1] * gain) &&
+      display_lut_covers(rgb[2] * gain)) {
+    display_lut_interpolate(cm_processor->display_lut, gain, rgb);
+  }
+  else {
+    OCIO_processorApplyRGB(cm_processor->processor, rgb);
+  }
+}
+
+static void display_lut_apply(const ColormanageProcessor *cm_processor,
+                              float *buffer,
+                              int width,
+                              int height,
+                              int channels,
+                              bool predivide)
+{
+  const size_t tot_pixels = (size_t)width * height;
+  float *pixel = buffer;
+
+  for (size_t i = 0; i < tot_pixels; i++, pixel += channels) {
+    /* Same as #OCIO_processorApply_predivide. */
+    if (predivide && channels == 4 && pixel[3] != 1.0f && pixel[3] != 0.0f) {
+      const float alpha = pixel[3];
+      mul_v3_fl(pixel, 1.0f / alpha);
+      display_lut_apply_v3(cm_processor, pixel);
+      mul_v3_fl(pixel, alpha);
+    }
+    else {
+      display_lut_apply_v3(cm_processor, pixel);
+    }
+  }
+}
+
+/**
+ * Apply the display transform of \a cm_processor with a LUT, for processors of which the result
+ * is only stored in byte buffers.
+ */
+void colormanage_processor_use_display_lut(
+    ColormanageProcessor *cm_processor,
+    const ColorManagedViewSettings *view_settings,
+    const ColorManagedDisplaySettings *display_settings)
+{
+  if (cm_processor->is_data_result || cm_processor->processor == NULL || view_settings == NULL) {
+    return;
+  }
+
+  cm_processor->display_lut = display_lut_acquire(view_settings, display_settings);
+  cm_processor->display_lut_gain = powf(2.0f, view_settings->exposure);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Threaded Display Buffer Transform Routines
  * \{ */
@@ -1828,6 +2215,9 @@ static void colormanage_display_buffer_process_ex(
 
   if (skip_transform == false) {
     cm_processor = IMB_colormanagement_display_processor_new(view_settings, display_settings);
+    if (display_buffer == NULL) {
+      colormanage_processor_use_display_lut(cm_processor, view_settings, display_settings);
+    }
   }
 
   display_buffer_apply_threaded(ibuf,
@@ -3688,6 +4078,7 @@ static void imb_partial_display_buffer_update_ex(
 
     if (!skip_transform) {
       cm_processor = IMB_colormanagement_display_processor_new(view_settings, display_settings);
+      colormanage_processor_use_display_lut(cm_processor, view_settings, display_settings);
     }
 
     if (do_threads) {
@@ -3871,7 +4262,10 @@ void IMB_colormanagement_processor_apply_v4(ColormanageProcessor *cm_processor,
     BKE_curvemapping_evaluate_premulRGBF(cm_processor->curve_mapping, pixel, pixel);
   }
 
-  if (cm_processor->processor) {
+  if (cm_processor->display_lut) {
+    display_lut_apply_v3(cm_processor, pixel);
+  }
+  else if (cm_processor->processor) {
     OCIO_processorApplyRGBA(cm_processor->processor, pixel);
   }
 }
@@ -3883,7 +4277,10 @@ void IMB_colormanagement_processor_apply_v4_predivide(ColormanageProcessor *cm_p
     BKE_curvemapping_evaluate_premulRGBF(cm_processor->curve_mapping, pixel, pixel);
   }
 
-  if (cm_processor->processor) {
+  if (cm_processor->display_lut) {
+    display_lut_apply(cm_processor, pixel, 1, 1, 4, true);
+  }
+  else if (cm_processor->processor) {
     OCIO_processorApplyRGBA_predivide(cm_processor->processor, pixel);
   }
 }
@@ -3894,7 +4291,10 @@ void IMB_colormanagement_processor_apply_v3(ColormanageProcessor *cm_processor,
     BKE_curvemapping_evaluate_premulRGBF(cm_processor->curve_mapping, pixel, pixel);
   }
 
-  if (cm_processor->processor) {
+  if (cm_processor->display_lut) {
+    display_lut_apply_v3(cm_processor, pixel);
+  }
+  else if (cm_processor->processor) {
     OCIO_processorApplyRGB(cm_processor->processor, pixel);
   }
 }
@@ -3940,7 +4340,10 @@ void IMB_colormanagement_processor_apply(ColormanageProcessor *cm_processor,
     }
   }
 
-  if (cm_processor->processor && channels >= 3) {
+  if (cm_processor->display_lut && channels >= 3) {
+    display_lut_apply(cm_processor, buffer, width, height, channels, predivide);
+  }
+  else if (cm_processor->processor && channels >= 3) {
     OCIO_PackedImageDesc *img;
 
     /* apply OCIO processor */
@@ -3989,6 +4392,9 @@ void IMB_colormanagement_processor_free(ColormanageProcessor *cm_processor)
   if (cm_processor->processor) {
     OCIO_processorRelease(cm_processor->processor);
   }
+  if (cm_processor->display_lut) {
+    display_lut_release(cm_processor->display_lut);
+  }
 
   MEM_freeN(cm_processor);
 }
@@ -1115,7 +1115,7 @@ static void index_rebuild_fallback(FallbackIndexBuilderContext *context,
 
         struct ImBuf *s_ibuf = IMB_dupImBuf(tmp_ibuf);
 
-        IMB_scalefastImBuf(s_ibuf, x, y);
+        IMB_resampleImBuf(s_ibuf, x, y, IMB_FILTER_AREA);
 
         IMB_convert_rgba_to_abgr(s_ibuf);
 
@@ -1287,7 +1287,19 @@ void IMB_anim_set_index_dir(struct anim *anim, const char *dir)
   if (STREQ(anim->index_dir, dir)) {
     return;
   }
+#ifdef WITH_FFMPEG
+  /* The decoder thread reads the directory to find the keyframe index. */
+  ThreadMutex *decode_mutex = (anim->pCodecCtx != NULL) ? &anim->decode_mutex : NULL;
+  if (decode_mutex) {
+    BLI_mutex_lock(decode_mutex);
+  }
+#endif
   BLI_strncpy(anim->index_dir, dir, sizeof(anim->index_dir));
+#ifdef WITH_FFMPEG
+  if (decode_mutex) {
+    BLI_mutex_unlock(decode_mutex);
+  }
+#endif
 
   IMB_free_indices(anim);
 }
@@ -1363,3 +1375,175 @@ IMB_Proxy_Size IMB_anim_proxy_get_existing(struct anim *anim)
   }
   return existing;
 }
+
+/* ----------------------------------------------------------------------
+ * - keyframe index
+ * ---------------------------------------------------------------------- */
+
+/* Seeking needs to know where the keyframes are, the container's own index is often too coarse
+ * or missing. Unlike the time-code indices this one only needs the packets to be read, not
+ * decoded, so it is built automatically the first time a movie is played and stored next to
+ * the proxies. Entries are sorted by PTS, `frameno` is the keyframe number. */
+
+#ifdef WITH_FFMPEG
+
+void IMB_anim_keyframe_index_filepath(struct anim *anim, char *r_filepath)
+{
+  char index_dir[FILE_MAXDIR];
+  char stream_suffix[20];
+  char index_name[256];
+
+  stream_suffix[0] = 0;
+
+  if (anim->streamindex > 0) {
+    BLI_snprintf(stream_suffix, sizeof(stream_suffix), "_st%d", anim->streamindex);
+  }
+
+  BLI_snprintf(
+      index_name, sizeof(index_name), "keyframes%s%s.blen_kf", stream_suffix, anim->suffix);
+
+  get_index_dir(anim, index_dir, sizeof(index_dir));
+
+  BLI_join_dirfile(r_filepath, FILE_MAXFILE + FILE_MAXDIR, index_dir, index_name);
+}
+
+static int keyframe_entry_cmp(const void *a_v, const void *b_v)
+{
+  const anim_index_entry *a = a_v;
+  const anim_index_entry *b = b_v;
+
+  if ((long long)a->pts < (long long)b->pts) {
+    return -1;
+  }
+  if ((long long)a->pts > (long long)b->pts) {
+    return 1;
+  }
+  return 0;
+}
+
+static struct anim_index *index_keyframes_ffmpeg(struct anim *anim,
+                                                 const char *fname,
+                                                 bool (*is_stopped)(void *userdata),
+                                                 void *userdata)
+{
+  bool stop = false;
+  AVFormatContext *format_ctx = NULL;
+  AVPacket packet;
+  anim_index_entry *entries;
+  int num_entries = 0, max_entries = 256;
+
+  /* Use an own demuxer, the one of the animation is busy decoding. */
+  if (avformat_open_input(&format_ctx, anim->name, NULL, NULL) != 0) {
+    return NULL;
+  }
+
+  if (avformat_find_stream_info(format_ctx, NULL) < 0) {
+    avformat_close_input(&format_ctx);
+    return NULL;
+  }
+
+  memset(&packet, 0, sizeof(AVPacket));
+  entries = MEM_mallocN(sizeof(anim_index_entry) * max_entries, "keyframe index entries");
+
+  while (!(stop = is_stopped(userdata)) && av_read_frame(format_ctx, &packet) >= 0) {
+    if (packet.stream_index == anim->videoStream && (packet.flags & AV_PKT_FLAG_KEY) &&
+        packet.dts != AV_NOPTS_VALUE) {
+      if (num_entries == max_entries) {
+        max_entries *= 2;
+        entries = MEM_reallocN(entries, sizeof(anim_index_entry) * max_entries);
+      }
+
+      anim_index_entry *entry = &entries[num_entries];
+      entry->frameno = num_entries;
+      entry->seek_pos = packet.pos;
+      entry->seek_pos_dts = packet.dts;
+      entry->pts = (packet.pts != AV_NOPTS_VALUE) ? packet.pts : packet.dts;
+      num_entries++;
+    }
+    av_free_packet(&packet);
+  }
+
+  avformat_close_input(&format_ctx);
+
+  if (stop || num_entries == 0) {
+    MEM_freeN(entries);
+    return NULL;
+  }
+
+  qsort(entries, num_entries, sizeof(anim_index_entry), keyframe_entry_cmp);
+
+  /* Not being able to write the index only means it is built again next time. */
+  anim_index_builder *builder = IMB_index_builder_create(fname);
+  if (builder) {
+    for (int i = 0; i < num_entries; i++) {
+      IMB_index_builder_add_entry(builder,
+                                  entries[i].frameno,
+                                  entries[i].seek_pos,
+                                  entries[i].seek_pos_dts,
+                                  entries[i].pts);
+    }
+    IMB_index_builder_finish(builder, false);
+  }
+
+  struct anim_index *idx = MEM_callocN(sizeof(struct anim_index), "anim_index");
+  BLI_strncpy(idx->name, fname, sizeof(idx->name));
+  idx->entries = entries;
+  idx->num_entries = num_entries;
+
+  return idx;
+}
+
+#endif
+
+struct anim_index *IMB_anim_keyframe_index_ensure(struct anim *anim,
+                                                  const char *filepath,
+                                                  bool (*is_stopped)(void *userdata),
+                                                  void *userdata)
+{
+#ifdef WITH_FFMPEG
+  struct anim_index *idx;
+
+  if (anim->curtype != ANIM_FFMPEG) {
+    return NULL;
+  }
+
+  /* Rebuild indices of movies which were replaced since. */
+  if (BLI_exists(filepath) && !BLI_file_older(filepath, anim->name)) {
+    idx = IMB_indexer_open(filepath);
+    if (idx && idx->num_entries > 0) {
+      return idx;
+    }
+    if (idx) {
+      IMB_indexer_close(idx);
+    }
+  }
+
+  return index_keyframes_ffmpeg(anim, filepath, is_stopped, userdata);
+#else
+  UNUSED_VARS(anim, filepath, is_stopped, userdata);
+  return NULL;
+#endif
+}
+
+int IMB_indexer_get_keyframe(struct anim_index *idx, long long pts)
+{
+  int first = 0;
+  int len = idx->num_entries;
+
+  /* bsearch (upper bound) the first keyframe after pts */
+
+  while (len > 0) {
+    const int half = len >> 1;
+    const int middle = first + half;
+
+    if ((long long)idx->entries[middle].pts <= pts) {
+      first = middle + 1;
+      len = len - half - 1;
+    }
+    else {
+      len = half;
+    }
+  }
+
+  return first - 1;
+}
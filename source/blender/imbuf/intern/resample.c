@@ -0,0 +1,410 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2021, Blender Foundation.
+ */
+
+/** \file
+ * \ingroup imbuf
+ *
+ * Separable resampling of image buffers.
+ *
+ * The weights of the input pixels contributing to every output column and row are computed
+ * once, the image is then filtered horizontally into a float buffer with the new width and the
+ * old height, and vertically from there into the final buffer. Both passes are multi-threaded
+ * over rows. Byte buffers are filtered premultiplied, so transparent pixels don't bleed their
+ * color into the result.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+#include "BLI_math_base.h"
+#include "BLI_math_color.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+#include "imbuf.h"
+
+/* -------------------------------------------------------------------- */
+/** \name Filter Weights
+ * \{ */
+
+/* Input pixels contributing to every output pixel along one axis. */
+typedef struct ResampleAxis {
+  /* Number of input pixels per output pixel. */
+  int taps;
+  /* First input pixel of every output pixel. */
+  int *first;
+  /* `taps` weights of every output pixel, normalized to sum up to one. */
+  float *weights;
+} ResampleAxis;
+
+static float resample_filter_radius(eIMBResampleFilter filter)
+{
+  switch (filter) {
+    case IMB_FILTER_AREA:
+    case IMB_FILTER_BILINEAR:
+      return 1.0f;
+    case IMB_FILTER_BICUBIC:
+      return 2.0f;
+    case IMB_FILTER_LANCZOS:
+      return 3.0f;
+  }
+  return 1.0f;
+}
+
+static float resample_filter_weight(eIMBResampleFilter filter, float x)
+{
+  x = fabsf(x);
+
+  switch (filter) {
+    case IMB_FILTER_AREA:
+    case IMB_FILTER_BILINEAR:
+      return max_ff(1.0f - x, 0.0f);
+    case IMB_FILTER_BICUBIC:
+      /* Mitchell-Netravali with B = C = 1/3. */
+      if (x < 1.0f) {
+        return (7.0f * x * x * x - 12.0f * x * x + 16.0f / 3.0f) / 6.0f;
+      }
+      if (x < 2.0f) {
+        return (-7.0f / 3.0f * x * x * x + 12.0f * x * x - 20.0f * x + 32.0f / 3.0f) / 6.0f;
+      }
+      return 0.0f;
+    case IMB_FILTER_LANCZOS:
+      if (x < 1e-6f) {
+        return 1.0f;
+      }
+      if (x < 3.0f) {
+        const float px = (float)M_PI * x;
+        return 3.0f * sinf(px) * sinf(px / 3.0f) / (px * px);
+      }
+      return 0.0f;
+  }
+  return 0.0f;
+}
+
+static void resample_axis_init(ResampleAxis *axis, int in, int out, eIMBResampleFilter filter)
+{
+  axis->first = MEM_mallocN(sizeof(int) * out, __func__);
+
+  if (in == out) {
+    axis->taps = 1;
+    axis->weights = MEM_mallocN(sizeof(float) * out, __func__);
+    for (int i = 0; i < out; i++) {
+      axis->first[i] = i;
+      axis->weights[i] = 1.0f;
+    }
+    return;
+  }
+
+  /* Pixel `i` covers `[i, i + 1]` in input coordinates. */
+  const float scale = (float)in / (float)out;
+  const bool use_area = (filter == IMB_FILTER_AREA) && (scale > 1.0f);
+  /* The filter is stretched when reducing, so all input pixels contribute. */
+  const float filter_scale = max_ff(scale, 1.0f);
+  const float support = use_area ? 0.5f * scale :
+                                   resample_filter_radius(filter) * filter_scale;
+
+  /* Number of input pixels a filter of this size can overlap, fewer for small images since
+   * pixels outside of the image are folded into the edge. */
+  const int support_taps = (int)ceilf(2.0f * support) + 1;
+  axis->taps = min_ii(support_taps, in);
+  axis->weights = MEM_callocN(sizeof(float) * out * axis->taps, __func__);
+
+  for (int i = 0; i < out; i++) {
+    float *weights = axis->weights + i * axis->taps;
+    const float center = (i + 0.5f) * scale;
+    const int first = use_area ? (int)floorf(center - support) :
+                                 (int)floorf(center - support - 0.5f) + 1;
+    const int base = clamp_i(first, 0, in - axis->taps);
+    float total = 0.0f;
+
+    for (int j = first; j < first + support_taps; j++) {
+      float weight;
+      if (use_area) {
+        weight = max_ff(min_ff(j + 1.0f, center + support) - max_ff((float)j, center - support),
+                        0.0f);
+      }
+      else {
+        weight = resample_filter_weight(filter, (j + 0.5f - center) / filter_scale);
+      }
+      /* Pixels outside of the image repeat the edge. */
+      weights[clamp_i(j, 0, in - 1) - base] += weight;
+      total += weight;
+    }
+
+    if (total != 0.0f) {
+      for (int k = 0; k < axis->taps; k++) {
+        weights[k] /= total;
+      }
+    }
+    axis->first[i] = base;
+  }
+}
+
+static void resample_axis_free(ResampleAxis *axis)
+{
+  MEM_freeN(axis->first);
+  MEM_freeN(axis->weights);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Filter Passes
+ * \{ */
+
+typedef struct ResampleData {
+  ResampleAxis axis_x;
+  ResampleAxis axis_y;
+  int in_x;
+  int out_x;
+  int channels;
+  /* Convert bytes from straight to premultiplied alpha and back. */
+  bool premultiply;
+
+  const unsigned char *in_byte;
+  const float *in_float;
+  /* Result of the horizontal pass, `out_x * in_y * channels`. */
+  float *tmp;
+  unsigned char *out_byte;
+  float *out_float;
+} ResampleData;
+
+/* Row buffer of a thread. */
+typedef struct ResampleTLS {
+  float *row;
+} ResampleTLS;
+
+static float *resample_tls_row(ResampleTLS *tls_data, int size)
+{
+  if (tls_data->row == NULL) {
+    tls_data->row = MEM_mallocN(sizeof(float) * size, __func__);
+  }
+  return tls_data->row;
+}
+
+static void resample_tls_free(const void *__restrict UNUSED(userdata), void *__restrict chunk)
+{
+  ResampleTLS *tls_data = chunk;
+  MEM_SAFE_FREE(tls_data->row);
+}
+
+static void resample_rows_task(void *__restrict userdata,
+                               const int y,
+                               const TaskParallelTLS *__restrict tls)
+{
+  const ResampleData *data = userdata;
+  const ResampleAxis *axis = &data->axis_x;
+  const int channels = data->channels;
+  const float *src;
+
+  if (data->in_byte) {
+    const unsigned char *src_byte = data->in_byte + (size_t)y * data->in_x * 4;
+    float *row = resample_tls_row(tls->userdata_chunk, data->in_x * 4);
+    if (data->premultiply) {
+      for (int x = 0; x < data->in_x; x++) {
+        straight_uchar_to_premul_float(row + x * 4, src_byte + x * 4);
+      }
+    }
+    else {
+      for (int x = 0; x < data->in_x * 4; x++) {
+        row[x] = src_byte[x] * (1.0f / 255.0f);
+      }
+    }
+    src = row;
+  }
+  else {
+    src = data->in_float + (size_t)y * data->in_x * channels;
+  }
+
+  float *dst = data->tmp + (size_t)y * data->out_x * channels;
+
+  for (int x = 0; x < data->out_x; x++, dst += channels) {
+    const float *weights = axis->weights + x * axis->taps;
+    const float *src_pixel = src + axis->first[x] * channels;
+
+#ifdef __SSE2__
+    if (channels == 4) {
+      __m128 sum = _mm_setzero_ps();
+      for (int k = 0; k < axis->taps; k++) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(src_pixel)));
+        src_pixel += 4;
+      }
+      _mm_storeu_ps(dst, sum);
+      continue;
+    }
+#endif
+
+    for (int c = 0; c < channels; c++) {
+      dst[c] = 0.0f;
+    }
+    for (int k = 0; k < axis->taps; k++) {
+      for (int c = 0; c < channels; c++) {
+        dst[c] += weights[k] * src_pixel[c];
+      }
+      src_pixel += channels;
+    }
+  }
+}
+
+/* `dst += weight * src` for `len` floats. */
+static void resample_madd(float *dst, const float *src, float weight, int len)
+{
+  int i = 0;
+#ifdef __SSE2__
+  const __m128 weight4 = _mm_set1_ps(weight);
+  for (; i + 4 <= len; i += 4) {
+    _mm_storeu_ps(dst + i,
+                  _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(weight4, _mm_loadu_ps(src + i))));
+  }
+#endif
+  for (; i < len; i++) {
+    dst[i] += weight * src[i];
+  }
+}
+
+static void resample_columns_task(void *__restrict userdata,
+                                  const int y,
+                                  const TaskParallelTLS *__restrict tls)
+{
+  const ResampleData *data = userdata;
+  const ResampleAxis *axis = &data->axis_y;
+  const int len = data->out_x * data->channels;
+  const float *weights = axis->weights + y * axis->taps;
+  const float *src = data->tmp + (size_t)axis->first[y] * len;
+
+  /* Whole rows are added up, so the inner loop streams through contiguous memory. */
+  float *dst = (data->out_float) ? data->out_float + (size_t)y * len :
+                                   resample_tls_row(tls->userdata_chunk, len);
+  memset(dst, 0, sizeof(float) * len);
+  for (int k = 0; k < axis->taps; k++, src += len) {
+    resample_madd(dst, src, weights[k], len);
+  }
+
+  if (data->out_byte) {
+    unsigned char *dst_byte = data->out_byte + (size_t)y * len;
+    if (data->premultiply) {
+      for (int x = 0; x < len; x += 4) {
+        premul_float_to_straight_uchar(dst_byte + x, dst + x);
+      }
+    }
+    else {
+      for (int x = 0; x < len; x++) {
+        dst_byte[x] = unit_float_to_uchar_clamp(dst[x]);
+      }
+    }
+  }
+}
+
+static void resample_buffer(ResampleData *data, int in_y, int out_y)
+{
+  ResampleTLS tls_data = {NULL};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.userdata_chunk = &tls_data;
+  settings.userdata_chunk_size = sizeof(tls_data);
+  settings.func_free = resample_tls_free;
+
+  data->tmp = MEM_mallocN(sizeof(float) * data->out_x * in_y * data->channels, __func__);
+
+  BLI_task_parallel_range(0, in_y, data, resample_rows_task, &settings);
+  BLI_task_parallel_range(0, out_y, data, resample_columns_task, &settings);
+
+  MEM_freeN(data->tmp);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Public API
+ * \{ */
+
+bool IMB_resampleImBuf(struct ImBuf *ibuf,
+                       unsigned int newx,
+                       unsigned int newy,
+                       eIMBResampleFilter filter)
+{
+  if (ibuf == NULL) {
+    return false;
+  }
+  if (ibuf->rect == NULL && ibuf->rect_float == NULL) {
+    return false;
+  }
+
+  /* A size of zero keeps the size of that axis. */
+  newx = (newx) ? newx : ibuf->x;
+  newy = (newy) ? newy : ibuf->y;
+  if (newx == ibuf->x && newy == ibuf->y) {
+    return false;
+  }
+
+  ResampleData data = {{0}};
+  resample_axis_init(&data.axis_x, ibuf->x, newx, filter);
+  resample_axis_init(&data.axis_y, ibuf->y, newy, filter);
+  data.in_x = ibuf->x;
+  data.out_x = newx;
+
+  if (ibuf->rect) {
+    unsigned char *rect = MEM_mallocN(sizeof(uchar[4]) * newx * newy, __func__);
+
+    data.channels = 4;
+    data.premultiply = (ibuf->planes == 32) &&
+                       !(ibuf->flags & (IB_alphamode_channel_packed | IB_alphamode_ignore));
+    data.in_byte = (unsigned char *)ibuf->rect;
+    data.in_float = NULL;
+    data.out_byte = rect;
+    data.out_float = NULL;
+    resample_buffer(&data, ibuf->y, newy);
+
+    imb_freerectImBuf(ibuf);
+    ibuf->mall |= IB_rect;
+    ibuf->rect = (unsigned int *)rect;
+  }
+
+  if (ibuf->rect_float) {
+    float *rect_float = MEM_mallocN(sizeof(float) * ibuf->channels * newx * newy, __func__);
+
+    data.channels = ibuf->channels;
+    data.premultiply = false;
+    data.in_byte = NULL;
+    data.in_float = ibuf->rect_float;
+    data.out_byte = NULL;
+    data.out_float = rect_float;
+    resample_buffer(&data, ibuf->y, newy);
+
+    imb_freerectfloatImBuf(ibuf);
+    ibuf->mall |= IB_rectfloat;
+    ibuf->rect_float = rect_float;
+  }
+
+  resample_axis_free(&data.axis_x);
+  resample_axis_free(&data.axis_y);
+
+  ibuf->x = newx;
+  ibuf->y = newy;
+  return true;
+}
+
+/** \} */
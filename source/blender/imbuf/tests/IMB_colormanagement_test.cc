@@ -0,0 +1,155 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "BKE_appdir.h"
+#include "BKE_colortools.h"
+
+#include "DNA_color_types.h"
+#include "DNA_userdef_types.h"
+
+#include "IMB_colormanagement.h"
+#include "IMB_imbuf.h"
+
+#include "intern/IMB_colormanagement_intern.h"
+
+namespace blender::imbuf::tests {
+
+class ColormanagementDisplayLUTTest : public testing::Test {
+ protected:
+  ColorManagedDisplaySettings display_settings;
+  ColorManagedViewSettings view_settings;
+  char display_lut_accuracy;
+
+  static void SetUpTestCase()
+  {
+    BKE_appdir_init();
+    IMB_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    IMB_exit();
+  }
+
+  void SetUp() override
+  {
+    display_lut_accuracy = U.display_lut_accuracy;
+    U.display_lut_accuracy = USER_DISPLAY_LUT_HIGH;
+
+    BKE_color_managed_display_settings_init(&display_settings);
+    IMB_colormanagement_init_default_view_settings(&view_settings, &display_settings);
+  }
+
+  void TearDown() override
+  {
+    BKE_color_managed_view_settings_free(&view_settings);
+    U.display_lut_accuracy = display_lut_accuracy;
+  }
+
+  std::vector<float> display_transform(std::vector<float> pixels, const bool use_display_lut)
+  {
+    ColormanageProcessor *cm_processor = IMB_colormanagement_display_processor_new(
+        &view_settings, &display_settings);
+    if (use_display_lut) {
+      colormanage_processor_use_display_lut(cm_processor, &view_settings, &display_settings);
+    }
+    IMB_colormanagement_processor_apply(
+        cm_processor, pixels.data(), pixels.size() / 4, 1, 4, false);
+    IMB_colormanagement_processor_free(cm_processor);
+    return pixels;
+  }
+
+  /* The fallback configuration, used when OpenColorIO or its configuration isn't available,
+   * leaves the display transform out. There is nothing to compare the LUT against then. */
+  bool has_display_transform()
+  {
+    const std::vector<float> gray = {0.2f, 0.2f, 0.2f, 1.0f};
+    return display_transform(gray, false) != gray;
+  }
+
+  /* Largest difference between the display transform with and without the LUT, in the range of
+   * display buffers. Relative to values above one when \a clamp is false. */
+  float max_display_lut_error(const std::vector<float> &pixels, const bool clamp = true)
+  {
+    const std::vector<float> expected = display_transform(pixels, false);
+    const std::vector<float> result = display_transform(pixels, true);
+
+    float max_error = 0.0f;
+    for (size_t i = 0; i < pixels.size(); i++) {
+      float value = result[i], expected_value = expected[i];
+      if (clamp) {
+        value = std::min(std::max(value, 0.0f), 1.0f);
+        expected_value = std::min(std::max(expected_value, 0.0f), 1.0f);
+      }
+      else {
+        const float scale = std::max(std::fabs(expected_value), 1.0f);
+        value /= scale;
+        expected_value /= scale;
+      }
+      max_error = std::max(max_error, std::fabs(value - expected_value));
+    }
+    return max_error;
+  }
+};
+
+/* Every combination of scene linear values covering the range of the LUT, spaced so samples fall
+ * between the grid points. */
+static std::vector<float> display_lut_test_pixels()
+{
+  std::vector<float> values = {0.0f};
+  for (float value = 1.0f / 8192.0f; value < 4096.0f; value *= 1.37f) {
+    values.push_back(value);
+  }
+  values.push_back(4096.0f);
+
+  std::vector<float> pixels;
+  for (const float r : values) {
+    for (const float g : values) {
+      for (const float b : values) {
+        pixels.insert(pixels.end(), {r, g, b, 1.0f});
+      }
+    }
+  }
+  return pixels;
+}
+
+TEST_F(ColormanagementDisplayLUTTest, Accuracy)
+{
+  if (!has_display_transform()) {
+    GTEST_SKIP();
+  }
+  /* The LUT is meant for 8-bit display buffers, it stays within half a step of them. */
+  EXPECT_LE(max_display_lut_error(display_lut_test_pixels()), 0.5f / 255.0f);
+}
+
+TEST_F(ColormanagementDisplayLUTTest, AccuracyExposure)
+{
+  if (!has_display_transform()) {
+    GTEST_SKIP();
+  }
+  view_settings.exposure = 1.5f;
+  EXPECT_LE(max_display_lut_error(display_lut_test_pixels()), 0.5f / 255.0f);
+}
+
+TEST_F(ColormanagementDisplayLUTTest, OutOfRange)
+{
+  if (!has_display_transform()) {
+    GTEST_SKIP();
+  }
+  /* Pixels with a channel outside the range of the LUT use the exact transform. */
+  const std::vector<float> pixels = {-0.5f,   0.2f, 0.8f, 1.0f, 0.5f, -1e-6f, 0.25f, 1.0f,
+                                     8192.0f, 0.2f, 0.8f, 1.0f, 0.1f, 0.3f,   1e6f,  1.0f};
+  EXPECT_LE(max_display_lut_error(pixels, false), 1e-5f);
+
+  /* Exposure moves values out of the range. */
+  view_settings.exposure = 2.0f;
+  const std::vector<float> pixels_exposure = {2000.0f, 0.2f, 0.8f, 1.0f};
+  EXPECT_LE(max_display_lut_error(pixels_exposure, false), 1e-5f);
+}
+
+}  // namespace blender::imbuf::tests
@@ -0,0 +1,191 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cstring>
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+namespace blender::imbuf::tests {
+
+/* Opaque pixels with varying colors, the byte and float buffers have the same values. */
+static ImBuf *create_test_image(const int width, const int height)
+{
+  ImBuf *ibuf = IMB_allocImBuf(width, height, 32, IB_rect | IB_rectfloat);
+  unsigned char *rect = (unsigned char *)ibuf->rect;
+  for (int i = 0; i < width * height; i++) {
+    for (int c = 0; c < 4; c++) {
+      const int value = (c == 3) ? 255 : (i * 37 + c * 61) % 256;
+      rect[i * 4 + c] = value;
+      ibuf->rect_float[i * 4 + c] = value / 255.0f;
+    }
+  }
+  return ibuf;
+}
+
+/* Rounding of the float math may differ between platforms, by one for bytes. */
+static void expect_image_eq(const ImBuf *ibuf,
+                            const int width,
+                            const int height,
+                            const unsigned char *expected_rect,
+                            const float *expected_rect_float)
+{
+  ASSERT_EQ(ibuf->x, width);
+  ASSERT_EQ(ibuf->y, height);
+  const unsigned char *rect = (const unsigned char *)ibuf->rect;
+  for (int i = 0; i < width * height * 4; i++) {
+    EXPECT_NEAR(rect[i], expected_rect[i], 1) << "byte " << i;
+    EXPECT_NEAR(ibuf->rect_float[i], expected_rect_float[i], 1e-6f) << "float " << i;
+  }
+}
+
+/* The expected values are the results of IMB_scaleImBuf before IMB_resampleImBuf was added,
+ * existing callers rely on them. */
+
+TEST(imbuf_scaling, ScaleDown)
+{
+  ImBuf *ibuf = create_test_image(4, 4);
+  EXPECT_TRUE(IMB_scaleImBuf(ibuf, 2, 2));
+
+  const unsigned char expected_rect[] = {
+      92, 153, 86, 255, 102, 100, 160, 255, 132, 130, 126, 255, 79, 139, 136, 255};
+  const float expected_rect_float[] = {0.361835986f, 0.601051688f, 0.339564621f, 1.0f,
+                                       0.402835697f, 0.391072601f, 0.629033387f, 1.0f,
+                                       0.51830554f,  0.509052217f, 0.496034205f, 1.0f,
+                                       0.309587717f, 0.546293557f, 0.535785317f, 1.0f};
+  expect_image_eq(ibuf, 2, 2, expected_rect, expected_rect_float);
+  IMB_freeImBuf(ibuf);
+}
+
+TEST(imbuf_scaling, ScaleDownFractional)
+{
+  ImBuf *ibuf = create_test_image(5, 3);
+  EXPECT_TRUE(IMB_scaleImBuf(ibuf, 3, 2));
+
+  const unsigned char expected_rect[] = {76,  103, 113, 255, 68,  111, 172, 255, 109, 170, 130, 255,
+                                         153, 180, 121, 255, 143, 153, 78,  255, 84,  76,  137, 255};
+  const float expected_rect_float[] = {0.298077255f, 0.404731721f, 0.44410646f,  1.0f,
+                                       0.264413893f, 0.436349809f, 0.675565422f, 1.0f,
+                                       0.429465413f, 0.668681085f, 0.508214891f, 1.0f,
+                                       0.598975658f, 0.702952147f, 0.47316733f,  1.0f,
+                                       0.559956312f, 0.599970281f, 0.304944426f, 1.0f,
+                                       0.327963591f, 0.298060089f, 0.537275791f, 1.0f};
+  expect_image_eq(ibuf, 3, 2, expected_rect, expected_rect_float);
+  IMB_freeImBuf(ibuf);
+}
+
+TEST(imbuf_scaling, ScaleUp)
+{
+  ImBuf *ibuf = create_test_image(2, 2);
+  EXPECT_TRUE(IMB_scaleImBuf(ibuf, 3, 3));
+
+  const unsigned char expected_rect[] = {0,   61,  122, 255, 18,  79,  140, 255, 37,  98,  159, 255,
+                                         37,  98,  159, 255, 55,  116, 177, 255, 74,  135, 196, 255,
+                                         74,  135, 196, 255, 92,  153, 214, 255, 111, 172, 233, 255};
+  const float expected_rect_float[] = {0.0f,         0.239215687f, 0.478431374f, 1.0f,
+                                       0.0724764764f, 0.311692178f, 0.55090785f,  1.0f,
+                                       0.144952953f, 0.384168625f, 0.623384356f, 1.0f,
+                                       0.144952953f, 0.384168655f, 0.623384356f, 1.0f,
+                                       0.217429429f, 0.456645131f, 0.695860803f, 1.0f,
+                                       0.289905906f, 0.529121578f, 0.768337309f, 1.0f,
+                                       0.289905906f, 0.529121637f, 0.76833725f,  1.0f,
+                                       0.362382382f, 0.601598024f, 0.840813756f, 1.0f,
+                                       0.434858829f, 0.674074531f, 0.913290262f, 1.0f};
+  expect_image_eq(ibuf, 3, 3, expected_rect, expected_rect_float);
+  IMB_freeImBuf(ibuf);
+}
+
+TEST(imbuf_scaling, ScaleThreaded)
+{
+  ImBuf *ibuf = create_test_image(4, 4);
+  IMB_scaleImBuf_threaded(ibuf, 3, 2);
+
+  const unsigned char expected_rect[] = {0,  61,  122, 255, 49, 110, 171, 255, 99,  160, 221, 255,
+                                         40, 101, 162, 255, 89, 150, 211, 255, 139, 200, 90,  255};
+  const float expected_rect_float[] = {0.0f,         0.239215687f, 0.478431374f, 1.0f,
+                                       0.193464071f, 0.432679772f, 0.671895504f, 1.0f,
+                                       0.386928141f, 0.626143813f, 0.865359545f, 1.0f,
+                                       0.156862751f, 0.396078438f, 0.635294139f, 1.0f,
+                                       0.350326836f, 0.589542508f, 0.82875818f,  1.0f,
+                                       0.543790877f, 0.783006549f, 0.352941096f, 1.0f};
+  expect_image_eq(ibuf, 3, 2, expected_rect, expected_rect_float);
+  IMB_freeImBuf(ibuf);
+}
+
+TEST(imbuf_scaling, OneHalf)
+{
+  /* The odd last column and row are left out. */
+  ImBuf *ibuf = create_test_image(5, 5);
+  ImBuf *half = IMB_onehalf(ibuf);
+  ASSERT_EQ(half->x, 2);
+  ASSERT_EQ(half->y, 2);
+
+  const unsigned char *rect = (const unsigned char *)ibuf->rect;
+  const unsigned char *half_rect = (const unsigned char *)half->rect;
+  for (int y = 0; y < 2; y++) {
+    for (int x = 0; x < 2; x++) {
+      const int i1 = ((y * 2) * 5 + x * 2) * 4;
+      const int i2 = i1 + 5 * 4;
+      const int i = (y * 2 + x) * 4;
+      for (int c = 0; c < 4; c++) {
+        /* Opaque, so premultiplication doesn't change the average. */
+        const int sum = rect[i1 + c] + rect[i2 + c] + rect[i1 + 4 + c] + rect[i2 + 4 + c];
+        EXPECT_NEAR(half_rect[i + c], sum / 4, 1);
+
+        const float *rect_float = ibuf->rect_float;
+        EXPECT_EQ(half->rect_float[i + c],
+                  0.25f * (rect_float[i1 + c] + rect_float[i2 + c] + rect_float[i1 + 4 + c] +
+                           rect_float[i2 + 4 + c]));
+      }
+    }
+  }
+
+  IMB_freeImBuf(half);
+  IMB_freeImBuf(ibuf);
+}
+
+TEST(imbuf_scaling, ResampleAreaAverage)
+{
+  ImBuf *ibuf = create_test_image(4, 4);
+  ImBuf *orig = IMB_dupImBuf(ibuf);
+  EXPECT_TRUE(IMB_resampleImBuf(ibuf, 2, 2, IMB_FILTER_AREA));
+  ASSERT_EQ(ibuf->x, 2);
+  ASSERT_EQ(ibuf->y, 2);
+
+  for (int y = 0; y < 2; y++) {
+    for (int x = 0; x < 2; x++) {
+      const int i1 = ((y * 2) * 4 + x * 2) * 4;
+      const int i2 = i1 + 4 * 4;
+      const int i = (y * 2 + x) * 4;
+      for (int c = 0; c < 4; c++) {
+        const float *rect_float = orig->rect_float;
+        const float average = 0.25f * (rect_float[i1 + c] + rect_float[i2 + c] +
+                                       rect_float[i1 + 4 + c] + rect_float[i2 + 4 + c]);
+        EXPECT_NEAR(ibuf->rect_float[i + c], average, 1e-6f);
+        EXPECT_NEAR(((unsigned char *)ibuf->rect)[i + c], average * 255.0f, 1.0f);
+      }
+    }
+  }
+
+  IMB_freeImBuf(orig);
+  IMB_freeImBuf(ibuf);
+}
+
+TEST(imbuf_scaling, ResamplePremultiplied)
+{
+  /* The color of a transparent pixel doesn't bleed into the result. */
+  ImBuf *ibuf = IMB_allocImBuf(2, 1, 32, IB_rect);
+  const unsigned char pixels[] = {255, 0, 0, 255, 0, 255, 0, 0};
+  memcpy(ibuf->rect, pixels, sizeof(pixels));
+  EXPECT_TRUE(IMB_resampleImBuf(ibuf, 1, 1, IMB_FILTER_AREA));
+
+  const unsigned char *rect = (const unsigned char *)ibuf->rect;
+  EXPECT_EQ(rect[0], 255);
+  EXPECT_EQ(rect[1], 0);
+  EXPECT_EQ(rect[2], 0);
+  EXPECT_EQ(rect[3], 128);
+  IMB_freeImBuf(ibuf);
+}
+
+}  // namespace blender::imbuf::tests
@@ -62,6 +62,7 @@ struct AlembicExportParams {
   bool export_particles;
   bool export_custom_properties;
   bool use_instancing;
+  bool use_parallel_evaluation;
 
   /* See MOD_TRIANGULATE_NGON_xxx and MOD_TRIANGULATE_QUAD_xxx
    * in DNA_modifier_types.h */
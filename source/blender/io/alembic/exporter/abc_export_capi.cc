@@ -22,6 +22,8 @@
 #include "abc_hierarchy_iterator.h"
 #include "abc_subdiv_disabler.h"
 
+#include "IO_frame_evaluator.hh"
+
 #include "MEM_guardedalloc.h"
 
 #include "DEG_depsgraph.h"
@@ -49,6 +51,7 @@ static CLG_LogRef LOG = {"io.alembic"};
 
 #include <algorithm>
 #include <memory>
+#include <vector>
 
 struct ExportJobData {
   Main *bmain;
@@ -138,29 +141,31 @@ static void export_startjob(void *customdata,
 
     /* Writing the animated frames is not 100% of the work, but it's our best guess. */
     const float progress_per_frame = 1.0f / std::max(size_t(1), abc_archive->total_frame_count());
-    ABCArchive::Frames::const_iterator frame_it = abc_archive->frames_begin();
-    const ABCArchive::Frames::const_iterator frames_end = abc_archive->frames_end();
-
-    for (; frame_it != frames_end; frame_it++) {
-      double frame = *frame_it;
-
-      if (G.is_break || (stop != nullptr && *stop)) {
-        break;
-      }
-
-      /* Update the scene for the next frame to render. */
-      scene->r.cfra = static_cast<int>(frame);
-      scene->r.subframe = frame - scene->r.cfra;
-      BKE_scene_graph_update_for_newframe(data->depsgraph);
-
-      CLOG_INFO(&LOG, 2, "Exporting frame %.2f", frame);
-      ExportSubset export_subset = abc_archive->export_subset_for_frame(frame);
-      iter.set_export_subset(export_subset);
-      iter.iterate_and_write();
-
-      *progress += progress_per_frame;
-      *do_update = true;
-    }
+    const std::vector<double> frames(abc_archive->frames_begin(), abc_archive->frames_end());
+    const bool visible_objects_only = data->params.visible_objects_only;
+
+    evaluate_frames(
+        data->depsgraph,
+        frames,
+        data->params.use_parallel_evaluation,
+        [visible_objects_only](Depsgraph *depsgraph) {
+          build_depsgraph(depsgraph, visible_objects_only);
+        },
+        [&](double frame, Depsgraph *depsgraph) {
+          if (G.is_break || (stop != nullptr && *stop)) {
+            return false;
+          }
+
+          CLOG_INFO(&LOG, 2, "Exporting frame %.2f", frame);
+          ExportSubset export_subset = abc_archive->export_subset_for_frame(frame);
+          iter.set_depsgraph(depsgraph);
+          iter.set_export_subset(export_subset);
+          iter.iterate_and_write();
+
+          *progress += progress_per_frame;
+          *do_update = true;
+          return true;
+        });
   }
   else {
     /* If we're not animating, a single iteration over all objects is enough. */
@@ -218,13 +218,17 @@ class AbstractHierarchyIterator {
   typedef std::set<HierarchyContext *> ExportChildren;
   /* Mapping from an object and its duplicator to the object's export-children. */
   typedef std::map<ObjectIdentifier, ExportChildren> ExportGraph;
-  /* Mapping from ID to its export path. This is used for instancing; given an
-   * instanced datablock, the export path of the original can be looked up. */
+  /* Mapping from original ID to its export path. This is used for instancing; given an
+   * instanced datablock, the export path of the original can be looked up. Original IDs are the
+   * same in every dependency graph, see #set_depsgraph(). */
   typedef std::map<ID *, std::string> ExportPathMap;
 
  protected:
   ExportGraph export_graph_;
+  /* Objects by original object. */
   ExportPathMap duplisource_export_path_;
+  /* Object data by original data, or by original object for data created by its evaluation. */
+  ExportPathMap duplisource_data_export_path_;
   Depsgraph *depsgraph_;
   WriterMap writers_;
   ExportSubset export_subset_;
@@ -250,6 +254,14 @@ class AbstractHierarchyIterator {
    * previous iteration. */
   void set_export_subset(ExportSubset export_subset_);
 
+  /* Dependency graph the writers get the evaluated data from. */
+  Depsgraph *get_depsgraph() const;
+
+  /* Iterate over another dependency graph from the next call to iterate_and_write() on, for when
+   * the frames of an animation are evaluated in several dependency graphs. The writers are kept,
+   * they get their data from the new dependency graph. */
+  void set_depsgraph(Depsgraph *depsgraph);
+
   /* Convert the given name to something that is valid for the exported file format.
    * This base implementation is a no-op; override in a concrete subclass. */
   virtual std::string make_valid_name(const std::string &name) const;
@@ -0,0 +1,54 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2021 Blender Foundation.
+ * All rights reserved.
+ */
+#pragma once
+
+#include <functional>
+#include <vector>
+
+struct Depsgraph;
+
+namespace blender::io {
+
+/* Build a dependency graph the same way as the one the export started with. */
+typedef std::function<void(Depsgraph *depsgraph)> BuildDepsgraphFn;
+
+/* Called for every evaluated frame, with the dependency graph the frame was evaluated in.
+ * Return false to stop evaluating frames, for example when the export is cancelled. */
+typedef std::function<bool(double frame, Depsgraph *depsgraph)> ConsumeFrameFn;
+
+/* Return true when no frame depends on the evaluation of the frame before it, so that frames can
+ * be evaluated in any order. This is not the case for scenes with simulations or point caches,
+ * and for scenes with image sequences or movies, which take their frame from the original
+ * scene. */
+bool frames_can_evaluate_in_parallel(Depsgraph *depsgraph);
+
+/* Evaluate `depsgraph` for each of the frames and call `consume_frame` for them, in order.
+ *
+ * Frames are evaluated one at a time by setting the current frame of the scene, unless
+ * `use_parallel` is set and #frames_can_evaluate_in_parallel() allows it. In that case additional
+ * dependency graphs are built with `build_depsgraph`, and all of them evaluate upcoming frames at
+ * the same time while the consumer handles the current one. The current frame of the scene is
+ * restored then, and frame change handlers are not called. */
+void evaluate_frames(Depsgraph *depsgraph,
+                     const std::vector<double> &frames,
+                     bool use_parallel,
+                     const BuildDepsgraphFn &build_depsgraph,
+                     const ConsumeFrameFn &consume_frame);
+
+}  // namespace blender::io
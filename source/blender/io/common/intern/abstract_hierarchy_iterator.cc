@@ -220,6 +220,16 @@ void AbstractHierarchyIterator::set_export_subset(ExportSubset export_subset)
   export_subset_ = export_subset;
 }
 
+Depsgraph *AbstractHierarchyIterator::get_depsgraph() const
+{
+  return depsgraph_;
+}
+
+void AbstractHierarchyIterator::set_depsgraph(Depsgraph *depsgraph)
+{
+  depsgraph_ = depsgraph;
+}
+
 std::string AbstractHierarchyIterator::make_valid_name(const std::string &name) const
 {
   return name;
@@ -516,6 +526,24 @@ AbstractHierarchyIterator::ExportChildren &AbstractHierarchyIterator::graph_chil
   return export_graph_[ObjectIdentifier::for_hierarchy_context(context)];
 }
 
+/* Instancing is tracked by original IDs, so that it's the same in every dependency graph the
+ * frames are evaluated in. */
+static ID *duplisource_key_object(Object *object)
+{
+  return DEG_get_original_id(&object->id);
+}
+
+static ID *duplisource_key_object_data(Object *object)
+{
+  ID *data = static_cast<ID *>(object->data);
+  if (data->orig_id != nullptr) {
+    /* Copy-on-write data, which is shared by all objects using the original data. */
+    return data->orig_id;
+  }
+  /* Data created by evaluating the object, for example by its modifiers. */
+  return DEG_get_original_id(&object->id);
+}
+
 void AbstractHierarchyIterator::determine_export_paths(const HierarchyContext *parent_context)
 {
   const std::string &parent_export_path = parent_context ? parent_context->export_path : "";
@@ -526,12 +554,12 @@ void AbstractHierarchyIterator::determine_export_paths(const HierarchyContext *p
     if (context->duplicator == nullptr) {
       /* This is an original (i.e. non-instanced) object, so we should keep track of where it was
        * exported to, just in case it gets instanced somewhere. */
-      ID *source_ob = &context->object->id;
+      ID *source_ob = duplisource_key_object(context->object);
       duplisource_export_path_[source_ob] = context->export_path;
 
       if (context->object->data != nullptr) {
-        ID *source_data = static_cast<ID *>(context->object->data);
-        duplisource_export_path_[source_data] = get_object_data_path(context);
+        ID *source_data = duplisource_key_object_data(context->object);
+        duplisource_data_export_path_[source_data] = get_object_data_path(context);
       }
     }
 
@@ -546,7 +574,7 @@ void AbstractHierarchyIterator::determine_duplication_references(
 
   for (HierarchyContext *context : children) {
     if (context->duplicator != nullptr) {
-      ID *source_id = &context->object->id;
+      ID *source_id = duplisource_key_object(context->object);
       const ExportPathMap::const_iterator &it = duplisource_export_path_.find(source_id);
 
       if (it == duplisource_export_path_.end()) {
@@ -559,15 +587,16 @@ void AbstractHierarchyIterator::determine_duplication_references(
       }
 
       if (context->object->data) {
-        ID *source_data_id = (ID *)context->object->data;
-        const ExportPathMap::const_iterator &it = duplisource_export_path_.find(source_data_id);
+        ID *source_data_id = duplisource_key_object_data(context->object);
+        const ExportPathMap::const_iterator &it = duplisource_data_export_path_.find(
+            source_data_id);
 
-        if (it == duplisource_export_path_.end()) {
+        if (it == duplisource_data_export_path_.end()) {
           /* The original was not found, so mark this instance as "original". */
           std::string data_path = get_object_data_path(context);
           context->mark_as_not_instanced();
           duplisource_export_path_[source_id] = context->export_path;
-          duplisource_export_path_[source_data_id] = data_path;
+          duplisource_data_export_path_[source_data_id] = data_path;
         }
       }
     }
@@ -644,8 +673,8 @@ void AbstractHierarchyIterator::make_writer_object_data(const HierarchyContext *
 
   HierarchyContext data_context = context_for_object_data(context);
   if (data_context.is_instance()) {
-    ID *object_data = static_cast<ID *>(context->object->data);
-    data_context.original_export_path = duplisource_export_path_[object_data];
+    ID *object_data = duplisource_key_object_data(context->object);
+    data_context.original_export_path = duplisource_data_export_path_[object_data];
 
     /* If the object is marked as an instance, so should the object data. */
     BLI_assert(data_context.is_instance());
@@ -20,15 +20,23 @@
 
 #include "tests/blendfile_loading_base_test.h"
 
+#include "BKE_collection.h"
+#include "BKE_layer.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
 #include "BKE_scene.h"
 #include "BLI_math.h"
 #include "BLO_readfile.h"
 #include "DEG_depsgraph.h"
 #include "DEG_depsgraph_build.h"
+#include "DNA_collection_types.h"
 #include "DNA_object_types.h"
 
 #include <map>
 #include <set>
+#include <vector>
 
 namespace blender::io {
 
@@ -360,4 +368,135 @@ TEST_F(AbstractHierarchyIteratorInvisibleTest, ExportInvisibleTest)
   EXPECT_EQ(0, iterator->particle_writers.size());
 }
 
+/* Mapping from export path to the export path of the original, empty when not instanced. */
+typedef std::map<std::string, std::string> instanced_paths;
+
+class InstancingHierarchyWriter : public AbstractHierarchyWriter {
+ public:
+  instanced_paths &paths;
+
+  explicit InstancingHierarchyWriter(instanced_paths &paths) : paths(paths)
+  {
+  }
+
+  void write(HierarchyContext &context) override
+  {
+    paths[context.export_path] = context.original_export_path;
+  }
+};
+
+/* Records the instancing of every iteration, writers are written to more than once. */
+class InstancingHierarchyIterator : public AbstractHierarchyIterator {
+ public:
+  instanced_paths paths;
+
+  explicit InstancingHierarchyIterator(Depsgraph *depsgraph) : AbstractHierarchyIterator(depsgraph)
+  {
+  }
+  ~InstancingHierarchyIterator() override
+  {
+    release_writers();
+  }
+
+ protected:
+  AbstractHierarchyWriter *create_transform_writer(const HierarchyContext * /*context*/) override
+  {
+    return new InstancingHierarchyWriter(paths);
+  }
+  AbstractHierarchyWriter *create_data_writer(const HierarchyContext * /*context*/) override
+  {
+    return new InstancingHierarchyWriter(paths);
+  }
+  AbstractHierarchyWriter *create_hair_writer(const HierarchyContext * /*context*/) override
+  {
+    return nullptr;
+  }
+  AbstractHierarchyWriter *create_particle_writer(const HierarchyContext * /*context*/) override
+  {
+    return nullptr;
+  }
+
+  void release_writer(AbstractHierarchyWriter *writer) override
+  {
+    delete writer;
+  }
+};
+
+/* Builds a scene instancing a collection twice, instead of loading a file. */
+class AbstractHierarchyIteratorSetDepsgraphTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Depsgraph *depsgraph_other = nullptr;
+
+  void SetUp() override
+  {
+    bmain = BKE_main_new();
+    Scene *scene = BKE_scene_add(bmain, "Scene");
+
+    /* The collection is not in the scene, its objects are only exported as instances. */
+    Collection *collection = BKE_collection_add(bmain, nullptr, "Instanced");
+    Object *source = BKE_object_add_only_object(bmain, OB_MESH, "Source");
+    source->data = BKE_mesh_add(bmain, "SourceMesh");
+    BKE_collection_object_add(bmain, collection, source);
+
+    for (const char *name : {"InstancerA", "InstancerB"}) {
+      Object *instancer = BKE_object_add_only_object(bmain, OB_EMPTY, name);
+      instancer->transflag |= OB_DUPLICOLLECTION;
+      instancer->instance_collection = collection;
+      id_us_plus(&collection->id);
+      BKE_collection_object_add(bmain, scene->master_collection, instancer);
+    }
+
+    depsgraph = depsgraph_new(scene);
+    depsgraph_other = depsgraph_new(scene);
+  }
+
+  void TearDown() override
+  {
+    DEG_graph_free(depsgraph_other);
+    BlendfileLoadingBaseTest::TearDown();
+    BKE_main_free(bmain);
+  }
+
+  Depsgraph *depsgraph_new(Scene *scene)
+  {
+    Depsgraph *depsgraph = DEG_graph_new(
+        bmain, scene, BKE_view_layer_default_view(scene), DAG_EVAL_RENDER);
+    DEG_graph_build_from_view_layer(depsgraph);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+    return depsgraph;
+  }
+};
+
+/* Frames evaluated in several dependency graphs are exported as if they were all evaluated in
+ * the same one. */
+TEST_F(AbstractHierarchyIteratorSetDepsgraphTest, InstancingAcrossDepsgraphs)
+{
+  std::vector<instanced_paths> expected;
+  {
+    InstancingHierarchyIterator iterator(depsgraph);
+    for (int i = 0; i < 3; i++) {
+      iterator.paths.clear();
+      iterator.iterate_and_write();
+      expected.push_back(iterator.paths);
+    }
+  }
+
+  /* One of the instances is exported as the original, the other references it. */
+  int num_instances = 0;
+  for (const instanced_paths::value_type &path : expected[0]) {
+    num_instances += !path.second.empty();
+  }
+  EXPECT_GT(num_instances, 0);
+
+  InstancingHierarchyIterator iterator(depsgraph);
+  for (Depsgraph *frame_depsgraph : {depsgraph, depsgraph_other, depsgraph}) {
+    iterator.set_depsgraph(frame_depsgraph);
+    iterator.paths.clear();
+    iterator.iterate_and_write();
+  }
+  /* The writers were created in the first iteration, all iterations write to them. */
+  EXPECT_EQ(expected.back(), iterator.paths);
+}
+
 }  // namespace blender::io
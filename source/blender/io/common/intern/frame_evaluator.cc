@@ -0,0 +1,274 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2021 Blender Foundation.
+ * All rights reserved.
+ */
+#include "IO_frame_evaluator.hh"
+
+#include "BKE_main.h"
+#include "BKE_pointcache.h"
+#include "BKE_scene.h"
+
+#include "BLI_listbase.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_query.h"
+
+#include "DNA_image_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include <algorithm>
+
+namespace blender::io {
+
+/* Upper bound of the number of dependency graphs evaluating at the same time. Every one of them
+ * holds an evaluated copy of the scene, so this limits the memory used. */
+static const int MAX_PARALLEL_FRAMES = 8;
+
+namespace {
+
+struct ParallelFrameEvaluation {
+  const std::vector<double> *frames;
+  std::vector<Depsgraph *> depsgraphs;
+
+  ThreadMutex mutex;
+  ThreadCondition condition;
+
+  /* Index of the frame every dependency graph was last evaluated for, -1 before its first
+   * evaluation. */
+  std::vector<int> evaluated_frame_index;
+  /* Number of frames the consumer is done with. A dependency graph can only evaluate its next
+   * frame once the consumer is done with its previous one. */
+  int num_consumed_frames;
+  bool cancel;
+};
+
+struct FrameEvaluationThread {
+  ParallelFrameEvaluation *evaluation;
+  int depsgraph_index;
+};
+
+}  // namespace
+
+static bool object_depends_on_previous_frame(Scene *scene, Object *object)
+{
+  if (BKE_ptcache_object_has(scene, object, 0)) {
+    return true;
+  }
+  /* Simulations without a point cache. */
+  LISTBASE_FOREACH (ModifierData *, md, &object->modifiers) {
+    if (ELEM(md->type, eModifierType_Fluidsim, eModifierType_Simulation)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool frames_can_evaluate_in_parallel(Depsgraph *depsgraph)
+{
+  Main *bmain = DEG_get_bmain(depsgraph);
+  Scene *scene = DEG_get_input_scene(depsgraph);
+
+  if (scene->rigidbody_world != nullptr) {
+    return false;
+  }
+  /* The frame of image users is updated from the original scene in
+   * BKE_image_editors_update_frame(), which only works for one frame at a time. */
+  LISTBASE_FOREACH (Image *, image, &bmain->images) {
+    if (ELEM(image->source, IMA_SRC_SEQUENCE, IMA_SRC_MOVIE)) {
+      return false;
+    }
+  }
+
+  bool can_evaluate_in_parallel = true;
+  DEG_OBJECT_ITER_BEGIN (depsgraph,
+                         object_eval,
+                         DEG_ITER_OBJECT_FLAG_LINKED_DIRECTLY |
+                             DEG_ITER_OBJECT_FLAG_LINKED_INDIRECTLY |
+                             DEG_ITER_OBJECT_FLAG_LINKED_VIA_SET) {
+    if (object_depends_on_previous_frame(scene, DEG_get_original_object(object_eval))) {
+      can_evaluate_in_parallel = false;
+      break;
+    }
+  }
+  DEG_OBJECT_ITER_END;
+  return can_evaluate_in_parallel;
+}
+
+/* Evaluate the frame without touching the original scene, which is shared with the other
+ * dependency graphs. Only for dependency graphs that were evaluated before, see
+ * #depsgraph_evaluate_first_frame(). */
+static void depsgraph_evaluate_frame(Depsgraph *depsgraph, const double frame)
+{
+  Scene *scene_eval = DEG_get_evaluated_scene(depsgraph);
+  BKE_scene_frame_set(scene_eval, frame);
+  DEG_evaluate_on_framechange(depsgraph, BKE_scene_frame_get(scene_eval));
+  DEG_ids_clear_recalc(DEG_get_bmain(depsgraph), depsgraph);
+}
+
+/* The first evaluation of a dependency graph copies the evaluated scene from the original one,
+ * including its frame. So the original scene is set to the frame for it, which requires that no
+ * other dependency graph evaluates at the same time. */
+static void depsgraph_evaluate_first_frame(Depsgraph *depsgraph, const double frame)
+{
+  Scene *scene = DEG_get_input_scene(depsgraph);
+  const int cfra = scene->r.cfra;
+  const float subframe = scene->r.subframe;
+
+  BKE_scene_frame_set(scene, frame);
+  DEG_evaluate_on_framechange(depsgraph, BKE_scene_frame_get(scene));
+  DEG_ids_clear_recalc(DEG_get_bmain(depsgraph), depsgraph);
+
+  scene->r.cfra = cfra;
+  scene->r.subframe = subframe;
+}
+
+static void *frame_evaluation_thread_run(void *customdata)
+{
+  FrameEvaluationThread *thread = static_cast<FrameEvaluationThread *>(customdata);
+  ParallelFrameEvaluation *evaluation = thread->evaluation;
+  Depsgraph *depsgraph = evaluation->depsgraphs[thread->depsgraph_index];
+  const int num_depsgraphs = evaluation->depsgraphs.size();
+  const int num_frames = evaluation->frames->size();
+
+  /* Every dependency graph evaluates every N-th frame. The first frame of the new dependency
+   * graphs was evaluated already. */
+  int frame_index = thread->depsgraph_index;
+  if (evaluation->evaluated_frame_index[thread->depsgraph_index] == frame_index) {
+    frame_index += num_depsgraphs;
+  }
+  for (; frame_index < num_frames; frame_index += num_depsgraphs) {
+    BLI_mutex_lock(&evaluation->mutex);
+    while (!evaluation->cancel &&
+           frame_index >= evaluation->num_consumed_frames + num_depsgraphs) {
+      BLI_condition_wait(&evaluation->condition, &evaluation->mutex);
+    }
+    const bool cancel = evaluation->cancel;
+    BLI_mutex_unlock(&evaluation->mutex);
+
+    if (cancel) {
+      break;
+    }
+
+    depsgraph_evaluate_frame(depsgraph, (*evaluation->frames)[frame_index]);
+
+    BLI_mutex_lock(&evaluation->mutex);
+    evaluation->evaluated_frame_index[thread->depsgraph_index] = frame_index;
+    BLI_condition_notify_all(&evaluation->condition);
+    BLI_mutex_unlock(&evaluation->mutex);
+  }
+  return nullptr;
+}
+
+static void evaluate_frames_parallel(Depsgraph *depsgraph,
+                                     const std::vector<double> &frames,
+                                     const int num_depsgraphs,
+                                     const BuildDepsgraphFn &build_depsgraph,
+                                     const ConsumeFrameFn &consume_frame)
+{
+  Main *bmain = DEG_get_bmain(depsgraph);
+  Scene *scene = DEG_get_input_scene(depsgraph);
+  ViewLayer *view_layer = DEG_get_input_view_layer(depsgraph);
+
+  ParallelFrameEvaluation evaluation;
+  evaluation.frames = &frames;
+  evaluation.evaluated_frame_index.resize(num_depsgraphs, -1);
+  evaluation.depsgraphs.push_back(depsgraph);
+  for (int i = 1; i < num_depsgraphs; i++) {
+    Depsgraph *frame_depsgraph = DEG_graph_new(bmain, scene, view_layer, DEG_get_mode(depsgraph));
+    build_depsgraph(frame_depsgraph);
+    depsgraph_evaluate_first_frame(frame_depsgraph, frames[i]);
+    evaluation.depsgraphs.push_back(frame_depsgraph);
+    evaluation.evaluated_frame_index[i] = i;
+  }
+  BLI_mutex_init(&evaluation.mutex);
+  BLI_condition_init(&evaluation.condition);
+  evaluation.num_consumed_frames = 0;
+  evaluation.cancel = false;
+
+  std::vector<FrameEvaluationThread> threads(num_depsgraphs);
+  ListBase threadbase;
+  BLI_threadpool_init(&threadbase, frame_evaluation_thread_run, num_depsgraphs);
+  for (int i = 0; i < num_depsgraphs; i++) {
+    threads[i].evaluation = &evaluation;
+    threads[i].depsgraph_index = i;
+    BLI_threadpool_insert(&threadbase, &threads[i]);
+  }
+
+  const int num_frames = frames.size();
+  for (int frame_index = 0; frame_index < num_frames; frame_index++) {
+    const int depsgraph_index = frame_index % num_depsgraphs;
+
+    BLI_mutex_lock(&evaluation.mutex);
+    while (evaluation.evaluated_frame_index[depsgraph_index] != frame_index) {
+      BLI_condition_wait(&evaluation.condition, &evaluation.mutex);
+    }
+    BLI_mutex_unlock(&evaluation.mutex);
+
+    const bool keep_going = consume_frame(frames[frame_index],
+                                          evaluation.depsgraphs[depsgraph_index]);
+
+    BLI_mutex_lock(&evaluation.mutex);
+    evaluation.num_consumed_frames = frame_index + 1;
+    evaluation.cancel = !keep_going;
+    BLI_condition_notify_all(&evaluation.condition);
+    BLI_mutex_unlock(&evaluation.mutex);
+
+    if (!keep_going) {
+      break;
+    }
+  }
+
+  BLI_threadpool_end(&threadbase);
+  BLI_condition_end(&evaluation.condition);
+  BLI_mutex_end(&evaluation.mutex);
+
+  for (int i = 1; i < num_depsgraphs; i++) {
+    DEG_graph_free(evaluation.depsgraphs[i]);
+  }
+}
+
+void evaluate_frames(Depsgraph *depsgraph,
+                     const std::vector<double> &frames,
+                     const bool use_parallel,
+                     const BuildDepsgraphFn &build_depsgraph,
+                     const ConsumeFrameFn &consume_frame)
+{
+  const int num_depsgraphs = std::min(
+      {BLI_system_thread_count(), MAX_PARALLEL_FRAMES, static_cast<int>(frames.size())});
+
+  if (use_parallel && num_depsgraphs > 1 && frames_can_evaluate_in_parallel(depsgraph)) {
+    evaluate_frames_parallel(depsgraph, frames, num_depsgraphs, build_depsgraph, consume_frame);
+    return;
+  }
+
+  Scene *scene = DEG_get_input_scene(depsgraph);
+  for (const double frame : frames) {
+    /* Update the scene for the next frame to render. */
+    BKE_scene_frame_set(scene, frame);
+    BKE_scene_graph_update_for_newframe(depsgraph);
+
+    if (!consume_frame(frame, depsgraph)) {
+      break;
+    }
+  }
+}
+
+}  // namespace blender::io
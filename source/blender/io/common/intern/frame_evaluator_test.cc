@@ -0,0 +1,231 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2021 Blender Foundation.
+ * All rights reserved.
+ */
+#include "IO_frame_evaluator.hh"
+
+#include "tests/blendfile_loading_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BKE_action.h"
+#include "BKE_anim_data.h"
+#include "BKE_collection.h"
+#include "BKE_fcurve.h"
+#include "BKE_layer.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+
+#include "DNA_anim_types.h"
+#include "DNA_image_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include <climits>
+#include <set>
+#include <vector>
+
+namespace blender::io {
+
+namespace {
+
+struct EvaluatedFrame {
+  double frame;
+  Depsgraph *depsgraph;
+  /* State of the evaluated scene and object, when the frame is consumed. */
+  int cfra;
+  float subframe;
+  float location_x;
+};
+
+}  // namespace
+
+/* Builds a scene with an object that moves along X by one unit per frame, instead of loading a
+ * file. */
+class FrameEvaluatorTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+
+  void SetUp() override
+  {
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    scene->r.cfra = 1;
+    scene->r.subframe = 0.0f;
+
+    Object *object = BKE_object_add_only_object(bmain, OB_EMPTY, "Animated");
+    BKE_collection_object_add(bmain, scene->master_collection, object);
+    object_animate_location_x(object);
+
+    depsgraph = DEG_graph_new(bmain, scene, BKE_view_layer_default_view(scene), DAG_EVAL_RENDER);
+    build_depsgraph(depsgraph);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+  }
+
+  void TearDown() override
+  {
+    BLI_system_num_threads_override_set(0);
+    BlendfileLoadingBaseTest::TearDown();
+    BKE_main_free(bmain);
+  }
+
+  static void build_depsgraph(Depsgraph *depsgraph)
+  {
+    DEG_graph_build_from_view_layer(depsgraph);
+  }
+
+  void object_animate_location_x(Object *object)
+  {
+    bAction *action = BKE_action_add(bmain, "Action");
+    FCurve *fcu = BKE_fcurve_create();
+    fcu->rna_path = BLI_strdup("location");
+    fcu->array_index = 0;
+    fcu->totvert = 2;
+    fcu->bezt = (BezTriple *)MEM_calloc_arrayN(fcu->totvert, sizeof(BezTriple), __func__);
+    for (int i = 0; i < fcu->totvert; i++) {
+      BezTriple *bezt = &fcu->bezt[i];
+      bezt->vec[1][0] = bezt->vec[1][1] = i * 100.0f;
+      bezt->ipo = BEZT_IPO_LIN;
+      bezt->h1 = bezt->h2 = HD_AUTO_ANIM;
+    }
+    calchandles_fcurve(fcu);
+    BLI_addtail(&action->curves, fcu);
+
+    AnimData *adt = BKE_animdata_add_id(&object->id);
+    adt->action = action;
+    id_us_plus(&action->id);
+  }
+
+  std::vector<EvaluatedFrame> evaluate(const std::vector<double> &frames,
+                                       const bool use_parallel,
+                                       const int num_frames_to_consume = INT_MAX)
+  {
+    std::vector<EvaluatedFrame> evaluated_frames;
+    evaluate_frames(depsgraph,
+                    frames,
+                    use_parallel,
+                    build_depsgraph,
+                    [&](const double frame, Depsgraph *frame_depsgraph) {
+                      const Scene *scene_eval = DEG_get_evaluated_scene(frame_depsgraph);
+                      Object *object = (Object *)BKE_libblock_find_name(bmain, ID_OB, "Animated");
+                      const Object *object_eval = DEG_get_evaluated_object(frame_depsgraph,
+                                                                           object);
+                      evaluated_frames.push_back({frame,
+                                                  frame_depsgraph,
+                                                  scene_eval->r.cfra,
+                                                  scene_eval->r.subframe,
+                                                  object_eval->loc[0]});
+                      return static_cast<int>(evaluated_frames.size()) < num_frames_to_consume;
+                    });
+    return evaluated_frames;
+  }
+
+  void expect_frames_evaluated(const std::vector<double> &frames,
+                               const std::vector<EvaluatedFrame> &evaluated_frames)
+  {
+    ASSERT_EQ(evaluated_frames.size(), frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+      const EvaluatedFrame &evaluated = evaluated_frames[i];
+      EXPECT_EQ(evaluated.frame, frames[i]);
+      EXPECT_EQ(evaluated.cfra, static_cast<int>(frames[i]));
+      EXPECT_FLOAT_EQ(evaluated.subframe, frames[i] - static_cast<int>(frames[i]));
+      EXPECT_FLOAT_EQ(evaluated.location_x, frames[i]) << "frame " << frames[i];
+    }
+  }
+};
+
+TEST_F(FrameEvaluatorTest, Sequential)
+{
+  const std::vector<double> frames = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+  std::vector<EvaluatedFrame> evaluated_frames = evaluate(frames, false);
+
+  expect_frames_evaluated(frames, evaluated_frames);
+  for (const EvaluatedFrame &evaluated : evaluated_frames) {
+    EXPECT_EQ(evaluated.depsgraph, depsgraph);
+  }
+  /* The sequential path changes the frame of the scene. */
+  EXPECT_EQ(scene->r.cfra, 6);
+}
+
+TEST_F(FrameEvaluatorTest, Parallel)
+{
+  BLI_system_num_threads_override_set(4);
+  const std::vector<double> frames = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0};
+  std::vector<EvaluatedFrame> evaluated_frames = evaluate(frames, true);
+
+  /* Includes the first frame of every dependency graph, which copies the scene from the
+   * original. */
+  expect_frames_evaluated(frames, evaluated_frames);
+
+  std::set<Depsgraph *> depsgraphs;
+  for (const EvaluatedFrame &evaluated : evaluated_frames) {
+    depsgraphs.insert(evaluated.depsgraph);
+  }
+  EXPECT_EQ(depsgraphs.size(), 4);
+
+  /* The original scene is left at its frame. */
+  EXPECT_EQ(scene->r.cfra, 1);
+  EXPECT_EQ(scene->r.subframe, 0.0f);
+}
+
+TEST_F(FrameEvaluatorTest, ParallelSubframes)
+{
+  BLI_system_num_threads_override_set(2);
+  const std::vector<double> frames = {20.0, 20.25, 20.5, 20.75, 21.0};
+  std::vector<EvaluatedFrame> evaluated_frames = evaluate(frames, true);
+
+  expect_frames_evaluated(frames, evaluated_frames);
+  EXPECT_EQ(scene->r.cfra, 1);
+}
+
+TEST_F(FrameEvaluatorTest, ParallelCancel)
+{
+  BLI_system_num_threads_override_set(4);
+  const std::vector<double> frames = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0};
+  std::vector<EvaluatedFrame> evaluated_frames = evaluate(frames, true, 3);
+
+  expect_frames_evaluated({1.0, 2.0, 3.0}, evaluated_frames);
+}
+
+TEST_F(FrameEvaluatorTest, ParallelFallback)
+{
+  BLI_system_num_threads_override_set(4);
+  /* Image sequences take their frame from the original scene. */
+  Image *image = (Image *)BKE_id_new(bmain, ID_IM, "Sequence");
+  image->source = IMA_SRC_SEQUENCE;
+  EXPECT_FALSE(frames_can_evaluate_in_parallel(depsgraph));
+
+  const std::vector<double> frames = {1.0, 2.0, 3.0};
+  std::vector<EvaluatedFrame> evaluated_frames = evaluate(frames, true);
+  expect_frames_evaluated(frames, evaluated_frames);
+  for (const EvaluatedFrame &evaluated : evaluated_frames) {
+    EXPECT_EQ(evaluated.depsgraph, depsgraph);
+  }
+}
+
+}  // namespace blender::io
@@ -20,6 +20,8 @@
 #include "usd.h"
 #include "usd_hierarchy_iterator.h"
 
+#include "IO_frame_evaluator.hh"
+
 #include <pxr/base/plug/registry.h>
 #include <pxr/pxr.h>
 #include <pxr/usd/usd/stage.h>
@@ -74,6 +76,17 @@ static void ensure_usd_plugin_path_registered()
   pxr::PlugRegistry::GetInstance().RegisterPlugins(blender_usd_datafiles + "/");
 }
 
+/* Construct the depsgraph for exporting. */
+static void build_depsgraph(Depsgraph *depsgraph, const bool visible_objects_only)
+{
+  if (visible_objects_only) {
+    DEG_graph_build_from_view_layer(depsgraph);
+  }
+  else {
+    DEG_graph_build_for_all_objects(depsgraph);
+  }
+}
+
 static void export_startjob(void *customdata,
                             /* Cannot be const, this function implements wm_jobs_start_callback.
                              * NOLINTNEXTLINE: readability-non-const-parameter. */
@@ -88,14 +101,8 @@ static void export_startjob(void *customdata,
   WM_set_locked_interface(data->wm, true);
   G.is_break = false;
 
-  /* Construct the depsgraph for exporting. */
   Scene *scene = DEG_get_input_scene(data->depsgraph);
-  if (data->params.visible_objects_only) {
-    DEG_graph_build_from_view_layer(data->depsgraph);
-  }
-  else {
-    DEG_graph_build_for_all_objects(data->depsgraph);
-  }
+  build_depsgraph(data->depsgraph, data->params.visible_objects_only);
   BKE_scene_graph_update_tagged(data->depsgraph, data->bmain);
 
   *progress = 0.0f;
@@ -133,22 +140,32 @@ static void export_startjob(void *customdata,
     /* Writing the animated frames is not 100% of the work, but it's our best guess. */
     float progress_per_frame = 1.0f / std::max(1, (scene->r.efra - scene->r.sfra + 1));
 
-    for (float frame = scene->r.sfra; frame <= scene->r.efra; frame++) {
-      if (G.is_break || (stop != nullptr && *stop)) {
-        break;
-      }
-
-      /* Update the scene for the next frame to render. */
-      scene->r.cfra = static_cast<int>(frame);
-      scene->r.subframe = frame - scene->r.cfra;
-      BKE_scene_graph_update_for_newframe(data->depsgraph);
-
-      iter.set_export_frame(frame);
-      iter.iterate_and_write();
-
-      *progress += progress_per_frame;
-      *do_update = true;
+    std::vector<double> frames;
+    for (int frame = scene->r.sfra; frame <= scene->r.efra; frame++) {
+      frames.push_back(frame);
     }
+    const bool visible_objects_only = data->params.visible_objects_only;
+
+    evaluate_frames(
+        data->depsgraph,
+        frames,
+        data->params.use_parallel_evaluation,
+        [visible_objects_only](Depsgraph *depsgraph) {
+          build_depsgraph(depsgraph, visible_objects_only);
+        },
+        [&](double frame, Depsgraph *depsgraph) {
+          if (G.is_break || (stop != nullptr && *stop)) {
+            return false;
+          }
+
+          iter.set_depsgraph(depsgraph);
+          iter.set_export_frame(frame);
+          iter.iterate_and_write();
+
+          *progress += progress_per_frame;
+          *do_update = true;
+          return true;
+        });
   }
   else {
     /* If we're not animating, a single iteration over all objects is enough. */
@@ -23,7 +23,6 @@
 #include <pxr/usd/sdf/path.h>
 #include <pxr/usd/usd/common.h>
 
-struct Depsgraph;
 struct Object;
 
 namespace blender::io::usd {
@@ -31,7 +30,6 @@ namespace blender::io::usd {
 class USDHierarchyIterator;
 
 struct USDExporterContext {
-  Depsgraph *depsgraph;
   const pxr::UsdStageRefPtr stage;
   const pxr::SdfPath usd_path;
   const USDHierarchyIterator *hierarchy_iterator;
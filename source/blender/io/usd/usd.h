@@ -38,6 +38,7 @@ struct USDExportParams {
   bool visible_objects_only;
   bool use_instancing;
   enum eEvaluationMode evaluation_mode;
+  bool use_parallel_evaluation;
 };
 
 /* The USD_export takes a as_background_job parameter, and returns a boolean.
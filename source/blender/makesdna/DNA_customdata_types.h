@@ -53,6 +53,11 @@ typedef struct CustomDataLayer {
   char name[64];
   /** Layer data. */
   void *data;
+  /**
+   * Run-time, users of the data when it is shared with layers of other CustomData,
+   * it is freed by the last of them. NULL when the layer owns its data alone.
+   */
+  struct CustomDataSharing *sharing;
 } CustomDataLayer;
 
 #define MAX_CUSTOMDATA_LAYER_NAME 64
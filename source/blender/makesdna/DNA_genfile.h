@@ -110,6 +110,15 @@ void *DNA_struct_reconstruct(const struct DNA_ReconstructInfo *reconstruct_info,
                              int blocks,
                              const void *old_blocks);
 
+/* Calls `fn(userdata, index)` for every index below `len`, in any order and possibly in
+ * parallel. DNA does not depend on a task scheduler, the caller provides one. */
+typedef void (*DNA_ParallelForFn)(int len, void *userdata, void (*fn)(void *userdata, int index));
+void *DNA_struct_reconstruct_ex(const struct DNA_ReconstructInfo *reconstruct_info,
+                                int old_struct_nr,
+                                int blocks,
+                                const void *old_blocks,
+                                DNA_ParallelForFn parallel_for);
+
 int DNA_elem_offset(struct SDNA *sdna, const char *stype, const char *vartype, const char *name);
 
 int DNA_elem_size_nr(const struct SDNA *sdna, short type, short name);
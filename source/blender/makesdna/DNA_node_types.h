@@ -448,7 +448,9 @@ typedef struct bNodeTree {
   short is_updating;
   /** Generic temporary flag for recursion check (DFS/BFS). */
   short done;
-  char _pad2[4];
+  /** Execution model of the compositor, see #eNodeTreeExecutionMode. */
+  short execution_mode;
+  char _pad2[2];
 
   /** Specific node type this tree is used for. */
   int nodetype DNA_DEPRECATED;
@@ -476,7 +478,10 @@ typedef struct bNodeTree {
    * in case multiple different editors are used and make context ambiguous.
    */
   bNodeInstanceKey active_viewer_key;
-  char _pad[4];
+  /** Memory limit in MB of the buffers of the tiled execution, larger buffers are kept on disk. */
+  int buffer_limit;
+  /** Directory of the buffers kept on disk, the temporary directory when empty. */
+  char buffer_dir[1024];
 
   /** Execution data.
    *
@@ -519,6 +524,14 @@ typedef struct bNodeTree {
 /* tree is localized copy, free when deleting node groups */
 /* #define NTREE_IS_LOCALIZED           (1 << 5) */
 
+/* ntree->execution_mode */
+typedef enum eNodeTreeExecutionMode {
+  /** Operations are executed per tile, pulling pixels from their inputs. */
+  NTREE_EXECUTION_MODE_TILED = 0,
+  /** Operations are executed one after the other on whole buffers. */
+  NTREE_EXECUTION_MODE_FULL_FRAME = 1,
+} eNodeTreeExecutionMode;
+
 /* ntree->update */
 typedef enum eNodeTreeUpdate {
   NTREE_UPDATE = 0xFFFF,             /* generic update flag (includes all others) */
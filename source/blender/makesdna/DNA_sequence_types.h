@@ -695,6 +695,8 @@ enum {
 
   SEQ_CACHE_PREFETCH_ENABLE = (1 << 10),
   SEQ_CACHE_DISK_CACHE_ENABLE = (1 << 11),
+  /* Keep 10 mantissa bits of float images in the compressed cache, for a better ratio. */
+  SEQ_CACHE_COMPRESSED_CACHE_REDUCE_PRECISION = (1 << 12),
 };
 
 #ifdef __cplusplus
@@ -765,7 +765,10 @@ typedef struct UserDef {
   int prefetchframes;
   /** Control the rotation step of the view when PAD2, PAD4, PAD6&PAD8 is use. */
   float pad_rot_angle;
-  char _pad12[4];
+  /** Memory for frames evicted from the sequencer cache, compressed (megabytes, 0 disables). */
+  int sequencer_compressed_cache_limit;
+  /** Memory for results of compositor nodes kept between executions (megabytes, 0 disables). */
+  int compositor_cache_limit;
   /** Rotating view icon size. */
   short rvisize;
   /** Rotating view icon brightness. */
@@ -792,7 +795,7 @@ typedef struct UserDef {
   /** Seconds to zoom around current frame. */
   float view_frame_seconds;
 
-  char _pad7[6];
+  char _pad7[2];
 
   /** Private, defaults to 20 for 72 DPI setting. */
   short widget_unit;
@@ -879,7 +882,8 @@ typedef struct UserDef {
   short pie_menu_threshold;
 
   short opensubdiv_compute_type;
-  short _pad6;
+  char display_lut_accuracy; /* eUserpref_DisplayLUTAccuracy */
+  char _pad6[1];
 
   char factor_display_type;
 
@@ -1354,6 +1358,13 @@ typedef enum eUserpref_DiskCacheCompression {
   USER_SEQ_DISK_CACHE_COMPRESSION_HIGH = 2,
 } eUserpref_DiskCacheCompression;
 
+/** #UserDef.display_lut_accuracy */
+typedef enum eUserpref_DisplayLUTAccuracy {
+  USER_DISPLAY_LUT_HIGH = 0,
+  USER_DISPLAY_LUT_LOW = 1,
+  USER_DISPLAY_LUT_EXACT = 2,
+} eUserpref_DisplayLUTAccuracy;
+
 /* Locale Ids. Auto will try to get local from OS. Our default is English though. */
 /** #UserDef.language */
 enum {
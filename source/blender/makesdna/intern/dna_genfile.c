@@ -1214,24 +1214,76 @@ static void reconstruct_structs(const DNA_ReconstructInfo *reconstruct_info,
   const int old_block_size = reconstruct_info->oldsdna->types_size[old_struct->type];
   const int new_block_size = reconstruct_info->newsdna->types_size[new_struct->type];
 
+  const ReconstructStep *steps = reconstruct_info->steps[new_struct_nr];
+  const int step_count = reconstruct_info->step_counts[new_struct_nr];
+
+  /* Only a single copy per struct is common, e.g. when members were added at the end or only
+   * renamed. Avoid interpreting the steps for every element then. */
+  if (step_count == 1 && steps[0].type == RECONSTRUCT_STEP_MEMCPY) {
+    const int old_offset = steps[0].data.memcpy.old_offset;
+    const int new_offset = steps[0].data.memcpy.new_offset;
+    const int size = steps[0].data.memcpy.size;
+    if (size == old_block_size && size == new_block_size) {
+      memcpy(new_blocks, old_blocks, (size_t)size * (size_t)blocks);
+    }
+    else {
+      for (int a = 0; a < blocks; a++) {
+        memcpy(new_blocks + (size_t)a * new_block_size + new_offset,
+               old_blocks + (size_t)a * old_block_size + old_offset,
+               size);
+      }
+    }
+    return;
+  }
+
   for (int a = 0; a < blocks; a++) {
-    const char *old_block = old_blocks + a * old_block_size;
-    char *new_block = new_blocks + a * new_block_size;
+    const char *old_block = old_blocks + (size_t)a * old_block_size;
+    char *new_block = new_blocks + (size_t)a * new_block_size;
     reconstruct_struct(reconstruct_info, new_struct_nr, old_block, new_block);
   }
 }
 
+/* Arrays are split in ranges of roughly this many bytes to be reconstructed in parallel. */
+#define RECONSTRUCT_PARALLEL_RANGE_SIZE (1 << 16)
+
+typedef struct ReconstructParallelData {
+  const DNA_ReconstructInfo *reconstruct_info;
+  int blocks;
+  int blocks_per_range;
+  int old_struct_nr;
+  int new_struct_nr;
+  int old_block_size;
+  int new_block_size;
+  const char *old_blocks;
+  char *new_blocks;
+} ReconstructParallelData;
+
+static void reconstruct_structs_range_cb(void *userdata, const int range_index)
+{
+  const ReconstructParallelData *data = userdata;
+  const int start = range_index * data->blocks_per_range;
+  const int blocks = MIN2(data->blocks_per_range, data->blocks - start);
+  reconstruct_structs(data->reconstruct_info,
+                      blocks,
+                      data->old_struct_nr,
+                      data->new_struct_nr,
+                      data->old_blocks + (size_t)start * data->old_block_size,
+                      data->new_blocks + (size_t)start * data->new_block_size);
+}
+
 /**
  * \param reconstruct_info: Information preprocessed by #DNA_reconstruct_info_create.
  * \param old_struct_nr: Index of struct info within oldsdna.
  * \param blocks: The number of array elements.
  * \param old_blocks: Array of struct data.
+ * \param parallel_for: Optional, used to reconstruct ranges of large arrays in parallel.
  * \return An allocated reconstructed struct.
  */
-void *DNA_struct_reconstruct(const DNA_ReconstructInfo *reconstruct_info,
-                             int old_struct_nr,
-                             int blocks,
-                             const void *old_blocks)
+void *DNA_struct_reconstruct_ex(const DNA_ReconstructInfo *reconstruct_info,
+                                int old_struct_nr,
+                                int blocks,
+                                const void *old_blocks,
+                                DNA_ParallelForFn parallel_for)
 {
   const SDNA *oldsdna = reconstruct_info->oldsdna;
   const SDNA *newsdna = reconstruct_info->newsdna;
@@ -1247,12 +1299,40 @@ void *DNA_struct_reconstruct(const DNA_ReconstructInfo *reconstruct_info,
   const SDNA_Struct *new_struct = newsdna->structs[new_struct_nr];
   const int new_block_size = newsdna->types_size[new_struct->type];
 
-  char *new_blocks = MEM_callocN(blocks * new_block_size, "reconstruct");
-  reconstruct_structs(
-      reconstruct_info, blocks, old_struct_nr, new_struct_nr, old_blocks, new_blocks);
+  char *new_blocks = MEM_callocN((size_t)blocks * new_block_size, "reconstruct");
+
+  const int blocks_per_range = MAX2(RECONSTRUCT_PARALLEL_RANGE_SIZE / new_block_size, 1);
+  if (parallel_for != NULL && blocks > blocks_per_range) {
+    /* Large arrays (mesh data for example), elements are independent. */
+    ReconstructParallelData data = {
+        .reconstruct_info = reconstruct_info,
+        .blocks = blocks,
+        .blocks_per_range = blocks_per_range,
+        .old_struct_nr = old_struct_nr,
+        .new_struct_nr = new_struct_nr,
+        .old_block_size = oldsdna->types_size[old_struct->type],
+        .new_block_size = new_block_size,
+        .old_blocks = old_blocks,
+        .new_blocks = new_blocks,
+    };
+    const int ranges_len = (blocks + blocks_per_range - 1) / blocks_per_range;
+    parallel_for(ranges_len, &data, reconstruct_structs_range_cb);
+  }
+  else {
+    reconstruct_structs(
+        reconstruct_info, blocks, old_struct_nr, new_struct_nr, old_blocks, new_blocks);
+  }
   return new_blocks;
 }
 
+void *DNA_struct_reconstruct(const DNA_ReconstructInfo *reconstruct_info,
+                             int old_struct_nr,
+                             int blocks,
+                             const void *old_blocks)
+{
+  return DNA_struct_reconstruct_ex(reconstruct_info, old_struct_nr, blocks, old_blocks, NULL);
+}
+
 /** Finds a member in the given struct with the given name. */
 static const SDNA_StructMember *find_member_with_matching_name(const SDNA *sdna,
                                                                const SDNA_Struct *struct_info,
@@ -1525,6 +1605,104 @@ static int compress_reconstruct_steps(ReconstructStep *steps, const int old_step
   return new_step_count;
 }
 
+/* Nested structs are inlined into the steps of their parent struct when that takes at most this
+ * many steps. Copies of neighboring members can then be merged across struct boundaries, and
+ * less steps have to be interpreted for every element. */
+#define RECONSTRUCT_INLINE_STEPS_MAX 16
+
+static int reconstruct_steps_inlined_count(const DNA_ReconstructInfo *reconstruct_info,
+                                           const ReconstructStep *steps,
+                                           const int step_count)
+{
+  int count = 0;
+  for (int a = 0; a < step_count; a++) {
+    const ReconstructStep *step = &steps[a];
+    if (step->type == RECONSTRUCT_STEP_SUBSTRUCT) {
+      const int new_struct_nr = step->data.substruct.new_struct_nr;
+      const int sub_count = reconstruct_steps_inlined_count(
+          reconstruct_info,
+          reconstruct_info->steps[new_struct_nr],
+          reconstruct_info->step_counts[new_struct_nr]);
+      if (sub_count * step->data.substruct.array_len <= RECONSTRUCT_INLINE_STEPS_MAX) {
+        count += sub_count * step->data.substruct.array_len;
+        continue;
+      }
+    }
+    count++;
+  }
+  return count;
+}
+
+/** Offsets are stored in the same place for all step types. */
+static void reconstruct_step_offsets_add(ReconstructStep *step,
+                                         const int old_offset,
+                                         const int new_offset)
+{
+  switch (step->type) {
+    case RECONSTRUCT_STEP_MEMCPY:
+      step->data.memcpy.old_offset += old_offset;
+      step->data.memcpy.new_offset += new_offset;
+      break;
+    case RECONSTRUCT_STEP_CAST_PRIMITIVE:
+      step->data.cast_primitive.old_offset += old_offset;
+      step->data.cast_primitive.new_offset += new_offset;
+      break;
+    case RECONSTRUCT_STEP_CAST_POINTER_TO_32:
+    case RECONSTRUCT_STEP_CAST_POINTER_TO_64:
+      step->data.cast_pointer.old_offset += old_offset;
+      step->data.cast_pointer.new_offset += new_offset;
+      break;
+    case RECONSTRUCT_STEP_SUBSTRUCT:
+      step->data.substruct.old_offset += old_offset;
+      step->data.substruct.new_offset += new_offset;
+      break;
+    case RECONSTRUCT_STEP_INIT_ZERO:
+      break;
+  }
+}
+
+static void reconstruct_steps_inline(const DNA_ReconstructInfo *reconstruct_info,
+                                     const ReconstructStep *steps,
+                                     const int step_count,
+                                     const int old_offset,
+                                     const int new_offset,
+                                     ReconstructStep *r_steps,
+                                     int *r_step_count)
+{
+  const SDNA *oldsdna = reconstruct_info->oldsdna;
+  const SDNA *newsdna = reconstruct_info->newsdna;
+
+  for (int a = 0; a < step_count; a++) {
+    const ReconstructStep *step = &steps[a];
+    if (step->type == RECONSTRUCT_STEP_SUBSTRUCT) {
+      const int old_struct_nr = step->data.substruct.old_struct_nr;
+      const int new_struct_nr = step->data.substruct.new_struct_nr;
+      const ReconstructStep *sub_steps = reconstruct_info->steps[new_struct_nr];
+      const int sub_step_count = reconstruct_info->step_counts[new_struct_nr];
+      const int array_len = step->data.substruct.array_len;
+      if (reconstruct_steps_inlined_count(reconstruct_info, sub_steps, sub_step_count) *
+              array_len <=
+          RECONSTRUCT_INLINE_STEPS_MAX) {
+        const int old_size = oldsdna->types_size[oldsdna->structs[old_struct_nr]->type];
+        const int new_size = newsdna->types_size[newsdna->structs[new_struct_nr]->type];
+        for (int i = 0; i < array_len; i++) {
+          reconstruct_steps_inline(reconstruct_info,
+                                   sub_steps,
+                                   sub_step_count,
+                                   old_offset + step->data.substruct.old_offset + i * old_size,
+                                   new_offset + step->data.substruct.new_offset + i * new_size,
+                                   r_steps,
+                                   r_step_count);
+        }
+        continue;
+      }
+    }
+    ReconstructStep *r_step = &r_steps[(*r_step_count)++];
+    *r_step = *step;
+    reconstruct_step_offsets_add(r_step, old_offset, new_offset);
+  }
+}
+
 /**
  * Pre-process information about how structs in \a newsdna can be reconstructed from structs in
  * \a oldsdna. This information is then used to speedup #DNA_struct_reconstruct.
@@ -1574,6 +1752,36 @@ DNA_ReconstructInfo *DNA_reconstruct_info_create(const SDNA *oldsdna,
     UNUSED_VARS(print_reconstruct_step);
   }
 
+  /* Inline small nested structs, this needs the steps of all structs to be known. */
+  ReconstructStep **inlined_steps = MEM_calloc_arrayN(
+      sizeof(ReconstructStep *), newsdna->structs_len, __func__);
+  int *inlined_step_counts = MEM_calloc_arrayN(sizeof(int), newsdna->structs_len, __func__);
+  for (int new_struct_nr = 0; new_struct_nr < newsdna->structs_len; new_struct_nr++) {
+    const ReconstructStep *steps = reconstruct_info->steps[new_struct_nr];
+    const int step_count = reconstruct_info->step_counts[new_struct_nr];
+    if (steps == NULL) {
+      continue;
+    }
+    const int inlined_count = reconstruct_steps_inlined_count(reconstruct_info, steps, step_count);
+    ReconstructStep *new_steps = MEM_malloc_arrayN(
+        MAX2(inlined_count, 1), sizeof(ReconstructStep), __func__);
+    int new_step_count = 0;
+    reconstruct_steps_inline(
+        reconstruct_info, steps, step_count, 0, 0, new_steps, &new_step_count);
+    BLI_assert(new_step_count == inlined_count);
+    inlined_steps[new_struct_nr] = new_steps;
+    inlined_step_counts[new_struct_nr] = compress_reconstruct_steps(new_steps, new_step_count);
+  }
+  for (int new_struct_nr = 0; new_struct_nr < newsdna->structs_len; new_struct_nr++) {
+    if (reconstruct_info->steps[new_struct_nr] != NULL) {
+      MEM_freeN(reconstruct_info->steps[new_struct_nr]);
+    }
+  }
+  MEM_freeN(reconstruct_info->steps);
+  MEM_freeN(reconstruct_info->step_counts);
+  reconstruct_info->steps = inlined_steps;
+  reconstruct_info->step_counts = inlined_step_counts;
+
   return reconstruct_info;
 }
 
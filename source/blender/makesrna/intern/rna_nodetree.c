@@ -9783,6 +9783,45 @@ static void rna_def_composite_nodetree(BlenderRNA *brna)
   RNA_def_struct_sdna(srna, "bNodeTree");
   RNA_def_struct_ui_icon(srna, ICON_RENDERLAYERS);
 
+  static const EnumPropertyItem execution_mode_items[] = {
+      {NTREE_EXECUTION_MODE_TILED,
+       "TILED",
+       0,
+       "Tiled",
+       "Compose the image in tiles, evaluating all nodes for each tile"},
+      {NTREE_EXECUTION_MODE_FULL_FRAME,
+       "FULL_FRAME",
+       0,
+       "Full Frame",
+       "Compose the whole image node by node, storing the result of every node in a buffer"},
+      {0, NULL, 0, NULL, NULL},
+  };
+
+  prop = RNA_def_property(srna, "execution_mode", PROP_ENUM, PROP_NONE);
+  RNA_def_property_enum_sdna(prop, NULL, "execution_mode");
+  RNA_def_property_enum_items(prop, execution_mode_items);
+  RNA_def_property_ui_text(prop, "Execution Mode", "Set how compositing is executed");
+  RNA_def_property_update(prop, NC_NODE | ND_DISPLAY, "rna_NodeTree_update");
+
+  prop = RNA_def_property(srna, "buffer_limit", PROP_INT, PROP_NONE);
+  RNA_def_property_int_sdna(prop, NULL, "buffer_limit");
+  RNA_def_property_range(prop, 0, INT_MAX);
+  RNA_def_property_ui_range(prop, 0, 65536, 256, -1);
+  RNA_def_property_ui_text(prop,
+                           "Buffer Limit",
+                           "Memory in MB used by the buffers that tiled execution writes between "
+                           "nodes, buffers beyond the limit are kept in files on disk so huge "
+                           "images can be composited. Other buffers are not limited "
+                           "(0 for no limit)");
+
+  prop = RNA_def_property(srna, "buffer_directory", PROP_STRING, PROP_DIRPATH);
+  RNA_def_property_string_sdna(prop, NULL, "buffer_dir");
+  RNA_def_property_ui_text(prop,
+                           "Buffer Directory",
+                           "Directory of the buffers beyond the buffer limit, the temporary "
+                           "directory when empty. It has to be on disk, buffers are kept in "
+                           "memory when it is a memory file system such as tmpfs");
+
   prop = RNA_def_property(srna, "render_quality", PROP_ENUM, PROP_NONE);
   RNA_def_property_enum_sdna(prop, NULL, "render_quality");
   RNA_def_property_enum_items(prop, node_quality_items);
@@ -5280,6 +5280,26 @@ static void rna_def_userdef_system(BlenderRNA *brna)
       {0, NULL, 0, NULL, NULL},
   };
 
+  static const EnumPropertyItem display_lut_accuracy_items[] = {
+      {USER_DISPLAY_LUT_HIGH,
+       "HIGH",
+       0,
+       "High",
+       "Bake the display transform into a 65x65x65 lookup table, accurate for 8-bit display"},
+      {USER_DISPLAY_LUT_LOW,
+       "LOW",
+       0,
+       "Low",
+       "Bake the display transform into a 33x33x33 lookup table, faster to bake but may show "
+       "small color differences"},
+      {USER_DISPLAY_LUT_EXACT,
+       "EXACT",
+       0,
+       "Exact",
+       "Apply the display transform to every pixel with OpenColorIO"},
+      {0, NULL, 0, NULL, NULL},
+  };
+
   static const EnumPropertyItem image_draw_methods[] = {
       {IMAGE_DRAW_METHOD_AUTO,
        "AUTO",
@@ -5360,6 +5380,32 @@ static void rna_def_userdef_system(BlenderRNA *brna)
   RNA_def_property_ui_text(prop, "Memory Cache Limit", "Memory cache limit (in megabytes)");
   RNA_def_property_update(prop, 0, "rna_Userdef_memcache_update");
 
+  prop = RNA_def_property(srna, "sequencer_compressed_cache_limit", PROP_INT, PROP_NONE);
+  RNA_def_property_int_sdna(prop, NULL, "sequencer_compressed_cache_limit");
+  RNA_def_property_range(prop, 0, max_memory_in_megabytes_int());
+  RNA_def_property_ui_text(prop,
+                           "Compressed Cache Limit",
+                           "Memory for frames evicted from the cache, which are kept compressed "
+                           "(in megabytes, 0 to disable)");
+
+  prop = RNA_def_property(srna, "compositor_cache_limit", PROP_INT, PROP_NONE);
+  RNA_def_property_int_sdna(prop, NULL, "compositor_cache_limit");
+  RNA_def_property_range(prop, 0, max_memory_in_megabytes_int());
+  RNA_def_property_ui_text(prop,
+                           "Compositor Cache Limit",
+                           "Memory used to keep results of nodes between compositing runs, so "
+                           "only nodes that changed are recalculated (full-frame execution only, "
+                           "in megabytes, 0 to disable)");
+
+  prop = RNA_def_property(
+      srna, "use_sequencer_compressed_cache_reduced_precision", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(
+      prop, NULL, "sequencer_disk_cache_flag", SEQ_CACHE_COMPRESSED_CACHE_REDUCE_PRECISION);
+  RNA_def_property_ui_text(prop,
+                           "Reduced Float Precision",
+                           "Keep float images in the compressed cache with the precision of half "
+                           "floats, which is visually lossless and compresses much better");
+
   /* Sequencer disk cache */
 
   prop = RNA_def_property(srna, "use_sequencer_disk_cache", PROP_BOOLEAN, PROP_NONE);
@@ -5456,6 +5502,15 @@ static void rna_def_userdef_system(BlenderRNA *brna)
       prop, "Image Display Method", "Method used for displaying images on the screen");
   RNA_def_property_update(prop, 0, "rna_userdef_update");
 
+  prop = RNA_def_property(srna, "display_lut_accuracy", PROP_ENUM, PROP_NONE);
+  RNA_def_property_enum_items(prop, display_lut_accuracy_items);
+  RNA_def_property_enum_sdna(prop, NULL, "display_lut_accuracy");
+  RNA_def_property_ui_text(prop,
+                           "Display Transform Accuracy",
+                           "Accuracy of the display transform of float images which are displayed "
+                           "by the CPU, such as in the image editor and sequencer");
+  RNA_def_property_update(prop, 0, "rna_userdef_update");
+
   prop = RNA_def_property(srna, "anisotropic_filter", PROP_ENUM, PROP_NONE);
   RNA_def_property_enum_sdna(prop, NULL, "anisotropic_filter");
   RNA_def_property_enum_items(prop, anisotropic_items);
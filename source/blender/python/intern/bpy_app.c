@@ -419,6 +419,16 @@ static PyGetSetDef bpy_app_getsets[] = {
      bpy_app_debug_set,
      bpy_app_debug_doc,
      (void *)G_DEBUG_DEPSGRAPH_PRETTY},
+    {"debug_depsgraph_trace",
+     bpy_app_debug_get,
+     bpy_app_debug_set,
+     bpy_app_debug_doc,
+     (void *)G_DEBUG_DEPSGRAPH_TRACE},
+    {"debug_compositor",
+     bpy_app_debug_get,
+     bpy_app_debug_set,
+     bpy_app_debug_doc,
+     (void *)G_DEBUG_COMPOSITOR},
     {"debug_simdata",
      bpy_app_debug_get,
      bpy_app_debug_set,
@@ -120,6 +120,7 @@ void BKE_sequence_iterator_end(SeqIterator *iter);
 
 typedef enum eSeqTaskId {
   SEQ_TASK_MAIN_RENDER,
+  /* Prefetch workers use consecutive IDs starting with this one. */
   SEQ_TASK_PREFETCH_RENDER,
 } eSeqTaskId;
 
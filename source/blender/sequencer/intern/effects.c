@@ -28,6 +28,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 #include "MEM_guardedalloc.h"
 
 #include "BLI_listbase.h"
@@ -35,6 +39,7 @@
 #include "BLI_path_util.h"
 #include "BLI_rect.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
@@ -189,378 +194,483 @@ static ImBuf *prepare_effect_imbufs(const SeqRenderData *context,
   return out;
 }
 
-/*********************** Alpha Over *************************/
+/*********************** Blend Kernels *************************/
 
-static void init_alpha_over_or_under(Sequence *seq)
+/* Row kernels shared by the blending effects and the strip stack, which blends through the
+ * effects as well. Effects call them for every line of their slice through #blend_rows_byte and
+ * #blend_rows_float, lines alternate between the factors of both fields. Slices start on even
+ * lines so the field of a line does not depend on how the image is split.
+ *
+ * The float kernels handle one RGBA pixel per SSE2 vector, byte cross fades handle four pixels
+ * per vector. They give the same results as the scalar code, which is kept for other CPUs. */
+
+typedef void (*BlendRowFuncByte)(unsigned char *out,
+                                 const unsigned char *rect1,
+                                 const unsigned char *rect2,
+                                 int width,
+                                 float fac);
+typedef void (*BlendRowFuncFloat)(
+    float *out, const float *rect1, const float *rect2, int width, float fac);
+
+static void blend_rows_byte(BlendRowFuncByte func,
+                            float facf0,
+                            float facf1,
+                            int x,
+                            int y,
+                            const unsigned char *rect1,
+                            const unsigned char *rect2,
+                            unsigned char *out)
 {
-  Sequence *seq1 = seq->seq1;
-  Sequence *seq2 = seq->seq2;
-
-  seq->seq2 = seq1;
-  seq->seq1 = seq2;
+  for (int i = 0; i < y; i++) {
+    const size_t offset = (size_t)4 * x * i;
+    func(out + offset, rect1 + offset, rect2 + offset, x, (i & 1) ? facf1 : facf0);
+  }
 }
 
-static void do_alphaover_effect_byte(float facf0,
-                                     float facf1,
-                                     int x,
-                                     int y,
-                                     unsigned char *rect1,
-                                     unsigned char *rect2,
-                                     unsigned char *out)
+static void blend_rows_float(BlendRowFuncFloat func,
+                             float facf0,
+                             float facf1,
+                             int x,
+                             int y,
+                             const float *rect1,
+                             const float *rect2,
+                             float *out)
 {
-  float fac2, mfac, fac, fac4;
-  int xo;
-  unsigned char *cp1, *cp2, *rt;
-  float tempc[4], rt1[4], rt2[4];
+  for (int i = 0; i < y; i++) {
+    const size_t offset = (size_t)4 * x * i;
+    func(out + offset, rect1 + offset, rect2 + offset, x, (i & 1) ? facf1 : facf0);
+  }
+}
 
-  xo = x;
-  cp1 = rect1;
-  cp2 = rect2;
-  rt = out;
+#ifdef __SSE2__
+/* Components of \a a where \a mask is set, of \a b elsewhere. */
+BLI_INLINE __m128 blend_select_ps(__m128 mask, __m128 a, __m128 b)
+{
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
 
-  fac2 = facf0;
-  fac4 = facf1;
+BLI_INLINE __m128 blend_alpha_ps(__m128 color)
+{
+  return _mm_shuffle_ps(color, color, _MM_SHUFFLE(3, 3, 3, 3));
+}
 
-  while (y--) {
-    x = xo;
-    while (x--) {
-      /* rt = rt1 over rt2  (alpha from rt1) */
+/* Mask of the RGB components, to keep the alpha of the first input. */
+BLI_INLINE __m128 blend_rgb_mask_ps(void)
+{
+  return _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+}
+#endif
 
-      straight_uchar_to_premul_float(rt1, cp1);
-      straight_uchar_to_premul_float(rt2, cp2);
+/* rt = rt1 over rt2 (alpha from rt1) */
+static void blend_row_alphaover_byte(unsigned char *rt,
+                                     const unsigned char *cp1,
+                                     const unsigned char *cp2,
+                                     int width,
+                                     float fac)
+{
+  if (fac <= 0.0f) {
+    memcpy(rt, cp2, sizeof(unsigned char[4]) * width);
+    return;
+  }
 
-      fac = fac2;
-      mfac = 1.0f - fac2 * rt1[3];
+  for (int x = 0; x < width; x++, rt += 4, cp1 += 4, cp2 += 4) {
+    float rt1[4], rt2[4], tempc[4];
 
-      if (fac <= 0.0f) {
-        *((unsigned int *)rt) = *((unsigned int *)cp2);
-      }
-      else if (mfac <= 0.0f) {
-        *((unsigned int *)rt) = *((unsigned int *)cp1);
-      }
-      else {
-        tempc[0] = fac * rt1[0] + mfac * rt2[0];
-        tempc[1] = fac * rt1[1] + mfac * rt2[1];
-        tempc[2] = fac * rt1[2] + mfac * rt2[2];
-        tempc[3] = fac * rt1[3] + mfac * rt2[3];
+    straight_uchar_to_premul_float(rt1, cp1);
 
-        premul_float_to_straight_uchar(rt, tempc);
-      }
-      cp1 += 4;
-      cp2 += 4;
-      rt += 4;
+    const float mfac = 1.0f - fac * rt1[3];
+    if (mfac <= 0.0f) {
+      copy_v4_v4_uchar(rt, cp1);
+      continue;
     }
 
-    if (y == 0) {
-      break;
-    }
-    y--;
+    straight_uchar_to_premul_float(rt2, cp2);
 
-    x = xo;
-    while (x--) {
-      straight_uchar_to_premul_float(rt1, cp1);
-      straight_uchar_to_premul_float(rt2, cp2);
+    tempc[0] = fac * rt1[0] + mfac * rt2[0];
+    tempc[1] = fac * rt1[1] + mfac * rt2[1];
+    tempc[2] = fac * rt1[2] + mfac * rt2[2];
+    tempc[3] = fac * rt1[3] + mfac * rt2[3];
 
-      fac = fac4;
-      mfac = 1.0f - (fac4 * rt1[3]);
+    premul_float_to_straight_uchar(rt, tempc);
+  }
+}
 
-      if (fac <= 0.0f) {
-        *((unsigned int *)rt) = *((unsigned int *)cp2);
-      }
-      else if (mfac <= 0.0f) {
-        *((unsigned int *)rt) = *((unsigned int *)cp1);
-      }
-      else {
-        tempc[0] = fac * rt1[0] + mfac * rt2[0];
-        tempc[1] = fac * rt1[1] + mfac * rt2[1];
-        tempc[2] = fac * rt1[2] + mfac * rt2[2];
-        tempc[3] = fac * rt1[3] + mfac * rt2[3];
+static void blend_row_alphaover_float(
+    float *rt, const float *rt1, const float *rt2, int width, float fac)
+{
+  if (fac <= 0.0f) {
+    memcpy(rt, rt2, sizeof(float[4]) * width);
+    return;
+  }
 
-        premul_float_to_straight_uchar(rt, tempc);
-      }
-      cp1 += 4;
-      cp2 += 4;
-      rt += 4;
+#ifdef __SSE2__
+  const __m128 fac_v = _mm_set1_ps(fac);
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 zero = _mm_setzero_ps();
+
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    const __m128 c1 = _mm_loadu_ps(rt1);
+    const __m128 c2 = _mm_loadu_ps(rt2);
+    const __m128 mfac = _mm_sub_ps(one, _mm_mul_ps(fac_v, blend_alpha_ps(c1)));
+    const __m128 result = _mm_add_ps(_mm_mul_ps(fac_v, c1), _mm_mul_ps(mfac, c2));
+
+    _mm_storeu_ps(rt, blend_select_ps(_mm_cmple_ps(mfac, zero), c1, result));
+  }
+#else
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    const float mfac = 1.0f - (fac * rt1[3]);
+
+    if (mfac <= 0.0f) {
+      copy_v4_v4(rt, rt1);
+    }
+    else {
+      rt[0] = fac * rt1[0] + mfac * rt2[0];
+      rt[1] = fac * rt1[1] + mfac * rt2[1];
+      rt[2] = fac * rt1[2] + mfac * rt2[2];
+      rt[3] = fac * rt1[3] + mfac * rt2[3];
     }
   }
+#endif
 }
 
-static void do_alphaover_effect_float(
-    float facf0, float facf1, int x, int y, float *rect1, float *rect2, float *out)
+/* rt = rt1 under rt2 (alpha from rt2) */
+static void blend_row_alphaunder_byte(unsigned char *rt,
+                                      const unsigned char *cp1,
+                                      const unsigned char *cp2,
+                                      int width,
+                                      float fac)
 {
-  float fac2, mfac, fac, fac4;
-  int xo;
-  float *rt1, *rt2, *rt;
+  for (int x = 0; x < width; x++, rt += 4, cp1 += 4, cp2 += 4) {
+    float rt1[4], rt2[4], tempc[4];
 
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
+    straight_uchar_to_premul_float(rt2, cp2);
 
-  fac2 = facf0;
-  fac4 = facf1;
+    /* This complex optimization is because the 'skybuf' can be crossed in. */
+    if (rt2[3] <= 0.0f && fac >= 1.0f) {
+      copy_v4_v4_uchar(rt, cp1);
+      continue;
+    }
+    if (rt2[3] >= 1.0f) {
+      copy_v4_v4_uchar(rt, cp2);
+      continue;
+    }
 
-  while (y--) {
-    x = xo;
-    while (x--) {
-      /* rt = rt1 over rt2  (alpha from rt1) */
+    const float mfac = fac * (1.0f - rt2[3]);
+    if (mfac <= 0.0f) {
+      copy_v4_v4_uchar(rt, cp2);
+      continue;
+    }
 
-      fac = fac2;
-      mfac = 1.0f - (fac2 * rt1[3]);
+    straight_uchar_to_premul_float(rt1, cp1);
 
-      if (fac <= 0.0f) {
-        memcpy(rt, rt2, sizeof(float[4]));
-      }
-      else if (mfac <= 0) {
-        memcpy(rt, rt1, sizeof(float[4]));
-      }
-      else {
-        rt[0] = fac * rt1[0] + mfac * rt2[0];
-        rt[1] = fac * rt1[1] + mfac * rt2[1];
-        rt[2] = fac * rt1[2] + mfac * rt2[2];
-        rt[3] = fac * rt1[3] + mfac * rt2[3];
-      }
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+    tempc[0] = mfac * rt1[0] + rt2[0];
+    tempc[1] = mfac * rt1[1] + rt2[1];
+    tempc[2] = mfac * rt1[2] + rt2[2];
+    tempc[3] = mfac * rt1[3] + rt2[3];
 
-    if (y == 0) {
-      break;
-    }
-    y--;
+    premul_float_to_straight_uchar(rt, tempc);
+  }
+}
 
-    x = xo;
-    while (x--) {
-      fac = fac4;
-      mfac = 1.0f - (fac4 * rt1[3]);
+static void blend_row_alphaunder_float(
+    float *rt, const float *rt1, const float *rt2, int width, float fac)
+{
+#ifdef __SSE2__
+  const __m128 fac_v = _mm_set1_ps(fac);
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 zero = _mm_setzero_ps();
+  /* The first input only shows through transparent pixels when fully faded in. */
+  const __m128 fac_full = (fac >= 1.0f) ? _mm_cmpeq_ps(zero, zero) : zero;
 
-      if (fac <= 0.0f) {
-        memcpy(rt, rt2, sizeof(float[4]));
-      }
-      else if (mfac <= 0.0f) {
-        memcpy(rt, rt1, sizeof(float[4]));
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    const __m128 c1 = _mm_loadu_ps(rt1);
+    const __m128 c2 = _mm_loadu_ps(rt2);
+    const __m128 a2 = blend_alpha_ps(c2);
+    const __m128 mfac = _mm_mul_ps(fac_v, _mm_sub_ps(one, a2));
+    const __m128 result = _mm_add_ps(_mm_mul_ps(mfac, c1), c2);
+    const __m128 use_c1 = _mm_and_ps(fac_full, _mm_cmple_ps(a2, zero));
+    const __m128 use_c2 = _mm_or_ps(_mm_cmpge_ps(a2, one), _mm_cmpeq_ps(mfac, zero));
+
+    _mm_storeu_ps(rt, blend_select_ps(use_c1, c1, blend_select_ps(use_c2, c2, result)));
+  }
+#else
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    /* This complex optimization is because the 'skybuf' can be crossed in. */
+    if (rt2[3] <= 0.0f && fac >= 1.0f) {
+      copy_v4_v4(rt, rt1);
+    }
+    else if (rt2[3] >= 1.0f) {
+      copy_v4_v4(rt, rt2);
+    }
+    else {
+      const float mfac = fac * (1.0f - rt2[3]);
+
+      if (mfac == 0.0f) {
+        copy_v4_v4(rt, rt2);
       }
       else {
-        rt[0] = fac * rt1[0] + mfac * rt2[0];
-        rt[1] = fac * rt1[1] + mfac * rt2[1];
-        rt[2] = fac * rt1[2] + mfac * rt2[2];
-        rt[3] = fac * rt1[3] + mfac * rt2[3];
+        rt[0] = mfac * rt1[0] + rt2[0];
+        rt[1] = mfac * rt1[1] + rt2[1];
+        rt[2] = mfac * rt1[2] + rt2[2];
+        rt[3] = mfac * rt1[3] + rt2[3];
       }
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
     }
   }
+#endif
 }
 
-static void do_alphaover_effect(const SeqRenderData *context,
-                                Sequence *UNUSED(seq),
-                                float UNUSED(timeline_frame),
-                                float facf0,
-                                float facf1,
-                                ImBuf *ibuf1,
-                                ImBuf *ibuf2,
-                                ImBuf *UNUSED(ibuf3),
-                                int start_line,
-                                int total_lines,
-                                ImBuf *out)
+static void blend_row_cross_byte(unsigned char *rt,
+                                 const unsigned char *rt1,
+                                 const unsigned char *rt2,
+                                 int width,
+                                 float fac)
 {
-  if (out->rect_float) {
-    float *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
+  const int fac2 = (int)(256.0f * fac);
+  const int fac1 = 256 - fac2;
+  int x = 0;
 
-    slice_get_float_buffers(
-        context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
+#ifdef __SSE2__
+  /* With both factors in 0..256 the sums fit in unsigned 16 bit. */
+  if (fac2 >= 0 && fac2 <= 256) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i fac1_v = _mm_set1_epi16((short)fac1);
+    const __m128i fac2_v = _mm_set1_epi16((short)fac2);
 
-    do_alphaover_effect_float(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
+    for (; x + 4 <= width; x += 4, rt += 16, rt1 += 16, rt2 += 16) {
+      const __m128i c1 = _mm_loadu_si128((const __m128i *)rt1);
+      const __m128i c2 = _mm_loadu_si128((const __m128i *)rt2);
+      const __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(c1, zero), fac1_v),
+                                       _mm_mullo_epi16(_mm_unpacklo_epi8(c2, zero), fac2_v));
+      const __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(c1, zero), fac1_v),
+                                       _mm_mullo_epi16(_mm_unpackhi_epi8(c2, zero), fac2_v));
+
+      _mm_storeu_si128((__m128i *)rt,
+                       _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
   }
-  else {
-    unsigned char *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
+#endif
 
-    slice_get_byte_buffers(
-        context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
+  for (; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    rt[0] = (fac1 * rt1[0] + fac2 * rt2[0]) >> 8;
+    rt[1] = (fac1 * rt1[1] + fac2 * rt2[1]) >> 8;
+    rt[2] = (fac1 * rt1[2] + fac2 * rt2[2]) >> 8;
+    rt[3] = (fac1 * rt1[3] + fac2 * rt2[3]) >> 8;
+  }
+}
+
+static void blend_row_cross_float(
+    float *rt, const float *rt1, const float *rt2, int width, float fac)
+{
+  const float fac2 = fac;
+  const float fac1 = 1.0f - fac2;
 
-    do_alphaover_effect_byte(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
+#ifdef __SSE2__
+  const __m128 fac1_v = _mm_set1_ps(fac1);
+  const __m128 fac2_v = _mm_set1_ps(fac2);
+
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    _mm_storeu_ps(rt,
+                  _mm_add_ps(_mm_mul_ps(fac1_v, _mm_loadu_ps(rt1)),
+                             _mm_mul_ps(fac2_v, _mm_loadu_ps(rt2))));
+  }
+#else
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    rt[0] = fac1 * rt1[0] + fac2 * rt2[0];
+    rt[1] = fac1 * rt1[1] + fac2 * rt2[1];
+    rt[2] = fac1 * rt1[2] + fac2 * rt2[2];
+    rt[3] = fac1 * rt1[3] + fac2 * rt2[3];
   }
+#endif
 }
 
-/*********************** Alpha Under *************************/
+static void blend_row_add_byte(unsigned char *rt,
+                               const unsigned char *cp1,
+                               const unsigned char *cp2,
+                               int width,
+                               float fac)
+{
+  const int fac1 = (int)(256.0f * fac);
 
-static void do_alphaunder_effect_byte(float facf0,
-                                      float facf1,
-                                      int x,
-                                      int y,
-                                      unsigned char *rect1,
-                                      unsigned char *rect2,
-                                      unsigned char *out)
+  for (int x = 0; x < width; x++, rt += 4, cp1 += 4, cp2 += 4) {
+    const int m = fac1 * (int)cp2[3];
+    rt[0] = min_ii(cp1[0] + ((m * cp2[0]) >> 16), 255);
+    rt[1] = min_ii(cp1[1] + ((m * cp2[1]) >> 16), 255);
+    rt[2] = min_ii(cp1[2] + ((m * cp2[2]) >> 16), 255);
+    rt[3] = cp1[3];
+  }
+}
+
+static void blend_row_add_float(float *rt, const float *rt1, const float *rt2, int width, float fac)
 {
-  float fac2, fac, fac4;
-  int xo;
-  unsigned char *cp1, *cp2, *rt;
-  float tempc[4], rt1[4], rt2[4];
+  const float fac_inv = 1.0f - fac;
 
-  xo = x;
-  cp1 = rect1;
-  cp2 = rect2;
-  rt = out;
+#ifdef __SSE2__
+  const __m128 fac_inv_v = _mm_set1_ps(fac_inv);
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 rgb = blend_rgb_mask_ps();
 
-  fac2 = facf0;
-  fac4 = facf1;
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    const __m128 c1 = _mm_loadu_ps(rt1);
+    const __m128 c2 = _mm_loadu_ps(rt2);
+    const __m128 m = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(blend_alpha_ps(c1), fac_inv_v)),
+                                blend_alpha_ps(c2));
 
-  while (y--) {
-    x = xo;
-    while (x--) {
-      /* rt = rt1 under rt2  (alpha from rt2) */
-      straight_uchar_to_premul_float(rt1, cp1);
-      straight_uchar_to_premul_float(rt2, cp2);
+    _mm_storeu_ps(rt, blend_select_ps(rgb, _mm_add_ps(c1, _mm_mul_ps(m, c2)), c1));
+  }
+#else
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    const float m = (1.0f - (rt1[3] * fac_inv)) * rt2[3];
+    rt[0] = rt1[0] + m * rt2[0];
+    rt[1] = rt1[1] + m * rt2[1];
+    rt[2] = rt1[2] + m * rt2[2];
+    rt[3] = rt1[3];
+  }
+#endif
+}
 
-      /* this complex optimization is because the
-       * 'skybuf' can be crossed in
-       */
-      if (rt2[3] <= 0.0f && fac2 >= 1.0f) {
-        *((unsigned int *)rt) = *((unsigned int *)cp1);
-      }
-      else if (rt2[3] >= 1.0f) {
-        *((unsigned int *)rt) = *((unsigned int *)cp2);
-      }
-      else {
-        fac = (fac2 * (1.0f - rt2[3]));
+static void blend_row_sub_byte(unsigned char *rt,
+                               const unsigned char *cp1,
+                               const unsigned char *cp2,
+                               int width,
+                               float fac)
+{
+  const int fac1 = (int)(256.0f * fac);
 
-        if (fac <= 0) {
-          *((unsigned int *)rt) = *((unsigned int *)cp2);
-        }
-        else {
-          tempc[0] = (fac * rt1[0] + rt2[0]);
-          tempc[1] = (fac * rt1[1] + rt2[1]);
-          tempc[2] = (fac * rt1[2] + rt2[2]);
-          tempc[3] = (fac * rt1[3] + rt2[3]);
+  for (int x = 0; x < width; x++, rt += 4, cp1 += 4, cp2 += 4) {
+    const int m = fac1 * (int)cp2[3];
+    rt[0] = max_ii(cp1[0] - ((m * cp2[0]) >> 16), 0);
+    rt[1] = max_ii(cp1[1] - ((m * cp2[1]) >> 16), 0);
+    rt[2] = max_ii(cp1[2] - ((m * cp2[2]) >> 16), 0);
+    rt[3] = cp1[3];
+  }
+}
 
-          premul_float_to_straight_uchar(rt, tempc);
-        }
-      }
-      cp1 += 4;
-      cp2 += 4;
-      rt += 4;
-    }
+static void blend_row_sub_float(float *rt, const float *rt1, const float *rt2, int width, float fac)
+{
+  const float fac_inv = 1.0f - fac;
 
-    if (y == 0) {
-      break;
-    }
-    y--;
+#ifdef __SSE2__
+  const __m128 fac_inv_v = _mm_set1_ps(fac_inv);
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 rgb = blend_rgb_mask_ps();
 
-    x = xo;
-    while (x--) {
-      straight_uchar_to_premul_float(rt1, cp1);
-      straight_uchar_to_premul_float(rt2, cp2);
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    const __m128 c1 = _mm_loadu_ps(rt1);
+    const __m128 c2 = _mm_loadu_ps(rt2);
+    const __m128 m = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(blend_alpha_ps(c1), fac_inv_v)),
+                                blend_alpha_ps(c2));
+    const __m128 result = _mm_max_ps(_mm_sub_ps(c1, _mm_mul_ps(m, c2)), zero);
 
-      if (rt2[3] <= 0.0f && fac4 >= 1.0f) {
-        *((unsigned int *)rt) = *((unsigned int *)cp1);
-      }
-      else if (rt2[3] >= 1.0f) {
-        *((unsigned int *)rt) = *((unsigned int *)cp2);
-      }
-      else {
-        fac = (fac4 * (1.0f - rt2[3]));
+    _mm_storeu_ps(rt, blend_select_ps(rgb, result, c1));
+  }
+#else
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    const float m = (1.0f - (rt1[3] * fac_inv)) * rt2[3];
+    rt[0] = max_ff(rt1[0] - m * rt2[0], 0.0f);
+    rt[1] = max_ff(rt1[1] - m * rt2[1], 0.0f);
+    rt[2] = max_ff(rt1[2] - m * rt2[2], 0.0f);
+    rt[3] = rt1[3];
+  }
+#endif
+}
 
-        if (fac <= 0) {
-          *((unsigned int *)rt) = *((unsigned int *)cp2);
-        }
-        else {
-          tempc[0] = (fac * rt1[0] + rt2[0]);
-          tempc[1] = (fac * rt1[1] + rt2[1]);
-          tempc[2] = (fac * rt1[2] + rt2[2]);
-          tempc[3] = (fac * rt1[3] + rt2[3]);
+/* fac * (a * b) + (1 - fac) * a  =>  fac * a * (b - 1) + a */
+static void blend_row_mul_byte(unsigned char *rt,
+                               const unsigned char *rt1,
+                               const unsigned char *rt2,
+                               int width,
+                               float fac)
+{
+  const int fac1 = (int)(256.0f * fac);
 
-          premul_float_to_straight_uchar(rt, tempc);
-        }
-      }
-      cp1 += 4;
-      cp2 += 4;
-      rt += 4;
-    }
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    rt[0] = rt1[0] + ((fac1 * rt1[0] * (rt2[0] - 255)) >> 16);
+    rt[1] = rt1[1] + ((fac1 * rt1[1] * (rt2[1] - 255)) >> 16);
+    rt[2] = rt1[2] + ((fac1 * rt1[2] * (rt2[2] - 255)) >> 16);
+    rt[3] = rt1[3] + ((fac1 * rt1[3] * (rt2[3] - 255)) >> 16);
   }
 }
 
-static void do_alphaunder_effect_float(
-    float facf0, float facf1, int x, int y, float *rect1, float *rect2, float *out)
+static void blend_row_mul_float(float *rt, const float *rt1, const float *rt2, int width, float fac)
 {
-  float fac2, fac, fac4;
-  int xo;
-  float *rt1, *rt2, *rt;
+#ifdef __SSE2__
+  const __m128 fac_v = _mm_set1_ps(fac);
+  const __m128 one = _mm_set1_ps(1.0f);
 
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    const __m128 c1 = _mm_loadu_ps(rt1);
+    const __m128 c2 = _mm_loadu_ps(rt2);
 
-  fac2 = facf0;
-  fac4 = facf1;
+    _mm_storeu_ps(rt, _mm_add_ps(c1, _mm_mul_ps(_mm_mul_ps(fac_v, c1), _mm_sub_ps(c2, one))));
+  }
+#else
+  for (int x = 0; x < width; x++, rt += 4, rt1 += 4, rt2 += 4) {
+    rt[0] = rt1[0] + fac * rt1[0] * (rt2[0] - 1.0f);
+    rt[1] = rt1[1] + fac * rt1[1] * (rt2[1] - 1.0f);
+    rt[2] = rt1[2] + fac * rt1[2] * (rt2[2] - 1.0f);
+    rt[3] = rt1[3] + fac * rt1[3] * (rt2[3] - 1.0f);
+  }
+#endif
+}
 
-  while (y--) {
-    x = xo;
-    while (x--) {
-      /* rt = rt1 under rt2  (alpha from rt2) */
+/*********************** Alpha Over *************************/
 
-      /* this complex optimization is because the
-       * 'skybuf' can be crossed in
-       */
-      if (rt2[3] <= 0 && fac2 >= 1.0f) {
-        memcpy(rt, rt1, sizeof(float[4]));
-      }
-      else if (rt2[3] >= 1.0f) {
-        memcpy(rt, rt2, sizeof(float[4]));
-      }
-      else {
-        fac = fac2 * (1.0f - rt2[3]);
+static void init_alpha_over_or_under(Sequence *seq)
+{
+  Sequence *seq1 = seq->seq1;
+  Sequence *seq2 = seq->seq2;
 
-        if (fac == 0) {
-          memcpy(rt, rt2, sizeof(float[4]));
-        }
-        else {
-          rt[0] = fac * rt1[0] + rt2[0];
-          rt[1] = fac * rt1[1] + rt2[1];
-          rt[2] = fac * rt1[2] + rt2[2];
-          rt[3] = fac * rt1[3] + rt2[3];
-        }
-      }
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+  seq->seq2 = seq1;
+  seq->seq1 = seq2;
+}
 
-    if (y == 0) {
-      break;
-    }
-    y--;
+static void do_alphaover_effect(const SeqRenderData *context,
+                                Sequence *UNUSED(seq),
+                                float UNUSED(timeline_frame),
+                                float facf0,
+                                float facf1,
+                                ImBuf *ibuf1,
+                                ImBuf *ibuf2,
+                                ImBuf *UNUSED(ibuf3),
+                                int start_line,
+                                int total_lines,
+                                ImBuf *out)
+{
+  if (out->rect_float) {
+    float *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
 
-    x = xo;
-    while (x--) {
-      if (rt2[3] <= 0 && fac4 >= 1.0f) {
-        memcpy(rt, rt1, sizeof(float[4]));
-      }
-      else if (rt2[3] >= 1.0f) {
-        memcpy(rt, rt2, sizeof(float[4]));
-      }
-      else {
-        fac = fac4 * (1.0f - rt2[3]);
+    slice_get_float_buffers(
+        context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
-        if (fac == 0) {
-          memcpy(rt, rt2, sizeof(float[4]));
-        }
-        else {
-          rt[0] = fac * rt1[0] + rt2[0];
-          rt[1] = fac * rt1[1] + rt2[1];
-          rt[2] = fac * rt1[2] + rt2[2];
-          rt[3] = fac * rt1[3] + rt2[3];
-        }
-      }
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+    blend_rows_float(blend_row_alphaover_float,
+                     facf0,
+                     facf1,
+                     context->rectx,
+                     total_lines,
+                     rect1,
+                     rect2,
+                     rect_out);
+  }
+  else {
+    unsigned char *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
+
+    slice_get_byte_buffers(
+        context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
+
+    blend_rows_byte(blend_row_alphaover_byte,
+                    facf0,
+                    facf1,
+                    context->rectx,
+                    total_lines,
+                    rect1,
+                    rect2,
+                    rect_out);
   }
 }
 
+/*********************** Alpha Under *************************/
+
 static void do_alphaunder_effect(const SeqRenderData *context,
                                  Sequence *UNUSED(seq),
                                  float UNUSED(timeline_frame),
@@ -579,7 +689,14 @@ static void do_alphaunder_effect(const SeqRenderData *context,
     slice_get_float_buffers(
         context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
-    do_alphaunder_effect_float(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
+    blend_rows_float(blend_row_alphaunder_float,
+                     facf0,
+                     facf1,
+                     context->rectx,
+                     total_lines,
+                     rect1,
+                     rect2,
+                     rect_out);
   }
   else {
     unsigned char *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
@@ -587,115 +704,19 @@ static void do_alphaunder_effect(const SeqRenderData *context,
     slice_get_byte_buffers(
         context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
-    do_alphaunder_effect_byte(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
+    blend_rows_byte(blend_row_alphaunder_byte,
+                    facf0,
+                    facf1,
+                    context->rectx,
+                    total_lines,
+                    rect1,
+                    rect2,
+                    rect_out);
   }
 }
 
 /*********************** Cross *************************/
 
-static void do_cross_effect_byte(float facf0,
-                                 float facf1,
-                                 int x,
-                                 int y,
-                                 unsigned char *rect1,
-                                 unsigned char *rect2,
-                                 unsigned char *out)
-{
-  int fac1, fac2, fac3, fac4;
-  int xo;
-  unsigned char *rt1, *rt2, *rt;
-
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
-
-  fac2 = (int)(256.0f * facf0);
-  fac1 = 256 - fac2;
-  fac4 = (int)(256.0f * facf1);
-  fac3 = 256 - fac4;
-
-  while (y--) {
-    x = xo;
-    while (x--) {
-      rt[0] = (fac1 * rt1[0] + fac2 * rt2[0]) >> 8;
-      rt[1] = (fac1 * rt1[1] + fac2 * rt2[1]) >> 8;
-      rt[2] = (fac1 * rt1[2] + fac2 * rt2[2]) >> 8;
-      rt[3] = (fac1 * rt1[3] + fac2 * rt2[3]) >> 8;
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
-
-    if (y == 0) {
-      break;
-    }
-    y--;
-
-    x = xo;
-    while (x--) {
-      rt[0] = (fac3 * rt1[0] + fac4 * rt2[0]) >> 8;
-      rt[1] = (fac3 * rt1[1] + fac4 * rt2[1]) >> 8;
-      rt[2] = (fac3 * rt1[2] + fac4 * rt2[2]) >> 8;
-      rt[3] = (fac3 * rt1[3] + fac4 * rt2[3]) >> 8;
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
-  }
-}
-
-static void do_cross_effect_float(
-    float facf0, float facf1, int x, int y, float *rect1, float *rect2, float *out)
-{
-  float fac1, fac2, fac3, fac4;
-  int xo;
-  float *rt1, *rt2, *rt;
-
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
-
-  fac2 = facf0;
-  fac1 = 1.0f - fac2;
-  fac4 = facf1;
-  fac3 = 1.0f - fac4;
-
-  while (y--) {
-    x = xo;
-    while (x--) {
-      rt[0] = fac1 * rt1[0] + fac2 * rt2[0];
-      rt[1] = fac1 * rt1[1] + fac2 * rt2[1];
-      rt[2] = fac1 * rt1[2] + fac2 * rt2[2];
-      rt[3] = fac1 * rt1[3] + fac2 * rt2[3];
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
-
-    if (y == 0) {
-      break;
-    }
-    y--;
-
-    x = xo;
-    while (x--) {
-      rt[0] = fac3 * rt1[0] + fac4 * rt2[0];
-      rt[1] = fac3 * rt1[1] + fac4 * rt2[1];
-      rt[2] = fac3 * rt1[2] + fac4 * rt2[2];
-      rt[3] = fac3 * rt1[3] + fac4 * rt2[3];
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
-  }
-}
-
 static void do_cross_effect(const SeqRenderData *context,
                             Sequence *UNUSED(seq),
                             float UNUSED(timeline_frame),
@@ -714,7 +735,14 @@ static void do_cross_effect(const SeqRenderData *context,
     slice_get_float_buffers(
         context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
-    do_cross_effect_float(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
+    blend_rows_float(blend_row_cross_float,
+                     facf0,
+                     facf1,
+                     context->rectx,
+                     total_lines,
+                     rect1,
+                     rect2,
+                     rect_out);
   }
   else {
     unsigned char *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
@@ -722,7 +750,14 @@ static void do_cross_effect(const SeqRenderData *context,
     slice_get_byte_buffers(
         context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
-    do_cross_effect_byte(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
+    blend_rows_byte(blend_row_cross_byte,
+                    facf0,
+                    facf1,
+                    context->rectx,
+                    total_lines,
+                    rect1,
+                    rect2,
+                    rect_out);
   }
 }
 
@@ -1017,118 +1052,15 @@ static void do_gammacross_effect(const SeqRenderData *context,
   else {
     unsigned char *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
 
-    slice_get_byte_buffers(
-        context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
-
-    do_gammacross_effect_byte(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
-  }
-}
-
-/*********************** Add *************************/
-
-static void do_add_effect_byte(float facf0,
-                               float facf1,
-                               int x,
-                               int y,
-                               unsigned char *rect1,
-                               unsigned char *rect2,
-                               unsigned char *out)
-{
-  int xo, fac1, fac3;
-  unsigned char *cp1, *cp2, *rt;
-
-  xo = x;
-  cp1 = rect1;
-  cp2 = rect2;
-  rt = out;
-
-  fac1 = (int)(256.0f * facf0);
-  fac3 = (int)(256.0f * facf1);
-
-  while (y--) {
-    x = xo;
-
-    while (x--) {
-      const int m = fac1 * (int)cp2[3];
-      rt[0] = min_ii(cp1[0] + ((m * cp2[0]) >> 16), 255);
-      rt[1] = min_ii(cp1[1] + ((m * cp2[1]) >> 16), 255);
-      rt[2] = min_ii(cp1[2] + ((m * cp2[2]) >> 16), 255);
-      rt[3] = cp1[3];
-
-      cp1 += 4;
-      cp2 += 4;
-      rt += 4;
-    }
-
-    if (y == 0) {
-      break;
-    }
-    y--;
-
-    x = xo;
-    while (x--) {
-      const int m = fac3 * (int)cp2[3];
-      rt[0] = min_ii(cp1[0] + ((m * cp2[0]) >> 16), 255);
-      rt[1] = min_ii(cp1[1] + ((m * cp2[1]) >> 16), 255);
-      rt[2] = min_ii(cp1[2] + ((m * cp2[2]) >> 16), 255);
-      rt[3] = cp1[3];
-
-      cp1 += 4;
-      cp2 += 4;
-      rt += 4;
-    }
-  }
-}
-
-static void do_add_effect_float(
-    float facf0, float facf1, int x, int y, float *rect1, float *rect2, float *out)
-{
-  int xo;
-  float fac1, fac3;
-  float *rt1, *rt2, *rt;
-
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
-
-  fac1 = facf0;
-  fac3 = facf1;
-
-  while (y--) {
-    x = xo;
-    while (x--) {
-      const float m = (1.0f - (rt1[3] * (1.0f - fac1))) * rt2[3];
-      rt[0] = rt1[0] + m * rt2[0];
-      rt[1] = rt1[1] + m * rt2[1];
-      rt[2] = rt1[2] + m * rt2[2];
-      rt[3] = rt1[3];
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
-
-    if (y == 0) {
-      break;
-    }
-    y--;
-
-    x = xo;
-    while (x--) {
-      const float m = (1.0f - (rt1[3] * (1.0f - fac3))) * rt2[3];
-      rt[0] = rt1[0] + m * rt2[0];
-      rt[1] = rt1[1] + m * rt2[1];
-      rt[2] = rt1[2] + m * rt2[2];
-      rt[3] = rt1[3];
+    slice_get_byte_buffers(
+        context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
+    do_gammacross_effect_byte(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
   }
 }
 
+/*********************** Add *************************/
+
 static void do_add_effect(const SeqRenderData *context,
                           Sequence *UNUSED(seq),
                           float UNUSED(timeline_frame),
@@ -1147,7 +1079,14 @@ static void do_add_effect(const SeqRenderData *context,
     slice_get_float_buffers(
         context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
-    do_add_effect_float(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
+    blend_rows_float(blend_row_add_float,
+                     facf0,
+                     facf1,
+                     context->rectx,
+                     total_lines,
+                     rect1,
+                     rect2,
+                     rect_out);
   }
   else {
     unsigned char *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
@@ -1155,115 +1094,19 @@ static void do_add_effect(const SeqRenderData *context,
     slice_get_byte_buffers(
         context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
-    do_add_effect_byte(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
+    blend_rows_byte(blend_row_add_byte,
+                    facf0,
+                    facf1,
+                    context->rectx,
+                    total_lines,
+                    rect1,
+                    rect2,
+                    rect_out);
   }
 }
 
 /*********************** Sub *************************/
 
-static void do_sub_effect_byte(float facf0,
-                               float facf1,
-                               int x,
-                               int y,
-                               unsigned char *rect1,
-                               unsigned char *rect2,
-                               unsigned char *out)
-{
-  int xo, fac1, fac3;
-  unsigned char *cp1, *cp2, *rt;
-
-  xo = x;
-  cp1 = rect1;
-  cp2 = rect2;
-  rt = out;
-
-  fac1 = (int)(256.0f * facf0);
-  fac3 = (int)(256.0f * facf1);
-
-  while (y--) {
-    x = xo;
-    while (x--) {
-      const int m = fac1 * (int)cp2[3];
-      rt[0] = max_ii(cp1[0] - ((m * cp2[0]) >> 16), 0);
-      rt[1] = max_ii(cp1[1] - ((m * cp2[1]) >> 16), 0);
-      rt[2] = max_ii(cp1[2] - ((m * cp2[2]) >> 16), 0);
-      rt[3] = cp1[3];
-
-      cp1 += 4;
-      cp2 += 4;
-      rt += 4;
-    }
-
-    if (y == 0) {
-      break;
-    }
-    y--;
-
-    x = xo;
-    while (x--) {
-      const int m = fac3 * (int)cp2[3];
-      rt[0] = max_ii(cp1[0] - ((m * cp2[0]) >> 16), 0);
-      rt[1] = max_ii(cp1[1] - ((m * cp2[1]) >> 16), 0);
-      rt[2] = max_ii(cp1[2] - ((m * cp2[2]) >> 16), 0);
-      rt[3] = cp1[3];
-
-      cp1 += 4;
-      cp2 += 4;
-      rt += 4;
-    }
-  }
-}
-
-static void do_sub_effect_float(
-    float UNUSED(facf0), float facf1, int x, int y, float *rect1, float *rect2, float *out)
-{
-  int xo;
-  float /* fac1, */ fac3_inv;
-  float *rt1, *rt2, *rt;
-
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
-
-  /* UNUSED */
-  // fac1 = facf0;
-  fac3_inv = 1.0f - facf1;
-
-  while (y--) {
-    x = xo;
-    while (x--) {
-      const float m = (1.0f - (rt1[3] * fac3_inv)) * rt2[3];
-      rt[0] = max_ff(rt1[0] - m * rt2[0], 0.0f);
-      rt[1] = max_ff(rt1[1] - m * rt2[1], 0.0f);
-      rt[2] = max_ff(rt1[2] - m * rt2[2], 0.0f);
-      rt[3] = rt1[3];
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
-
-    if (y == 0) {
-      break;
-    }
-    y--;
-
-    x = xo;
-    while (x--) {
-      const float m = (1.0f - (rt1[3] * fac3_inv)) * rt2[3];
-      rt[0] = max_ff(rt1[0] - m * rt2[0], 0.0f);
-      rt[1] = max_ff(rt1[1] - m * rt2[1], 0.0f);
-      rt[2] = max_ff(rt1[2] - m * rt2[2], 0.0f);
-      rt[3] = rt1[3];
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
-  }
-}
-
 static void do_sub_effect(const SeqRenderData *context,
                           Sequence *UNUSED(seq),
                           float UNUSED(timeline_frame),
@@ -1282,7 +1125,15 @@ static void do_sub_effect(const SeqRenderData *context,
     slice_get_float_buffers(
         context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
-    do_sub_effect_float(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
+    /* Float subtraction has always used the factor of the second field for both. */
+    blend_rows_float(blend_row_sub_float,
+                     facf1,
+                     facf1,
+                     context->rectx,
+                     total_lines,
+                     rect1,
+                     rect2,
+                     rect_out);
   }
   else {
     unsigned char *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
@@ -1290,7 +1141,14 @@ static void do_sub_effect(const SeqRenderData *context,
     slice_get_byte_buffers(
         context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
-    do_sub_effect_byte(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
+    blend_rows_byte(blend_row_sub_byte,
+                    facf0,
+                    facf1,
+                    context->rectx,
+                    total_lines,
+                    rect1,
+                    rect2,
+                    rect_out);
   }
 }
 
@@ -1405,116 +1263,6 @@ static void do_drop_effect_float(
 
 /*********************** Mul *************************/
 
-static void do_mul_effect_byte(float facf0,
-                               float facf1,
-                               int x,
-                               int y,
-                               unsigned char *rect1,
-                               unsigned char *rect2,
-                               unsigned char *out)
-{
-  int xo, fac1, fac3;
-  unsigned char *rt1, *rt2, *rt;
-
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
-
-  fac1 = (int)(256.0f * facf0);
-  fac3 = (int)(256.0f * facf1);
-
-  /* formula:
-   * fac * (a * b) + (1 - fac) * a  => fac * a * (b - 1) + axaux = c * px + py * s; //+centx
-   * yaux = -s * px + c * py; //+centy
-   */
-
-  while (y--) {
-
-    x = xo;
-    while (x--) {
-
-      rt[0] = rt1[0] + ((fac1 * rt1[0] * (rt2[0] - 255)) >> 16);
-      rt[1] = rt1[1] + ((fac1 * rt1[1] * (rt2[1] - 255)) >> 16);
-      rt[2] = rt1[2] + ((fac1 * rt1[2] * (rt2[2] - 255)) >> 16);
-      rt[3] = rt1[3] + ((fac1 * rt1[3] * (rt2[3] - 255)) >> 16);
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
-
-    if (y == 0) {
-      break;
-    }
-    y--;
-
-    x = xo;
-    while (x--) {
-
-      rt[0] = rt1[0] + ((fac3 * rt1[0] * (rt2[0] - 255)) >> 16);
-      rt[1] = rt1[1] + ((fac3 * rt1[1] * (rt2[1] - 255)) >> 16);
-      rt[2] = rt1[2] + ((fac3 * rt1[2] * (rt2[2] - 255)) >> 16);
-      rt[3] = rt1[3] + ((fac3 * rt1[3] * (rt2[3] - 255)) >> 16);
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
-  }
-}
-
-static void do_mul_effect_float(
-    float facf0, float facf1, int x, int y, float *rect1, float *rect2, float *out)
-{
-  int xo;
-  float fac1, fac3;
-  float *rt1, *rt2, *rt;
-
-  xo = x;
-  rt1 = rect1;
-  rt2 = rect2;
-  rt = out;
-
-  fac1 = facf0;
-  fac3 = facf1;
-
-  /* formula:
-   * fac * (a * b) + (1 - fac) * a  =>  fac * a * (b - 1) + a
-   */
-
-  while (y--) {
-    x = xo;
-    while (x--) {
-      rt[0] = rt1[0] + fac1 * rt1[0] * (rt2[0] - 1.0f);
-      rt[1] = rt1[1] + fac1 * rt1[1] * (rt2[1] - 1.0f);
-      rt[2] = rt1[2] + fac1 * rt1[2] * (rt2[2] - 1.0f);
-      rt[3] = rt1[3] + fac1 * rt1[3] * (rt2[3] - 1.0f);
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
-
-    if (y == 0) {
-      break;
-    }
-    y--;
-
-    x = xo;
-    while (x--) {
-      rt[0] = rt1[0] + fac3 * rt1[0] * (rt2[0] - 1.0f);
-      rt[1] = rt1[1] + fac3 * rt1[1] * (rt2[1] - 1.0f);
-      rt[2] = rt1[2] + fac3 * rt1[2] * (rt2[2] - 1.0f);
-      rt[3] = rt1[3] + fac3 * rt1[3] * (rt2[3] - 1.0f);
-
-      rt1 += 4;
-      rt2 += 4;
-      rt += 4;
-    }
-  }
-}
-
 static void do_mul_effect(const SeqRenderData *context,
                           Sequence *UNUSED(seq),
                           float UNUSED(timeline_frame),
@@ -1533,7 +1281,14 @@ static void do_mul_effect(const SeqRenderData *context,
     slice_get_float_buffers(
         context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
-    do_mul_effect_float(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
+    blend_rows_float(blend_row_mul_float,
+                     facf0,
+                     facf1,
+                     context->rectx,
+                     total_lines,
+                     rect1,
+                     rect2,
+                     rect_out);
   }
   else {
     unsigned char *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
@@ -1541,7 +1296,14 @@ static void do_mul_effect(const SeqRenderData *context,
     slice_get_byte_buffers(
         context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
-    do_mul_effect_byte(facf0, facf1, context->rectx, total_lines, rect1, rect2, rect_out);
+    blend_rows_byte(blend_row_mul_byte,
+                    facf0,
+                    facf1,
+                    context->rectx,
+                    total_lines,
+                    rect1,
+                    rect2,
+                    rect_out);
   }
 }
 
@@ -2176,28 +1938,27 @@ static void copy_wipe_effect(Sequence *dst, Sequence *src, const int UNUSED(flag
 
 static void do_wipe_effect_byte(Sequence *seq,
                                 float facf0,
-                                float UNUSED(facf1),
-                                int x,
-                                int y,
+                                int width,
+                                int height,
+                                int start_line,
+                                int total_lines,
                                 unsigned char *rect1,
                                 unsigned char *rect2,
                                 unsigned char *out)
 {
   WipeZone wipezone;
   WipeVars *wipe = (WipeVars *)seq->effectdata;
-  int xo, yo;
   unsigned char *cp1, *cp2, *rt;
 
-  precalc_wipe_zone(&wipezone, wipe, x, y);
+  /* The zone is defined by the whole image, slices only check their own lines. */
+  precalc_wipe_zone(&wipezone, wipe, width, height);
 
   cp1 = rect1;
   cp2 = rect2;
   rt = out;
 
-  xo = x;
-  yo = y;
-  for (y = 0; y < yo; y++) {
-    for (x = 0; x < xo; x++) {
+  for (int y = start_line; y < start_line + total_lines; y++) {
+    for (int x = 0; x < width; x++) {
       float check = check_zone(&wipezone, x, y, seq, facf0);
       if (check) {
         if (cp1) {
@@ -2248,28 +2009,26 @@ static void do_wipe_effect_byte(Sequence *seq,
 
 static void do_wipe_effect_float(Sequence *seq,
                                  float facf0,
-                                 float UNUSED(facf1),
-                                 int x,
-                                 int y,
+                                 int width,
+                                 int height,
+                                 int start_line,
+                                 int total_lines,
                                  float *rect1,
                                  float *rect2,
                                  float *out)
 {
   WipeZone wipezone;
   WipeVars *wipe = (WipeVars *)seq->effectdata;
-  int xo, yo;
   float *rt1, *rt2, *rt;
 
-  precalc_wipe_zone(&wipezone, wipe, x, y);
+  precalc_wipe_zone(&wipezone, wipe, width, height);
 
   rt1 = rect1;
   rt2 = rect2;
   rt = out;
 
-  xo = x;
-  yo = y;
-  for (y = 0; y < yo; y++) {
-    for (x = 0; x < xo; x++) {
+  for (int y = start_line; y < start_line + total_lines; y++) {
+    for (int x = 0; x < width; x++) {
       float check = check_zone(&wipezone, x, y, seq, facf0);
       if (check) {
         if (rt1) {
@@ -2311,39 +2070,50 @@ static void do_wipe_effect_float(Sequence *seq,
   }
 }
 
-static ImBuf *do_wipe_effect(const SeqRenderData *context,
-                             Sequence *seq,
-                             float UNUSED(timeline_frame),
-                             float facf0,
-                             float facf1,
-                             ImBuf *ibuf1,
-                             ImBuf *ibuf2,
-                             ImBuf *ibuf3)
+static void do_wipe_effect(const SeqRenderData *context,
+                           Sequence *seq,
+                           float UNUSED(timeline_frame),
+                           float facf0,
+                           float UNUSED(facf1),
+                           ImBuf *ibuf1,
+                           ImBuf *ibuf2,
+                           ImBuf *UNUSED(ibuf3),
+                           int start_line,
+                           int total_lines,
+                           ImBuf *out)
 {
-  ImBuf *out = prepare_effect_imbufs(context, ibuf1, ibuf2, ibuf3);
-
   if (out->rect_float) {
+    float *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
+
+    slice_get_float_buffers(
+        context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
+
     do_wipe_effect_float(seq,
                          facf0,
-                         facf1,
                          context->rectx,
                          context->recty,
-                         ibuf1->rect_float,
-                         ibuf2->rect_float,
-                         out->rect_float);
+                         start_line,
+                         total_lines,
+                         ibuf1->rect_float ? rect1 : NULL,
+                         ibuf2->rect_float ? rect2 : NULL,
+                         rect_out);
   }
   else {
+    unsigned char *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
+
+    slice_get_byte_buffers(
+        context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
+
     do_wipe_effect_byte(seq,
                         facf0,
-                        facf1,
                         context->rectx,
                         context->recty,
-                        (unsigned char *)ibuf1->rect,
-                        (unsigned char *)ibuf2->rect,
-                        (unsigned char *)out->rect);
+                        start_line,
+                        total_lines,
+                        ibuf1->rect ? rect1 : NULL,
+                        ibuf2->rect ? rect2 : NULL,
+                        rect_out);
   }
-
-  return out;
 }
 
 /*********************** Transform *************************/
@@ -2501,6 +2271,86 @@ static void do_transform_effect(const SeqRenderData *context,
 
 /*********************** Glow *************************/
 
+typedef struct GlowBlurData {
+  const float *src;
+  float *dst;
+  const float *filter;
+  int width, height;
+  int half_width;
+} GlowBlurData;
+
+/**
+ * The blur window of a pixel which is \a pos pixels into a line of \a len pixels.
+ *
+ * Pixels in the strips at both ends of the line use a mirrored window, where the strips overlap
+ * the result is the one the single-threaded passes wrote last.
+ */
+static bool glow_blur_window(int pos, int len, int half_width, int *r_center)
+{
+  const int pos_mirror = len - 1 - pos;
+  const bool start_strip = pos < half_width;
+  const bool end_strip = pos_mirror < half_width;
+
+  if (end_strip && (!start_strip || pos_mirror >= pos)) {
+    *r_center = pos_mirror;
+    return true;
+  }
+  *r_center = pos;
+  return false;
+}
+
+static void glow_blur_rows_task(void *__restrict userdata,
+                                const int y,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const GlowBlurData *data = userdata;
+  const int width = data->width;
+  const int half_width = data->half_width;
+  const float *src = data->src + (size_t)4 * width * y;
+  float *dst = data->dst + (size_t)4 * width * y;
+
+  for (int x = 0; x < width; x++) {
+    int center;
+    const bool mirror = glow_blur_window(x, width, half_width, &center);
+    float color[4];
+
+    zero_v4(color);
+    for (int i = center - half_width, fx = 0; i < center + half_width; i++, fx++) {
+      if ((i >= 0) && (i < width)) {
+        madd_v4_v4fl(color, src + 4 * (mirror ? width - 1 - i : i), data->filter[fx]);
+      }
+    }
+    copy_v4_v4(dst + 4 * x, color);
+  }
+}
+
+/* Accumulates whole rows, in the same order the pixels of a column were added. */
+static void glow_blur_columns_task(void *__restrict userdata,
+                                   const int y,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const GlowBlurData *data = userdata;
+  const int width = data->width;
+  const int height = data->height;
+  const int half_width = data->half_width;
+  float *dst = data->dst + (size_t)4 * width * y;
+  int center;
+  const bool mirror = glow_blur_window(y, height, half_width, &center);
+
+  memset(dst, 0, sizeof(float[4]) * width);
+
+  for (int i = center - half_width, fy = 0; i < center + half_width; i++, fy++) {
+    if ((i >= 0) && (i < height)) {
+      const float *src = data->src + (size_t)4 * width * (mirror ? height - 1 - i : i);
+      const float weight = data->filter[fy];
+
+      for (int x = 0; x < width; x++) {
+        madd_v4_v4fl(dst + 4 * x, src + 4 * x, weight);
+      }
+    }
+  }
+}
+
 static void RVBlurBitmap2_float(float *map, int width, int height, float blur, int quality)
 {
   /* Much better than the previous blur!
@@ -2510,11 +2360,10 @@ static void RVBlurBitmap2_float(float *map, int width, int height, float blur, i
    * Watch out though, it tends to misbehave with large blur values on
    * a small bitmap. Avoid avoid! */
 
-  float *temp = NULL, *swap;
+  float *temp = NULL;
   float *filter = NULL;
-  int x, y, i, fx, fy;
-  int index, ix, halfWidth;
-  float fval, k, curColor[4], curColor2[4], weight = 0;
+  int ix, halfWidth;
+  float fval, k, weight = 0;
 
   /* If we're not really blurring, bail out */
   if (blur <= 0) {
@@ -2559,110 +2408,98 @@ static void RVBlurBitmap2_float(float *map, int width, int height, float blur, i
     filter[ix] /= fval;
   }
 
-  /* Blur the rows */
-  for (y = 0; y < height; y++) {
-    /* Do the left & right strips */
-    for (x = 0; x < halfWidth; x++) {
-      fx = 0;
-      zero_v4(curColor);
-      zero_v4(curColor2);
+  GlowBlurData data = {
+      .filter = filter,
+      .width = width,
+      .height = height,
+      .half_width = halfWidth,
+  };
 
-      for (i = x - halfWidth; i < x + halfWidth; i++) {
-        if ((i >= 0) && (i < width)) {
-          index = (i + y * width) * 4;
-          madd_v4_v4fl(curColor, map + index, filter[fx]);
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 8;
 
-          index = (width - 1 - i + y * width) * 4;
-          madd_v4_v4fl(curColor2, map + index, filter[fx]);
-        }
-        fx++;
-      }
-      index = (x + y * width) * 4;
-      copy_v4_v4(temp + index, curColor);
+  /* Blur the rows into the temporary map. */
+  data.src = map;
+  data.dst = temp;
+  BLI_task_parallel_range(0, height, &data, glow_blur_rows_task, &settings);
 
-      index = (width - 1 - x + y * width) * 4;
-      copy_v4_v4(temp + index, curColor2);
-    }
+  /* Blur the columns back into the map. */
+  data.src = temp;
+  data.dst = map;
+  BLI_task_parallel_range(0, height, &data, glow_blur_columns_task, &settings);
 
-    /* Do the main body */
-    for (x = halfWidth; x < width - halfWidth; x++) {
-      fx = 0;
-      zero_v4(curColor);
-      for (i = x - halfWidth; i < x + halfWidth; i++) {
-        index = (i + y * width) * 4;
-        madd_v4_v4fl(curColor, map + index, filter[fx]);
-        fx++;
-      }
-      index = (x + y * width) * 4;
-      copy_v4_v4(temp + index, curColor);
-    }
-  }
+  /* Tidy up   */
+  MEM_freeN(filter);
+  MEM_freeN(temp);
+}
 
-  /* Swap buffers */
-  swap = temp;
-  temp = map;
-  map = swap;
-
-  /* Blur the columns */
-  for (x = 0; x < width; x++) {
-    /* Do the top & bottom strips */
-    for (y = 0; y < halfWidth; y++) {
-      fy = 0;
-      zero_v4(curColor);
-      zero_v4(curColor2);
-      for (i = y - halfWidth; i < y + halfWidth; i++) {
-        if ((i >= 0) && (i < height)) {
-          /* Bottom */
-          index = (x + i * width) * 4;
-          madd_v4_v4fl(curColor, map + index, filter[fy]);
-
-          /* Top */
-          index = (x + (height - 1 - i) * width) * 4;
-          madd_v4_v4fl(curColor2, map + index, filter[fy]);
-        }
-        fy++;
-      }
-      index = (x + y * width) * 4;
-      copy_v4_v4(temp + index, curColor);
+typedef struct GlowBitmapData {
+  const float *a;
+  const float *b;
+  float *c;
+  int width;
+  float threshold, boost, clamp;
+} GlowBitmapData;
 
-      index = (x + (height - 1 - y) * width) * 4;
-      copy_v4_v4(temp + index, curColor2);
-    }
+static void glow_add_bitmaps_task(void *__restrict userdata,
+                                  const int y,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const GlowBitmapData *data = userdata;
+  const size_t offset = (size_t)4 * data->width * y;
+  const float *a = data->a + offset;
+  const float *b = data->b + offset;
+  float *c = data->c + offset;
 
-    /* Do the main body */
-    for (y = halfWidth; y < height - halfWidth; y++) {
-      fy = 0;
-      zero_v4(curColor);
-      for (i = y - halfWidth; i < y + halfWidth; i++) {
-        index = (x + i * width) * 4;
-        madd_v4_v4fl(curColor, map + index, filter[fy]);
-        fy++;
-      }
-      index = (x + y * width) * 4;
-      copy_v4_v4(temp + index, curColor);
-    }
+#ifdef __SSE2__
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (int x = 0; x < data->width; x++, a += 4, b += 4, c += 4) {
+    _mm_storeu_ps(c, _mm_min_ps(one, _mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))));
   }
-
-  /* Swap buffers */
-  swap = temp;
-  temp = map; /* map = swap; */ /* UNUSED */
-
-  /* Tidy up   */
-  MEM_freeN(filter);
-  MEM_freeN(temp);
+#else
+  for (int x = 0; x < data->width; x++, a += 4, b += 4, c += 4) {
+    c[GlowR] = min_ff(1.0f, a[GlowR] + b[GlowR]);
+    c[GlowG] = min_ff(1.0f, a[GlowG] + b[GlowG]);
+    c[GlowB] = min_ff(1.0f, a[GlowB] + b[GlowB]);
+    c[GlowA] = min_ff(1.0f, a[GlowA] + b[GlowA]);
+  }
+#endif
 }
 
 static void RVAddBitmaps_float(float *a, float *b, float *c, int width, int height)
 {
-  int x, y, index;
-
-  for (y = 0; y < height; y++) {
-    for (x = 0; x < width; x++) {
-      index = (x + y * width) * 4;
-      c[index + GlowR] = min_ff(1.0f, a[index + GlowR] + b[index + GlowR]);
-      c[index + GlowG] = min_ff(1.0f, a[index + GlowG] + b[index + GlowG]);
-      c[index + GlowB] = min_ff(1.0f, a[index + GlowB] + b[index + GlowB]);
-      c[index + GlowA] = min_ff(1.0f, a[index + GlowA] + b[index + GlowA]);
+  GlowBitmapData data = {.a = a, .b = b, .c = c, .width = width};
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 32;
+  BLI_task_parallel_range(0, height, &data, glow_add_bitmaps_task, &settings);
+}
+
+static void glow_isolate_highlights_task(void *__restrict userdata,
+                                         const int y,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const GlowBitmapData *data = userdata;
+  const size_t offset = (size_t)4 * data->width * y;
+  const float *in = data->a + offset;
+  float *out = data->c + offset;
+  const float threshold = data->threshold;
+  const float boost = data->boost;
+  const float clamp = data->clamp;
+
+  for (int x = 0; x < data->width; x++, in += 4, out += 4) {
+    /* Isolate the intensity */
+    const float intensity = (in[GlowR] + in[GlowG] + in[GlowB] - threshold);
+    if (intensity > 0) {
+      out[GlowR] = min_ff(clamp, (in[GlowR] * boost * intensity));
+      out[GlowG] = min_ff(clamp, (in[GlowG] * boost * intensity));
+      out[GlowB] = min_ff(clamp, (in[GlowB] * boost * intensity));
+      out[GlowA] = min_ff(clamp, (in[GlowA] * boost * intensity));
+    }
+    else {
+      zero_v4(out);
     }
   }
 }
@@ -2670,29 +2507,19 @@ static void RVAddBitmaps_float(float *a, float *b, float *c, int width, int heig
 static void RVIsolateHighlights_float(
     const float *in, float *out, int width, int height, float threshold, float boost, float clamp)
 {
-  int x, y, index;
-  float intensity;
-
-  for (y = 0; y < height; y++) {
-    for (x = 0; x < width; x++) {
-      index = (x + y * width) * 4;
+  GlowBitmapData data = {
+      .a = in,
+      .c = out,
+      .width = width,
+      .threshold = threshold,
+      .boost = boost,
+      .clamp = clamp,
+  };
 
-      /* Isolate the intensity */
-      intensity = (in[index + GlowR] + in[index + GlowG] + in[index + GlowB] - threshold);
-      if (intensity > 0) {
-        out[index + GlowR] = min_ff(clamp, (in[index + GlowR] * boost * intensity));
-        out[index + GlowG] = min_ff(clamp, (in[index + GlowG] * boost * intensity));
-        out[index + GlowB] = min_ff(clamp, (in[index + GlowB] * boost * intensity));
-        out[index + GlowA] = min_ff(clamp, (in[index + GlowA] * boost * intensity));
-      }
-      else {
-        out[index + GlowR] = 0;
-        out[index + GlowG] = 0;
-        out[index + GlowB] = 0;
-        out[index + GlowA] = 0;
-      }
-    }
-  }
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 32;
+  BLI_task_parallel_range(0, height, &data, glow_isolate_highlights_task, &settings);
 }
 
 static void init_glow_effect(Sequence *seq)
@@ -3331,7 +3158,7 @@ static void do_overdrop_effect(const SeqRenderData *context,
         context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
     do_drop_effect_float(facf0, facf1, x, y, rect1, rect2, rect_out);
-    do_alphaover_effect_float(facf0, facf1, x, y, rect1, rect2, rect_out);
+    blend_rows_float(blend_row_alphaover_float, facf0, facf1, x, y, rect1, rect2, rect_out);
   }
   else {
     unsigned char *rect1 = NULL, *rect2 = NULL, *rect_out = NULL;
@@ -3340,7 +3167,7 @@ static void do_overdrop_effect(const SeqRenderData *context,
         context, ibuf1, ibuf2, NULL, out, start_line, &rect1, &rect2, NULL, &rect_out);
 
     do_drop_effect_byte(facf0, facf1, x, y, rect1, rect2, rect_out);
-    do_alphaover_effect_byte(facf0, facf1, x, y, rect1, rect2, rect_out);
+    blend_rows_byte(blend_row_alphaover_byte, facf0, facf1, x, y, rect1, rect2, rect_out);
   }
 }
 
@@ -4200,13 +4027,14 @@ static struct SeqEffectHandle get_sequence_effect_impl(int seq_type)
       rval.execute_slice = do_alphaunder_effect;
       break;
     case SEQ_TYPE_WIPE:
+      rval.multithreaded = true;
       rval.init = init_wipe_effect;
       rval.num_inputs = num_inputs_wipe;
       rval.free = free_wipe_effect;
       rval.copy = copy_wipe_effect;
       rval.early_out = early_out_fade;
       rval.get_default_fac = get_default_fac_fade;
-      rval.execute = do_wipe_effect;
+      rval.execute_slice = do_wipe_effect;
       break;
     case SEQ_TYPE_GLOW:
       rval.init = init_glow_effect;
@@ -42,6 +42,7 @@
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
 #include "BLI_path_util.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BKE_global.h"
@@ -54,6 +55,16 @@
 #include "prefetch.h"
 #include "strip_time.h"
 
+#ifdef WITH_LZO
+#  ifdef WITH_SYSTEM_LZO
+#    include <lzo/lzo1x.h>
+#  else
+#    include "minilzo.h"
+#  endif
+#else
+#  include "zlib.h"
+#endif
+
 /**
  * Sequencer Cache Design Notes
  * ============================
@@ -94,6 +105,19 @@
  * To distinguish 2 blend files with same name, scene->ed->disk_cache_timestamp
  * is used as UID. Blend file can still be copied manually which may cause conflict.
  *
+ *
+ * Compressed Cache Design Notes
+ * =============================
+ *
+ * When the compressed cache has a memory limit in user preferences, #SEQ_CACHE_STORE_FINAL_OUT
+ * images which are recycled to make room in the cache are compressed and kept in RAM, so they
+ * can be restored without rendering them again. Entries are freed in least recently used order
+ * when the limit is exceeded, and invalidated together with the cache entries.
+ * Images are split into blocks which are compressed in parallel. Each block is shuffled into
+ * byte planes with the delta of consecutive bytes, so smooth images compress well with a fast
+ * LZ codec. Floats can optionally be reduced to the precision of half floats.
+ * Compressed cache is checked before disk cache.
+ *
  */
 
 /* <cache type>-<resolution X>x<resolution Y>-<rendersize>%(<view_id>)-<frame no>.dcf */
@@ -137,15 +161,29 @@ typedef struct DiskCacheFile {
   int start_frame;
 } DiskCacheFile;
 
+typedef struct SeqCompressedCache {
+  /* SeqCacheKey of SeqCompressedItem -> SeqCompressedItem. */
+  struct GHash *hash;
+  /* Items in order of use, least recently used first. */
+  ListBase items;
+  ThreadMutex mutex;
+  size_t memory_used;
+} SeqCompressedCache;
+
+#define SEQ_CACHE_TASKS_NUM (SEQ_TASK_PREFETCH_RENDER + SEQ_PREFETCH_WORKERS_MAX)
+
 typedef struct SeqCache {
   Main *bmain;
   struct GHash *hash;
   ThreadMutex iterator_mutex;
   struct BLI_mempool *keys_pool;
   struct BLI_mempool *items_pool;
-  struct SeqCacheKey *last_key;
+  /* Last key put by every render task, indexed by task ID. Items are linked to the final frame
+   * of the task rendering them, prefetch workers render different frames concurrently. */
+  struct SeqCacheKey *last_key[SEQ_CACHE_TASKS_NUM];
   size_t memory_used;
   SeqDiskCache *disk_cache;
+  SeqCompressedCache *compressed_cache;
 } SeqCache;
 
 typedef struct SeqCacheItem {
@@ -169,10 +207,48 @@ typedef struct SeqCacheKey {
   int type;
 } SeqCacheKey;
 
+#define CCACHE_BLOCK_SIZE (1 << 20)
+/* Worst case size of a compressed block. */
+#define CCACHE_BLOCK_BOUND (CCACHE_BLOCK_SIZE + CCACHE_BLOCK_SIZE / 16 + 64 + 3)
+
+typedef struct SeqCompressedBlock {
+  void *data;
+  size_t size;
+  /* Block didn't compress and is only shuffled. */
+  bool is_stored;
+} SeqCompressedBlock;
+
+typedef struct SeqCompressedItem {
+  struct SeqCompressedItem *next, *prev;
+  SeqCacheKey key;
+  int x, y;
+  unsigned char planes;
+  bool is_float;
+  char colorspace_name[COLORSPACE_NAME_MAX];
+  size_t size_raw;
+  /* Memory used by the item. */
+  size_t size_compressed;
+  int blocks_num;
+  SeqCompressedBlock *blocks;
+  /* Threads decompressing the item without holding the lock. When it is removed from the cache
+   * meanwhile, the last of them frees it. */
+  int users;
+  bool is_removed;
+} SeqCompressedItem;
+
+/* Image put into the compressed cache once the cache is unlocked. */
+typedef struct SeqCacheEvictedImage {
+  struct SeqCacheEvictedImage *next, *prev;
+  SeqCacheKey key;
+  ImBuf *ibuf;
+} SeqCacheEvictedImage;
+
 static ThreadMutex cache_create_lock = BLI_MUTEX_INITIALIZER;
 static float seq_cache_timeline_frame_to_frame_index(Sequence *seq,
                                                      float timeline_frame,
                                                      int type);
+static unsigned int seq_cache_hashhash(const void *key_);
+static bool seq_cache_hashcmp(const void *a_, const void *b_);
 static float seq_cache_frame_index_to_timeline_frame(Sequence *seq, float frame_index);
 
 static char *seq_disk_cache_base_dir(void)
@@ -686,7 +762,386 @@ static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *ke
   return ibuf;
 }
 
+static size_t seq_compressed_cache_size_limit(void)
+{
+  return (size_t)U.sequencer_compressed_cache_limit * 1024 * 1024;
+}
+
+static bool seq_compressed_cache_is_enabled(void)
+{
+  return U.sequencer_compressed_cache_limit != 0;
+}
+
+static void seq_compressed_cache_create(SeqCache *cache)
+{
+  BLI_mutex_lock(&cache_create_lock);
+  if (cache->compressed_cache == NULL) {
+    SeqCompressedCache *compressed_cache = MEM_callocN(sizeof(SeqCompressedCache),
+                                                       "SeqCompressedCache");
+    compressed_cache->hash = BLI_ghash_new(
+        seq_cache_hashhash, seq_cache_hashcmp, "SeqCompressedCache hash");
+    BLI_mutex_init(&compressed_cache->mutex);
+    cache->compressed_cache = compressed_cache;
+  }
+  BLI_mutex_unlock(&cache_create_lock);
+}
+
+/* Split 32 bit words into 4 planes of their bytes, storing the difference to the previous
+ * byte of the plane. */
+static void seq_compressed_shuffle(unsigned char *dst,
+                                   const uint32_t *src,
+                                   size_t words,
+                                   uint32_t mask)
+{
+  unsigned char prev[4] = {0, 0, 0, 0};
+
+  for (size_t i = 0; i < words; i++) {
+    const uint32_t word = src[i] & mask;
+    for (int b = 0; b < 4; b++) {
+      const unsigned char byte = (unsigned char)(word >> (b * 8));
+      dst[b * words + i] = byte - prev[b];
+      prev[b] = byte;
+    }
+  }
+}
+
+static void seq_compressed_unshuffle(uint32_t *dst, const unsigned char *src, size_t words)
+{
+  unsigned char prev[4] = {0, 0, 0, 0};
+
+  for (size_t i = 0; i < words; i++) {
+    uint32_t word = 0;
+    for (int b = 0; b < 4; b++) {
+      prev[b] += src[b * words + i];
+      word |= (uint32_t)prev[b] << (b * 8);
+    }
+    dst[i] = word;
+  }
+}
+
+/* Scratch buffers of a thread (de)compressing blocks. */
+typedef struct SeqCompressTLS {
+  unsigned char *shuffled;
+  unsigned char *compressed;
+  void *work_memory;
+} SeqCompressTLS;
+
+static void seq_compress_tls_free(const void *__restrict UNUSED(userdata), void *__restrict chunk)
+{
+  SeqCompressTLS *tls_data = chunk;
+  MEM_SAFE_FREE(tls_data->shuffled);
+  MEM_SAFE_FREE(tls_data->compressed);
+  MEM_SAFE_FREE(tls_data->work_memory);
+}
+
+/* Return size of compressed data, 0 on failure. */
+static size_t seq_compressed_encode(SeqCompressTLS *tls_data,
+                                    const unsigned char *in,
+                                    size_t in_len,
+                                    unsigned char *out)
+{
+#ifdef WITH_LZO
+  lzo_uint out_len = CCACHE_BLOCK_BOUND;
+  if (tls_data->work_memory == NULL) {
+    tls_data->work_memory = MEM_mallocN(LZO1X_1_MEM_COMPRESS, __func__);
+  }
+  if (lzo1x_1_compress(in, (lzo_uint)in_len, out, &out_len, tls_data->work_memory) != LZO_E_OK) {
+    return 0;
+  }
+  return out_len;
+#else
+  UNUSED_VARS(tls_data);
+  uLongf out_len = CCACHE_BLOCK_BOUND;
+  if (compress2(out, &out_len, in, (uLong)in_len, Z_BEST_SPEED) != Z_OK) {
+    return 0;
+  }
+  return out_len;
+#endif
+}
+
+static bool seq_compressed_decode(const unsigned char *in,
+                                  size_t in_len,
+                                  unsigned char *out,
+                                  size_t out_len)
+{
+#ifdef WITH_LZO
+  lzo_uint len = out_len;
+  return lzo1x_decompress_safe(in, (lzo_uint)in_len, out, &len, NULL) == LZO_E_OK &&
+         len == out_len;
+#else
+  uLongf len = out_len;
+  return uncompress(out, &len, in, (uLong)in_len) == Z_OK && len == out_len;
+#endif
+}
+
+typedef struct SeqCompressData {
+  SeqCompressedItem *item;
+  /* Image buffer, compressed from or decompressed to. */
+  void *raw;
+  uint32_t mask;
+  bool failed;
+} SeqCompressData;
+
+static void seq_compress_block_task(void *__restrict userdata,
+                                    const int index,
+                                    const TaskParallelTLS *__restrict tls)
+{
+  SeqCompressData *data = userdata;
+  SeqCompressTLS *tls_data = tls->userdata_chunk;
+  SeqCompressedBlock *block = &data->item->blocks[index];
+  const size_t offset = (size_t)index * CCACHE_BLOCK_SIZE;
+  const size_t len = MIN2(CCACHE_BLOCK_SIZE, data->item->size_raw - offset);
+
+  if (tls_data->shuffled == NULL) {
+    tls_data->shuffled = MEM_mallocN(CCACHE_BLOCK_SIZE, __func__);
+    tls_data->compressed = MEM_mallocN(CCACHE_BLOCK_BOUND, __func__);
+  }
+
+  seq_compressed_shuffle(
+      tls_data->shuffled, (uint32_t *)((char *)data->raw + offset), len / 4, data->mask);
+  size_t size = seq_compressed_encode(tls_data, tls_data->shuffled, len, tls_data->compressed);
+
+  block->is_stored = (size == 0 || size >= len);
+  block->size = block->is_stored ? len : size;
+  block->data = MEM_mallocN(block->size, "SeqCompressedBlock");
+  memcpy(block->data, block->is_stored ? tls_data->shuffled : tls_data->compressed, block->size);
+}
+
+static void seq_decompress_block_task(void *__restrict userdata,
+                                      const int index,
+                                      const TaskParallelTLS *__restrict tls)
+{
+  SeqCompressData *data = userdata;
+  SeqCompressTLS *tls_data = tls->userdata_chunk;
+  const SeqCompressedBlock *block = &data->item->blocks[index];
+  const size_t offset = (size_t)index * CCACHE_BLOCK_SIZE;
+  const size_t len = MIN2(CCACHE_BLOCK_SIZE, data->item->size_raw - offset);
+  const unsigned char *shuffled = block->data;
+
+  if (!block->is_stored) {
+    if (tls_data->shuffled == NULL) {
+      tls_data->shuffled = MEM_mallocN(CCACHE_BLOCK_SIZE, __func__);
+    }
+    if (!seq_compressed_decode(block->data, block->size, tls_data->shuffled, len)) {
+      data->failed = true;
+      return;
+    }
+    shuffled = tls_data->shuffled;
+  }
+
+  seq_compressed_unshuffle((uint32_t *)((char *)data->raw + offset), shuffled, len / 4);
+}
+
+static void seq_compressed_cache_run(SeqCompressData *data, TaskParallelRangeFunc func)
+{
+  SeqCompressTLS tls_data = {NULL};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.userdata_chunk = &tls_data;
+  settings.userdata_chunk_size = sizeof(tls_data);
+  settings.func_free = seq_compress_tls_free;
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, data->item->blocks_num, data, func, &settings);
+}
+
+static void seq_compressed_item_free(SeqCompressedItem *item)
+{
+  for (int i = 0; i < item->blocks_num; i++) {
+    MEM_SAFE_FREE(item->blocks[i].data);
+  }
+  MEM_freeN(item->blocks);
+  MEM_freeN(item);
+}
+
+static void seq_compressed_item_remove(SeqCompressedCache *compressed_cache,
+                                       SeqCompressedItem *item)
+{
+  BLI_ghash_remove(compressed_cache->hash, &item->key, NULL, NULL);
+  BLI_remlink(&compressed_cache->items, item);
+  compressed_cache->memory_used -= item->size_compressed;
+  if (item->users > 0) {
+    item->is_removed = true;
+  }
+  else {
+    seq_compressed_item_free(item);
+  }
+}
+
+static SeqCompressedItem *seq_compressed_item_create(SeqCacheKey *key, ImBuf *ibuf)
+{
+  /* Sequencer images have 4 channels, others are not worth supporting. */
+  if (ibuf->rect == NULL && (ibuf->rect_float == NULL || ibuf->channels != 4)) {
+    return NULL;
+  }
+
+  SeqCompressedItem *item = MEM_callocN(sizeof(*item), "SeqCompressedItem");
+  item->key = *key;
+  item->key.link_prev = NULL;
+  item->key.link_next = NULL;
+  item->x = ibuf->x;
+  item->y = ibuf->y;
+  item->planes = ibuf->planes;
+  item->is_float = (ibuf->rect == NULL);
+
+  const char *colorspace_name;
+  if (item->is_float) {
+    item->size_raw = (size_t)ibuf->x * ibuf->y * 4 * sizeof(float);
+    colorspace_name = IMB_colormanagement_get_float_colorspace(ibuf);
+  }
+  else {
+    item->size_raw = (size_t)ibuf->x * ibuf->y * 4;
+    colorspace_name = IMB_colormanagement_get_rect_colorspace(ibuf);
+  }
+  BLI_strncpy(item->colorspace_name, colorspace_name, sizeof(item->colorspace_name));
+
+  item->blocks_num = (int)((item->size_raw + CCACHE_BLOCK_SIZE - 1) / CCACHE_BLOCK_SIZE);
+  item->blocks = MEM_callocN(sizeof(SeqCompressedBlock) * item->blocks_num, __func__);
+
+  SeqCompressData data = {
+      .item = item,
+      .raw = item->is_float ? (void *)ibuf->rect_float : (void *)ibuf->rect,
+      .mask = 0xffffffff,
+  };
+  if (item->is_float &&
+      (U.sequencer_disk_cache_flag & SEQ_CACHE_COMPRESSED_CACHE_REDUCE_PRECISION)) {
+    /* Keep 10 of the 23 mantissa bits, the low bytes then compress to almost nothing. */
+    data.mask = 0xffffe000;
+  }
+  seq_compressed_cache_run(&data, seq_compress_block_task);
+
+  item->size_compressed = sizeof(*item) + sizeof(SeqCompressedBlock) * item->blocks_num;
+  for (int i = 0; i < item->blocks_num; i++) {
+    item->size_compressed += item->blocks[i].size;
+  }
+
+  return item;
+}
+
+/* Compress images evicted from the cache, called without the cache being locked. */
+static void seq_compressed_cache_put_evicted(SeqCache *cache, ListBase *evicted)
+{
+  LISTBASE_FOREACH_MUTABLE (SeqCacheEvictedImage *, evicted_image, evicted) {
+    if (cache->compressed_cache == NULL) {
+      seq_compressed_cache_create(cache);
+    }
+    SeqCompressedCache *compressed_cache = cache->compressed_cache;
+
+    BLI_mutex_lock(&compressed_cache->mutex);
+    bool is_cached = BLI_ghash_haskey(compressed_cache->hash, &evicted_image->key);
+    BLI_mutex_unlock(&compressed_cache->mutex);
+
+    /* Compress without holding the lock, images may be restored in the meantime. */
+    SeqCompressedItem *item = NULL;
+    if (!is_cached) {
+      item = seq_compressed_item_create(&evicted_image->key, evicted_image->ibuf);
+    }
+    IMB_freeImBuf(evicted_image->ibuf);
+    MEM_freeN(evicted_image);
+
+    if (item == NULL) {
+      continue;
+    }
+
+    BLI_mutex_lock(&compressed_cache->mutex);
+    if (BLI_ghash_haskey(compressed_cache->hash, &item->key)) {
+      /* Compressed by another thread. */
+      seq_compressed_item_free(item);
+    }
+    else {
+      BLI_ghash_insert(compressed_cache->hash, &item->key, item);
+      BLI_addtail(&compressed_cache->items, item);
+      compressed_cache->memory_used += item->size_compressed;
+    }
+
+    const size_t size_limit = seq_compressed_cache_size_limit();
+    while (compressed_cache->memory_used > size_limit && compressed_cache->items.first) {
+      seq_compressed_item_remove(compressed_cache, compressed_cache->items.first);
+    }
+    BLI_mutex_unlock(&compressed_cache->mutex);
+  }
+
+  BLI_listbase_clear(evicted);
+}
+
+static ImBuf *seq_compressed_cache_get(SeqCompressedCache *compressed_cache, SeqCacheKey *key)
+{
+  BLI_mutex_lock(&compressed_cache->mutex);
+
+  SeqCompressedItem *item = BLI_ghash_lookup(compressed_cache->hash, key);
+  if (item == NULL) {
+    BLI_mutex_unlock(&compressed_cache->mutex);
+    return NULL;
+  }
+
+  /* Mark as most recently used. */
+  BLI_remlink(&compressed_cache->items, item);
+  BLI_addtail(&compressed_cache->items, item);
+
+  /* Decompress without holding the lock, the blocks are decompressed by tasks which may run
+   * other work needing the cache on this thread. The reference keeps the item alive. */
+  item->users++;
+  BLI_mutex_unlock(&compressed_cache->mutex);
+
+  ImBuf *ibuf = IMB_allocImBuf(
+      item->x, item->y, item->planes, item->is_float ? IB_rectfloat : IB_rect);
+  SeqCompressData data = {
+      .item = item,
+      .raw = item->is_float ? (void *)ibuf->rect_float : (void *)ibuf->rect,
+  };
+  seq_compressed_cache_run(&data, seq_decompress_block_task);
+
+  if (data.failed) {
+    IMB_freeImBuf(ibuf);
+    ibuf = NULL;
+  }
+  else if (item->is_float) {
+    IMB_colormanagement_assign_float_colorspace(ibuf, item->colorspace_name);
+  }
+  else {
+    IMB_colormanagement_assign_rect_colorspace(ibuf, item->colorspace_name);
+  }
+
+  BLI_mutex_lock(&compressed_cache->mutex);
+  item->users--;
+  if (item->is_removed) {
+    if (item->users == 0) {
+      seq_compressed_item_free(item);
+    }
+  }
+  else if (data.failed) {
+    seq_compressed_item_remove(compressed_cache, item);
+  }
+  BLI_mutex_unlock(&compressed_cache->mutex);
+
+  return ibuf;
+}
+
+static void seq_compressed_cache_cleanup(SeqCompressedCache *compressed_cache,
+                                         int invalidate_types,
+                                         int range_start,
+                                         int range_end)
+{
+  BLI_mutex_lock(&compressed_cache->mutex);
+  LISTBASE_FOREACH_MUTABLE (SeqCompressedItem *, item, &compressed_cache->items) {
+    if (item->key.type & invalidate_types && item->key.timeline_frame >= range_start &&
+        item->key.timeline_frame <= range_end) {
+      seq_compressed_item_remove(compressed_cache, item);
+    }
+  }
+  BLI_mutex_unlock(&compressed_cache->mutex);
+}
+
+static void seq_compressed_cache_destruct(SeqCompressedCache *compressed_cache)
+{
+  seq_compressed_cache_cleanup(compressed_cache, SEQ_CACHE_ALL_TYPES, INT_MIN, INT_MAX);
+  BLI_ghash_free(compressed_cache->hash, NULL, NULL);
+  BLI_mutex_end(&compressed_cache->mutex);
+  MEM_freeN(compressed_cache);
+}
+
 #undef DCACHE_FNAME_FORMAT
+#undef CCACHE_BLOCK_SIZE
+#undef CCACHE_BLOCK_BOUND
 #undef DCACHE_IMAGES_PER_FILE
 #undef COLORSPACE_NAME_MAX
 #undef DCACHE_CURRENT_VERSION
@@ -781,7 +1236,11 @@ static void seq_cache_unlock(Scene *scene)
 
 static size_t seq_cache_get_mem_total(void)
 {
-  return ((size_t)U.memcachelimit) * 1024 * 1024;
+  const size_t mem_total = ((size_t)U.memcachelimit) * 1024 * 1024;
+  /* Frames decoded ahead by movies count towards the same limit. */
+  const size_t decoded_frames = IMB_anim_decoded_frames_memory();
+
+  return (decoded_frames < mem_total) ? mem_total - decoded_frames : 0;
 }
 
 static void seq_cache_keyfree(void *val)
@@ -803,18 +1262,32 @@ static void seq_cache_valfree(void *val)
   BLI_mempool_free(item->cache_owner->items_pool, item);
 }
 
-static void seq_cache_put(SeqCache *cache, SeqCacheKey *key, ImBuf *ibuf)
+/**
+ * \return false when the cache already has an item for \a key, the caller keeps ownership of
+ * \a key then.
+ */
+static bool seq_cache_put(SeqCache *cache, SeqCacheKey *key, ImBuf *ibuf)
 {
+  void **item_p;
+
+  /* Render tasks can render the same key at the same time, e.g. for still images. Keep the item
+   * which was stored first, replacing it would free the image buffer and the key other tasks link
+   * to. */
+  if (BLI_ghash_ensure_p(cache->hash, key, &item_p)) {
+    BLI_assert(((SeqCacheItem *)*item_p)->ibuf != ibuf);
+    return false;
+  }
+
   SeqCacheItem *item;
   item = BLI_mempool_alloc(cache->items_pool);
   item->cache_owner = cache;
   item->ibuf = ibuf;
+  *item_p = item;
 
-  if (BLI_ghash_reinsert(cache->hash, key, item, seq_cache_keyfree, seq_cache_valfree)) {
-    IMB_refImBuf(ibuf);
-    cache->last_key = key;
-    cache->memory_used += IMB_get_size_in_memory(ibuf);
-  }
+  IMB_refImBuf(ibuf);
+  cache->last_key[key->task_id] = key;
+  cache->memory_used += IMB_get_size_in_memory(ibuf);
+  return true;
 }
 
 static ImBuf *seq_cache_get(SeqCache *cache, SeqCacheKey *key)
@@ -998,21 +1471,34 @@ bool BKE_sequencer_cache_recycle_item(Scene *scene)
     return false;
   }
 
+  ListBase evicted = {NULL, NULL};
+  bool success = true;
+
   seq_cache_lock(scene);
 
   while (cache->memory_used > memory_total) {
     SeqCacheKey *finalkey = seq_cache_get_item_for_removal(scene);
 
     if (finalkey) {
+      if (seq_compressed_cache_is_enabled() && finalkey->type == SEQ_CACHE_STORE_FINAL_OUT) {
+        SeqCacheItem *item = BLI_ghash_lookup(cache->hash, finalkey);
+        SeqCacheEvictedImage *evicted_image = MEM_mallocN(sizeof(*evicted_image), __func__);
+        evicted_image->key = *finalkey;
+        evicted_image->ibuf = item->ibuf;
+        IMB_refImBuf(item->ibuf);
+        BLI_addtail(&evicted, evicted_image);
+      }
       seq_cache_recycle_linked(scene, finalkey);
     }
     else {
-      seq_cache_unlock(scene);
-      return false;
+      success = false;
+      break;
     }
   }
   seq_cache_unlock(scene);
-  return true;
+
+  seq_compressed_cache_put_evicted(cache, &evicted);
+  return success;
 }
 
 static void seq_cache_set_temp_cache_linked(Scene *scene, SeqCacheKey *base)
@@ -1069,7 +1555,6 @@ static void seq_cache_create(Main *bmain, Scene *scene)
     cache->keys_pool = BLI_mempool_create(sizeof(SeqCacheKey), 0, 64, BLI_MEMPOOL_NOP);
     cache->items_pool = BLI_mempool_create(sizeof(SeqCacheItem), 0, 64, BLI_MEMPOOL_NOP);
     cache->hash = BLI_ghash_new(seq_cache_hashhash, seq_cache_hashcmp, "SeqCache hash");
-    cache->last_key = NULL;
     cache->bmain = bmain;
     BLI_mutex_init(&cache->iterator_mutex);
     scene->ed->cache = cache;
@@ -1123,6 +1608,10 @@ void BKE_sequencer_cache_destruct(Scene *scene)
   BLI_mempool_destroy(cache->items_pool);
   BLI_mutex_end(&cache->iterator_mutex);
 
+  if (cache->compressed_cache != NULL) {
+    seq_compressed_cache_destruct(cache->compressed_cache);
+  }
+
   if (cache->disk_cache != NULL) {
     BLI_freelistN(&cache->disk_cache->files);
     BLI_mutex_end(&cache->disk_cache->read_write_mutex);
@@ -1158,8 +1647,12 @@ void BKE_sequencer_cache_cleanup(Scene *scene)
     BLI_ghashIterator_step(&gh_iter);
     BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
   }
-  cache->last_key = NULL;
+  memset(cache->last_key, 0, sizeof(cache->last_key));
   seq_cache_unlock(scene);
+
+  if (cache->compressed_cache != NULL) {
+    seq_compressed_cache_cleanup(cache->compressed_cache, SEQ_CACHE_ALL_TYPES, INT_MIN, INT_MAX);
+  }
 }
 
 void BKE_sequencer_cache_cleanup_sequence(Scene *scene,
@@ -1222,8 +1715,13 @@ void BKE_sequencer_cache_cleanup_sequence(Scene *scene,
       BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
     }
   }
-  cache->last_key = NULL;
+  memset(cache->last_key, 0, sizeof(cache->last_key));
   seq_cache_unlock(scene);
+
+  if (cache->compressed_cache != NULL) {
+    seq_compressed_cache_cleanup(
+        cache->compressed_cache, invalidate_composite, range_start, range_end);
+  }
 }
 
 struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context,
@@ -1273,6 +1771,16 @@ struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context,
     return ibuf;
   }
 
+  /* Try compressed cache, skipped like disk cache to only look up images in the cache. */
+  if (!skip_disk_cache && cache && cache->compressed_cache &&
+      type == SEQ_CACHE_STORE_FINAL_OUT) {
+    ibuf = seq_compressed_cache_get(cache->compressed_cache, &key);
+    if (ibuf) {
+      BKE_sequencer_cache_put_if_possible(context, seq, timeline_frame, type, ibuf, 0.0f, true);
+      return ibuf;
+    }
+  }
+
   /* Try disk cache: */
   if (!skip_disk_cache && seq_disk_cache_is_enabled(context->bmain)) {
     if (cache->disk_cache == NULL) {
@@ -1320,8 +1828,9 @@ bool BKE_sequencer_cache_put_if_possible(const SeqRenderData *context,
     return true;
   }
 
-  seq_cache_set_temp_cache_linked(scene, scene->ed->cache->last_key);
-  scene->ed->cache->last_key = NULL;
+  SeqCache *cache = scene->ed->cache;
+  seq_cache_set_temp_cache_linked(scene, cache->last_key[context->task_id]);
+  cache->last_key[context->task_id] = NULL;
   return false;
 }
 
@@ -1392,29 +1901,35 @@ void BKE_sequencer_cache_put(const SeqRenderData *context,
   key->task_id = context->task_id;
 
   /* Item stored for later use */
+  SeqCacheKey **last_key = &cache->last_key[key->task_id];
+
   if (flag & type) {
     key->is_temp_cache = false;
-    key->link_prev = cache->last_key;
+    key->link_prev = *last_key;
   }
 
-  SeqCacheKey *temp_last_key = cache->last_key;
-  seq_cache_put(cache, key, i);
+  SeqCacheKey *temp_last_key = *last_key;
+  if (!seq_cache_put(cache, key, i)) {
+    BLI_mempool_free(cache->keys_pool, key);
+    seq_cache_unlock(scene);
+    return;
+  }
 
   /* Restore pointer to previous item as this one will be freed when stack is rendered. */
   if (key->is_temp_cache) {
-    cache->last_key = temp_last_key;
+    *last_key = temp_last_key;
   }
 
   /* Set last_key's reference to this key so we can look up chain backwards.
-   * Item is already put in cache, so cache->last_key points to current key.
+   * Item is already put in cache, so last_key points to current key.
    */
   if (flag & type && temp_last_key) {
-    temp_last_key->link_next = cache->last_key;
+    temp_last_key->link_next = *last_key;
   }
 
   /* Reset linking. */
   if (key->type == SEQ_CACHE_STORE_FINAL_OUT) {
-    cache->last_key = NULL;
+    *last_key = NULL;
   }
 
   seq_cache_unlock(scene);
@@ -1460,7 +1975,7 @@ void BKE_sequencer_cache_iterate(struct Scene *scene,
     interrupt = callback_iter(userdata, key->seq, key->timeline_frame, key->type, key->cost);
   }
 
-  cache->last_key = NULL;
+  memset(cache->last_key, 0, sizeof(cache->last_key));
   seq_cache_unlock(scene);
 }
 
@@ -37,6 +37,11 @@ struct SeqRenderData;
 }
 #endif
 
+/* Every prefetch worker keeps its own evaluated copy of the scene and renders a frame at a time.
+ * The copies aren't counted in the cache memory limit: besides the scene data they hold the movie
+ * decoders of the strips, so every worker costs about as much memory as the scene itself. */
+#define SEQ_PREFETCH_WORKERS_MAX 4
+
 void BKE_sequencer_prefetch_start(const struct SeqRenderData *context,
                                   float timeline_frame,
                                   float cost);
@@ -37,6 +37,7 @@
 #include "BLI_linklist.h"
 #include "BLI_listbase.h"
 #include "BLI_path_util.h"
+#include "BLI_task.h"
 
 #include "BKE_anim_data.h"
 #include "BKE_animsys.h"
@@ -768,17 +769,11 @@ static ImBuf *seq_render_preprocess_ibuf(const SeqRenderData *context,
   return ibuf;
 }
 
-typedef struct RenderEffectInitData {
-  struct SeqEffectHandle *sh;
-  const SeqRenderData *context;
-  Sequence *seq;
-  float timeline_frame, facf0, facf1;
-  ImBuf *ibuf1, *ibuf2, *ibuf3;
-
-  ImBuf *out;
-} RenderEffectInitData;
+/* Effects are executed in slices of this many lines. The count is even so every slice starts on
+ * the first field, interlaced effects use the factor of the field of their first line. */
+#define SEQ_EFFECT_SLICE_LINES 64
 
-typedef struct RenderEffectThread {
+typedef struct RenderEffectData {
   struct SeqEffectHandle *sh;
   const SeqRenderData *context;
   Sequence *seq;
@@ -786,49 +781,27 @@ typedef struct RenderEffectThread {
   ImBuf *ibuf1, *ibuf2, *ibuf3;
 
   ImBuf *out;
-  int start_line, tot_line;
-} RenderEffectThread;
-
-static void render_effect_execute_init_handle(void *handle_v,
-                                              int start_line,
-                                              int tot_line,
-                                              void *init_data_v)
-{
-  RenderEffectThread *handle = (RenderEffectThread *)handle_v;
-  RenderEffectInitData *init_data = (RenderEffectInitData *)init_data_v;
-
-  handle->sh = init_data->sh;
-  handle->context = init_data->context;
-  handle->seq = init_data->seq;
-  handle->timeline_frame = init_data->timeline_frame;
-  handle->facf0 = init_data->facf0;
-  handle->facf1 = init_data->facf1;
-  handle->ibuf1 = init_data->ibuf1;
-  handle->ibuf2 = init_data->ibuf2;
-  handle->ibuf3 = init_data->ibuf3;
-  handle->out = init_data->out;
-
-  handle->start_line = start_line;
-  handle->tot_line = tot_line;
-}
+} RenderEffectData;
 
-static void *render_effect_execute_do_thread(void *thread_data_v)
+static void render_effect_execute_slice(void *__restrict userdata,
+                                        const int slice,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  RenderEffectThread *thread_data = (RenderEffectThread *)thread_data_v;
-
-  thread_data->sh->execute_slice(thread_data->context,
-                                 thread_data->seq,
-                                 thread_data->timeline_frame,
-                                 thread_data->facf0,
-                                 thread_data->facf1,
-                                 thread_data->ibuf1,
-                                 thread_data->ibuf2,
-                                 thread_data->ibuf3,
-                                 thread_data->start_line,
-                                 thread_data->tot_line,
-                                 thread_data->out);
-
-  return NULL;
+  const RenderEffectData *data = userdata;
+  const int start_line = slice * SEQ_EFFECT_SLICE_LINES;
+  const int total_lines = min_ii(SEQ_EFFECT_SLICE_LINES, data->out->y - start_line);
+
+  data->sh->execute_slice(data->context,
+                          data->seq,
+                          data->timeline_frame,
+                          data->facf0,
+                          data->facf1,
+                          data->ibuf1,
+                          data->ibuf2,
+                          data->ibuf3,
+                          start_line,
+                          total_lines,
+                          data->out);
 }
 
 ImBuf *seq_render_effect_execute_threaded(struct SeqEffectHandle *sh,
@@ -841,25 +814,25 @@ ImBuf *seq_render_effect_execute_threaded(struct SeqEffectHandle *sh,
                                           ImBuf *ibuf2,
                                           ImBuf *ibuf3)
 {
-  RenderEffectInitData init_data;
   ImBuf *out = sh->init_execution(context, ibuf1, ibuf2, ibuf3);
-
-  init_data.sh = sh;
-  init_data.context = context;
-  init_data.seq = seq;
-  init_data.timeline_frame = timeline_frame;
-  init_data.facf0 = facf0;
-  init_data.facf1 = facf1;
-  init_data.ibuf1 = ibuf1;
-  init_data.ibuf2 = ibuf2;
-  init_data.ibuf3 = ibuf3;
-  init_data.out = out;
-
-  IMB_processor_apply_threaded(out->y,
-                               sizeof(RenderEffectThread),
-                               &init_data,
-                               render_effect_execute_init_handle,
-                               render_effect_execute_do_thread);
+  RenderEffectData data = {
+      .sh = sh,
+      .context = context,
+      .seq = seq,
+      .timeline_frame = timeline_frame,
+      .facf0 = facf0,
+      .facf1 = facf1,
+      .ibuf1 = ibuf1,
+      .ibuf2 = ibuf2,
+      .ibuf3 = ibuf3,
+      .out = out,
+  };
+  const int num_slices = (out->y + SEQ_EFFECT_SLICE_LINES - 1) / SEQ_EFFECT_SLICE_LINES;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (num_slices > 1);
+  BLI_task_parallel_range(0, num_slices, &data, render_effect_execute_slice, &settings);
 
   return out;
 }
@@ -465,7 +465,8 @@ static int wm_read_exotic(const char *name)
     else {
       len = gzread(gzfile, header, sizeof(header));
       gzclose(gzfile);
-      if (len == sizeof(header) && STREQLEN(header, "BLENDER", 7)) {
+      if (len == sizeof(header) && (STREQLEN(header, "BLENDER", 7) ||
+                                    STREQLEN(header, BLO_MEMFILE_JOURNAL_MAGIC, 7))) {
         retval = BKE_READ_EXOTIC_OK_BLEND;
       }
       else {
@@ -720,6 +721,9 @@ bool WM_file_read(bContext *C, const char *filepath, ReportList *reports)
     /* also exit screens and editors */
     wm_window_match_init(C, &wmbase);
 
+    /* Only supported without UI, the screens & workspaces are not read. */
+    const bool use_scene_only = G.background && (G.f & G_FLAG_LOAD_SCENE_ONLY);
+
     /* confusing this global... */
     G.relbase_valid = 1;
     success = BKE_blendfile_read(
@@ -730,7 +734,8 @@ bool WM_file_read(bContext *C, const char *filepath, ReportList *reports)
          * Further it's just confusing if a user loads a file and various preferences change. */
         &(const struct BlendFileReadParams){
             .is_startup = false,
-            .skip_flags = BLO_READ_SKIP_USERDEF,
+            .skip_flags = BLO_READ_SKIP_USERDEF |
+                          (use_scene_only ? BLO_READ_SKIP_UNUSED_IDS : BLO_READ_SKIP_NONE),
         },
         reports);
 
@@ -1598,6 +1603,43 @@ void wm_autosave_location(char *filepath)
   BLI_join_dirfile(filepath, FILE_MAX, BKE_tempdir_base(), path);
 }
 
+/* Undo memfiles are auto-saved incrementally, to a journal next to the regular auto-save file. */
+static void wm_autosave_journal_location(const char *filepath, char *r_journal_filepath)
+{
+  BLI_strncpy(r_journal_filepath, filepath, FILE_MAX);
+  BLI_path_extension_replace(r_journal_filepath, FILE_MAX, BLO_MEMFILE_JOURNAL_EXT);
+}
+
+/**
+ * Turn the journals found next to the auto-save files into regular `.blend` files which can be
+ * recovered, unless the `.blend` file was saved after the journal.
+ */
+static void wm_autosave_journals_recover(const char *dirpath)
+{
+  struct direntry *files;
+  const uint files_len = BLI_filelist_dir_contents(dirpath, &files);
+
+  for (uint i = 0; i < files_len; i++) {
+    const char *journal_filepath = files[i].path;
+    if (!BLI_path_extension_check(journal_filepath, BLO_MEMFILE_JOURNAL_EXT)) {
+      continue;
+    }
+
+    char filepath[FILE_MAX];
+    BLI_strncpy(filepath, journal_filepath, sizeof(filepath));
+    BLI_path_extension_replace(filepath, sizeof(filepath), ".blend");
+    if (BLI_exists(filepath) && !BLI_file_older(filepath, journal_filepath)) {
+      continue;
+    }
+
+    if (!BLO_memfile_journal_recover(journal_filepath, filepath)) {
+      fprintf(stderr, "Unable to recover auto-save journal '%s'\n", journal_filepath);
+    }
+  }
+
+  BLI_filelist_free(files, files_len);
+}
+
 void WM_autosave_init(wmWindowManager *wm)
 {
   wm_autosave_timer_ended(wm);
@@ -1633,12 +1675,23 @@ void wm_autosave_timer(Main *bmain, wmWindowManager *wm, wmTimer *UNUSED(wt))
     /* fast save of last undobuffer, now with UI */
     struct MemFile *memfile = ED_undosys_stack_memfile_get_active(wm->undo_stack);
     if (memfile) {
-      BLO_memfile_write_file(memfile, filepath);
+      /* Only the parts that changed since the previous auto-save are written. */
+      char journal_filepath[FILE_MAX];
+      wm_autosave_journal_location(filepath, journal_filepath);
+      BLO_memfile_write_file_incremental(memfile, journal_filepath);
     }
   }
   else {
     /* Save as regular blend file. */
     const int fileflags = G.fileflags & ~G_FILE_COMPRESS;
+    char journal_filepath[FILE_MAX];
+
+    /* The journal of previous auto-saves is outdated now. */
+    BLO_memfile_journal_close();
+    wm_autosave_journal_location(filepath, journal_filepath);
+    if (BLI_exists(journal_filepath)) {
+      BLI_delete(journal_filepath, false, false);
+    }
 
     ED_editors_flush_edits(bmain);
 
@@ -1663,6 +1716,13 @@ void wm_autosave_delete(void)
 
   wm_autosave_location(filename);
 
+  char journal_filepath[FILE_MAX];
+  BLO_memfile_journal_close();
+  wm_autosave_journal_location(filename, journal_filepath);
+  if (BLI_exists(journal_filepath)) {
+    BLI_delete(journal_filepath, false, false);
+  }
+
   if (BLI_exists(filename)) {
     char str[FILE_MAX];
     BLI_join_dirfile(str, sizeof(str), BKE_tempdir_base(), BLENDER_QUIT_FILE);
@@ -1682,6 +1742,11 @@ void wm_autosave_read(bContext *C, ReportList *reports)
   char filename[FILE_MAX];
 
   wm_autosave_location(filename);
+
+  char dirpath[FILE_MAX];
+  BLI_split_dir_part(filename, dirpath, sizeof(dirpath));
+  wm_autosave_journals_recover(dirpath);
+
   WM_file_read(C, filename, reports);
 }
 
@@ -2630,6 +2695,12 @@ static int wm_recover_auto_save_invoke(bContext *C, wmOperator *op, const wmEven
   char filename[FILE_MAX];
 
   wm_autosave_location(filename);
+
+  /* Auto-saves of crashed sessions may only exist as journals. */
+  char dirpath[FILE_MAX];
+  BLI_split_dir_part(filename, dirpath, sizeof(dirpath));
+  wm_autosave_journals_recover(dirpath);
+
   RNA_string_set(op->ptr, "filepath", filename);
   WM_event_add_fileselect(C, op);
 
@@ -586,6 +586,8 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_args_print_arg_doc(ba, "--debug-depsgraph-no-threads");
   BLI_args_print_arg_doc(ba, "--debug-depsgraph-time");
   BLI_args_print_arg_doc(ba, "--debug-depsgraph-pretty");
+  BLI_args_print_arg_doc(ba, "--debug-depsgraph-trace");
+  BLI_args_print_arg_doc(ba, "--debug-compositor");
   BLI_args_print_arg_doc(ba, "--debug-gpu");
   BLI_args_print_arg_doc(ba, "--debug-gpumem");
   BLI_args_print_arg_doc(ba, "--debug-gpu-shaders");
@@ -607,6 +609,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   printf("Misc Options:\n");
   BLI_args_print_arg_doc(ba, "--app-template");
   BLI_args_print_arg_doc(ba, "--factory-startup");
+  BLI_args_print_arg_doc(ba, "--load-scene-only");
   BLI_args_print_arg_doc(ba, "--enable-event-simulate");
   printf("\n");
   BLI_args_print_arg_doc(ba, "--env-system-datafiles");
@@ -980,6 +983,15 @@ static const char arg_handle_debug_mode_generic_set_doc_depsgraph_no_threads[] =
 static const char arg_handle_debug_mode_generic_set_doc_depsgraph_pretty[] =
     "\n\t"
     "Enable colors for dependency graph debug messages.";
+static const char arg_handle_debug_mode_generic_set_doc_depsgraph_trace[] =
+    "\n\t"
+    "Write a Chrome trace of every dependency graph evaluation to the temporary directory.\n"
+    "\tThe trace shows the time and thread of every operation.";
+static const char arg_handle_debug_mode_generic_set_doc_compositor[] =
+    "\n\t"
+    "Enable compositor profiling, prints the timing of every execution and writes a Chrome trace "
+    "of it\n"
+    "\tto the temporary directory.";
 static const char arg_handle_debug_mode_generic_set_doc_gpumem[] =
     "\n\t"
     "Enable GPU memory stats in status bar.";
@@ -1117,6 +1129,19 @@ static int arg_handle_factory_startup_set(int UNUSED(argc),
   return 0;
 }
 
+static const char arg_handle_load_scene_only_set_doc[] =
+    "\n\t"
+    "Only load the data-blocks used by the active scene of blend-files opened in background mode.\n"
+    "\tThis speeds up loading large files for rendering,\n"
+    "\tthe file must not be saved afterwards since the unused data-blocks are missing.";
+static int arg_handle_load_scene_only_set(int UNUSED(argc),
+                                          const char **UNUSED(argv),
+                                          void *UNUSED(data))
+{
+  G.f |= G_FLAG_LOAD_SCENE_ONLY;
+  return 0;
+}
+
 static const char arg_handle_enable_event_simulate_doc[] =
     "\n\t"
     "Enable event simulation testing feature 'bpy.types.Window.event_simulate'.";
@@ -2160,6 +2185,16 @@ void main_args_setup(bContext *C, bArgs *ba)
                "--debug-depsgraph-uuid",
                CB_EX(arg_handle_debug_mode_generic_set, depsgraph_build),
                (void *)G_DEBUG_DEPSGRAPH_UUID);
+  BLI_args_add(ba,
+               NULL,
+               "--debug-depsgraph-trace",
+               CB_EX(arg_handle_debug_mode_generic_set, depsgraph_trace),
+               (void *)G_DEBUG_DEPSGRAPH_TRACE);
+  BLI_args_add(ba,
+               NULL,
+               "--debug-compositor",
+               CB_EX(arg_handle_debug_mode_generic_set, compositor),
+               (void *)G_DEBUG_COMPOSITOR);
   BLI_args_add(ba,
                NULL,
                "--debug-gpumem",
@@ -2181,6 +2216,7 @@ void main_args_setup(bContext *C, bArgs *ba)
 
   BLI_args_add(ba, NULL, "--app-template", CB(arg_handle_app_template), NULL);
   BLI_args_add(ba, NULL, "--factory-startup", CB(arg_handle_factory_startup_set), NULL);
+  BLI_args_add(ba, NULL, "--load-scene-only", CB(arg_handle_load_scene_only_set), NULL);
   BLI_args_add(ba, NULL, "--enable-event-simulate", CB(arg_handle_enable_event_simulate), NULL);
 
   /* Pass: Custom Window Stuff. */